@@ -43,6 +43,8 @@
 /* Select fingerprint sensor */
 #define CONFIG_FP_SENSOR_FPC1145
 #define CONFIG_CMD_FPSENSOR_DEBUG
+/* Nucleo-H753ZI boards have CRYP and HASH, Nucleo-H743ZI ones don't. */
+#define CONFIG_FP_CRYPTO_HW_ACCELERATE
 /* Special memory regions to store large arrays */
 #define FP_FRAME_SECTION __SECTION(ahb4)
 #define FP_TEMPLATE_SECTION __SECTION(ahb)
@@ -15,6 +15,9 @@ ifndef CONFIG_KEYBOARD_DISCRETE
 chip-$(HAS_TASK_KEYSCAN)+=keyboard_raw.o
 endif
 chip-$(CONFIG_USB_PD_TCPC)+=usb_pd_phy.o
+ifneq ($(HAS_TASK_HOSTCMD),)
+chip-$(CONFIG_HOST_INTERFACE_SOCKET)+=host_socket.o
+endif
 
 dirs-y += chip/host/dcrypto
 
@@ -0,0 +1,247 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Host command interface over a UNIX socket for the emulator.
+ *
+ * This lets host tools (e.g. ectool --socket) drive the full host
+ * packet path of a host build. The wire format is the plain protocol v3
+ * packet: the client writes a struct ec_host_request followed by its data,
+ * and we answer with a struct ec_host_response followed by its data.
+ * Requests are handled one at a time in the order they are received, so a
+ * client may queue several requests before reading the responses.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "host_test.h"
+#include "task.h"
+#include "test_util.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <pthread.h>
+#include <unistd.h>
+
+#define CPRINTS(format, args...) cprints(CC_HOSTCMD, format, ##args)
+
+/* Maximum packet sizes, including the request/response headers */
+#define HOST_SOCKET_PACKET_SIZE 1024
+
+static uint8_t request_buf[HOST_SOCKET_PACKET_SIZE];
+static uint8_t response_buf[HOST_SOCKET_PACKET_SIZE];
+static struct host_packet socket_packet;
+
+static int listen_fd = -1;
+static int conn_fd = -1;
+static pthread_t socket_thread;
+
+static pthread_mutex_t socket_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t response_sent = PTHREAD_COND_INITIALIZER;
+static int packet_received;
+static int packet_done;
+
+static int read_all(int fd, void *buf, size_t size)
+{
+	uint8_t *p = buf;
+	ssize_t n;
+
+	while (size) {
+		n = read(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static int write_all(int fd, const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+	ssize_t n;
+
+	while (size) {
+		n = write(fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static void socket_send_response(struct host_packet *pkt)
+{
+	/* A dead client is noticed by the next read */
+	write_all(conn_fd, pkt->response, pkt->response_size);
+
+	pthread_mutex_lock(&socket_mutex);
+	packet_done = 1;
+	pthread_cond_signal(&response_sent);
+	pthread_mutex_unlock(&socket_mutex);
+}
+
+static void socket_packet_interrupt(void)
+{
+	packet_received = 1;
+	host_packet_receive(&socket_packet);
+}
+
+/* Read one request from the client; return 0 on success */
+static int socket_read_request(void)
+{
+	const struct ec_host_request *r =
+		(const struct ec_host_request *)request_buf;
+	int size;
+
+	if (read_all(conn_fd, request_buf, sizeof(*r)))
+		return -1;
+
+	size = host_request_expected_size(r);
+	if (size == 0 || size > sizeof(request_buf)) {
+		/*
+		 * We can't find the start of the next packet in the stream,
+		 * so reject this one and drop the client.
+		 */
+		CPRINTS("socket: bad request header");
+		socket_packet.driver_result = EC_RES_REQUEST_TRUNCATED;
+		socket_packet.request_size = sizeof(*r);
+		return 1;
+	}
+
+	if (read_all(conn_fd, request_buf + sizeof(*r), size - sizeof(*r)))
+		return -1;
+
+	socket_packet.driver_result = EC_RES_SUCCESS;
+	socket_packet.request_size = size;
+	return 0;
+}
+
+static void socket_dispatch_request(void)
+{
+	packet_done = 0;
+	packet_received = 0;
+
+	/*
+	 * Emulated interrupts are dropped while interrupts are disabled, so
+	 * retry until the packet has been picked up.
+	 */
+	while (1) {
+		task_trigger_test_interrupt(socket_packet_interrupt);
+		if (packet_received)
+			break;
+		usleep(100);
+	}
+
+	pthread_mutex_lock(&socket_mutex);
+	while (!packet_done)
+		pthread_cond_wait(&response_sent, &socket_mutex);
+	pthread_mutex_unlock(&socket_mutex);
+}
+
+static void *socket_serve(void *arg)
+{
+	int rv;
+
+	/*
+	 * Events posted to a task before it first runs are dropped, so don't
+	 * take requests until the host command task is up.
+	 */
+	wait_for_task_started_nosleep();
+
+	while (1) {
+		conn_fd = accept(listen_fd, NULL, NULL);
+		if (conn_fd < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		do {
+			rv = socket_read_request();
+			if (rv >= 0)
+				socket_dispatch_request();
+		} while (rv == 0);
+
+		close(conn_fd);
+		conn_fd = -1;
+	}
+
+	return NULL;
+}
+
+int host_socket_open(const char *path)
+{
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+
+	if (listen_fd >= 0)
+		return EC_ERROR_BUSY;
+	if (strlen(path) >= sizeof(addr.sun_path))
+		return EC_ERROR_INVAL;
+	strcpy(addr.sun_path, path);
+
+	listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (listen_fd < 0)
+		return EC_ERROR_UNKNOWN;
+
+	unlink(path);
+	if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) ||
+	    listen(listen_fd, 1)) {
+		close(listen_fd);
+		listen_fd = -1;
+		return EC_ERROR_UNKNOWN;
+	}
+
+	socket_packet.send_response = socket_send_response;
+	socket_packet.request = request_buf;
+	socket_packet.request_temp = NULL;
+	socket_packet.request_max = sizeof(request_buf);
+	socket_packet.response = response_buf;
+	socket_packet.response_max = sizeof(response_buf);
+
+	pthread_create(&socket_thread, NULL, socket_serve, NULL);
+	CPRINTS("Host commands on socket %s", path);
+
+	return EC_SUCCESS;
+}
+
+static void host_socket_init(void)
+{
+	const char *path = getenv("EC_HOST_SOCKET");
+
+	if (path && host_socket_open(path))
+		CPRINTS("Can't listen on %s", path);
+}
+DECLARE_HOOK(HOOK_INIT, host_socket_init, HOOK_PRIO_DEFAULT);
+
+static enum ec_status
+host_socket_get_protocol_info(struct host_cmd_handler_args *args)
+{
+	struct ec_response_get_protocol_info *r = args->response;
+
+	memset(r, 0, sizeof(*r));
+	r->protocol_versions = BIT(3);
+	r->max_request_packet_size = HOST_SOCKET_PACKET_SIZE;
+	r->max_response_packet_size = HOST_SOCKET_PACKET_SIZE;
+	r->flags = EC_PROTOCOL_INFO_IN_PROGRESS_SUPPORTED;
+
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_GET_PROTOCOL_INFO, host_socket_get_protocol_info,
+		     EC_VER_MASK(0));
@@ -14,4 +14,16 @@
 /* Get emulator executable name */
 const char *__get_prog_name(void);
 
+/**
+ * Serve host command packets on a UNIX socket.
+ *
+ * This is done automatically at init if the EC_HOST_SOCKET environment
+ * variable names the socket path. Only available with
+ * CONFIG_HOST_INTERFACE_SOCKET.
+ *
+ * @param path		Path of the socket to create
+ * @return EC_SUCCESS, or non-zero on error.
+ */
+int host_socket_open(const char *path);
+
 #endif /* __CROS_EC_HOST_TEST_H */
@@ -413,7 +413,7 @@ void lpc_kbc_obe_interrupt(void)
 	}
 #endif
 
-	task_wake(TASK_ID_KEYPROTO);
+	keyboard_host_read();
 }
 #endif /* HAS_TASK_KEYPROTO */
 
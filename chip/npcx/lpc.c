@@ -557,7 +557,7 @@ static void lpc_kbc_obe_interrupt(void)
 
 	NPCX_HIKMST &= ~I8042_AUX_DATA;
 
-	task_wake(TASK_ID_KEYPROTO);
+	keyboard_host_read();
 }
 DECLARE_IRQ(NPCX_IRQ_KBC_OBE, lpc_kbc_obe_interrupt, 4);
 #endif
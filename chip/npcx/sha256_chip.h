@@ -20,6 +20,4 @@ struct sha256_ctx {
 	uint8_t buf[SHA256_BLOCK_SIZE];
 } __aligned(4);
 
-void SHA256_abort(struct sha256_ctx *ctx);
-
 #endif /* __CROS_EC_SHA256_CHIP_H */
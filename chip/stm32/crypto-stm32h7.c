@@ -0,0 +1,332 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * Fingerprint crypto backend on the CRYP and HASH peripherals, found on the
+ * STM32H7x3 variants with crypto (e.g. STM32H753, not STM32H743).
+ */
+
+#include "builtin/endian.h"
+#include "common.h"
+#include "fpsensor_crypto_backend.h"
+#include "registers.h"
+#include "sha256.h"
+#include "util.h"
+
+#define CRYPTO_AHB2ENR (STM32_RCC_AHB2ENR_CRYPTEN | STM32_RCC_AHB2ENR_HASHEN)
+
+/* Polls of a status bit before giving up: a block takes < 100 cycles. */
+#define CRYPTO_TRIES 10000
+
+#define CRYP_BLOCK_SIZE 16
+
+static uint32_t get_be32(const uint8_t *p)
+{
+	uint32_t v;
+
+	memcpy(&v, p, sizeof(v));
+	return be32toh(v);
+}
+
+static enum ec_error_list cryp_wait(uint32_t mask, uint32_t value)
+{
+	int tries = CRYPTO_TRIES;
+
+	while ((STM32_CRYP_SR & mask) != value)
+		if (!--tries)
+			return EC_ERROR_TIMEOUT;
+	return EC_SUCCESS;
+}
+
+static enum ec_error_list hash_wait(uint32_t mask, uint32_t value)
+{
+	int tries = CRYPTO_TRIES;
+
+	while ((STM32_HASH_SR & mask) != value)
+		if (!--tries)
+			return EC_ERROR_TIMEOUT;
+	return EC_SUCCESS;
+}
+
+/* Start CRYP in a mode, with a key and an IV, its FIFOs flushed. */
+static void cryp_start(uint32_t cr, const uint8_t *key, int key_size,
+		       const uint32_t iv[4])
+{
+	int first = 8 - key_size / 4;
+	int i;
+
+	STM32_CRYP_CR = cr;
+	/* The key ends in K3RR, whatever its size. */
+	for (i = 0; i < key_size / 4; i++)
+		STM32_CRYP_KR(first + i) = get_be32(key + 4 * i);
+	for (i = 0; i < 4; i++)
+		STM32_CRYP_IVR(i) = iv[i];
+	STM32_CRYP_CR = cr | STM32_CRYP_CR_FFLUSH;
+	STM32_CRYP_CR = cr | STM32_CRYP_CR_CRYPEN;
+}
+
+/*
+ * Run data through CRYP, a block at a time. In GCM, a partial last block
+ * is zero padded and the number of padding bytes set, for the tag.
+ */
+static enum ec_error_list cryp_process(const uint8_t *in, uint8_t *out,
+				       size_t size, bool gcm)
+{
+	uint32_t block[CRYP_BLOCK_SIZE / 4];
+	enum ec_error_list ret;
+	int i;
+
+	while (size) {
+		size_t n = MIN(size, (size_t)CRYP_BLOCK_SIZE);
+
+		memset(block, 0, sizeof(block));
+		memcpy(block, in, n);
+		if (gcm && n < CRYP_BLOCK_SIZE)
+			STM32_CRYP_CR = (STM32_CRYP_CR &
+					 ~STM32_CRYP_CR_NPBLB_MASK) |
+					((CRYP_BLOCK_SIZE - n)
+					 << STM32_CRYP_CR_NPBLB_SHIFT);
+
+		/* With 8 bit data, the bytes go in and out in memory order. */
+		for (i = 0; i < ARRAY_SIZE(block); i++) {
+			ret = cryp_wait(STM32_CRYP_SR_IFNF, STM32_CRYP_SR_IFNF);
+			if (ret)
+				return ret;
+			STM32_CRYP_DIN = block[i];
+		}
+		for (i = 0; i < ARRAY_SIZE(block); i++) {
+			ret = cryp_wait(STM32_CRYP_SR_OFNE, STM32_CRYP_SR_OFNE);
+			if (ret)
+				return ret;
+			block[i] = STM32_CRYP_DOUT;
+		}
+		memcpy(out, block, n);
+
+		in += n;
+		out += n;
+		size -= n;
+	}
+	return cryp_wait(STM32_CRYP_SR_BUSY, 0);
+}
+
+static enum ec_error_list cryp_gcm(const uint8_t *key, int key_size,
+				   const uint8_t *in, uint8_t *out,
+				   int text_size, const uint8_t *nonce,
+				   uint8_t *tag, bool decrypt)
+{
+	uint32_t cr = STM32_CRYP_CR_ALGOMODE_AES_GCM |
+		      STM32_CRYP_CR_DATATYPE_8;
+	uint32_t iv[4];
+	uint32_t block[CRYP_BLOCK_SIZE / 4];
+	enum ec_error_list ret;
+	int tries = CRYPTO_TRIES;
+	int i;
+
+	if (key_size == 32)
+		cr |= STM32_CRYP_CR_KEYSIZE_256;
+	else if (key_size == 16)
+		cr |= STM32_CRYP_CR_KEYSIZE_128;
+	else
+		return EC_ERROR_INVAL;
+
+	/* The 96-bit nonce, then the counter of the first payload block. */
+	for (i = 0; i < 3; i++)
+		iv[i] = get_be32(nonce + 4 * i);
+	iv[3] = 2;
+
+	/* Init phase: CRYPEN drops once the hash key is computed. */
+	cryp_start(cr | STM32_CRYP_CR_GCM_CCMPH_INIT, key, key_size, iv);
+	while (STM32_CRYP_CR & STM32_CRYP_CR_CRYPEN)
+		if (!--tries) {
+			ret = EC_ERROR_TIMEOUT;
+			goto out;
+		}
+
+	/* No additional data: straight to the payload phase. */
+	STM32_CRYP_CR = cr | STM32_CRYP_CR_GCM_CCMPH_PAYLOAD |
+			(decrypt ? STM32_CRYP_CR_ALGODIR : 0);
+	STM32_CRYP_CR |= STM32_CRYP_CR_CRYPEN;
+	ret = cryp_process(in, out, text_size, true);
+	if (ret)
+		goto out;
+
+	/* Final phase, always in the encrypt direction. */
+	STM32_CRYP_CR &= ~STM32_CRYP_CR_CRYPEN;
+	STM32_CRYP_CR = cr | STM32_CRYP_CR_GCM_CCMPH_FINAL;
+	STM32_CRYP_CR |= STM32_CRYP_CR_CRYPEN;
+	/* Bit lengths of the additional data and of the payload */
+	STM32_CRYP_DIN = 0;
+	STM32_CRYP_DIN = 0;
+	STM32_CRYP_DIN = 0;
+	STM32_CRYP_DIN = htobe32((uint32_t)text_size * 8);
+	for (i = 0; i < ARRAY_SIZE(block); i++) {
+		ret = cryp_wait(STM32_CRYP_SR_OFNE, STM32_CRYP_SR_OFNE);
+		if (ret)
+			goto out;
+		block[i] = STM32_CRYP_DOUT;
+	}
+	memcpy(tag, block, CRYP_BLOCK_SIZE);
+
+out:
+	STM32_CRYP_CR = 0;
+	memset(block, 0, sizeof(block));
+	return ret;
+}
+
+static enum ec_error_list hw_aes_gcm_encrypt(const uint8_t *key, int key_size,
+					     const uint8_t *in, uint8_t *out,
+					     int text_size,
+					     const uint8_t *nonce,
+					     uint8_t *tag, int tag_size)
+{
+	uint8_t full_tag[CRYP_BLOCK_SIZE];
+	enum ec_error_list ret;
+
+	if (tag_size > (int)sizeof(full_tag))
+		return EC_ERROR_INVAL;
+
+	ret = cryp_gcm(key, key_size, in, out, text_size, nonce, full_tag,
+		       false);
+	if (ret == EC_SUCCESS)
+		memcpy(tag, full_tag, tag_size);
+	return ret;
+}
+
+static enum ec_error_list hw_aes_gcm_decrypt(const uint8_t *key, int key_size,
+					     const uint8_t *in, uint8_t *out,
+					     int text_size,
+					     const uint8_t *nonce,
+					     const uint8_t *tag, int tag_size)
+{
+	uint8_t full_tag[CRYP_BLOCK_SIZE];
+	enum ec_error_list ret;
+
+	if (tag_size > (int)sizeof(full_tag))
+		return EC_ERROR_INVAL;
+
+	ret = cryp_gcm(key, key_size, in, out, text_size, nonce, full_tag,
+		       true);
+	if (ret == EC_SUCCESS && safe_memcmp(full_tag, tag, tag_size))
+		ret = EC_ERROR_UNKNOWN;
+	return ret;
+}
+
+static enum ec_error_list hw_aes_ctr(const uint8_t *key, const uint8_t *iv,
+				     uint8_t *data, size_t data_size)
+{
+	const uint32_t cr = STM32_CRYP_CR_ALGOMODE_AES_CTR |
+			    STM32_CRYP_CR_DATATYPE_8 |
+			    STM32_CRYP_CR_KEYSIZE_256;
+	uint32_t counter[4];
+	enum ec_error_list ret = EC_SUCCESS;
+	int i;
+
+	for (i = 0; i < 4; i++)
+		counter[i] = get_be32(iv + 4 * i);
+
+	/*
+	 * CRYP only counts on the low 32 bits: restart it with the carry
+	 * when they wrap.
+	 */
+	while (data_size && ret == EC_SUCCESS) {
+		uint64_t room = BIT_ULL(32) - counter[3];
+		size_t n = data_size;
+
+		if (room < DIV_ROUND_UP(data_size, CRYP_BLOCK_SIZE))
+			n = room * CRYP_BLOCK_SIZE;
+
+		cryp_start(cr, key, 32, counter);
+		ret = cryp_process(data, data, n, false);
+		STM32_CRYP_CR = 0;
+
+		data += n;
+		data_size -= n;
+		counter[3] += n / CRYP_BLOCK_SIZE;
+		for (i = 2; i >= 0 && !counter[i + 1]; i--)
+			counter[i]++;
+	}
+	return ret;
+}
+
+/* Feed data to HASH, then start the computation of what it was given. */
+static enum ec_error_list hash_feed(const uint8_t *data, int size)
+{
+	enum ec_error_list ret;
+	int i;
+
+	/* Number of valid bits in the last word */
+	STM32_HASH_STR = (size % 4) * 8;
+	for (i = 0; i < size; i += 4) {
+		uint32_t word = 0;
+
+		/* Let a block be processed before the FIFO overflows. */
+		ret = hash_wait(STM32_HASH_SR_BUSY, 0);
+		if (ret)
+			return ret;
+		memcpy(&word, data + i, MIN(size - i, 4));
+		STM32_HASH_DIN = word;
+	}
+	STM32_HASH_STR |= STM32_HASH_STR_DCAL;
+	return EC_SUCCESS;
+}
+
+static void hw_hmac_sha256(uint8_t *output, const uint8_t *key, int key_len,
+			   const uint8_t *message, int message_len)
+{
+	enum ec_error_list ret;
+	int i;
+
+	STM32_HASH_CR = STM32_HASH_CR_INIT | STM32_HASH_CR_MODE_HMAC |
+			STM32_HASH_CR_ALGO_SHA256 | STM32_HASH_CR_DATATYPE_8 |
+			(key_len > SHA256_BLOCK_SIZE ? STM32_HASH_CR_LKEY : 0);
+
+	/* Inner hash of the key then the message, outer hash of the key */
+	ret = hash_feed(key, key_len);
+	if (!ret)
+		ret = hash_wait(STM32_HASH_SR_BUSY, 0);
+	if (!ret)
+		ret = hash_feed(message, message_len);
+	if (!ret)
+		ret = hash_wait(STM32_HASH_SR_BUSY, 0);
+	if (!ret)
+		ret = hash_feed(key, key_len);
+	if (!ret)
+		ret = hash_wait(STM32_HASH_SR_DCIS, STM32_HASH_SR_DCIS);
+
+	if (ret) {
+		/* The caller can't take an error: do it in software. */
+		fp_crypto_software.hmac_sha256(output, key, key_len, message,
+					       message_len);
+		return;
+	}
+
+	for (i = 0; i < SHA256_DIGEST_SIZE / 4; i++) {
+		uint32_t word = htobe32(STM32_HASH_HR(i));
+
+		memcpy(output + 4 * i, &word, sizeof(word));
+	}
+	/* Start over, so that the digest doesn't stay in the registers. */
+	STM32_HASH_CR = STM32_HASH_CR_INIT;
+}
+
+static enum ec_error_list hw_init(void)
+{
+	/* The enable bits of missing peripherals are reserved, they read 0. */
+	STM32_RCC_AHB2ENR |= CRYPTO_AHB2ENR;
+	if ((STM32_RCC_AHB2ENR & CRYPTO_AHB2ENR) != CRYPTO_AHB2ENR) {
+		STM32_RCC_AHB2ENR &= ~CRYPTO_AHB2ENR;
+		return EC_ERROR_UNIMPLEMENTED;
+	}
+	return EC_SUCCESS;
+}
+
+const struct fp_crypto_backend fp_crypto_hardware = {
+	.name = "STM32H7 CRYP/HASH",
+	.init = hw_init,
+	.aes_gcm_encrypt = hw_aes_gcm_encrypt,
+	.aes_gcm_decrypt = hw_aes_gcm_decrypt,
+	.aes_ctr = hw_aes_ctr,
+	.hmac_sha256 = hw_hmac_sha256,
+};
@@ -187,6 +187,8 @@
 
 #define STM32_PWR_BASE 0x58024800
 #define STM32_RCC_BASE 0x58024400
+#define STM32_CRYP_BASE 0x48021000
+#define STM32_HASH_BASE 0x48021400
 #define STM32_RNG_BASE 0x48021800
 #define STM32_RTC_BASE 0x58004000
 
@@ -1128,6 +1130,49 @@ enum dmamux1_request {
 #define STM32_RNG_SR_DRDY BIT(0)
 #define STM32_RNG_DR REG32(STM32_RNG_BASE + 0x8)
 
+/* --- CRYP (STM32H7x3 variants with crypto only) --- */
+#define STM32_CRYP_CR REG32(STM32_CRYP_BASE + 0x00)
+#define STM32_CRYP_CR_ALGODIR BIT(2)
+#define STM32_CRYP_CR_ALGOMODE_MASK (BIT(19) | (7 << 3))
+#define STM32_CRYP_CR_ALGOMODE_AES_CTR (6 << 3)
+#define STM32_CRYP_CR_ALGOMODE_AES_GCM BIT(19)
+#define STM32_CRYP_CR_DATATYPE_8 (2 << 6)
+#define STM32_CRYP_CR_KEYSIZE_128 (0 << 8)
+#define STM32_CRYP_CR_KEYSIZE_256 (2 << 8)
+#define STM32_CRYP_CR_FFLUSH BIT(14)
+#define STM32_CRYP_CR_CRYPEN BIT(15)
+#define STM32_CRYP_CR_GCM_CCMPH_MASK (3 << 16)
+#define STM32_CRYP_CR_GCM_CCMPH_INIT (0 << 16)
+#define STM32_CRYP_CR_GCM_CCMPH_PAYLOAD (2 << 16)
+#define STM32_CRYP_CR_GCM_CCMPH_FINAL (3 << 16)
+#define STM32_CRYP_CR_NPBLB_SHIFT 20
+#define STM32_CRYP_CR_NPBLB_MASK (0xF << 20)
+#define STM32_CRYP_SR REG32(STM32_CRYP_BASE + 0x04)
+#define STM32_CRYP_SR_IFNF BIT(1)
+#define STM32_CRYP_SR_OFNE BIT(2)
+#define STM32_CRYP_SR_BUSY BIT(4)
+#define STM32_CRYP_DIN REG32(STM32_CRYP_BASE + 0x08)
+#define STM32_CRYP_DOUT REG32(STM32_CRYP_BASE + 0x0C)
+/* Key words, K0LR (n = 0) to K3RR (n = 7), most significant first */
+#define STM32_CRYP_KR(n) REG32(STM32_CRYP_BASE + 0x20 + 4 * (n))
+/* IV words, IV0LR (n = 0) to IV1RR (n = 3), most significant first */
+#define STM32_CRYP_IVR(n) REG32(STM32_CRYP_BASE + 0x40 + 4 * (n))
+
+/* --- HASH (STM32H7x3 variants with crypto only) --- */
+#define STM32_HASH_CR REG32(STM32_HASH_BASE + 0x00)
+#define STM32_HASH_CR_INIT BIT(2)
+#define STM32_HASH_CR_DATATYPE_8 (2 << 4)
+#define STM32_HASH_CR_MODE_HMAC BIT(6)
+#define STM32_HASH_CR_ALGO_SHA256 (BIT(18) | BIT(7))
+#define STM32_HASH_CR_LKEY BIT(16)
+#define STM32_HASH_DIN REG32(STM32_HASH_BASE + 0x04)
+#define STM32_HASH_STR REG32(STM32_HASH_BASE + 0x08)
+#define STM32_HASH_STR_DCAL BIT(8)
+#define STM32_HASH_SR REG32(STM32_HASH_BASE + 0x24)
+#define STM32_HASH_SR_DCIS BIT(1)
+#define STM32_HASH_SR_BUSY BIT(3)
+#define STM32_HASH_HR(n) REG32(STM32_HASH_BASE + 0x310 + 4 * (n))
+
 /* --- AXI interconnect --- */
 
 /* STM32H7: AXI_TARGx_FN_MOD exists for masters x = 1, 2 and 7 */
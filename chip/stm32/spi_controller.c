@@ -448,6 +448,16 @@ int spi_transaction_wait(const struct spi_device_t *spi_device)
 	return spi_dma_wait(spi_device->port);
 }
 
+void spi_transaction_lock(const struct spi_device_t *spi_device)
+{
+	mutex_lock(spi_mutex + spi_device->port);
+}
+
+void spi_transaction_unlock(const struct spi_device_t *spi_device)
+{
+	mutex_unlock(spi_mutex + spi_device->port);
+}
+
 int spi_transaction(const struct spi_device_t *spi_device,
 		    const uint8_t *txdata, int txlen, uint8_t *rxdata,
 		    int rxlen)
@@ -102,11 +102,88 @@ static int usb_power_write_line(struct usb_power_config const *config)
 	return 0;
 }
 
+static uint8_t *usb_power_put_varint(uint8_t *p, uint32_t value)
+{
+	while (value >= 0x80) {
+		*p++ = value | 0x80;
+		value >>= 7;
+	}
+	*p++ = value;
+	return p;
+}
+
+static uint32_t usb_power_zigzag(int32_t value)
+{
+	return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+/*
+ * Pack as many power records as fit into one frame and write it to USB.
+ * Records are copied out, so their slots are free again right away.
+ */
+static int usb_power_write_packed(struct usb_power_config const *config)
+{
+	struct usb_power_state *state = config->state;
+	struct usb_power_packed_frame *f =
+		(struct usb_power_packed_frame *)state->packed_buf;
+	const uint8_t *end = state->packed_buf + sizeof(state->packed_buf);
+	/* A time delta and the worst case delta of each INA. */
+	const int set_max = 5 + 3 * state->ina_count;
+	struct usb_power_report *prev = NULL;
+	uint8_t *p = f->data;
+	int sets = 0;
+	int i;
+
+	if (state->reports_head == state->reports_tail)
+		return 0;
+
+	while (state->reports_tail != state->reports_head && sets < 255 &&
+	       end - p >= set_max) {
+		struct usb_power_report *r =
+			(struct usb_power_report *)&state->reports_data_area
+				[state->stride_bytes * state->reports_tail];
+
+		if (prev)
+			p = usb_power_put_varint(
+				p, usb_power_zigzag(r->timestamp -
+						    prev->timestamp -
+						    state->integration_us));
+		else
+			f->timestamp = r->timestamp;
+
+		for (i = 0; i < state->ina_count; i++) {
+			int32_t delta = (int16_t)r->power[i];
+
+			if (prev)
+				delta -= (int16_t)prev->power[i];
+			p = usb_power_put_varint(p, usb_power_zigzag(delta));
+		}
+
+		prev = r;
+		sets++;
+		state->reports_tail =
+			(state->reports_tail + 1) % state->max_cached;
+	}
+	state->reports_xmit_active = state->reports_tail;
+
+	f->status = USB_POWER_SUCCESS;
+	f->size = state->ina_count;
+	f->sets = sets;
+	f->missed = MIN(state->missed, 255);
+	state->missed = 0;
+	f->length = p - f->data;
+
+	usb_write_ep(config->endpoint, p - state->packed_buf,
+		     state->packed_buf);
+	return p - state->packed_buf;
+}
+
 static int usb_power_state_reset(struct usb_power_config const *config)
 {
 	struct usb_power_state *state = config->state;
 
 	state->state = USB_POWER_STATE_OFF;
+	state->format = USB_POWER_FORMAT_RECORDS;
 	state->reports_head = 0;
 	state->reports_tail = 0;
 	state->reports_xmit_active = 0;
@@ -172,6 +249,8 @@ static int usb_power_state_start(struct usb_power_config const *config,
 
 	/* Find our starting time. */
 	config->state->base_time = get_time().val;
+	state->next_sample = state->base_time + state->integration_us;
+	state->missed = 0;
 
 	hook_call_deferred(config->deferred_cap, state->integration_us);
 	return USB_POWER_SUCCESS;
@@ -195,6 +274,34 @@ static int usb_power_state_settime(struct usb_power_config const *config,
 	return USB_POWER_SUCCESS;
 }
 
+static int usb_power_state_setformat(struct usb_power_config const *config,
+				     union usb_power_command_data *cmd,
+				     int count)
+{
+	struct usb_power_state *state = config->state;
+
+	if (state->state == USB_POWER_STATE_CAPTURING) {
+		CPRINTS("[SETFORMAT] Error capturing.");
+		return USB_POWER_ERROR_BUSY;
+	}
+
+	if (count != sizeof(struct usb_power_command_setformat)) {
+		CPRINTS("[SETFORMAT] Error count %d is not %d", (int)count,
+			sizeof(struct usb_power_command_setformat));
+		return USB_POWER_ERROR_READ_SIZE;
+	}
+
+	if (cmd->setformat.format != USB_POWER_FORMAT_RECORDS &&
+	    cmd->setformat.format != USB_POWER_FORMAT_PACKED) {
+		CPRINTS("[SETFORMAT] Error format 0x%x invalid",
+			(int)cmd->setformat.format);
+		return USB_POWER_ERROR_INVAL;
+	}
+
+	state->format = cmd->setformat.format;
+	return USB_POWER_SUCCESS;
+}
+
 static int usb_power_state_addina(struct usb_power_config const *config,
 				  union usb_power_command_data *cmd, int count)
 {
@@ -327,11 +434,18 @@ static int usb_power_read(struct usb_power_config const *config)
 		result = usb_power_state_settime(config, cmd, count);
 		break;
 
+	case USB_POWER_CMD_SETFORMAT:
+		result = usb_power_state_setformat(config, cmd, count);
+		break;
+
 	case USB_POWER_CMD_NEXT:
 		if (state->state == USB_POWER_STATE_CAPTURING) {
 			int ret;
 
-			ret = usb_power_write_line(config);
+			if (state->format == USB_POWER_FORMAT_PACKED)
+				ret = usb_power_write_packed(config);
+			else
+				ret = usb_power_write_line(config);
 			if (ret)
 				return EC_SUCCESS;
 
@@ -681,17 +795,22 @@ static int usb_power_get_samples(struct usb_power_config const *config)
  * This function is called every [interval] uS, and reads the accumulated
  * values of the INAs, and reschedules itself for the next interval.
  *
+ * Sample times stay on a grid of the integration time from the start of
+ * the capture, which is also when the INAs finish their conversions, so
+ * that late deferred calls do not add up into drift.  If sampling falls a
+ * whole interval behind, the sample times missed are skipped and counted.
+ *
  * It will stop collecting frames if a ringbuffer overflow is
  * detected, or a stop request is seen..
  */
 void usb_power_deferred_cap(struct usb_power_config const *config)
 {
+	struct usb_power_state *state = config->state;
 	int ret;
-	uint64_t timeout = get_time().val + config->state->integration_us;
 	uint64_t timein;
 
 	/* Exit if we have stopped capturing in the meantime. */
-	if (config->state->state != USB_POWER_STATE_CAPTURING)
+	if (state->state != USB_POWER_STATE_CAPTURING)
 		return;
 
 	/* Get samples for this timeslice */
@@ -703,12 +822,14 @@ void usb_power_deferred_cap(struct usb_power_config const *config)
 
 	/* Calculate time remaining until next slice. */
 	timein = get_time().val;
-	if (timeout > timein)
-		timeout = timeout - timein;
-	else
-		timeout = 0;
+	state->next_sample += state->integration_us;
+	while (state->next_sample <= timein) {
+		state->next_sample += state->integration_us;
+		state->missed++;
+	}
 
 	/* Double check if we are still capturing. */
-	if (config->state->state == USB_POWER_STATE_CAPTURING)
-		hook_call_deferred(config->deferred_cap, timeout);
+	if (state->state == USB_POWER_STATE_CAPTURING)
+		hook_call_deferred(config->deferred_cap,
+				   state->next_sample - timein);
 }
@@ -67,6 +67,30 @@
  *     | 0x0005 | 8B: Wall clock time |
  *     +--------+---------------------+
  *
+ *     setformat:	0x0006
+ *     +--------+------------+
+ *     | 0x0006 | 1B: format |
+ *     +--------+------------+
+ *
+ *     Selects the format of the next responses, before start. Reset goes
+ *     back to records.
+ *
+ *     next response, packed format:
+ *     +-------------+----------+----------+------------+-------------+
+ *     | status : 1B | size: 1B | sets: 1B | missed: 1B | length : 2B |
+ *     +-------------+----------+----------+------------+-------------+
+ *     +----------------+-----------------------+
+ *     | timestamp : 8B | packed sets: length B |
+ *     +----------------+-----------------------+
+ *
+ *     A frame holds sets of one reading of each INA, taken at the same
+ *     time, oldest first.  Each set but the first starts with the time
+ *     since the previous set minus the integration time, then has the
+ *     reading of each INA minus its reading in the previous set (minus
+ *     zero in the first set), all as zigzag encoded varints: the value is
+ *     (v << 1) ^ (v >> 31), in groups of 7 bits, least significant first,
+ *     with bit 7 set on all bytes but the last.
+ *
  *
  *     Status: 1 byte status
  *
@@ -85,7 +109,15 @@
  *
  *     size: 1 byte incoming INA reads count
  *
- *     timestamp: 4 byte timestamp associated with these samples
+ *     sets: 1 byte count of sets in a packed frame
+ *
+ *     missed: 1 byte count of sample times skipped since the last packed
+ *	 frame because sampling fell behind, saturated at 255
+ *
+ *     length: 2 byte count of packed bytes after the timestamp
+ *
+ *     timestamp: 8 byte timestamp associated with these samples, or the
+ *	 first set of a packed frame
  *
  */
 
@@ -112,6 +144,15 @@ enum usb_power_command {
 	USB_POWER_CMD_START = 0x0003,
 	USB_POWER_CMD_NEXT = 0x0004,
 	USB_POWER_CMD_SETTIME = 0x0005,
+	USB_POWER_CMD_SETFORMAT = 0x0006,
+};
+
+/* Setformat "format" field. */
+enum usb_power_format {
+	/* One fixed size record per sample time. */
+	USB_POWER_FORMAT_RECORDS = 0x00,
+	/* Delta packed frames of several sample times. */
+	USB_POWER_FORMAT_PACKED = 0x01,
 };
 
 /* Addina "INA Type" field. */
@@ -162,6 +203,19 @@ struct __attribute__((__packed__)) usb_power_report {
 	uint16_t power[USB_POWER_MAX_READ_COUNT];
 };
 
+struct __attribute__((__packed__)) usb_power_packed_frame {
+	uint8_t status;
+	uint8_t size;
+	uint8_t sets;
+	uint8_t missed;
+	uint16_t length;
+	uint64_t timestamp;
+	uint8_t data[];
+};
+
+/* Largest packed frame, the most the host reads per command. */
+#define USB_POWER_PACKED_SIZE 512
+
 /* Must be 4 byte aligned */
 #define USB_POWER_RECORD_SIZE(ina_count)                    \
 	((((sizeof(struct usb_power_report) -               \
@@ -187,8 +241,14 @@ struct usb_power_state {
 	struct usb_power_ina_cfg ina_cfg[USB_POWER_MAX_READ_COUNT];
 	int ina_count;
 	int integration_us;
+	/* enum usb_power_format of the next responses. */
+	int format;
 	/* Start of sampling. */
 	uint64_t base_time;
+	/* When the next samples are due, on the integration time grid. */
+	uint64_t next_sample;
+	/* Sample times skipped since the last packed frame. */
+	int missed;
 	/* Offset between microcontroller timestamp and host wall clock. */
 	uint64_t wall_offset;
 
@@ -212,6 +272,8 @@ struct usb_power_state {
 	/* Pointers to RAM. */
 	uint8_t rx_buf[USB_MAX_PACKET_SIZE];
 	uint8_t tx_buf[USB_MAX_PACKET_SIZE * 4];
+	/* Packed frame being sent on USB. */
+	uint8_t packed_buf[USB_POWER_PACKED_SIZE];
 };
 
 /*
@@ -254,11 +316,17 @@ struct __attribute__((__packed__)) usb_power_command_settime {
 	uint64_t time;
 };
 
+struct __attribute__((__packed__)) usb_power_command_setformat {
+	uint16_t command;
+	uint8_t format;
+};
+
 union usb_power_command_data {
 	uint16_t command;
 	struct usb_power_command_start start;
 	struct usb_power_command_addina addina;
 	struct usb_power_command_settime settime;
+	struct usb_power_command_setformat setformat;
 };
 
 /*
@@ -328,6 +328,9 @@ static void create_spi_config_response(struct usb_spi_packet_ctx *packet)
 	if (current_device->usb_flags & USB_SPI_FLASH_DTR_SUPPORT)
 		packet->rsp_config.feature_bitmap |=
 			USB_SPI_FEATURE_DTR_SUPPORTED;
+#ifdef CONFIG_USB_SPI_POSTED_WRITES
+	packet->rsp_config.feature_bitmap |= USB_SPI_FEATURE_POSTED_WRITES;
+#endif
 #else
 	(void)current_device; /* Avoid warning about unused variable. */
 #endif
@@ -388,6 +391,281 @@ usb_spi_create_spi_transfer_response(struct usb_spi_packet_ctx *transmit_packet)
 	}
 }
 
+/*
+ * Run a transaction on the device, through the board driver if the device
+ * has a custom one.  Flash flags are only used by board drivers.
+ */
+static int usb_spi_transaction(const struct spi_device_t *device,
+			       uint32_t flash_flags, const uint8_t *txdata,
+			       int txlen, uint8_t *rxdata, int rxlen)
+{
+	if (device->usb_flags & USB_SPI_CUSTOM_SPI_DEVICE)
+		return usb_spi_board_transaction(device, flash_flags, txdata,
+						 txlen, rxdata, rxlen);
+
+	return spi_transaction(device, txdata, txlen, rxdata, rxlen);
+}
+
+#ifdef CONFIG_USB_SPI_POSTED_WRITES
+#ifndef CONFIG_USB_SPI_FLASH_EXTENSIONS
+#error "CONFIG_USB_SPI_POSTED_WRITES requires CONFIG_USB_SPI_FLASH_EXTENSIONS"
+#endif
+
+/* How long to leave a posted write on the SPI bus before checking on it. */
+#define POSTED_POLL_INTERVAL_USEC 50
+
+enum posted_phase {
+	/* The write at the head of the queue has not been started. */
+	POSTED_IDLE = 0,
+	/* The main transaction is on the bus, through DMA. */
+	POSTED_TRANSFER,
+	/* Waiting for the flash to clear its busy bit. */
+	POSTED_POLL,
+};
+
+struct posted_write {
+	uint32_t flash_flags;
+	uint16_t write_count;
+	uint8_t device_idx;
+};
+
+/*
+ * Flash writes acknowledged to the host but not done yet, oldest first.
+ * Each entry owns the buffer of the same index until it is done.
+ *
+ * The SPI port stays locked from the write enable of a posted write to the
+ * end of its busy polling, across deferred calls, so that no other
+ * transaction gets in between.
+ */
+static struct {
+	struct posted_write queue[CONFIG_USB_SPI_POSTED_DEPTH];
+	uint8_t head;
+	uint8_t count;
+	enum posted_phase phase;
+	timestamp_t deadline;
+	/* Device whose SPI port is locked, or NULL. */
+	const struct spi_device_t *locked;
+	/* Failure of a posted write, reported to the next transfer. */
+	uint16_t status_code;
+} posted;
+
+static uint16_t posted_buffers_[CONFIG_USB_SPI_POSTED_DEPTH]
+			       [(USB_SPI_BUFFER_SIZE + 1) / 2];
+
+static inline int posted_tail(void)
+{
+	return (posted.head + posted.count) % CONFIG_USB_SPI_POSTED_DEPTH;
+}
+
+static void posted_write_done(int rv)
+{
+	if (posted.locked) {
+		spi_transaction_unlock(posted.locked);
+		posted.locked = NULL;
+	}
+
+	if (rv == EC_SUCCESS) {
+		posted.head = (posted.head + 1) % CONFIG_USB_SPI_POSTED_DEPTH;
+		posted.count--;
+	} else {
+		/*
+		 * Drop the writes queued after a failure, keeping the tail
+		 * where it is: a posted write may be coming in there.
+		 */
+		posted.status_code = usb_spi_map_error(rv);
+		posted.head = posted_tail();
+		posted.count = 0;
+	}
+	posted.phase = POSTED_IDLE;
+}
+
+/*
+ * Run a transaction of a posted write, on a port already locked unless the
+ * device has a custom board driver.
+ */
+static int posted_transaction(const struct spi_device_t *device,
+			      const uint8_t *txdata, int txlen,
+			      uint8_t *rxdata, int rxlen)
+{
+	int rv;
+
+	if (device->usb_flags & USB_SPI_CUSTOM_SPI_DEVICE)
+		return usb_spi_board_transaction(device, 0, txdata, txlen,
+						 rxdata, rxlen);
+
+	rv = spi_transaction_async(device, txdata, txlen, rxdata, rxlen);
+	rv |= spi_transaction_flush(device);
+	return rv;
+}
+
+/*
+ * Start the write at the head of the queue.  With the standard SPI driver,
+ * the main transaction is left running on DMA; board drivers complete it
+ * before returning.
+ */
+static int posted_write_start(const struct spi_device_t *device,
+			      const struct posted_write *w, uint8_t *buffer)
+{
+	const uint8_t *txdata = buffer;
+	int txlen = w->write_count;
+	int rv;
+
+	if (w->flash_flags & FLASH_FLAG_WRITE_ENABLE) {
+		rv = posted_transaction(device, txdata, 1, NULL, 0);
+		if (rv != EC_SUCCESS)
+			return rv;
+		txdata++;
+		txlen--;
+	}
+
+	if (device->usb_flags & USB_SPI_CUSTOM_SPI_DEVICE)
+		return usb_spi_board_transaction(device, w->flash_flags, txdata,
+						 txlen, NULL, 0);
+#ifdef CONFIG_SPI_HALFDUPLEX
+	return spi_transaction_async(device, txdata, txlen, NULL, 0);
+#else
+	/*
+	 * Read back into the buffer itself, behind the bytes going out,
+	 * rather than into shared memory which the driver releases before
+	 * the DMA is done.
+	 */
+	return spi_transaction_async(device, txdata, txlen, buffer,
+				     SPI_READBACK_ALL);
+#endif
+}
+
+/*
+ * Carry out posted writes until no more than keep are left.  Unless wait is
+ * set, return instead of waiting on the SPI bus or the flash, with the
+ * deferred scheduled to pick up from there: USB packets are handled
+ * meanwhile.
+ */
+static void usb_spi_posted_run(bool wait, int keep)
+{
+	while (posted.count > keep) {
+		const struct posted_write *w = &posted.queue[posted.head];
+		const struct spi_device_t *device =
+			&spi_devices[w->device_idx];
+		const bool custom_board_driver = device->usb_flags &
+						 USB_SPI_CUSTOM_SPI_DEVICE;
+		uint8_t status_byte;
+		int rv;
+
+		switch (posted.phase) {
+		case POSTED_IDLE:
+			if (!custom_board_driver) {
+				spi_transaction_lock(device);
+				posted.locked = device;
+			}
+			rv = posted_write_start(
+				device, w,
+				(uint8_t *)posted_buffers_[posted.head]);
+			if (rv != EC_SUCCESS) {
+				if (!custom_board_driver)
+					spi_transaction_flush(device);
+				posted_write_done(rv);
+				break;
+			}
+			posted.phase = POSTED_TRANSFER;
+			if (!wait && !custom_board_driver) {
+				hook_call_deferred(usb_spi.deferred,
+						   POSTED_POLL_INTERVAL_USEC);
+				return;
+			}
+			break;
+		case POSTED_TRANSFER:
+			rv = custom_board_driver ?
+				     EC_SUCCESS :
+				     spi_transaction_flush(device);
+			if (rv != EC_SUCCESS ||
+			    !(w->flash_flags & FLASH_FLAG_POLL)) {
+				posted_write_done(rv);
+				break;
+			}
+			posted.phase = POSTED_POLL;
+			posted.deadline.val =
+				get_time().val + FLASH_BUSY_POLL_TIMEOUT_USEC;
+			break;
+		case POSTED_POLL:
+			rv = posted_transaction(device, &JEDEC_READ_STATUS, 1,
+						&status_byte, 1);
+			if (rv != EC_SUCCESS ||
+			    !(status_byte & JEDEC_STATUS_BUSY)) {
+				posted_write_done(rv);
+				break;
+			}
+			if (timestamp_expired(posted.deadline, NULL)) {
+				posted_write_done(EC_ERROR_TIMEOUT);
+				break;
+			}
+			if (!wait) {
+				hook_call_deferred(usb_spi.deferred,
+						   POSTED_POLL_INTERVAL_USEC);
+				return;
+			}
+			break;
+		}
+	}
+}
+
+/*
+ * Get ready to receive a command: anything but a posted write waits for the
+ * queue to drain, a posted write for a free buffer.  Returns the failure of
+ * an earlier posted write, which the command is to be answered with.
+ */
+static uint16_t usb_spi_posted_prepare(bool post)
+{
+	uint16_t status_code;
+
+	usb_spi_posted_run(true, post ? CONFIG_USB_SPI_POSTED_DEPTH - 1 : 0);
+
+	status_code = posted.status_code;
+	posted.status_code = USB_SPI_SUCCESS;
+
+	usb_spi_state.spi_write_ctx.buffer =
+		post ? (uint8_t *)posted_buffers_[posted_tail()] :
+		       (uint8_t *)usb_spi_buffer_;
+
+	return status_code;
+}
+
+/*
+ * Queue the write just received in the tail buffer, to be answered right
+ * away, unless a write before it failed in the meantime.
+ */
+static uint16_t usb_spi_post_write(void)
+{
+	struct posted_write *w = &posted.queue[posted_tail()];
+	uint16_t status_code = posted.status_code;
+
+	if (status_code != USB_SPI_SUCCESS) {
+		posted.status_code = USB_SPI_SUCCESS;
+		return status_code;
+	}
+
+	w->flash_flags = usb_spi_state.flash_flags;
+	w->write_count = usb_spi_state.spi_write_ctx.transfer_size;
+	w->device_idx = usb_spi_state.current_spi_device_idx;
+	posted.count++;
+
+	return USB_SPI_SUCCESS;
+}
+#else
+static inline void usb_spi_posted_run(bool wait, int keep)
+{
+}
+
+static inline uint16_t usb_spi_posted_prepare(bool post)
+{
+	return USB_SPI_SUCCESS;
+}
+
+static inline uint16_t usb_spi_post_write(void)
+{
+	return USB_SPI_UNKNOWN_ERROR;
+}
+#endif /* CONFIG_USB_SPI_POSTED_WRITES */
+
 #ifdef CONFIG_USB_SPI_FLASH_EXTENSIONS
 /*
  * Decodes the header fields of a Flash Command Start Packet, and sets up the
@@ -402,6 +680,23 @@ static void setup_flash_transfer(struct usb_spi_packet_ctx *packet)
 	const uint8_t addr_count = (flags & FLASH_FLAG_ADDR_LEN_MSK) >>
 				   FLASH_FLAG_ADDR_LEN_POS;
 	const bool write_enable = !!(flags & FLASH_FLAG_WRITE_ENABLE);
+	const bool post = IS_ENABLED(CONFIG_USB_SPI_POSTED_WRITES) &&
+			  (flags & FLASH_FLAG_POSTED);
+	const bool custom_board_driver =
+		spi_devices[usb_spi_state.current_spi_device_idx].usb_flags &
+		USB_SPI_CUSTOM_SPI_DEVICE;
+
+	if (post && (!(flags & FLASH_FLAG_READ_WRITE_WRITE) ||
+		     (!custom_board_driver &&
+		      (flags & FLASH_FLAGS_REQUIRING_SUPPORT)))) {
+		/* Failing after the host was answered would be too late. */
+		usb_spi_state.status_code = USB_SPI_UNSUPPORTED_FLASH_MODE;
+		return;
+	}
+	usb_spi_state.status_code = usb_spi_posted_prepare(post);
+	if (usb_spi_state.status_code != USB_SPI_SUCCESS)
+		return;
+
 	if ((packet->cmd_flash_start.flags & FLASH_FLAG_READ_WRITE_MSK) ==
 	    FLASH_FLAG_READ_WRITE_WRITE) {
 		size_t write_count = packet->cmd_flash_start.count;
@@ -462,6 +757,7 @@ static void usb_spi_process_rx_packet(struct usb_spi_packet_ctx *packet)
 		/* The host started a new USB SPI transfer */
 		size_t write_count = packet->cmd_start.write_count;
 		size_t read_count = packet->cmd_start.read_count;
+		uint16_t status_code;
 		usb_spi_state.flash_flags = 0;
 
 		if (!usb_spi_state.enabled) {
@@ -477,6 +773,9 @@ static void usb_spi_process_rx_packet(struct usb_spi_packet_ctx *packet)
 		} else if (read_count > USB_SPI_MAX_READ_COUNT &&
 			   read_count != USB_SPI_FULL_DUPLEX_ENABLED) {
 			setup_transfer_response(USB_SPI_READ_COUNT_INVALID);
+		} else if ((status_code = usb_spi_posted_prepare(false)) !=
+			   USB_SPI_SUCCESS) {
+			setup_transfer_response(status_code);
 		} else {
 			usb_spi_setup_transfer(write_count, read_count);
 			packet->header_size =
@@ -558,6 +857,8 @@ static void usb_spi_process_rx_packet(struct usb_spi_packet_ctx *packet)
 		const struct spi_device_t *current_device =
 			&spi_devices[usb_spi_state.current_spi_device_idx];
 
+		/* Posted writes go out first. */
+		usb_spi_posted_run(true, 0);
 		if (flags & USB_SPI_CHIP_SELECT) {
 			/* Set chip select low (asserted). */
 			gpio_set_level(current_device->gpio_cs, 0);
@@ -598,7 +899,7 @@ static uint16_t do_spi_transfer(void)
 			0;
 	uint16_t status_code = EC_SUCCESS;
 	int read_count = usb_spi_state.spi_read_ctx.transfer_size;
-	const char *write_data_ptr = usb_spi_state.spi_write_ctx.buffer;
+	const uint8_t *write_data_ptr = usb_spi_state.spi_write_ctx.buffer;
 	int write_count = usb_spi_state.spi_write_ctx.transfer_size;
 #ifndef CONFIG_SPI_HALFDUPLEX
 	/*
@@ -624,28 +925,17 @@ static uint16_t do_spi_transfer(void)
 	if (status_code == EC_SUCCESS &&
 	    flash_flags & FLASH_FLAG_WRITE_ENABLE) {
 		/* Precede main transaction with one-byte "write enable". */
-		if (custom_board_driver) {
-			status_code = usb_spi_board_transaction(
-				current_device, 0, write_data_ptr, 1, NULL, 0);
-		} else {
-			status_code = spi_transaction(
-				current_device, write_data_ptr, 1, NULL, 0);
-		}
+		status_code = usb_spi_transaction(current_device, 0,
+						  write_data_ptr, 1, NULL, 0);
 		write_data_ptr += 1;
 		write_count -= 1;
 	}
 
 	if (status_code == EC_SUCCESS) {
-		if (custom_board_driver) {
-			status_code = usb_spi_board_transaction(
-				current_device, flash_flags, write_data_ptr,
-				write_count, usb_spi_state.spi_read_ctx.buffer,
-				read_count);
-		} else {
-			status_code = spi_transaction(
-				current_device, write_data_ptr, write_count,
-				usb_spi_state.spi_read_ctx.buffer, read_count);
-		}
+		status_code = usb_spi_transaction(
+			current_device, flash_flags, write_data_ptr,
+			write_count, usb_spi_state.spi_read_ctx.buffer,
+			read_count);
 	}
 
 	if (flash_flags & FLASH_FLAG_POLL) {
@@ -656,15 +946,9 @@ static uint16_t do_spi_transfer(void)
 		while (status_code == EC_SUCCESS) {
 			timestamp_t now;
 			uint8_t status_byte;
-			if (custom_board_driver) {
-				status_code = usb_spi_board_transaction(
-					current_device, 0, &JEDEC_READ_STATUS,
-					1, &status_byte, 1);
-			} else {
-				status_code = spi_transaction(
-					current_device, &JEDEC_READ_STATUS, 1,
-					&status_byte, 1);
-			}
+			status_code = usb_spi_transaction(current_device, 0,
+							  &JEDEC_READ_STATUS, 1,
+							  &status_byte, 1);
 			if ((status_byte & JEDEC_STATUS_BUSY) == 0)
 				break;
 			now = get_time();
@@ -702,14 +986,19 @@ void usb_spi_deferred(void)
 	 * enable or disable routines and save our new state.
 	 */
 	if (enabled != usb_spi_state.enabled) {
-		if (enabled)
+		if (enabled) {
 			usb_spi_board_enable();
-		else
+		} else {
+			usb_spi_posted_run(true, 0);
 			usb_spi_board_disable();
+		}
 
 		usb_spi_state.enabled = enabled;
 	}
 
+	/* Move posted writes along before taking the next packet. */
+	usb_spi_posted_run(false, 0);
+
 	/* Read any packets from the endpoint. */
 
 	usb_spi_read_packet(receive_packet);
@@ -734,7 +1023,13 @@ void usb_spi_deferred(void)
 
 	/* Start a new SPI transfer. */
 	if (usb_spi_state.mode == USB_SPI_MODE_START_SPI) {
-		uint16_t status_code = do_spi_transfer();
+		uint16_t status_code;
+
+		if (IS_ENABLED(CONFIG_USB_SPI_POSTED_WRITES) &&
+		    (usb_spi_state.flash_flags & FLASH_FLAG_POSTED))
+			status_code = usb_spi_post_write();
+		else
+			status_code = do_spi_transfer();
 		setup_transfer_response(status_code);
 	}
 
@@ -742,6 +1037,9 @@ void usb_spi_deferred(void)
 		usb_spi_create_spi_transfer_response(transmit_packet);
 		usb_spi_write_packet(transmit_packet);
 	}
+
+	/* With the answer on its way, start a write just posted. */
+	usb_spi_posted_run(false, 0);
 }
 
 /*
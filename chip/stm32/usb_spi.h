@@ -224,7 +224,8 @@
  *                        BIT(3): Quad mode flash supported
  *                        BIT(4): Octo mode flash supported
  *                        BIT(5): Double transfer rate supported
- *                        BIT(6:15): Reserved for future use
+ *                        BIT(6): Posted flash writes supported
+ *                        BIT(7:15): Reserved for future use
  *
  * Command Restart Response Packet (Host to Device):
  *
@@ -308,7 +309,8 @@
  *        bits 15:27  reserved, must be zero
  *            bit 28  write to be preceded by "write enable"
  *            bit 29  write to be followed by polling of JEDEC "busy bit"
- *            bit 30  reserved, must be zero
+ *            bit 30  posted write, if bit 6 of the "feature bitmap" is set,
+ *                    otherwise reserved, must be zero
  *            bit 31  read (0) / write (1)
  *
  *     write payload: Up to 56 bytes of data to write to SPI, the total length
@@ -319,6 +321,15 @@
  *                    be an even number of bytes unless this is the final
  *                    packet.
  *
+ *      A posted write is answered as soon as its payload has been received,
+ *      with a success status, and goes out on the SPI bus (including the
+ *      "write enable" and the busy polling) while the host sends the next
+ *      command.  The device queues a few posted writes and carries them out
+ *      in order, before any command that is not a posted write.  If one of
+ *      them fails, the ones queued after it are dropped, and the next
+ *      transfer command is answered with the error instead of being run.
+ *      Posted reads are not supported.
+ *
  *
  * USB Error Codes:
  *
@@ -421,6 +432,8 @@ enum feature_bitmap {
 	 * both rising and falling clock edges.
 	 */
 	USB_SPI_FEATURE_DTR_SUPPORTED = BIT(5),
+	/* Indicates support for FLASH_FLAG_POSTED on flash writes. */
+	USB_SPI_FEATURE_POSTED_WRITES = BIT(6),
 };
 
 struct usb_spi_response_configuration_v2 {
@@ -484,6 +497,9 @@ struct usb_spi_flash_command {
 #define FLASH_FLAG_POLL_POS 29U
 #define FLASH_FLAG_POLL (0x1UL << FLASH_FLAG_POLL_POS)
 
+#define FLASH_FLAG_POSTED_POS 30U
+#define FLASH_FLAG_POSTED (0x1UL << FLASH_FLAG_POSTED_POS)
+
 #define FLASH_FLAG_READ_WRITE_POS 31U
 #define FLASH_FLAG_READ_WRITE_MSK (0x1UL << FLASH_FLAG_READ_WRITE_POS)
 #define FLASH_FLAG_READ_WRITE_READ 0
@@ -47,7 +47,9 @@ void als_task(void *u)
 
 		for (i = 0; i < EC_ALS_ENTRIES && i < ALS_COUNT; i++) {
 			als_data = als_read(i, &val) == EC_SUCCESS ? val : 0;
+			host_memmap_write_begin(EC_MEMMAP_MOTION_SEQ);
 			mapped[i] = als_data;
+			host_memmap_write_end(EC_MEMMAP_MOTION_SEQ);
 		}
 	}
 }
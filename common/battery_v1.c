@@ -30,6 +30,8 @@ int update_static_battery_info(void)
 	 */
 	int rv;
 
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+
 	/* Smart battery serial number is 16 bits */
 	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_SERIAL);
 	memset(batt_str, 0, EC_MEMMAP_TEXT_MAX);
@@ -78,6 +80,8 @@ int update_static_battery_info(void)
 		batt_flags |= EC_BATT_FLAG_AC_PRESENT;
 	*host_get_memmap(EC_MEMMAP_BATT_FLAG) = batt_flags;
 
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
+
 	if (rv)
 		charge_problem(PR_STATIC_UPDATE, rv);
 	else
@@ -127,6 +131,8 @@ void update_dynamic_battery_info(void)
 	if (curr->batt.flags & BATT_FLAG_BAD_ANY)
 		tmp |= EC_BATT_FLAG_INVALID_DATA;
 
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+
 	if (!(curr->batt.flags & BATT_FLAG_BAD_VOLTAGE))
 		*memmap_volt = curr->batt.voltage;
 
@@ -168,6 +174,8 @@ void update_dynamic_battery_info(void)
 	/* Update flags before sending host events. */
 	*memmap_flags = tmp;
 
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
+
 	if (send_batt_info_event)
 		host_set_single_event(EC_HOST_EVENT_BATTERY);
 	if (send_batt_status_event)
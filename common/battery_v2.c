@@ -13,6 +13,9 @@
 #include "host_command.h"
 #include "math_util.h"
 #include "printf.h"
+#include "sysjump.h"
+#include "system.h"
+#include "task.h"
 #include "util.h"
 
 #define CPRINTF(format, args...) cprintf(CC_CHARGER, format, ##args)
@@ -26,6 +29,16 @@ struct battery_static_info battery_static[CONFIG_BATTERY_COUNT];
 struct ec_response_battery_dynamic_info battery_dynamic[CONFIG_BATTERY_COUNT];
 
 #ifdef HAS_TASK_HOSTCMD
+/*
+ * Serializes the updates of the battery memmap region, which come from the
+ * charger, hook and host command tasks.
+ */
+K_MUTEX_DEFINE(memmap_mutex);
+
+/* Battery to present next, set by battery_memmap_set_index() */
+static volatile enum battery_index memmap_index_requested;
+
+/* Must be called with memmap_mutex held. */
 static void battery_update(enum battery_index i)
 {
 	char *batt_str;
@@ -38,6 +51,8 @@ static void battery_update(enum battery_index i)
 	int *memmap_lfcc = (int *)host_get_memmap(EC_MEMMAP_BATT_LFCC);
 	uint8_t *memmap_flags = host_get_memmap(EC_MEMMAP_BATT_FLAG);
 
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+
 	/* Smart battery serial number is 16 bits */
 	batt_str = (char *)host_get_memmap(EC_MEMMAP_BATT_SERIAL);
 	memcpy(batt_str, battery_static[i].serial_ext, EC_MEMMAP_TEXT_MAX);
@@ -77,6 +92,8 @@ static void battery_update(enum battery_index i)
 	*memmap_cap = battery_dynamic[i].remaining_capacity;
 	*memmap_lfcc = battery_dynamic[i].full_capacity;
 	*memmap_flags = battery_dynamic[i].flags;
+
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
 }
 
 #ifdef CONFIG_HOSTCMD_BATTERY_V2
@@ -90,7 +107,7 @@ host_command_battery_get_static(struct host_cmd_handler_args *args)
 		return EC_RES_INVALID_PARAM;
 	bs = &battery_static[p->index];
 
-	battery_update(p->index);
+	battery_memmap_refresh(p->index);
 	if (args->version == 0) {
 		struct ec_response_battery_static_info *r = args->response;
 
@@ -162,27 +179,52 @@ DECLARE_HOST_COMMAND(EC_CMD_BATTERY_GET_DYNAMIC,
 
 void battery_memmap_refresh(enum battery_index index)
 {
+	mutex_lock(&memmap_mutex);
 	if (*host_get_memmap(EC_MEMMAP_BATT_INDEX) == index)
 		battery_update(index);
+	mutex_unlock(&memmap_mutex);
+}
+
+static void battery_memmap_switch(void)
+{
+	enum battery_index index = memmap_index_requested;
+
+	/* The host sees either battery in full, never a mix of the two. */
+	mutex_lock(&memmap_mutex);
+	if (index >= 0 && index < CONFIG_BATTERY_COUNT) {
+		host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+		battery_update(index);
+		*host_get_memmap(EC_MEMMAP_BATT_INDEX) = index;
+		host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
+	}
+	mutex_unlock(&memmap_mutex);
 }
+DECLARE_DEFERRED(battery_memmap_switch);
 
 void battery_memmap_set_index(enum battery_index index)
 {
 	if (*host_get_memmap(EC_MEMMAP_BATT_INDEX) == index)
 		return;
 
+	/*
+	 * This runs in the ACPI interrupt, which can't wait for the task
+	 * updating the region: only mark it invalid here, and switch in the
+	 * hook task.
+	 */
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
 	*host_get_memmap(EC_MEMMAP_BATT_INDEX) = BATT_IDX_INVALID;
-	if (index < 0 || index >= CONFIG_BATTERY_COUNT)
-		return;
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
 
-	battery_update(index);
-	*host_get_memmap(EC_MEMMAP_BATT_INDEX) = index;
+	memmap_index_requested = index;
+	hook_call_deferred(&battery_memmap_switch_data, 0);
 }
 
 static void battery_init(void)
 {
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
 	*host_get_memmap(EC_MEMMAP_BATT_INDEX) = BATT_IDX_INVALID;
 	*host_get_memmap(EC_MEMMAP_BATT_COUNT) = CONFIG_BATTERY_COUNT;
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
 	*host_get_memmap(EC_MEMMAP_BATTERY_VERSION) = 2;
 
 	battery_memmap_set_index(BATT_IDX_MAIN);
@@ -206,6 +248,54 @@ static int is_battery_string_reliable(const char *buf)
 	return 1;
 }
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+#define BATTERY_STATIC_SYSJUMP_VERSION 1
+
+/* Whether battery_static[BATT_IDX_MAIN] was read without errors */
+static bool static_info_valid;
+
+static void battery_static_preserve(void)
+{
+	if (static_info_valid)
+		system_add_jump_struct(SYSJUMP_TAG_BATTERY_STATIC,
+				       BATTERY_STATIC_SYSJUMP_VERSION,
+				       &battery_static[BATT_IDX_MAIN]);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, battery_static_preserve, HOOK_PRIO_DEFAULT);
+
+/*
+ * On the first update after a jump, take the static info the previous image
+ * read, as long as the serial number says it's still the same battery.
+ */
+static bool battery_static_restore(struct battery_static_info *bs)
+{
+	static bool checked;
+	const struct battery_static_info *prev;
+	char serial[sizeof(bs->serial_ext)];
+	int batt_serial;
+
+	if (checked)
+		return false;
+	checked = true;
+
+	prev = system_get_jump_struct(SYSJUMP_TAG_BATTERY_STATIC,
+				      BATTERY_STATIC_SYSJUMP_VERSION,
+				      struct battery_static_info);
+	if (!prev)
+		return false;
+
+	if (battery_serial_number(&batt_serial) ||
+	    snprintf(serial, sizeof(serial), "%04X", batt_serial) <= 0 ||
+	    strcmp(serial, prev->serial_ext))
+		return false;
+
+	*bs = *prev;
+	CPRINTS("Battery static info taken over");
+
+	return true;
+}
+#endif /* CONFIG_SYSJUMP_WARM_STATE */
+
 int update_static_battery_info(void)
 {
 	int batt_serial;
@@ -218,6 +308,13 @@ int update_static_battery_info(void)
 
 	struct battery_static_info *const bs = &battery_static[BATT_IDX_MAIN];
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+	if (battery_static_restore(bs)) {
+		rv = EC_SUCCESS;
+		goto done;
+	}
+#endif
+
 	/* Clear all static information. */
 	memset(bs, 0, sizeof(*bs));
 
@@ -278,6 +375,10 @@ int update_static_battery_info(void)
 	    !is_battery_string_reliable(bs->type_ext))
 		rv |= EC_ERROR_UNKNOWN;
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+done:
+	static_info_valid = !rv;
+#endif
 	/* Zero the dynamic entries. They'll come next. */
 	memset(&battery_dynamic[BATT_IDX_MAIN], 0,
 	       sizeof(battery_dynamic[BATT_IDX_MAIN]));
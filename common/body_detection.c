@@ -12,6 +12,7 @@
 #include "math_util.h"
 #include "mkbp_input_devices.h"
 #include "motion_sense_fifo.h"
+#include "streaming_stats.h"
 #include "timer.h"
 
 /* Console output macros */
@@ -32,18 +33,18 @@ static int window_size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE;
 test_export_static uint64_t var_threshold_scaled, confidence_delta_scaled;
 static int stationary_timeframe;
 
-static int history_idx;
 static enum body_detect_states motion_state = BODY_DETECTION_OFF_BODY;
 
-static bool history_initialized;
 static bool body_detect_enable;
 STATIC_IF(CONFIG_ACCEL_SPOOF_MODE) bool spoof_enable;
 
-static struct body_detect_motion_data {
-	int history[CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE]; /* acceleration */
-	int sum; /* sum(history) */
-	uint64_t n2_variance; /* n^2 * var(history) */
-} data[2]; /* motion data for X-axis and Y-axis */
+/* Acceleration over the last window_size samples, for X-axis and Y-axis */
+static int16_t history[CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE * 2];
+static struct stats_window motion_data = {
+	.history = history,
+	.size = CONFIG_BODY_DETECTION_MAX_WINDOW_SIZE,
+	.axes = 2,
+};
 
 static void print_body_detect_mode(void)
 {
@@ -51,46 +52,18 @@ static void print_body_detect_mode(void)
 		body_detect_get_state() ? "en" : "dis");
 }
 
-/*
- * This function will update new variance and new sum according to incoming
- * value, previous value, previous sum and previous variance.
- * In order to prevent inaccuracy, we use integer to calculate instead of float
- *
- * n: window size
- * x: data in the old window
- * x': data in the new window
- * x_0: oldest value in the window, will be replaced by x_n
- * x_n: new coming value
- *
- * n^2 * var(x') = n^2 * var(x) + (x_n - x_0) *
- *                 (n * (x_n + x_0) - sum(x') - sum(x))
- */
-static void update_motion_data(struct body_detect_motion_data *x, int x_n)
-{
-	const int n = window_size;
-	const int x_0 = x->history[history_idx];
-	const int sum_diff = x_n - x_0;
-	const int new_sum = x->sum + sum_diff;
-
-	x->n2_variance +=
-		sum_diff * ((int64_t)n * (x_n + x_0) - new_sum - x->sum);
-	x->sum = new_sum;
-	x->history[history_idx] = x_n;
-}
-
 /* Update motion data of X, Y with new sensor data. */
 static void update_motion_variance(void)
 {
-	update_motion_data(&data[X], body_sensor->xyz[X]);
-	update_motion_data(&data[Y], body_sensor->xyz[Y]);
-	history_idx = (history_idx + 1 >= window_size) ? 0 : history_idx + 1;
+	stats_window_add(&motion_data, body_sensor->xyz);
 }
 
 /* return Var(X) + Var(Y) */
 static uint64_t get_motion_variance(void)
 {
-	return (data[X].n2_variance + data[Y].n2_variance) / window_size /
-	       window_size;
+	return (stats_window_n2_variance(&motion_data, X) +
+		stats_window_n2_variance(&motion_data, Y)) /
+	       window_size / window_size;
 }
 
 static int calculate_motion_confidence(uint64_t var)
@@ -232,9 +205,7 @@ void body_detect_reset(void)
 				  var_noise_factor, var_threshold,
 				  confidence_delta);
 	/* initialize motion data and state */
-	memset(data, 0, sizeof(data));
-	history_idx = 0;
-	history_initialized = 0;
+	stats_window_init(&motion_data, history, window_size, 2);
 }
 
 void body_detect(void)
@@ -246,11 +217,8 @@ void body_detect(void)
 		return;
 
 	update_motion_variance();
-	if (!history_initialized) {
-		if (history_idx == window_size - 1)
-			history_initialized = 1;
+	if (!stats_window_full(&motion_data))
 		return;
-	}
 
 	motion_var = get_motion_variance();
 	motion_confidence = calculate_motion_confidence(motion_var);
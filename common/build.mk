@@ -51,7 +51,7 @@ common-$(CONFIG_BATTERY_V2)+=battery_v2.o
 common-$(CONFIG_BATTERY_FUEL_GAUGE)+=battery_fuel_gauge.o
 common-$(CONFIG_BLUETOOTH_LE)+=bluetooth_le.o
 common-$(CONFIG_BLUETOOTH_LE_STACK)+=btle_hci_controller.o btle_ll.o
-common-$(CONFIG_BODY_DETECTION)+=body_detection.o
+common-$(CONFIG_BODY_DETECTION)+=body_detection.o streaming_stats.o
 common-$(CONFIG_CAPSENSE)+=capsense.o
 common-$(CONFIG_CEC)+=cec.o
 common-$(CONFIG_CBI_EEPROM)+=cbi.o cbi_eeprom.o
@@ -145,14 +145,17 @@ common-$(CONFIG_RGB_KEYBOARD)+=rgb_keyboard.o
 common-$(CONFIG_RNG)+=trng.o
 common-$(CONFIG_ROLLBACK)+=rollback.o
 common-$(CONFIG_RSA)+=rsa.o
-common-$(CONFIG_RWSIG)+=rwsig.o vboot/common.o
+common-$(CONFIG_RWSIG)+=rwsig.o sha256_flash.o vboot/common.o
 common-$(CONFIG_RWSIG_TYPE_RWSIG)+=vboot/vb21_lib.o
 common-$(CONFIG_MATH_UTIL)+=math_util.o
+common-$(CONFIG_STREAMING_STATS)+=streaming_stats.o
 common-$(CONFIG_ONLINE_CALIB)+=stillness_detector.o kasa.o math_util.o \
 	mat44.o vec3.o newton_fit.o accel_cal.o online_calibration.o \
-	mkbp_event.o mag_cal.o math_util.o mat33.o gyro_cal.o gyro_still_det.o
+	mkbp_event.o mag_cal.o math_util.o mat33.o gyro_cal.o gyro_still_det.o \
+	streaming_stats.o
 common-$(CONFIG_SHA1)+= sha1.o
 ifeq ($(CONFIG_SHA256),y)
+common-$(CONFIG_FLASH_CROS)+=sha256_flash.o
 # use the standard software SHA256 lib if the chip cannot support SHA256
 # hardware accelerator.
 ifeq ($(CONFIG_SHA256_HW_ACCELERATE),)
@@ -189,17 +192,19 @@ common-$(CONFIG_USB_PD_HOST_CMD)+=usb_pd_host_cmd.o
 common-$(CONFIG_USB_PD_CONSOLE_CMD)+=usb_pd_console_cmd.o
 endif
 common-$(CONFIG_USB_PD_DISCOVERY)+=usb_pd_discovery.o
+common-$(CONFIG_USB_PD_DISCOVERY_CACHE)+=usb_pd_discovery_cache.o
 common-$(CONFIG_USB_PD_ALT_MODE_UFP)+=usb_pd_alt_mode_ufp.o
 common-$(CONFIG_USB_PD_DPS)+=dps.o
 common-$(CONFIG_USB_PD_LOGGING)+=event_log.o pd_log.o
 common-$(CONFIG_USB_PD_TCPC)+=usb_pd_tcpc.o
 common-$(CONFIG_USB_UPDATE)+=usb_update.o update_fw.o
+common-$(CONFIG_UPDATE_WINDOW)+=update_fw.o
 common-$(CONFIG_USBC_OCP)+=usbc_ocp.o
 common-$(CONFIG_USBC_PPC)+=usbc_ppc.o
 common-$(CONFIG_VBOOT_EFS)+=vboot/vboot.o
 common-$(CONFIG_VBOOT_EFS2)+=vboot/efs2.o
 ifeq ($(CONFIG_VBOOT_HASH),y)
-common-y+=vboot_hash.o
+common-y+=vboot_hash.o sha256_flash.o
 # use the standard software SHA256 lib if the chip cannot support SHA256
 # hardware accelerator.
 ifeq ($(CONFIG_SHA256_HW_ACCELERATE),)
@@ -215,9 +220,11 @@ common-$(HAS_TASK_CONSOLE)+=console.o console_output.o
 common-$(HAS_TASK_CONSOLE)+=uart_buffering.o uart_hostcmd.o uart_printf.o
 common-$(CONFIG_CMD_MEM)+=memory_commands.o
 common-$(HAS_TASK_HOSTCMD)+=host_command_task.o host_command.o ec_features.o
+common-$(CONFIG_HOSTCMD_STATS)+=host_command_stats.o
+common-$(CONFIG_HOOK_INIT_TIMES)+=hook_init_times.o
 common-$(HAS_TASK_PDCMD)+=host_command_pd.o
 common-$(HAS_TASK_KEYSCAN)+=keyboard_scan.o
-common-$(HAS_TASK_LIGHTBAR)+=lb_common.o lightbar.o
+common-$(HAS_TASK_LIGHTBAR)+=lb_common.o lightbar.o lightbyte.o
 common-$(HAS_TASK_MOTIONSENSE)+=motion_sense.o
 common-$(CONFIG_SYSTEM_SAFE_MODE)+=system_safe_mode.o
 
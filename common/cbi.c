@@ -18,6 +18,9 @@
 #ifdef HOST_TOOLS_BUILD
 #include <string.h>
 #else
+#include "hooks.h"
+#include "sysjump.h"
+#include "system.h"
 #include "util.h"
 #endif
 
@@ -83,6 +86,61 @@ static int cache_status = CBI_CACHE_STATUS_INVALID;
 static uint8_t cbi[CBI_IMAGE_SIZE];
 static struct cbi_header *const head = (struct cbi_header *)cbi;
 
+/*
+ * Offset in cbi[] of the first item for each known tag, or 0 if the tag is
+ * absent, so lookups don't walk the image. Rebuilt whenever cbi[] changes.
+ */
+static uint8_t tag_offset[CBI_TAG_COUNT];
+BUILD_ASSERT(CBI_IMAGE_SIZE <= UINT8_MAX + 1);
+
+/* Range of bytes in cbi[] which may differ from the storage media */
+static int dirty_start;
+static int dirty_end = CBI_IMAGE_SIZE;
+
+static void cbi_index_tags(void)
+{
+	const uint8_t *end = cbi + MIN(head->total_size, sizeof(cbi));
+	const struct cbi_data *d;
+	const uint8_t *p;
+
+	memset(tag_offset, 0, sizeof(tag_offset));
+	/* Same walk as cbi_find_tag, so the first item of a tag wins */
+	for (p = head->data; p + sizeof(*d) < end; p += sizeof(*d) + d->size) {
+		d = (const struct cbi_data *)p;
+		if (d->tag < ARRAY_SIZE(tag_offset) && !tag_offset[d->tag])
+			tag_offset[d->tag] = p - cbi;
+	}
+}
+
+static struct cbi_data *cbi_lookup(enum cbi_data_tag tag)
+{
+	/* Unknown tags (e.g. from a newer CBI) aren't indexed */
+	if (tag >= ARRAY_SIZE(tag_offset))
+		return cbi_find_tag(cbi, tag);
+
+	if (!tag_offset[tag])
+		return NULL;
+
+	return (struct cbi_data *)&cbi[tag_offset[tag]];
+}
+
+static void cbi_mark_dirty(int start, int end)
+{
+	if (dirty_start == dirty_end) {
+		dirty_start = start;
+		dirty_end = end;
+	} else {
+		dirty_start = MIN(dirty_start, start);
+		dirty_end = MAX(dirty_end, end);
+	}
+}
+
+static void cbi_mark_clean(void)
+{
+	dirty_start = 0;
+	dirty_end = 0;
+}
+
 int cbi_create(void)
 {
 	memset(cbi, 0, sizeof(cbi));
@@ -92,6 +150,8 @@ int cbi_create(void)
 	head->minor_version = CBI_VERSION_MINOR;
 	head->crc = cbi_crc8(head);
 	cache_status = CBI_CACHE_STATUS_SYNCED;
+	cbi_index_tags();
+	cbi_mark_dirty(0, sizeof(cbi));
 
 	return EC_SUCCESS;
 }
@@ -155,6 +215,54 @@ static int do_cbi_read(void)
 	return EC_SUCCESS;
 }
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+#define CBI_SYSJUMP_VERSION 1
+
+/* Hand the image as read from storage to the next image */
+static void cbi_preserve(void)
+{
+	if (cache_status != CBI_CACHE_STATUS_SYNCED ||
+	    dirty_start != dirty_end ||
+	    cbi_config.storage_type == CBI_STORAGE_TYPE_GPIO ||
+	    head->total_size > JUMP_TAG_MAX_SIZE)
+		return;
+
+	system_add_jump_tag(SYSJUMP_TAG_CBI, CBI_SYSJUMP_VERSION,
+			    head->total_size, cbi);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, cbi_preserve, HOOK_PRIO_DEFAULT);
+
+/*
+ * Take the image the previous image read instead of reading the storage, on
+ * the first read only: later ones follow a cbi_invalidate_cache().
+ */
+static int cbi_restore(void)
+{
+	static bool checked;
+	const struct cbi_header *prev;
+	int version, size;
+
+	if (checked)
+		return EC_ERROR_INVAL;
+	checked = true;
+
+	prev = (const struct cbi_header *)system_get_jump_tag(
+		SYSJUMP_TAG_CBI, &version, &size);
+	if (!prev || version != CBI_SYSJUMP_VERSION || size < sizeof(*prev) ||
+	    prev->total_size != size ||
+	    memcmp(prev->magic, cbi_magic, sizeof(prev->magic)) ||
+	    prev->major_version > CBI_VERSION_MAJOR ||
+	    cbi_crc8(prev) != prev->crc)
+		return EC_ERROR_INVAL;
+
+	memset(cbi, 0, sizeof(cbi));
+	memcpy(cbi, prev, size);
+	CPRINTS("Took board info over from previous image");
+
+	return EC_SUCCESS;
+}
+#endif /* CONFIG_SYSJUMP_WARM_STATE */
+
 static int cbi_read(void)
 {
 	int i;
@@ -163,15 +271,29 @@ static int cbi_read(void)
 	if (cbi_get_cache_status() == CBI_CACHE_STATUS_SYNCED)
 		return EC_SUCCESS;
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+	if (cbi_restore() == EC_SUCCESS) {
+		cbi_index_tags();
+		cache_status = CBI_CACHE_STATUS_SYNCED;
+		cbi_mark_clean();
+		return EC_SUCCESS;
+	}
+#endif
+
 	for (i = 0; i < 2; i++) {
 		rv = do_cbi_read();
+		cbi_index_tags();
 		if (rv == EC_SUCCESS) {
 			cache_status = CBI_CACHE_STATUS_SYNCED;
+			cbi_mark_clean();
 			return EC_SUCCESS;
 		}
 		/* On error (I2C or bad contents), retry a read */
 	}
 
+	/* We no longer know what the storage holds */
+	cbi_mark_dirty(0, sizeof(cbi));
+
 	return rv;
 }
 
@@ -188,7 +310,7 @@ int cbi_get_board_info(enum cbi_data_tag tag, uint8_t *buf, uint8_t *size)
 	if (cbi_read())
 		return EC_ERROR_UNKNOWN;
 
-	d = cbi_find_tag(cbi, tag);
+	d = cbi_lookup(tag);
 	if (!d)
 		/* Not found */
 		return EC_ERROR_UNKNOWN;
@@ -220,11 +342,15 @@ test_mockable int cbi_set_board_info(enum cbi_data_tag tag, const uint8_t *buf,
 				     uint8_t size)
 {
 	struct cbi_data *d;
+	int offset;
+	int rv = EC_SUCCESS;
 
-	d = cbi_find_tag(cbi, tag);
+	d = cbi_lookup(tag);
 
 	/* If we found the entry, but the size doesn't match, delete it */
 	if (d && d->size != size) {
+		/* Everything after it moves up */
+		cbi_mark_dirty((uint8_t *)d - cbi, head->total_size);
 		cbi_remove_tag(cbi, d);
 		d = NULL;
 	}
@@ -232,27 +358,84 @@ test_mockable int cbi_set_board_info(enum cbi_data_tag tag, const uint8_t *buf,
 	if (!d) {
 		uint8_t *p;
 		/* Not found. Check if new item would fit */
-		if (sizeof(cbi) < head->total_size + sizeof(*d) + size)
-			return EC_ERROR_OVERFLOW;
-		/* Append new item */
-		p = cbi_set_data(&cbi[head->total_size], tag, buf, size);
-		head->total_size = p - cbi;
+		if (sizeof(cbi) < head->total_size + sizeof(*d) + size) {
+			rv = EC_ERROR_OVERFLOW;
+		} else {
+			/* Append new item */
+			offset = head->total_size;
+			p = cbi_set_data(&cbi[offset], tag, buf, size);
+			head->total_size = p - cbi;
+			cbi_mark_dirty(offset, head->total_size);
+		}
 	} else {
-		/* Overwrite existing item */
-		memcpy(d->value, buf, d->size);
+		/* Overwrite existing item, tracking only the changed bytes */
+		int first = -1;
+		int last = 0;
+
+		for (offset = 0; offset < size; offset++) {
+			if (d->value[offset] == buf[offset])
+				continue;
+			if (first < 0)
+				first = offset;
+			last = offset;
+		}
+		if (first >= 0) {
+			memcpy(d->value, buf, d->size);
+			cbi_mark_dirty(d->value + first - cbi,
+				       d->value + last + 1 - cbi);
+		}
 	}
 
-	return EC_SUCCESS;
+	cbi_index_tags();
+
+	return rv;
+}
+
+/*
+ * Write the dirty bytes and the header, which holds the CRC. The data goes
+ * first so an interrupted update leaves a CRC mismatch behind.
+ */
+static int cbi_store(void)
+{
+	const struct cbi_storage_driver *drv = cbi_config.drv;
+	const int crc = offsetof(struct cbi_header, crc);
+	const int end = MIN(dirty_end, head->total_size);
+	int rv;
+
+	if (!drv->store_range)
+		return drv->store(cbi);
+
+	if (dirty_start >= end)
+		return drv->store_range(cbi, crc, sizeof(*head) - crc);
+
+	if (dirty_start <= sizeof(*head))
+		return drv->store_range(cbi, MIN(dirty_start, crc),
+					MAX(end, sizeof(*head)) -
+						MIN(dirty_start, crc));
+
+	rv = drv->store_range(cbi, dirty_start, end - dirty_start);
+	if (rv)
+		return rv;
+
+	return drv->store_range(cbi, crc, sizeof(*head) - crc);
 }
 
 int cbi_write(void)
 {
+	int rv;
+
 	if (cbi_config.drv->is_protected()) {
 		CPRINTS("Failed to write due to WP");
 		return EC_ERROR_ACCESS_DENIED;
 	}
 
-	return cbi_config.drv->store(cbi);
+	rv = cbi_store();
+	if (rv)
+		cbi_mark_dirty(0, sizeof(cbi));
+	else
+		cbi_mark_clean();
+
+	return rv;
 }
 
 test_mockable int cbi_get_board_version(uint32_t *ver)
@@ -361,6 +544,8 @@ common_cbi_set(const struct __ec_align4 ec_params_set_cbi *p)
 		memset(cbi, 0, sizeof(cbi));
 		memcpy(head->magic, cbi_magic, sizeof(cbi_magic));
 		head->total_size = sizeof(*head);
+		cbi_index_tags();
+		cbi_mark_dirty(0, sizeof(cbi));
 	} else {
 		if (cbi_read())
 			return EC_RES_ERROR;
@@ -38,13 +38,15 @@ static int eeprom_is_write_protected(void)
 	return write_protect_is_asserted();
 }
 
-static int eeprom_write(uint8_t *cbi)
+static int eeprom_write_range(uint8_t *cbi, int offset, int len)
 {
-	uint8_t *p = cbi;
-	int rest = ((struct cbi_header *)p)->total_size;
+	uint8_t *p = cbi + offset;
 
-	while (rest > 0) {
-		int size = MIN(EEPROM_PAGE_WRITE_SIZE, rest);
+	while (len > 0) {
+		/* Page writes wrap around, so never cross a page boundary */
+		int size = MIN(EEPROM_PAGE_WRITE_SIZE -
+				       (p - cbi) % EEPROM_PAGE_WRITE_SIZE,
+			       len);
 		int rv;
 
 		rv = i2c_write_block(I2C_PORT_EEPROM, I2C_ADDR_EEPROM_FLAGS,
@@ -56,12 +58,19 @@ static int eeprom_write(uint8_t *cbi)
 		/* Wait for internal write cycle completion */
 		msleep(EEPROM_PAGE_WRITE_MS);
 		p += size;
-		rest -= size;
+		len -= size;
 	}
 
 	return EC_SUCCESS;
 }
 
+static int eeprom_write(uint8_t *cbi)
+{
+	const struct cbi_header *h = (struct cbi_header *)cbi;
+
+	return eeprom_write_range(cbi, 0, h->total_size);
+}
+
 #ifdef CONFIG_EEPROM_CBI_WP
 void cbi_latch_eeprom_wp(void)
 {
@@ -72,6 +81,7 @@ void cbi_latch_eeprom_wp(void)
 
 const struct cbi_storage_driver eeprom_drv = {
 	.store = eeprom_write,
+	.store_range = eeprom_write_range,
 	.load = eeprom_read,
 	.is_protected = eeprom_is_write_protected,
 };
@@ -96,6 +96,25 @@ static int charge_ceil[CHARGE_PORT_COUNT][CEIL_REQUESTOR_COUNT];
 /* Dual-role capability of attached partner port */
 static enum dualrole_capabilities dualrole_capability[CHARGE_PORT_COUNT];
 
+/*
+ * Set when something port selection depends on changes, so that refreshes
+ * that only concern the charge current keep the selected port.
+ */
+static int selection_dirty = 1;
+
+/* Set while a refresh is scheduled, so that bursts of changes share it */
+static int refresh_pending;
+
+#ifdef CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS
+#define REFRESH_DELAY (CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS * MSEC)
+#else
+#define REFRESH_DELAY 0
+#endif
+
+#ifdef TEST_BUILD
+static struct charge_manager_refresh_stats refresh_stats;
+#endif
+
 #ifdef CONFIG_USB_PD_LOGGING
 /* Mark port as dirty when making changes, for later logging */
 static int save_log[CHARGE_PORT_COUNT];
@@ -751,6 +770,8 @@ static void charge_manager_get_best_charge_port(int *new_port,
 	      battery_is_cut_off() != BATTERY_CUTOFF_STATE_NORMAL))) {
 		port = charge_port;
 		supplier = charge_supplier;
+		/* Select again once the battery is back */
+		selection_dirty = 1;
 	}
 #endif
 
@@ -774,9 +795,30 @@ static void charge_manager_refresh(void)
 	int ceil;
 	int power_changed = 0;
 
+	refresh_pending = 0;
+#ifdef TEST_BUILD
+	refresh_stats.refreshes++;
+#endif
+
 	/* Hunt for an acceptable charge port */
 	while (1) {
-		charge_manager_get_best_charge_port(&new_port, &new_supplier);
+		/*
+		 * Keep the port unless something it was selected on changed,
+		 * e.g. on a ceiling change. The DPS port can change without
+		 * telling us, so always select with DPS.
+		 */
+		if (selection_dirty || IS_ENABLED(CONFIG_USB_PD_DPS) ||
+		    !active_charge_port_initialized) {
+			selection_dirty = 0;
+			charge_manager_get_best_charge_port(&new_port,
+							    &new_supplier);
+#ifdef TEST_BUILD
+			refresh_stats.selections++;
+#endif
+		} else {
+			new_port = charge_port;
+			new_supplier = charge_supplier;
+		}
 
 		if (!left_safe_mode && new_port == CHARGE_PORT_NONE)
 			return;
@@ -818,6 +860,7 @@ static void charge_manager_refresh(void)
 			available_charge[i][new_port].current = 0;
 			available_charge[i][new_port].voltage = 0;
 		}
+		selection_dirty = 1;
 	}
 
 	active_charge_port_initialized = 1;
@@ -826,8 +869,10 @@ static void charge_manager_refresh(void)
 	 * Clear override if it wasn't selected as the 'best' port -- it means
 	 * that no charge is available on the port, or the port was rejected.
 	 */
-	if (override_port >= 0 && override_port != new_port)
+	if (override_port >= 0 && override_port != new_port) {
 		override_port = OVERRIDE_OFF;
+		selection_dirty = 1;
+	}
 
 	if (new_supplier == CHARGE_SUPPLIER_NONE) {
 #ifdef CONFIG_CHARGER_DEFAULT_CURRENT_LIMIT
@@ -1013,6 +1058,25 @@ static void charge_manager_refresh(void)
 }
 DECLARE_DEFERRED(charge_manager_refresh);
 
+/**
+ * Schedule a refresh, unless one is already on its way. With
+ * CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS, the changes that come together on
+ * attach (BC1.2, Type-C current, PD contract) are handled by a single
+ * refresh.
+ */
+static void charge_manager_schedule_refresh(void)
+{
+	/*
+	 * Re-arming the deferred call would push it out on every change, so
+	 * the first change of a burst sets when the refresh runs.
+	 */
+	if (REFRESH_DELAY && refresh_pending)
+		return;
+
+	refresh_pending = 1;
+	hook_call_deferred(&charge_manager_refresh_data, REFRESH_DELAY);
+}
+
 /**
  * Called when charge override times out waiting for power swap.
  */
@@ -1101,6 +1165,7 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 #endif
 	) {
 		override_port = OVERRIDE_OFF;
+		selection_dirty = 1;
 		if (delayed_override_port != OVERRIDE_OFF) {
 			delayed_override_port = OVERRIDE_OFF;
 			hook_call_deferred(&charge_override_timeout_data, -1);
@@ -1110,6 +1175,7 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 	if (change == CHANGE_CHARGE) {
 		available_charge[supplier][port].current = charge->current;
 		available_charge[supplier][port].voltage = charge->voltage;
+		selection_dirty = 1;
 		registration_time[port] = get_time();
 
 		/*
@@ -1144,7 +1210,7 @@ static void charge_manager_make_change(enum charge_manager_change_type change,
 	 * attached.
 	 */
 	if (charge_manager_is_seeded())
-		hook_call_deferred(&charge_manager_refresh_data, 0);
+		charge_manager_schedule_refresh();
 }
 
 void pd_set_input_current_limit(int port, uint32_t max_ma,
@@ -1229,6 +1295,7 @@ void charge_manager_update_dualrole(int port, enum dualrole_capabilities cap)
 	/* Ignore when capability is unchanged */
 	if (cap != dualrole_capability[port]) {
 		dualrole_capability[port] = cap;
+		selection_dirty = 1;
 		charge_manager_make_change(CHANGE_DUALROLE, 0, port, NULL);
 	}
 }
@@ -1262,8 +1329,9 @@ void charge_manager_leave_safe_mode(void)
 	CPRINTS("%s()", __func__);
 	cflush();
 	left_safe_mode = 1;
+	selection_dirty = 1;
 	if (charge_manager_is_seeded())
-		hook_call_deferred(&charge_manager_refresh_data, 0);
+		charge_manager_schedule_refresh();
 }
 #endif
 
@@ -1275,7 +1343,7 @@ void charge_manager_set_ceil(int port, enum ceil_requestor requestor, int ceil)
 	if (charge_ceil[port][requestor] != ceil) {
 		charge_ceil[port][requestor] = ceil;
 		if (port == charge_port && charge_manager_is_seeded())
-			hook_call_deferred(&charge_manager_refresh_data, 0);
+			charge_manager_schedule_refresh();
 	}
 }
 
@@ -1330,9 +1398,9 @@ int charge_manager_set_override(int port)
 	if (port < 0 || is_sink(port)) {
 		if (override_port != port) {
 			override_port = port;
+			selection_dirty = 1;
 			if (charge_manager_is_seeded())
-				hook_call_deferred(&charge_manager_refresh_data,
-						   0);
+				charge_manager_schedule_refresh();
 		}
 	}
 	/*
@@ -1371,6 +1439,15 @@ int charge_manager_get_selected_charge_port(void)
 	return port;
 }
 
+#ifdef TEST_BUILD
+void charge_manager_get_refresh_stats(
+	struct charge_manager_refresh_stats *stats)
+{
+	*stats = refresh_stats;
+	memset(&refresh_stats, 0, sizeof(refresh_stats));
+}
+#endif
+
 int charge_manager_get_charger_current(void)
 {
 	return charge_current;
@@ -155,6 +155,23 @@ static int battery_was_removed;
 
 static int problems_exist;
 
+/*
+ * Inputs of the charging decisions, for CONFIG_CHARGER_STEADY_STATE_POLL:
+ * while they stay the same from one loop to the next, the loop is steady
+ * and can poll less often.
+ */
+struct steady_inputs {
+	int ac;
+	enum charge_state state;
+	int state_of_charge;
+	int batt_flags;
+	int requested_voltage;
+	int requested_current;
+	int chg_status;
+};
+static struct steady_inputs steady_prev;
+static int steady_loops;
+
 static const char *const prob_text[] = {
 	"static update",     "set voltage",	 "set current", "set mode",
 	"set input current", "post init",	 "chg params",	"batt params",
@@ -616,6 +633,11 @@ static int set_chg_ctrl_mode(enum ec_charge_control_mode mode)
 	local_state.manual_current = current;
 	local_state.manual_voltage = voltage;
 
+	/* Don't wait for the next poll, which may be a while away */
+	if (IS_ENABLED(CONFIG_CHARGER_STEADY_STATE_POLL) &&
+	    task_get_current() != TASK_ID_CHARGER)
+		task_wake(TASK_ID_CHARGER);
+
 	return EC_SUCCESS;
 }
 
@@ -1453,6 +1475,45 @@ static void process_preferred_voltage(void)
 		pd_set_new_power_request(port);
 }
 
+/* Count the loops the charging decision inputs stayed the same */
+static void check_steady_state(void)
+{
+	struct steady_inputs now = {
+		.ac = curr.ac,
+		.state = curr.state,
+		.state_of_charge = curr.batt.state_of_charge,
+		.batt_flags = curr.batt.flags,
+		.requested_voltage = curr.requested_voltage,
+		.requested_current = curr.requested_current,
+		.chg_status = curr.chg.status,
+	};
+
+	if (memcmp(&now, &steady_prev, sizeof(now))) {
+		steady_prev = now;
+		steady_loops = 0;
+	} else if (steady_loops < 2 * CHARGE_STEADY_LOOPS) {
+		/* Enough to stretch any period to the steady one */
+		steady_loops++;
+	}
+}
+
+/*
+ * Stretch a default polling period while the loop is steady, doubling it
+ * for each steady loop past CHARGE_STEADY_LOOPS.
+ */
+static int steady_sleep_dur(int sleep_usec)
+{
+	int shift = steady_loops - CHARGE_STEADY_LOOPS;
+
+	if (shift <= 0 || sleep_usec >= CHARGE_POLL_PERIOD_STEADY)
+		return sleep_usec;
+
+	for (; shift && sleep_usec < CHARGE_POLL_PERIOD_STEADY; shift--)
+		sleep_usec *= 2;
+
+	return MIN(sleep_usec, CHARGE_POLL_PERIOD_STEADY);
+}
+
 /* Calculate the sleep duration, before we run around the task loop again */
 int calculate_sleep_dur(int battery_critical, int sleep_usec)
 {
@@ -1484,6 +1545,11 @@ int calculate_sleep_dur(int battery_critical, int sleep_usec)
 			/* AC present, so pay closer attention */
 			sleep_usec = CHARGE_POLL_PERIOD_CHARGE;
 		}
+
+		/* Nothing changed for a while, no need to look as often */
+		if (IS_ENABLED(CONFIG_CHARGER_STEADY_STATE_POLL) &&
+		    !battery_critical)
+			sleep_usec = steady_sleep_dur(sleep_usec);
 	}
 
 	/* Adjust for time spent in the charge loop */
@@ -1619,6 +1685,9 @@ void charger_task(void *u)
 		/* Report our state */
 		local_state.is_full = is_full;
 
+		if (IS_ENABLED(CONFIG_CHARGER_STEADY_STATE_POLL))
+			check_steady_state();
+
 		sleep_usec = calculate_sleep_dur(battery_critical, sleep_usec);
 		task_wait_event(sleep_usec);
 	}
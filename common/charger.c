@@ -21,6 +21,7 @@
 #include "hooks.h"
 #include "host_command.h"
 #include "printf.h"
+#include "timer.h"
 #include "util.h"
 
 /* Console output macros */
@@ -40,6 +41,56 @@ int dptf_get_charging_current_limit(void)
 	return dptf_limit_ma;
 }
 
+#ifdef CONFIG_CHARGER_SHADOW_REGS
+/* Last value written to a charger limit, valid until it expires */
+struct shadow_reg {
+	int value;
+	timestamp_t expires;
+};
+
+/* Shadows of the limits the charge loop keeps writing the same values to */
+static struct {
+	struct shadow_reg current;
+	struct shadow_reg voltage;
+	struct shadow_reg input_current;
+} shadow[CHARGER_NUM];
+
+static struct charger_write_stats write_stats;
+
+/* Drop the shadows, e.g. when the chargers may have reset their registers */
+static void charger_shadow_invalidate(void)
+{
+	memset(shadow, 0, sizeof(shadow));
+}
+DECLARE_HOOK(HOOK_AC_CHANGE, charger_shadow_invalidate, HOOK_PRIO_FIRST);
+
+/* Write a limit to a charger, unless it already has that value */
+static enum ec_error_list shadow_write(struct shadow_reg *reg,
+				       enum ec_error_list (*set)(int, int),
+				       int chgnum, int value)
+{
+	enum ec_error_list rv;
+
+	if (reg->value == value && !timestamp_expired(reg->expires, NULL)) {
+		write_stats.skipped++;
+		return EC_SUCCESS;
+	}
+
+	write_stats.written++;
+	rv = set(chgnum, value);
+	reg->value = value;
+	/* Rewrite the value now and then, in case the charger lost it */
+	reg->expires.val = rv ? 0 : get_time().val + CHARGER_SHADOW_TIMEOUT;
+
+	return rv;
+}
+
+void charger_get_write_stats(struct charger_write_stats *stats)
+{
+	*stats = write_stats;
+}
+#endif /* CONFIG_CHARGER_SHADOW_REGS */
+
 static void dptf_disable_hook(void)
 {
 	/* Before get to Sx, EC should take control of charger from DPTF */
@@ -197,6 +248,12 @@ void print_charger_debug(int chgnum)
 		ccprintf("\t%5d mA (%4d - %5d, %3d)\n", d,
 			 info->input_current_min, info->input_current_max,
 			 info->input_current_step);
+
+#ifdef CONFIG_CHARGER_SHADOW_REGS
+	print_item_name("Writes:");
+	ccprintf("%u written, %u skipped\n", write_stats.written,
+		 write_stats.skipped);
+#endif
 }
 
 void print_charger_prochot(int chgnum)
@@ -308,6 +365,9 @@ enum ec_error_list charger_post_init(void)
 		return EC_ERROR_INVAL;
 	}
 
+	if (IS_ENABLED(CONFIG_CHARGER_SHADOW_REGS))
+		charger_shadow_invalidate();
+
 	if (!chg_chips[chgnum].drv->post_init)
 		return EC_ERROR_UNIMPLEMENTED;
 
@@ -450,7 +510,13 @@ enum ec_error_list charger_set_current(int chgnum, int current)
 	if (!chg_chips[chgnum].drv->set_current)
 		return EC_ERROR_UNIMPLEMENTED;
 
+#ifdef CONFIG_CHARGER_SHADOW_REGS
+	return shadow_write(&shadow[chgnum].current,
+			    chg_chips[chgnum].drv->set_current, chgnum,
+			    current);
+#else
 	return chg_chips[chgnum].drv->set_current(chgnum, current);
+#endif
 }
 
 enum ec_error_list charger_get_actual_voltage(int chgnum, int *voltage)
@@ -495,7 +561,13 @@ enum ec_error_list charger_set_voltage(int chgnum, int voltage)
 	if (!chg_chips[chgnum].drv->set_voltage)
 		return EC_ERROR_UNIMPLEMENTED;
 
+#ifdef CONFIG_CHARGER_SHADOW_REGS
+	return shadow_write(&shadow[chgnum].voltage,
+			    chg_chips[chgnum].drv->set_voltage, chgnum,
+			    voltage);
+#else
 	return chg_chips[chgnum].drv->set_voltage(chgnum, voltage);
+#endif
 }
 
 enum ec_error_list charger_discharge_on_ac(int enable)
@@ -585,8 +657,14 @@ enum ec_error_list charger_set_input_current_limit(int chgnum,
 	if (!chg_chips[chgnum].drv->set_input_current_limit)
 		return EC_ERROR_UNIMPLEMENTED;
 
+#ifdef CONFIG_CHARGER_SHADOW_REGS
+	return shadow_write(&shadow[chgnum].input_current,
+			    chg_chips[chgnum].drv->set_input_current_limit,
+			    chgnum, input_current);
+#else
 	return chg_chips[chgnum].drv->set_input_current_limit(chgnum,
 							      input_current);
+#endif
 }
 
 enum ec_error_list charger_get_input_current_limit(int chgnum,
@@ -29,6 +29,7 @@ extern "C" {
 #include "fpsensor.h"
 #include "fpsensor_crypto.h"
 #include "fpsensor_detect.h"
+#include "fpsensor_frame_codec.h"
 #include "fpsensor_state.h"
 #include "fpsensor_utils.h"
 #include "scoped_fast_cpu.h"
@@ -403,6 +404,58 @@ enum ec_error_list validate_fp_buffer_offset(const uint32_t buffer_size,
 	return EC_SUCCESS;
 }
 
+/*
+ * Bits per sample of the frames packed for the host: all the sensors
+ * supported so far have 8 bits per pixel.
+ */
+#define FP_FRAME_SAMPLE_BITS 8
+
+/* Smallest packed chunk holding at least one block. */
+#define FP_FRAME_PACKED_MIN                              \
+	(sizeof(struct ec_response_fp_frame_packed) +    \
+	 (4 + FP_FRAME_PACK_BLOCK * FP_FRAME_SAMPLE_BITS + 7) / 8)
+
+static enum ec_status
+fp_command_frame_packed(struct host_cmd_handler_args *args)
+{
+	const auto *params =
+		static_cast<const struct ec_params_fp_frame *>(args->params);
+	auto *r = static_cast<struct ec_response_fp_frame_packed *>(
+		args->response);
+	uint32_t offset = params->offset & FP_FRAME_OFFSET_MASK;
+	uint32_t base = 0;
+	size_t packed;
+
+	if (FP_FRAME_GET_BUFFER_INDEX(params->offset) !=
+	    FP_FRAME_INDEX_RAW_IMAGE)
+		return EC_RES_INVALID_PARAM;
+	if (args->response_max < FP_FRAME_PACKED_MIN || !params->size)
+		return EC_RES_INVALID_PARAM;
+	if (system_is_locked())
+		return EC_RES_ACCESS_DENIED;
+	if (!is_raw_capture(sensor_mode))
+		base = FP_SENSOR_IMAGE_OFFSET;
+
+	if (validate_fp_buffer_offset(sizeof(fp_buffer) - base, offset,
+				      params->size) != EC_SUCCESS)
+		return EC_RES_INVALID_PARAM;
+
+	/*
+	 * Packing is stateless: the chunk only depends on the frame, so the
+	 * host may ask for the same offset again after a transport error.
+	 */
+	args->response_size =
+		sizeof(*r) + fp_frame_pack(fp_buffer + base,
+					   offset + params->size, offset,
+					   FP_FRAME_SAMPLE_BITS, r->data,
+					   args->response_max - sizeof(*r),
+					   &packed);
+	r->size = packed;
+	r->sample_bits = FP_FRAME_SAMPLE_BITS;
+	memset(r->reserved, 0, sizeof(r->reserved));
+	return EC_RES_SUCCESS;
+}
+
 static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 {
 	const auto *params =
@@ -416,6 +469,9 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 	struct ec_fp_template_encryption_metadata *enc_info;
 	enum ec_error_list ret;
 
+	if (args->version == 1)
+		return fp_command_frame_packed(args);
+
 	if (size > args->response_max)
 		return EC_RES_INVALID_PARAM;
 
@@ -527,7 +583,8 @@ static enum ec_status fp_command_frame(struct host_cmd_handler_args *args)
 
 	return EC_RES_SUCCESS;
 }
-DECLARE_HOST_COMMAND(EC_CMD_FP_FRAME, fp_command_frame, EC_VER_MASK(0));
+DECLARE_HOST_COMMAND(EC_CMD_FP_FRAME, fp_command_frame,
+		     EC_VER_MASK(0) | EC_VER_MASK(1));
 
 static enum ec_status fp_command_stats(struct host_cmd_handler_args *args)
 {
@@ -570,6 +627,241 @@ validate_template_format(struct ec_fp_template_encryption_metadata *enc_info)
 	return EC_RES_SUCCESS;
 }
 
+/* Size of the part of the template after the metadata which is encrypted */
+static uint32_t template_encrypted_size(
+	const struct ec_fp_template_encryption_metadata *enc_info)
+{
+	if (enc_info->struct_version <= 3)
+		return sizeof(fp_template[0]);
+	return sizeof(fp_template[0]) + sizeof(fp_positive_match_salt[0]);
+}
+
+/*
+ * Make template idx valid once it has been decrypted, generating the
+ * positive match salt of templates migrating to the current format.
+ */
+static enum ec_status
+fp_template_loaded(uint16_t idx,
+		   struct ec_fp_template_encryption_metadata *enc_info,
+		   uint8_t *positive_match_salt)
+{
+	if (template_needs_validation_value(enc_info)) {
+		CPRINTS("fgr%d: Generating positive match salt.", idx);
+		trng_init();
+		trng_rand_bytes(positive_match_salt,
+				FP_POSITIVE_MATCH_SALT_BYTES);
+		trng_exit();
+	}
+	if (bytes_are_trivial(positive_match_salt,
+			      sizeof(fp_positive_match_salt[0]))) {
+		CPRINTS("fgr%d: Trivial positive match salt.", idx);
+		fp_clear_finger_context(idx);
+		return EC_RES_INVALID_PARAM;
+	}
+	if (positive_match_salt != fp_positive_match_salt[idx])
+		memcpy(fp_positive_match_salt[idx], positive_match_salt,
+		       sizeof(fp_positive_match_salt[0]));
+
+	templ_valid++;
+	return EC_RES_SUCCESS;
+}
+
+/* Templates being loaded by EC_CMD_FP_TEMPLATE version 1 */
+static struct {
+	bool active;
+	/* Offset in the batch of the next chunk */
+	uint32_t offset;
+	/* Index the template being received goes to */
+	uint16_t idx;
+	/* Size of its part after the metadata which is encrypted */
+	uint32_t blob_size;
+	/* User the batch is loaded for */
+	uint32_t user_id[FP_CONTEXT_USERID_WORDS];
+	/* Key derived for the last salt seen */
+	bool have_key;
+	uint8_t salt[FP_CONTEXT_ENCRYPTION_SALT_BYTES];
+	uint8_t key[SBP_ENC_KEY_LEN];
+} template_batch;
+
+void fp_template_batch_end(void)
+{
+	aes_gcm_decrypt_abort();
+	OPENSSL_cleanse(&template_batch, sizeof(template_batch));
+}
+
+/* Stop a batch on error, dropping the template being received. */
+static void fp_template_batch_drop(void)
+{
+	if (template_batch.active &&
+	    template_batch.offset % sizeof(fp_enc_buffer) &&
+	    template_batch.idx == templ_valid)
+		fp_clear_finger_context(template_batch.idx);
+	fp_template_batch_end();
+}
+
+/* The metadata of the template has arrived: get ready for its payload. */
+static enum ec_status fp_template_batch_begin(uint16_t idx)
+{
+	auto *enc_info =
+		reinterpret_cast<struct ec_fp_template_encryption_metadata *>(
+			fp_enc_buffer);
+
+	if (validate_template_format(enc_info) != EC_RES_SUCCESS) {
+		CPRINTS("fgr%d: Template format not supported", idx);
+		return EC_RES_INVALID_PARAM;
+	}
+	template_batch.blob_size = template_encrypted_size(enc_info);
+
+	/*
+	 * Only derive the key again when the salt changes, dropping the key
+	 * of the previous template first.
+	 */
+	if (!template_batch.have_key ||
+	    memcmp(template_batch.salt, enc_info->encryption_salt,
+		   sizeof(template_batch.salt))) {
+		template_batch.have_key = false;
+		OPENSSL_cleanse(template_batch.key, sizeof(template_batch.key));
+		if (derive_encryption_key(template_batch.key,
+					  enc_info->encryption_salt) !=
+		    EC_SUCCESS) {
+			CPRINTS("fgr%d: Failed to derive key", idx);
+			return EC_RES_UNAVAILABLE;
+		}
+		memcpy(template_batch.salt, enc_info->encryption_salt,
+		       sizeof(template_batch.salt));
+		template_batch.have_key = true;
+	}
+
+	if (aes_gcm_decrypt_start(template_batch.key, SBP_ENC_KEY_LEN,
+				  enc_info->nonce,
+				  FP_CONTEXT_NONCE_BYTES) != EC_SUCCESS)
+		return EC_RES_UNAVAILABLE;
+	return EC_RES_SUCCESS;
+}
+
+/* The whole template has arrived and been decrypted: check it. */
+static enum ec_status fp_template_batch_finish(uint16_t idx)
+{
+	auto *enc_info =
+		reinterpret_cast<struct ec_fp_template_encryption_metadata *>(
+			fp_enc_buffer);
+
+	if (aes_gcm_decrypt_finish(enc_info->tag, FP_CONTEXT_TAG_BYTES) !=
+	    EC_SUCCESS) {
+		CPRINTS("fgr%d: Failed to decipher template", idx);
+		/* Don't leave bad data in the template buffer */
+		fp_clear_finger_context(idx);
+		return EC_RES_UNAVAILABLE;
+	}
+	return fp_template_loaded(idx, enc_info, fp_positive_match_salt[idx]);
+}
+
+/*
+ * Store the next bytes of a batch, decrypting the payload of each template
+ * straight into fp_template[] and fp_positive_match_salt[] as it arrives:
+ * by the time the last chunk of a template is there, only its tag is left
+ * to check, and the host goes on with the next template.
+ */
+static enum ec_status fp_template_batch_store(const uint8_t *data,
+					      uint32_t size)
+{
+	const uint32_t meta = sizeof(struct ec_fp_template_encryption_metadata);
+	const uint32_t salt_pos = meta + sizeof(fp_template[0]);
+	enum ec_status res = EC_RES_SUCCESS;
+
+	while (size && res == EC_RES_SUCCESS) {
+		uint32_t pos = template_batch.offset % sizeof(fp_enc_buffer);
+		uint16_t idx = template_batch.idx;
+		uint8_t *dst;
+		uint32_t n;
+
+		if (!pos) {
+			/* Can we store one more template ? */
+			idx = templ_valid;
+			if (idx >= FP_MAX_FINGER_COUNT)
+				return EC_RES_OVERFLOW;
+			fp_clear_finger_context(idx);
+			template_batch.idx = idx;
+		} else if (idx != templ_valid) {
+			/* The context was reset under the batch. */
+			return EC_RES_INVALID_PARAM;
+		}
+
+		if (pos < meta) {
+			dst = fp_enc_buffer + pos;
+			n = meta - pos;
+		} else if (pos < salt_pos) {
+			dst = fp_template[idx] + pos - meta;
+			n = salt_pos - pos;
+		} else {
+			dst = fp_positive_match_salt[idx] + pos - salt_pos;
+			n = sizeof(fp_enc_buffer) - pos;
+		}
+		n = MIN(n, size);
+
+		if (pos >= meta && pos - meta < template_batch.blob_size) {
+			n = MIN(n, meta + template_batch.blob_size - pos);
+			if (aes_gcm_decrypt_update(dst, data, n) != EC_SUCCESS)
+				return EC_RES_UNAVAILABLE;
+		} else {
+			memcpy(dst, data, n);
+		}
+
+		data += n;
+		size -= n;
+		template_batch.offset += n;
+		pos += n;
+		if (pos == meta)
+			res = fp_template_batch_begin(idx);
+		else if (pos == sizeof(fp_enc_buffer))
+			res = fp_template_batch_finish(idx);
+	}
+
+	return res;
+}
+
+static enum ec_status
+fp_command_template_batch(struct host_cmd_handler_args *args)
+{
+	const auto *params =
+		static_cast<const struct ec_params_fp_template *>(args->params);
+	uint32_t size = params->size & ~FP_TEMPLATE_COMMIT;
+	bool commit = params->size & FP_TEMPLATE_COMMIT;
+	enum ec_status res;
+
+	if (args->params_size !=
+	    size + offsetof(struct ec_params_fp_template, data))
+		return EC_RES_INVALID_PARAM;
+
+	if (!params->offset) {
+		fp_template_batch_end();
+		template_batch.active = true;
+		memcpy(template_batch.user_id, user_id, sizeof(user_id));
+	} else if (!template_batch.active ||
+		   params->offset != template_batch.offset ||
+		   memcmp(template_batch.user_id, user_id, sizeof(user_id))) {
+		fp_template_batch_drop();
+		return EC_RES_INVALID_PARAM;
+	}
+
+	{
+		ScopedFastCpu fast_cpu;
+
+		res = fp_template_batch_store(params->data, size);
+	}
+	if (res == EC_RES_SUCCESS && commit &&
+	    template_batch.offset % sizeof(fp_enc_buffer))
+		/* The batch ends in the middle of a template. */
+		res = EC_RES_INVALID_PARAM;
+
+	if (res != EC_RES_SUCCESS)
+		/* Keep the templates already loaded. */
+		fp_template_batch_drop();
+	else if (commit)
+		fp_template_batch_end();
+	return res;
+}
+
 static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 {
 	const auto *params =
@@ -581,6 +873,9 @@ static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 	uint8_t key[SBP_ENC_KEY_LEN];
 	struct ec_fp_template_encryption_metadata *enc_info;
 
+	if (args->version == 1)
+		return fp_command_template_batch(args);
+
 	/* Can we store one more template ? */
 	if (idx >= FP_MAX_FINGER_COUNT)
 		return EC_RES_OVERFLOW;
@@ -622,12 +917,7 @@ static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 			return EC_RES_INVALID_PARAM;
 		}
 
-		if (enc_info->struct_version <= 3) {
-			encrypted_blob_size = sizeof(fp_template[0]);
-		} else {
-			encrypted_blob_size = sizeof(fp_template[0]) +
-					      sizeof(fp_positive_match_salt[0]);
-		}
+		encrypted_blob_size = template_encrypted_size(enc_info);
 
 		ret = derive_encryption_key(key, enc_info->encryption_salt);
 		if (ret != EC_SUCCESS) {
@@ -649,26 +939,10 @@ static enum ec_status fp_command_template(struct host_cmd_handler_args *args)
 		}
 		memcpy(fp_template[idx], encrypted_template,
 		       sizeof(fp_template[0]));
-		if (template_needs_validation_value(enc_info)) {
-			CPRINTS("fgr%d: Generating positive match salt.", idx);
-			trng_init();
-			trng_rand_bytes(positive_match_salt,
-					FP_POSITIVE_MATCH_SALT_BYTES);
-			trng_exit();
-		}
-		if (bytes_are_trivial(positive_match_salt,
-				      sizeof(fp_positive_match_salt[0]))) {
-			CPRINTS("fgr%d: Trivial positive match salt.", idx);
-			OPENSSL_cleanse(fp_template[idx],
-					sizeof(fp_template[0]));
-			return EC_RES_INVALID_PARAM;
-		}
-		memcpy(fp_positive_match_salt[idx], positive_match_salt,
-		       sizeof(fp_positive_match_salt[0]));
-
-		templ_valid++;
+		return fp_template_loaded(idx, enc_info, positive_match_salt);
 	}
 
 	return EC_RES_SUCCESS;
 }
-DECLARE_HOST_COMMAND(EC_CMD_FP_TEMPLATE, fp_command_template, EC_VER_MASK(0));
+DECLARE_HOST_COMMAND(EC_CMD_FP_TEMPLATE, fp_command_template,
+		     EC_VER_MASK(0) | EC_VER_MASK(1));
@@ -24,6 +24,7 @@ extern "C" {
 }
 
 #include "fpsensor_auth_crypto.h"
+#include "fpsensor_crypto_backend.h"
 
 std::optional<fp_elliptic_curve_public_key>
 create_pubkey_from_ec_key(const EC_KEY &key)
@@ -145,22 +146,8 @@ enum ec_error_list decrypt_data_with_gsc_session_key_in_place(
 		return EC_ERROR_INVAL;
 	}
 
-	CleanseWrapper<AES_KEY> aes_key;
-	int res = AES_set_encrypt_key(gsc_session_key, 256, &aes_key);
-	if (res) {
-		return EC_ERROR_INVAL;
-	}
-
-	std::array<uint8_t, AES_BLOCK_SIZE> aes_iv;
-	std::copy(iv, iv + iv_size, aes_iv.begin());
-
-	/* The AES CTR uses the same function for encryption & decryption. */
-	unsigned int block_num = 0;
-	std::array<uint8_t, AES_BLOCK_SIZE> ecount_buf;
-	AES_ctr128_encrypt(data, data, data_size, &aes_key, aes_iv.data(),
-			   ecount_buf.data(), &block_num);
-
-	return EC_SUCCESS;
+	return fp_crypto_backend()->aes_ctr(gsc_session_key, iv, data,
+					    data_size);
 }
 
 enum ec_error_list encrypt_data_with_ecdh_key_in_place(
@@ -199,26 +186,8 @@ enum ec_error_list encrypt_data_with_ecdh_key_in_place(
 		return ret;
 	}
 
-	CleanseWrapper<AES_KEY> aes_key;
-	int res = AES_set_encrypt_key(enc_key.data(), 256, &aes_key);
-	if (res) {
-		return EC_ERROR_INVAL;
-	}
-
 	RAND_bytes(iv, iv_size);
 
-	/* The IV will be changed after the AES_ctr128_encrypt, we need a copy
-	 * for that. */
-	std::array<uint8_t, AES_BLOCK_SIZE> aes_iv;
-
-	std::copy(iv, iv + iv_size, aes_iv.begin());
-
-	unsigned int block_num = 0;
-	std::array<uint8_t, AES_BLOCK_SIZE> ecount_buf;
-
-	/* The AES CTR uses the same function for encryption & decryption. */
-	AES_ctr128_encrypt(data, data, data_size, &aes_key, aes_iv.data(),
-			   ecount_buf.data(), &block_num);
-
-	return EC_SUCCESS;
+	return fp_crypto_backend()->aes_ctr(enc_key.data(), iv, data,
+					    data_size);
 }
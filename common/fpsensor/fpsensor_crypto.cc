@@ -5,6 +5,7 @@
 
 #include "aes_gcm_helpers.h"
 #include "fpsensor_crypto.h"
+#include "fpsensor_crypto_backend.h"
 #include "fpsensor_state_without_driver_info.h"
 #include "fpsensor_utils.h"
 #include "openssl/aes.h"
@@ -63,7 +64,8 @@ test_mockable void compute_hmac_sha256(uint8_t *output, const uint8_t *key,
 				       const uint8_t *message,
 				       const int message_len)
 {
-	hmac_SHA256(output, key, key_len, message, message_len);
+	fp_crypto_backend()->hmac_sha256(output, key, key_len, message,
+					 message_len);
 }
 
 static void hkdf_extract(uint8_t *prk, const uint8_t *salt, size_t salt_size,
@@ -248,32 +250,14 @@ enum ec_error_list aes_gcm_encrypt(const uint8_t *key, int key_size,
 				   const uint8_t *nonce, int nonce_size,
 				   uint8_t *tag, int tag_size)
 {
-	int res;
-	AES_KEY aes_key;
-	GCM128_CONTEXT ctx;
-
 	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
 		CPRINTS("Invalid nonce size %d bytes", nonce_size);
 		return EC_ERROR_INVAL;
 	}
 
-	/* TODO(b/279950931): Use public boringssl API. */
-	res = AES_set_encrypt_key(key, 8 * key_size, &aes_key);
-	if (res) {
-		CPRINTS("Failed to set encryption key: %d", res);
-		return EC_ERROR_UNKNOWN;
-	}
-	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
-	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
-	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_encrypt(&ctx, &aes_key, plaintext, ciphertext,
-				    text_size);
-	if (!res) {
-		CPRINTS("Failed to encrypt: %d", res);
-		return EC_ERROR_UNKNOWN;
-	}
-	CRYPTO_gcm128_tag(&ctx, tag, tag_size);
-	return EC_SUCCESS;
+	return fp_crypto_backend()->aes_gcm_encrypt(key, key_size, plaintext,
+						    ciphertext, text_size,
+						    nonce, tag, tag_size);
 }
 
 enum ec_error_list aes_gcm_decrypt(const uint8_t *key, int key_size,
@@ -282,34 +266,89 @@ enum ec_error_list aes_gcm_decrypt(const uint8_t *key, int key_size,
 				   const uint8_t *nonce, int nonce_size,
 				   const uint8_t *tag, int tag_size)
 {
-	int res;
+	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
+		CPRINTS("Invalid nonce size %d bytes", nonce_size);
+		return EC_ERROR_INVAL;
+	}
+
+	return fp_crypto_backend()->aes_gcm_decrypt(key, key_size, ciphertext,
+						    plaintext, text_size,
+						    nonce, tag, tag_size);
+}
+
+/*
+ * Message being decrypted in pieces by aes_gcm_decrypt_update(). This stays
+ * in software: the pieces are of any size, when crypto peripherals work on
+ * whole blocks.
+ */
+static struct {
 	AES_KEY aes_key;
 	GCM128_CONTEXT ctx;
+	bool active;
+} gcm_stream;
+
+enum ec_error_list aes_gcm_decrypt_start(const uint8_t *key, int key_size,
+					 const uint8_t *nonce, int nonce_size)
+{
+	int res;
 
 	if (nonce_size != FP_CONTEXT_NONCE_BYTES) {
 		CPRINTS("Invalid nonce size %d bytes", nonce_size);
 		return EC_ERROR_INVAL;
 	}
 
+	aes_gcm_decrypt_abort();
 	/* TODO(b/279950931): Use public boringssl API. */
-	res = AES_set_encrypt_key(key, 8 * key_size, &aes_key);
+	res = AES_set_encrypt_key(key, 8 * key_size, &gcm_stream.aes_key);
 	if (res) {
 		CPRINTS("Failed to set decryption key: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
-	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
-	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, nonce_size);
+	CRYPTO_gcm128_init(&gcm_stream.ctx, &gcm_stream.aes_key,
+			   (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&gcm_stream.ctx, &gcm_stream.aes_key, nonce,
+			    nonce_size);
+	gcm_stream.active = true;
+	return EC_SUCCESS;
+}
+
+enum ec_error_list aes_gcm_decrypt_update(uint8_t *plaintext,
+					  const uint8_t *ciphertext,
+					  int text_size)
+{
+	int res;
+
+	if (!gcm_stream.active)
+		return EC_ERROR_INVAL;
+
 	/* CRYPTO functions return 1 on success, 0 on error. */
-	res = CRYPTO_gcm128_decrypt(&ctx, &aes_key, ciphertext, plaintext,
-				    text_size);
+	res = CRYPTO_gcm128_decrypt(&gcm_stream.ctx, &gcm_stream.aes_key,
+				    ciphertext, plaintext, text_size);
 	if (!res) {
 		CPRINTS("Failed to decrypt: %d", res);
+		aes_gcm_decrypt_abort();
 		return EC_ERROR_UNKNOWN;
 	}
-	res = CRYPTO_gcm128_finish(&ctx, tag, tag_size);
+	return EC_SUCCESS;
+}
+
+enum ec_error_list aes_gcm_decrypt_finish(const uint8_t *tag, int tag_size)
+{
+	int res;
+
+	if (!gcm_stream.active)
+		return EC_ERROR_INVAL;
+
+	res = CRYPTO_gcm128_finish(&gcm_stream.ctx, tag, tag_size);
+	aes_gcm_decrypt_abort();
 	if (!res) {
 		CPRINTS("Found incorrect tag: %d", res);
 		return EC_ERROR_UNKNOWN;
 	}
 	return EC_SUCCESS;
 }
+
+void aes_gcm_decrypt_abort(void)
+{
+	OPENSSL_cleanse(&gcm_stream, sizeof(gcm_stream));
+}
@@ -0,0 +1,238 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Software crypto backend of the fingerprint MCU, and backend selection */
+
+#include "aes_gcm_helpers.h"
+#include "crypto/cleanse_wrapper.h"
+#include "openssl/aes.h"
+#include "openssl/mem.h"
+
+/* These must be included after the "openssl/aes.h" */
+#include "crypto/fipsmodule/aes/internal.h"
+#include "crypto/fipsmodule/modes/internal.h"
+
+extern "C" {
+#include "console.h"
+#include "ec_commands.h"
+#include "sha256.h"
+#include "util.h"
+}
+
+#include "fpsensor_crypto_backend.h"
+#include "fpsensor_utils.h"
+
+#include <algorithm>
+#include <array>
+
+namespace
+{
+
+enum ec_error_list sw_aes_gcm_encrypt(const uint8_t *key, int key_size,
+				      const uint8_t *in, uint8_t *out,
+				      int text_size, const uint8_t *nonce,
+				      uint8_t *tag, int tag_size)
+{
+	CleanseWrapper<AES_KEY> aes_key;
+	CleanseWrapper<GCM128_CONTEXT> ctx;
+	int res;
+
+	/* TODO(b/279950931): Use public boringssl API. */
+	res = AES_set_encrypt_key(key, 8 * key_size, &aes_key);
+	if (res) {
+		CPRINTS("Failed to set encryption key: %d", res);
+		return EC_ERROR_UNKNOWN;
+	}
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, FP_CONTEXT_NONCE_BYTES);
+	/* CRYPTO functions return 1 on success, 0 on error. */
+	res = CRYPTO_gcm128_encrypt(&ctx, &aes_key, in, out, text_size);
+	if (!res) {
+		CPRINTS("Failed to encrypt: %d", res);
+		return EC_ERROR_UNKNOWN;
+	}
+	CRYPTO_gcm128_tag(&ctx, tag, tag_size);
+	return EC_SUCCESS;
+}
+
+enum ec_error_list sw_aes_gcm_decrypt(const uint8_t *key, int key_size,
+				      const uint8_t *in, uint8_t *out,
+				      int text_size, const uint8_t *nonce,
+				      const uint8_t *tag, int tag_size)
+{
+	CleanseWrapper<AES_KEY> aes_key;
+	CleanseWrapper<GCM128_CONTEXT> ctx;
+	int res;
+
+	/* TODO(b/279950931): Use public boringssl API. */
+	res = AES_set_encrypt_key(key, 8 * key_size, &aes_key);
+	if (res) {
+		CPRINTS("Failed to set decryption key: %d", res);
+		return EC_ERROR_UNKNOWN;
+	}
+	CRYPTO_gcm128_init(&ctx, &aes_key, (block128_f)AES_encrypt, 0);
+	CRYPTO_gcm128_setiv(&ctx, &aes_key, nonce, FP_CONTEXT_NONCE_BYTES);
+	/* CRYPTO functions return 1 on success, 0 on error. */
+	res = CRYPTO_gcm128_decrypt(&ctx, &aes_key, in, out, text_size);
+	if (!res) {
+		CPRINTS("Failed to decrypt: %d", res);
+		return EC_ERROR_UNKNOWN;
+	}
+	res = CRYPTO_gcm128_finish(&ctx, tag, tag_size);
+	if (!res) {
+		CPRINTS("Found incorrect tag: %d", res);
+		return EC_ERROR_UNKNOWN;
+	}
+	return EC_SUCCESS;
+}
+
+enum ec_error_list sw_aes_ctr(const uint8_t *key, const uint8_t *iv,
+			      uint8_t *data, size_t data_size)
+{
+	CleanseWrapper<AES_KEY> aes_key;
+	int res = AES_set_encrypt_key(key, 256, &aes_key);
+	if (res) {
+		return EC_ERROR_INVAL;
+	}
+
+	/* AES_ctr128_encrypt() moves the counter on, work on a copy. */
+	std::array<uint8_t, AES_BLOCK_SIZE> aes_iv;
+	std::copy(iv, iv + AES_BLOCK_SIZE, aes_iv.begin());
+
+	/* The AES CTR uses the same function for encryption & decryption. */
+	unsigned int block_num = 0;
+	std::array<uint8_t, AES_BLOCK_SIZE> ecount_buf;
+	AES_ctr128_encrypt(data, data, data_size, &aes_key, aes_iv.data(),
+			   ecount_buf.data(), &block_num);
+	OPENSSL_cleanse(ecount_buf.data(), ecount_buf.size());
+
+	return EC_SUCCESS;
+}
+
+void sw_hmac_sha256(uint8_t *output, const uint8_t *key, int key_len,
+		    const uint8_t *message, int message_len)
+{
+	hmac_SHA256(output, key, key_len, message, message_len);
+}
+
+#ifdef CONFIG_FP_CRYPTO_HW_ACCELERATE
+/*
+ * Known message of the backend checks: longer than a block and not a whole
+ * number of blocks, to go through the partial block paths.
+ */
+using CheckMessage = std::array<uint8_t, 37>;
+
+/*
+ * AES-GCM with a key_size key: the backend must encrypt as software does,
+ * decrypt that back with the tag, and refuse it with a wrong tag.
+ */
+bool gcm_agrees(const struct fp_crypto_backend *backend, const uint8_t *key,
+		int key_size, const uint8_t *nonce, const CheckMessage &message)
+{
+	CheckMessage expected, actual;
+	std::array<uint8_t, FP_CONTEXT_TAG_BYTES> expected_tag, actual_tag;
+
+	if (sw_aes_gcm_encrypt(key, key_size, message.data(), expected.data(),
+			       message.size(), nonce, expected_tag.data(),
+			       expected_tag.size()) ||
+	    backend->aes_gcm_encrypt(key, key_size, message.data(),
+				     actual.data(), message.size(), nonce,
+				     actual_tag.data(), actual_tag.size()) ||
+	    expected != actual || expected_tag != actual_tag)
+		return false;
+
+	if (backend->aes_gcm_decrypt(key, key_size, expected.data(),
+				     actual.data(), expected.size(), nonce,
+				     expected_tag.data(),
+				     expected_tag.size()) != EC_SUCCESS ||
+	    actual != message)
+		return false;
+
+	expected_tag[0] ^= 1;
+	return backend->aes_gcm_decrypt(key, key_size, expected.data(),
+					actual.data(), expected.size(), nonce,
+					expected_tag.data(),
+					expected_tag.size()) != EC_SUCCESS;
+}
+
+bool ctr_agrees(const struct fp_crypto_backend *backend, const uint8_t *key,
+		const uint8_t *iv, const CheckMessage &message)
+{
+	CheckMessage expected = message, actual = message;
+
+	return sw_aes_ctr(key, iv, expected.data(), expected.size()) ==
+		       EC_SUCCESS &&
+	       backend->aes_ctr(key, iv, actual.data(), actual.size()) ==
+		       EC_SUCCESS &&
+	       expected == actual;
+}
+
+/*
+ * Check a backend against the software one, with both AES key sizes. The
+ * HMAC key is a whole SHA256 block, the most that hmac_SHA256() takes.
+ */
+bool backend_agrees(const struct fp_crypto_backend *backend)
+{
+	CheckMessage message;
+	std::array<uint8_t, SHA256_BLOCK_SIZE> key;
+	std::array<uint8_t, AES_BLOCK_SIZE> iv, wrap_iv;
+	std::array<uint8_t, FP_CONTEXT_NONCE_BYTES> nonce;
+	std::array<uint8_t, SHA256_DIGEST_SIZE> expected_mac, actual_mac;
+
+	for (size_t i = 0; i < message.size(); i++)
+		message[i] = i * 7;
+	for (size_t i = 0; i < key.size(); i++)
+		key[i] = i * 13 + 1;
+	for (size_t i = 0; i < iv.size(); i++)
+		iv[i] = 0xF0 + i;
+	std::copy(iv.begin(), iv.begin() + nonce.size(), nonce.begin());
+	/*
+	 * The low 32 bits of the counter wrap after the first block, and so
+	 * do the next 32 bits with the carry.
+	 */
+	wrap_iv = iv;
+	std::fill(wrap_iv.begin() + 8, wrap_iv.end(), 0xFF);
+
+	if (!gcm_agrees(backend, key.data(), 16, nonce.data(), message) ||
+	    !gcm_agrees(backend, key.data(), 32, nonce.data(), message) ||
+	    !ctr_agrees(backend, key.data(), iv.data(), message) ||
+	    !ctr_agrees(backend, key.data(), wrap_iv.data(), message))
+		return false;
+
+	sw_hmac_sha256(expected_mac.data(), key.data(), key.size(),
+		       message.data(), message.size());
+	backend->hmac_sha256(actual_mac.data(), key.data(), key.size(),
+			     message.data(), message.size());
+	return expected_mac == actual_mac;
+}
+#endif /* CONFIG_FP_CRYPTO_HW_ACCELERATE */
+
+} // namespace
+
+const struct fp_crypto_backend fp_crypto_software = {
+	.name = "software",
+	.init = NULL,
+	.aes_gcm_encrypt = sw_aes_gcm_encrypt,
+	.aes_gcm_decrypt = sw_aes_gcm_decrypt,
+	.aes_ctr = sw_aes_ctr,
+	.hmac_sha256 = sw_hmac_sha256,
+};
+
+const struct fp_crypto_backend *fp_crypto_backend(void)
+{
+	static const struct fp_crypto_backend *backend;
+
+	if (backend)
+		return backend;
+
+	backend = &fp_crypto_software;
+#ifdef CONFIG_FP_CRYPTO_HW_ACCELERATE
+	if (fp_crypto_hardware.init() == EC_SUCCESS &&
+	    backend_agrees(&fp_crypto_hardware))
+		backend = &fp_crypto_hardware;
+#endif
+	CPRINTS("Crypto backend: %s", backend->name);
+	return backend;
+}
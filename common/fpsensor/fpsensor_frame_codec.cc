@@ -0,0 +1,209 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Compression of raw fingerprint frames, shared with ectool */
+
+#include "common.h"
+#include "fpsensor_frame_codec.h"
+#include "util.h"
+
+struct bit_writer {
+	uint8_t *out;
+	size_t pos;
+	uint32_t acc;
+	int count;
+};
+
+struct bit_reader {
+	const uint8_t *in;
+	size_t size;
+	size_t pos;
+	uint32_t acc;
+	int count;
+};
+
+static uint32_t get_sample(const uint8_t *frame, size_t offset, int bytes)
+{
+	if (bytes == 2)
+		return frame[offset] | frame[offset + 1] << 8;
+	return frame[offset];
+}
+
+static void put_sample(uint8_t *frame, size_t offset, int bytes,
+		       uint32_t sample)
+{
+	frame[offset] = sample;
+	if (bytes == 2)
+		frame[offset + 1] = sample >> 8;
+}
+
+/* Difference with the previous sample, as 0, -1, 1, -2, 2, ... */
+static uint32_t fold(uint32_t sample, uint32_t prev, int bits)
+{
+	const int shift = 32 - bits;
+	int32_t diff = (int32_t)((sample - prev) << shift) >> shift;
+
+	return (((uint32_t)diff << 1) ^ (uint32_t)(diff >> 31)) &
+	       (BIT(bits) - 1);
+}
+
+static uint32_t unfold(uint32_t value, uint32_t prev, int bits)
+{
+	uint32_t diff = (value >> 1) ^ (0 - (value & 1));
+
+	return (prev + diff) & (BIT(bits) - 1);
+}
+
+/* Write count <= 16 bits */
+static void put_bits(struct bit_writer *w, uint32_t value, int count)
+{
+	w->acc |= value << w->count;
+	w->count += count;
+	while (w->count >= 8) {
+		w->out[w->pos++] = w->acc;
+		w->acc >>= 8;
+		w->count -= 8;
+	}
+}
+
+/* Read count <= 16 bits */
+static bool get_bits(struct bit_reader *r, uint32_t *value, int count)
+{
+	while (r->count < count) {
+		if (r->pos >= r->size)
+			return false;
+		r->acc |= (uint32_t)r->in[r->pos++] << r->count;
+		r->count += 8;
+	}
+	*value = r->acc & (BIT(count) - 1);
+	r->acc >>= count;
+	r->count -= count;
+	return true;
+}
+
+size_t fp_frame_pack(const uint8_t *frame, size_t frame_size, size_t start,
+		     int sample_bits, uint8_t *out, size_t out_size,
+		     size_t *packed)
+{
+	const int bytes = sample_bits / 8;
+	struct bit_writer w = { out, 0, 0, 0 };
+	uint32_t values[FP_FRAME_PACK_BLOCK];
+	uint32_t prev = start ? get_sample(frame, start - bytes, bytes) : 0;
+	size_t offset = start;
+
+	while (offset + bytes <= frame_size) {
+		size_t n = MIN((size_t)FP_FRAME_PACK_BLOCK,
+			       (frame_size - offset) / bytes);
+		size_t best = n * sample_bits;
+		int best_k = FP_FRAME_PACK_VERBATIM;
+		uint32_t sample;
+		size_t i;
+		int k;
+
+		for (i = 0; i < n; i++) {
+			sample = get_sample(frame, offset + i * bytes, bytes);
+			values[i] = fold(sample, prev, sample_bits);
+			prev = sample;
+		}
+
+		for (k = 0; k < sample_bits; k++) {
+			size_t cost = 0;
+
+			for (i = 0; i < n; i++)
+				cost += (values[i] >> k) + 1 + k;
+			if (cost < best) {
+				best = cost;
+				best_k = k;
+			}
+		}
+
+		/* Leave the block for the next chunk if it does not fit. */
+		if (w.pos * 8 + w.count + 4 + best > out_size * 8)
+			break;
+
+		put_bits(&w, best_k, 4);
+		for (i = 0; i < n; i++, offset += bytes) {
+			uint32_t q;
+
+			if (best_k == FP_FRAME_PACK_VERBATIM) {
+				sample = get_sample(frame, offset, bytes);
+				put_bits(&w, sample, sample_bits);
+				continue;
+			}
+			/* Unary quotient: q 1 bits then a 0 bit. */
+			for (q = values[i] >> best_k; q >= 16; q -= 16)
+				put_bits(&w, 0xFFFF, 16);
+			put_bits(&w, BIT(q) - 1, q + 1);
+			if (best_k)
+				put_bits(&w, values[i] & (BIT(best_k) - 1),
+					 best_k);
+		}
+	}
+
+	if (w.count)
+		w.out[w.pos++] = w.acc;
+
+	*packed = offset - start;
+	return w.pos;
+}
+
+enum ec_error_list fp_frame_unpack(const uint8_t *in, size_t in_size,
+				   int sample_bits, uint8_t *frame,
+				   size_t start, size_t size)
+{
+	const int bytes = sample_bits / 8;
+	struct bit_reader r = { in, in_size, 0, 0, 0 };
+	uint32_t prev = start ? get_sample(frame, start - bytes, bytes) : 0;
+	size_t offset = start;
+	size_t end = start + size;
+
+	if ((sample_bits != 8 && sample_bits != 16) || size % bytes)
+		return EC_ERROR_INVAL;
+
+	while (offset < end) {
+		size_t n = MIN((size_t)FP_FRAME_PACK_BLOCK,
+			       (end - offset) / bytes);
+		uint32_t k;
+		size_t i;
+
+		if (!get_bits(&r, &k, 4))
+			return EC_ERROR_INVAL;
+		if (k >= (uint32_t)sample_bits && k != FP_FRAME_PACK_VERBATIM)
+			return EC_ERROR_INVAL;
+
+		for (i = 0; i < n; i++) {
+			uint32_t value, bit, low = 0;
+			uint32_t q = 0;
+
+			if (k == FP_FRAME_PACK_VERBATIM) {
+				if (!get_bits(&r, &value, sample_bits))
+					return EC_ERROR_INVAL;
+				prev = value;
+				put_sample(frame, offset, bytes, value);
+				offset += bytes;
+				continue;
+			}
+
+			do {
+				if (!get_bits(&r, &bit, 1))
+					return EC_ERROR_INVAL;
+				q += bit;
+			} while (bit && (q << k) < BIT(sample_bits));
+			if (bit || (k && !get_bits(&r, &low, k)))
+				return EC_ERROR_INVAL;
+
+			value = q << k | low;
+			prev = unfold(value, prev, sample_bits);
+			put_sample(frame, offset, bytes, prev);
+			offset += bytes;
+		}
+	}
+
+	/* All that may be left is the padding of the last byte. */
+	if (r.pos != in_size || r.acc)
+		return EC_ERROR_INVAL;
+
+	return EC_SUCCESS;
+}
@@ -64,6 +64,7 @@ void fp_clear_finger_context(uint16_t idx)
  */
 static void _fp_clear_context(void)
 {
+	fp_template_batch_end();
 	templ_valid = 0;
 	templ_dirty = 0;
 	OPENSSL_cleanse(fp_buffer, sizeof(fp_buffer));
@@ -219,6 +220,8 @@ static enum ec_status fp_command_context(struct host_cmd_handler_args *args)
 		if (sensor_mode & FP_MODE_RESET_SENSOR)
 			return EC_RES_BUSY;
 
+		/* A batch of templates can't go on for another user */
+		fp_template_batch_end();
 		memcpy(user_id, p->userid, sizeof(user_id));
 		return EC_RES_SUCCESS;
 	}
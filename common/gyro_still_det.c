@@ -13,18 +13,6 @@ void gyro_still_det_update(struct gyro_still_det *gyro_still_det,
 			   uint32_t stillness_win_endtime, uint32_t sample_time,
 			   fp_t x, fp_t y, fp_t z)
 {
-	fp_t delta = INT_TO_FP(0);
-
-	/*
-	 * Using the method of the assumed mean to preserve some numerical
-	 * stability while avoiding per-sample divisions that the more
-	 * numerically stable Welford method would afford.
-	 *
-	 * Reference for the numerical method used below to compute the
-	 * online mean and variance statistics:
-	 *   1). en.wikipedia.org/wiki/assumed_mean
-	 */
-
 	/* Increment the number of samples. */
 	gyro_still_det->num_acc_samples++;
 
@@ -39,19 +27,8 @@ void gyro_still_det_update(struct gyro_still_det *gyro_still_det,
 		gyro_still_det->window_start_time = sample_time;
 		gyro_still_det->start_new_window = false;
 
-		/* Update assumed mean values. */
-		gyro_still_det->assumed_mean[X] = x;
-		gyro_still_det->assumed_mean[Y] = y;
-		gyro_still_det->assumed_mean[Z] = z;
-
 		/* Reset current window mean and variance. */
-		gyro_still_det->num_acc_win_samples = 0;
-		gyro_still_det->win_mean[X] = INT_TO_FP(0);
-		gyro_still_det->win_mean[Y] = INT_TO_FP(0);
-		gyro_still_det->win_mean[Z] = INT_TO_FP(0);
-		gyro_still_det->acc_var[X] = INT_TO_FP(0);
-		gyro_still_det->acc_var[Y] = INT_TO_FP(0);
-		gyro_still_det->acc_var[Z] = INT_TO_FP(0);
+		stats_batch_reset(&gyro_still_det->win);
 	} else {
 		/*
 		 * Check to see if we have enough samples to compute a stillness
@@ -65,73 +42,27 @@ void gyro_still_det_update(struct gyro_still_det *gyro_still_det,
 	/* Record the most recent sample time stamp. */
 	gyro_still_det->last_sample_time = sample_time;
 
-	/* Online window mean and variance ("one-pass" accumulation). */
-	gyro_still_det->num_acc_win_samples++;
-
-	delta = (x - gyro_still_det->assumed_mean[X]);
-	gyro_still_det->win_mean[X] += delta;
-	gyro_still_det->acc_var[X] += fp_sq(delta);
-
-	delta = (y - gyro_still_det->assumed_mean[Y]);
-	gyro_still_det->win_mean[Y] += delta;
-	gyro_still_det->acc_var[Y] += fp_sq(delta);
-
-	delta = (z - gyro_still_det->assumed_mean[Z]);
-	gyro_still_det->win_mean[Z] += delta;
-	gyro_still_det->acc_var[Z] += fp_sq(delta);
+	/*
+	 * Online window mean and variance ("one-pass" accumulation), using
+	 * the first sample of the window as the assumed mean.
+	 */
+	stats_batch_add(&gyro_still_det->win, x, y, z);
 }
 
 fp_t gyro_still_det_compute(struct gyro_still_det *gyro_still_det)
 {
-	fp_t tmp_denom = INT_TO_FP(1);
-	fp_t tmp_denom_mean = INT_TO_FP(1);
-	fp_t tmp;
+	fp_t tmp_denom;
+	fpv3_t win_var;
 	fp_t upper_var_thresh, lower_var_thresh;
 
-	/* Don't divide by zero (not likely, but a precaution). */
-	if (gyro_still_det->num_acc_win_samples > 1) {
-		tmp_denom = fp_div(
-			tmp_denom,
-			INT_TO_FP(gyro_still_det->num_acc_win_samples - 1));
-		tmp_denom_mean =
-			fp_div(tmp_denom_mean,
-			       INT_TO_FP(gyro_still_det->num_acc_win_samples));
-	} else {
+	/* Update the final calculation of window mean and variance. */
+	if (stats_batch_compute(&gyro_still_det->win, true,
+				gyro_still_det->win_mean, win_var)) {
 		/* Return zero stillness confidence. */
 		gyro_still_det->stillness_confidence = 0;
 		return gyro_still_det->stillness_confidence;
 	}
 
-	/* Update the final calculation of window mean and variance. */
-	tmp = gyro_still_det->win_mean[X];
-	gyro_still_det->win_mean[X] =
-		fp_mul(gyro_still_det->win_mean[X], tmp_denom_mean);
-	gyro_still_det->win_var[X] =
-		fp_mul((gyro_still_det->acc_var[X] -
-			fp_mul(gyro_still_det->win_mean[X], tmp)),
-		       tmp_denom);
-
-	tmp = gyro_still_det->win_mean[Y];
-	gyro_still_det->win_mean[Y] =
-		fp_mul(gyro_still_det->win_mean[Y], tmp_denom_mean);
-	gyro_still_det->win_var[Y] =
-		fp_mul((gyro_still_det->acc_var[Y] -
-			fp_mul(gyro_still_det->win_mean[Y], tmp)),
-		       tmp_denom);
-
-	tmp = gyro_still_det->win_mean[Z];
-	gyro_still_det->win_mean[Z] =
-		fp_mul(gyro_still_det->win_mean[Z], tmp_denom_mean);
-	gyro_still_det->win_var[Z] =
-		fp_mul((gyro_still_det->acc_var[Z] -
-			fp_mul(gyro_still_det->win_mean[Z], tmp)),
-		       tmp_denom);
-
-	/* Adds the assumed mean value back to the total mean calculation. */
-	gyro_still_det->win_mean[X] += gyro_still_det->assumed_mean[X];
-	gyro_still_det->win_mean[Y] += gyro_still_det->assumed_mean[Y];
-	gyro_still_det->win_mean[Z] += gyro_still_det->assumed_mean[Z];
-
 	/* Define the variance thresholds. */
 	upper_var_thresh = gyro_still_det->var_threshold +
 			   gyro_still_det->confidence_delta;
@@ -140,17 +71,17 @@ fp_t gyro_still_det_compute(struct gyro_still_det *gyro_still_det)
 			   gyro_still_det->confidence_delta;
 
 	/* Compute the stillness confidence score. */
-	if ((gyro_still_det->win_var[X] > upper_var_thresh) ||
-	    (gyro_still_det->win_var[Y] > upper_var_thresh) ||
-	    (gyro_still_det->win_var[Z] > upper_var_thresh)) {
+	if ((win_var[X] > upper_var_thresh) ||
+	    (win_var[Y] > upper_var_thresh) ||
+	    (win_var[Z] > upper_var_thresh)) {
 		/*
 		 * Sensor variance exceeds the upper threshold (i.e., motion
 		 * detected). Set stillness confidence equal to 0.
 		 */
 		gyro_still_det->stillness_confidence = 0;
-	} else if ((gyro_still_det->win_var[X] <= lower_var_thresh) &&
-		   (gyro_still_det->win_var[Y] <= lower_var_thresh) &&
-		   (gyro_still_det->win_var[Z] <= lower_var_thresh)) {
+	} else if ((win_var[X] <= lower_var_thresh) &&
+		   (win_var[Y] <= lower_var_thresh) &&
+		   (win_var[Z] <= lower_var_thresh)) {
 		/*
 		 * Sensor variance is below the lower threshold (i.e.
 		 * stillness detected).
@@ -173,15 +104,15 @@ fp_t gyro_still_det_compute(struct gyro_still_det *gyro_still_det)
 				   (upper_var_thresh - lower_var_thresh));
 		limit[X] = gyro_still_det_limit(
 			FLOAT_TO_FP(0.5f) -
-			fp_mul(gyro_still_det->win_var[X] - var_thresh,
+			fp_mul(win_var[X] - var_thresh,
 			       tmp_denom));
 		limit[Y] = gyro_still_det_limit(
 			FLOAT_TO_FP(0.5f) -
-			fp_mul(gyro_still_det->win_var[Y] - var_thresh,
+			fp_mul(win_var[Y] - var_thresh,
 			       tmp_denom));
 		limit[Z] = gyro_still_det_limit(
 			FLOAT_TO_FP(0.5f) -
-			fp_mul(gyro_still_det->win_var[Z] - var_thresh,
+			fp_mul(win_var[Z] - var_thresh,
 			       tmp_denom));
 
 		gyro_still_det->stillness_confidence =
@@ -225,9 +156,6 @@ void gyro_still_det_reset(struct gyro_still_det *gyro_still_det,
 		gyro_still_det->mean[X] = INT_TO_FP(0);
 		gyro_still_det->mean[Y] = INT_TO_FP(0);
 		gyro_still_det->mean[Z] = INT_TO_FP(0);
-		gyro_still_det->acc_var[X] = INT_TO_FP(0);
-		gyro_still_det->acc_var[Y] = INT_TO_FP(0);
-		gyro_still_det->acc_var[Z] = INT_TO_FP(0);
 	}
 }
 
@@ -0,0 +1,96 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Time taken by each HOOK_INIT routine at boot */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "system.h"
+#include "timer.h"
+#include "util.h"
+
+BUILD_ASSERT(CONFIG_HOOK_INIT_TIMES_SLOTS <= UINT8_MAX);
+
+/* In the order the hooks ran */
+static struct ec_hook_init_time init_times[CONFIG_HOOK_INIT_TIMES_SLOTS];
+static uint8_t init_count;
+static uint8_t untracked;
+static uint32_t total_us;
+
+void hook_call_init_timed(void (*routine)(void), int priority)
+{
+	timestamp_t start = get_time();
+	uint32_t us;
+
+	routine();
+
+	us = get_time().val - start.val;
+	total_us += us;
+	if (init_count >= ARRAY_SIZE(init_times)) {
+		if (untracked < UINT8_MAX)
+			untracked++;
+		return;
+	}
+
+	init_times[init_count].routine = (uint32_t)(uintptr_t)routine;
+	init_times[init_count].time_us = us;
+	init_times[init_count].priority = priority;
+	init_count++;
+}
+
+static enum ec_status
+host_command_hook_init_times(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_hook_init_times *p = args->params;
+	struct ec_response_hook_init_times *r = args->response;
+	size_t room;
+
+	if (args->params_size < sizeof(*p))
+		return EC_RES_INVALID_PARAM;
+	if (args->response_max < sizeof(*r))
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	room = (args->response_max - sizeof(*r)) / sizeof(r->entries[0]);
+
+	r->total = init_count;
+	r->count = p->index < init_count ? MIN(init_count - p->index, room) : 0;
+	r->flags = system_jumped_to_this_image() ?
+			   EC_HOOK_INIT_TIMES_FLAG_JUMPED :
+			   0;
+	r->untracked = untracked;
+	r->total_us = total_us;
+	if (r->count)
+		memcpy(r->entries, &init_times[p->index],
+		       r->count * sizeof(r->entries[0]));
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entries[0]);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_HOOK_INIT_TIMES, host_command_hook_init_times,
+		     EC_VER_MASK(0));
+
+static int command_inittimes(int argc, const char **argv)
+{
+	int i;
+
+	ccprintf("%s boot, init hooks took %u us\n",
+		 system_jumped_to_this_image() ? "Jump" : "Cold", total_us);
+	ccprintf("   time_us prio routine\n");
+	for (i = 0; i < init_count; i++) {
+		ccprintf("%10u %4u 0x%08x\n", init_times[i].time_us,
+			 init_times[i].priority, init_times[i].routine);
+		cflush();
+	}
+	if (untracked)
+		ccprintf("%u more hooks not listed\n", untracked);
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(inittimes, command_inittimes, NULL,
+			"Show the time taken by each init hook");
@@ -135,7 +135,11 @@ void hook_notify(enum hook_type type)
 		for (p = start; p < end; p++) {
 			if (p->priority == prio) {
 				called++;
-				p->routine();
+				if (IS_ENABLED(CONFIG_HOOK_INIT_TIMES) &&
+				    type == HOOK_INIT)
+					hook_call_init_timed(p->routine, prio);
+				else
+					p->routine();
 			}
 		}
 	}
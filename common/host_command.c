@@ -44,12 +44,46 @@ uint8_t *host_get_memmap(int offset)
 #endif
 }
 
+/* Writers in the middle of an update, for each sequence counter */
+static uint8_t memmap_writers[EC_MEMMAP_MOTION_SEQ - EC_MEMMAP_THERMAL_SEQ + 1];
+
+static uint8_t *memmap_writers_of(int seq_offset)
+{
+	ASSERT(seq_offset >= EC_MEMMAP_THERMAL_SEQ &&
+	       seq_offset <= EC_MEMMAP_MOTION_SEQ);
+	return &memmap_writers[seq_offset - EC_MEMMAP_THERMAL_SEQ];
+}
+
+void host_memmap_write_begin(int seq_offset)
+{
+	uint8_t *writers = memmap_writers_of(seq_offset);
+	uint32_t key = irq_lock();
+
+	if ((*writers)++ == 0)
+		(*host_get_memmap(seq_offset))++;
+	irq_unlock(key);
+	/* The host must see the odd counter before any of the data. */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+void host_memmap_write_end(int seq_offset)
+{
+	uint8_t *writers = memmap_writers_of(seq_offset);
+	uint32_t key;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	key = irq_lock();
+	if (--(*writers) == 0)
+		(*host_get_memmap(seq_offset))++;
+	irq_unlock(key);
+}
+
 void host_command_init(void)
 {
 	/* Initialize memory map ID area */
 	host_get_memmap(EC_MEMMAP_ID)[0] = 'E';
 	host_get_memmap(EC_MEMMAP_ID)[1] = 'C';
-	*host_get_memmap(EC_MEMMAP_ID_VERSION) = 1;
+	*host_get_memmap(EC_MEMMAP_ID_VERSION) = EC_MEMMAP_SEQ_ID_VERSION;
 	*host_get_memmap(EC_MEMMAP_EVENTS_VERSION) = 1;
 
 #ifdef CONFIG_HOSTCMD_EVENTS
@@ -0,0 +1,179 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Host command execution statistics */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "util.h"
+
+BUILD_ASSERT(POWER_OF_TWO(CONFIG_HOSTCMD_STATS_SLOTS));
+BUILD_ASSERT(CONFIG_HOSTCMD_STATS_SLOTS <= UINT8_MAX);
+
+/* Slot is empty when calls == 0 */
+static struct ec_hostcmd_stats_entry hc_stats[CONFIG_HOSTCMD_STATS_SLOTS];
+static uint16_t queue_hist[EC_HOSTCMD_STATS_BUCKETS];
+static uint32_t untracked;
+static uint8_t slots_used;
+
+static int stats_bucket(uint32_t us)
+{
+	int b;
+
+	if (us < 2)
+		return 0;
+
+	b = __fls(us);
+	return MIN(b, EC_HOSTCMD_STATS_BUCKETS - 1);
+}
+
+static void hist_add(uint16_t *hist, uint32_t us)
+{
+	int b = stats_bucket(us);
+
+	if (hist[b] != UINT16_MAX)
+		hist[b]++;
+}
+
+/*
+ * Find the slot for a command, claiming an empty one if it hasn't been seen
+ * before. Open addressing with linear probing keeps lookup O(1) on average
+ * without needing a table covering the whole (sparse) command space.
+ */
+static struct ec_hostcmd_stats_entry *stats_slot(uint16_t command)
+{
+	uint32_t i = (command * 0x9e37U) & (CONFIG_HOSTCMD_STATS_SLOTS - 1);
+	int n;
+
+	for (n = 0; n < CONFIG_HOSTCMD_STATS_SLOTS; n++) {
+		struct ec_hostcmd_stats_entry *e = &hc_stats[i];
+
+		if (!e->calls) {
+			e->command = command;
+			slots_used++;
+			return e;
+		}
+		if (e->command == command)
+			return e;
+		i = (i + 1) & (CONFIG_HOSTCMD_STATS_SLOTS - 1);
+	}
+
+	return NULL;
+}
+
+void host_command_stats_record(uint16_t command, uint16_t result,
+			       uint32_t exec_us)
+{
+	struct ec_hostcmd_stats_entry *e = stats_slot(command);
+
+	if (!e) {
+		untracked++;
+		return;
+	}
+
+	e->calls++;
+	if (result != EC_RES_SUCCESS)
+		e->errors++;
+	e->total_us += exec_us;
+	e->max_us = MAX(e->max_us, exec_us);
+	hist_add(e->hist, exec_us);
+}
+
+void host_command_stats_record_queue(uint32_t queue_us)
+{
+	hist_add(queue_hist, queue_us);
+}
+
+static void host_command_stats_reset(void)
+{
+	memset(hc_stats, 0, sizeof(hc_stats));
+	memset(queue_hist, 0, sizeof(queue_hist));
+	untracked = 0;
+	slots_used = 0;
+}
+
+static enum ec_status
+host_command_hostcmd_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_hostcmd_stats *p = args->params;
+	struct ec_response_hostcmd_stats *r = args->response;
+	size_t room;
+	int i, skip;
+
+	if (args->params_size < sizeof(*p))
+		return EC_RES_INVALID_PARAM;
+	if (args->response_max < sizeof(*r))
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	room = (args->response_max - sizeof(*r)) / sizeof(r->entries[0]);
+
+	r->total = slots_used;
+	r->count = 0;
+	r->untracked = untracked;
+	memcpy(r->queue_hist, queue_hist, sizeof(r->queue_hist));
+
+	/* Entries are numbered in table order, skipping empty slots */
+	skip = p->index;
+	for (i = 0; i < CONFIG_HOSTCMD_STATS_SLOTS && r->count < room; i++) {
+		if (!hc_stats[i].calls)
+			continue;
+		if (skip) {
+			skip--;
+			continue;
+		}
+		r->entries[r->count++] = hc_stats[i];
+	}
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entries[0]);
+
+	if (p->flags & EC_HOSTCMD_STATS_FLAG_RESET)
+		host_command_stats_reset();
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_HOSTCMD_STATS, host_command_hostcmd_stats,
+		     EC_VER_MASK(0));
+
+#ifdef CONFIG_CMD_HCDEBUG
+static void print_hist(const uint16_t *hist)
+{
+	int i;
+
+	for (i = 0; i < EC_HOSTCMD_STATS_BUCKETS; i++)
+		ccprintf(" %u", hist[i]);
+	ccprintf("\n");
+}
+
+static int command_hcstats(int argc, const char **argv)
+{
+	int i;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "reset"))
+			return EC_ERROR_PARAM1;
+		host_command_stats_reset();
+		return EC_SUCCESS;
+	}
+
+	ccprintf("cmd    calls  errors   avg_us   max_us\n");
+	for (i = 0; i < CONFIG_HOSTCMD_STATS_SLOTS; i++) {
+		const struct ec_hostcmd_stats_entry *e = &hc_stats[i];
+
+		if (!e->calls)
+			continue;
+		ccprintf("0x%04x %6u %6u %8u %8u\n", e->command, e->calls,
+			 e->errors, e->total_us / e->calls, e->max_us);
+		cflush();
+	}
+	ccprintf("untracked: %u\nqueue (log2 us):", untracked);
+	print_hist(queue_hist);
+
+	return EC_SUCCESS;
+}
+DECLARE_CONSOLE_COMMAND(hcstats, command_hcstats, "[reset]",
+			"Show host command execution statistics");
+#endif /* CONFIG_CMD_HCDEBUG */
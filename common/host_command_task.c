@@ -73,6 +73,11 @@ static struct host_cmd_handler_args args0;
 /* Current host command packet from host, for protocol version 3+ */
 static struct host_packet *pkt0;
 
+#ifdef CONFIG_HOSTCMD_STATS
+/* When the pending command arrived at the host interface */
+static timestamp_t received_time;
+#endif
+
 /*
  * Host command suppress
  */
@@ -156,6 +161,12 @@ void host_command_received(struct host_cmd_handler_args *args)
 	hang_detect_stop_on_host_command();
 #endif
 
+#ifdef CONFIG_HOSTCMD_STATS
+	/* Packet commands were already stamped in host_packet_receive() */
+	if (args != &args0)
+		received_time = get_time();
+#endif
+
 	if (args->result) {
 		; /* driver has signalled an error, respond now */
 #ifdef CONFIG_HOST_COMMAND_STATUS
@@ -232,6 +243,10 @@ void host_packet_receive(struct host_packet *pkt)
 	/* Track the packet we're handling */
 	pkt0 = pkt;
 
+#ifdef CONFIG_HOSTCMD_STATS
+	received_time = get_time();
+#endif
+
 	/* If driver indicates error, don't even look at the data */
 	if (pkt->driver_result) {
 		args0.result = pkt->driver_result;
@@ -399,6 +414,10 @@ void host_command_task(void *u)
 
 		/* Process it */
 		if ((evt & TASK_EVENT_CMD_PENDING) && pending_args) {
+#ifdef CONFIG_HOSTCMD_STATS
+			host_command_stats_record_queue(t0.val -
+							received_time.val);
+#endif
 			pending_args->result =
 				host_command_process(pending_args);
 			host_send_response(pending_args);
@@ -524,10 +543,18 @@ uint16_t host_command_process(struct host_cmd_handler_args *args)
 {
 	const struct host_command *cmd;
 	int rv;
+#ifdef CONFIG_HOSTCMD_STATS
+	timestamp_t t_start;
+#endif
 
 	if (hcdebug)
 		host_command_debug_request(args);
 
+#ifdef CONFIG_HOSTCMD_STATS
+	/* Don't charge the command for the debug output above */
+	t_start = get_time();
+#endif
+
 	/*
 	 * Pre-emptively clear the entire response buffer so we do not
 	 * have any left over contents from previous host commands.
@@ -569,6 +596,11 @@ uint16_t host_command_process(struct host_cmd_handler_args *args)
 			rv = cmd->handler(args);
 	}
 
+#ifdef CONFIG_HOSTCMD_STATS
+	host_command_stats_record(args->command, rv,
+				  get_time().val - t_start.val);
+#endif
+
 	if (rv != EC_RES_SUCCESS)
 		CPRINTS("HC 0x%04x err %d", args->command, rv);
 
@@ -18,6 +18,7 @@
 #include "keyboard_8042_sharedlib.h"
 #include "keyboard_config.h"
 #include "keyboard_protocol.h"
+#include "keyboard_scan.h"
 #include "lightbar.h"
 #include "lpc.h"
 #include "power_button.h"
@@ -229,6 +230,140 @@ static void kblog_put(char type, uint8_t byte)
 	}
 }
 
+/*****************************************************************************/
+/* Key event latency */
+
+/*
+ * Bytes ever added to and taken from the to_host queue. The host read a key
+ * event when it read the byte numbered as the last one of its scan code.
+ */
+static uint32_t to_host_added;
+static uint32_t to_host_taken;
+/* Number of the to_host byte in the output buffer, 0 if not one */
+static uint32_t to_host_in_obuf;
+
+/* Key events queued, whose scan code the host has yet to read */
+#define KBLATENCY_IN_FLIGHT 4
+
+struct kblatency_event {
+	uint32_t read_us; /* Matrix read */
+	uint32_t queue_us; /* Scan code queued */
+	uint32_t last_byte; /* Number of the last byte of the scan code */
+};
+
+static struct kblatency_event kblatency_events[KBLATENCY_IN_FLIGHT];
+static uint8_t kblatency_first; /* Oldest event in flight */
+static uint8_t kblatency_count; /* Events in flight */
+static struct ec_response_8042_latency kblatency_stats;
+
+/**
+ * Start timing a key event, whose scan code was just queued.
+ *
+ * Must be called with to_host_mutex held, from keyboard_state_changed().
+ */
+static void kblatency_queued(void)
+{
+	uint32_t key;
+
+	if (!IS_ENABLED(CONFIG_8042_LATENCY))
+		return;
+
+	key = irq_lock();
+	if (kblatency_count < KBLATENCY_IN_FLIGHT) {
+		struct kblatency_event *e =
+			&kblatency_events[(kblatency_first + kblatency_count) %
+					  KBLATENCY_IN_FLIGHT];
+
+		e->read_us = keyboard_scan_get_read_time();
+		e->queue_us = get_time().le.lo;
+		e->last_byte = to_host_added;
+		kblatency_count++;
+	} else {
+		kblatency_stats.untracked++;
+	}
+	irq_unlock(key);
+}
+
+static void kblatency_stat_add(struct ec_8042_latency_stat *stat, uint32_t us)
+{
+	if (!kblatency_stats.count || us < stat->min_us)
+		stat->min_us = us;
+	stat->max_us = MAX(stat->max_us, us);
+	stat->total_us += us;
+}
+
+/**
+ * Finish timing the key events the host is done reading.
+ *
+ * Must be called with interrupts locked, once the output buffer is empty.
+ */
+static void kblatency_host_read(void)
+{
+	uint32_t now;
+
+	if (!IS_ENABLED(CONFIG_8042_LATENCY) || !to_host_in_obuf)
+		return;
+
+	now = get_time().le.lo;
+	while (kblatency_count) {
+		struct kblatency_event *e = &kblatency_events[kblatency_first];
+
+		if ((int32_t)(to_host_in_obuf - e->last_byte) < 0)
+			break;
+		kblatency_stat_add(
+			&kblatency_stats.stages[EC_8042_LATENCY_QUEUE],
+			e->queue_us - e->read_us);
+		kblatency_stat_add(
+			&kblatency_stats.stages[EC_8042_LATENCY_SEND],
+			now - e->queue_us);
+		kblatency_stat_add(
+			&kblatency_stats.stages[EC_8042_LATENCY_TOTAL],
+			now - e->read_us);
+		kblatency_stats.count++;
+		kblatency_first = (kblatency_first + 1) % KBLATENCY_IN_FLIGHT;
+		kblatency_count--;
+	}
+	to_host_in_obuf = 0;
+}
+
+/**
+ * Forget the key events in flight, their bytes are gone.
+ *
+ * Must be called with interrupts locked.
+ */
+static void kblatency_flush(void)
+{
+	kblatency_stats.untracked += kblatency_count;
+	kblatency_count = 0;
+	to_host_taken = to_host_added;
+	to_host_in_obuf = 0;
+}
+
+#ifdef CONFIG_8042_LATENCY
+static enum ec_status
+host_command_8042_latency(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_8042_latency *p = args->params;
+	struct ec_response_8042_latency *r = args->response;
+	uint32_t key;
+
+	if (args->params_size < sizeof(*p))
+		return EC_RES_INVALID_PARAM;
+
+	key = irq_lock();
+	*r = kblatency_stats;
+	if (p->flags & EC_8042_LATENCY_FLAG_RESET)
+		memset(&kblatency_stats, 0, sizeof(kblatency_stats));
+	irq_unlock(key);
+
+	args->response_size = sizeof(*r);
+
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_8042_LATENCY, host_command_8042_latency,
+		     EC_VER_MASK(0));
+#endif /* CONFIG_8042_LATENCY */
+
 /*****************************************************************************/
 
 void keyboard_host_write(int data, int is_cmd)
@@ -268,61 +403,190 @@ static void aux_enable_irq(int enable)
 }
 
 /**
- * Send a scan code to the host.
+ * Queue bytes for the host, if there's space for all of them.
  *
- * The EC lib will push the scan code bytes to host via port 0x60 and assert
- * the IBF flag to trigger an interrupt.  The EC lib must queue them if the
- * host cannot read the previous byte away in time.
+ * Must be called with to_host_mutex held.
  *
  * @param len		Number of bytes to send to the host
  * @param bytes		Data to send
  * @param chan		Channel to send data on
+ * @return 1 if the bytes were queued, 0 if they were dropped.
  */
-static void i8042_send_to_host(int len, const uint8_t *bytes, uint8_t chan,
+static int i8042_queue_to_host(int len, const uint8_t *bytes, uint8_t chan,
 			       int is_typematic)
 {
 	int i;
 	struct data_byte data;
-
-	/* Enqueue output data if there's space */
-	mutex_lock(&to_host_mutex);
+	struct queue const *queue = &to_host;
 
 	if (is_typematic && !typematic_len) {
 		for (i = 0; i < len; i++)
 			kblog_put('r', bytes[i]);
-	} else {
-		struct queue const *queue = &to_host;
+		return 0;
+	}
 
-		if (chan == CHAN_CMD)
-			queue = &to_host_cmd;
+	if (chan == CHAN_CMD)
+		queue = &to_host_cmd;
 
-		for (i = 0; i < len; i++) {
-			char type;
+	for (i = 0; i < len; i++) {
+		char type;
 
-			if (chan == CHAN_AUX)
-				type = 'a';
-			else if (chan == CHAN_CMD)
-				type = 'u';
-			else
-				type = 's';
-			kblog_put(type, bytes[i]);
-		}
+		if (chan == CHAN_AUX)
+			type = 'a';
+		else if (chan == CHAN_CMD)
+			type = 'u';
+		else
+			type = 's';
+		kblog_put(type, bytes[i]);
+	}
 
-		if (queue_space(queue) >= len) {
-			kblog_put('t', queue->state->tail);
-			for (i = 0; i < len; i++) {
-				data.chan = chan;
-				data.byte = bytes[i];
-				queue_add_unit(queue, &data);
-			}
-		}
+	if (queue_space(queue) < len)
+		return 0;
+
+	kblog_put('t', queue->state->tail);
+	for (i = 0; i < len; i++) {
+		data.chan = chan;
+		data.byte = bytes[i];
+		queue_add_unit(queue, &data);
 	}
+	if (queue == &to_host)
+		to_host_added += len;
+	return 1;
+}
+
+/**
+ * Move the next byte of the to-host queues to the output buffer, if the host
+ * read the previous one.
+ *
+ * Command responses go first. Other bytes wait while the second byte of a
+ * SETLEDS command is expected.
+ *
+ * This is called by the task, and with CONFIG_8042_FAST_PATH from the key
+ * scan task and from the interrupt of the host reading the output buffer.
+ *
+ * @return 1 if a byte was sent.
+ */
+static int i8042_put_next_byte(void)
+{
+	struct data_byte entry;
+	uint32_t key;
+
+	key = irq_lock();
+	if (lpc_keyboard_has_char()) {
+		irq_unlock(key);
+		return 0;
+	}
+
+	/* The host is done with the previous byte, even if not told yet. */
+	kblatency_host_read();
+
+	/*
+	 * We know DBBOUT is empty but we need act quickly as the host might be
+	 * sending a byte to DBBIN.
+	 *
+	 * So be cautious if you're adding any code below up to
+	 * lpc_keyboard_put_char since that'll increase the race condition. For
+	 * example, you don't want to add CPRINTS or kblog_put.
+	 *
+	 * We should claim OBF=1 atomically to prevent the host from writing to
+	 * DBBIN (i.e. set-ibf-if-not-obf). It's not possible for NPCX because
+	 * NPCX's HIKMST-IBF is read-only.
+	 */
+	if (queue_remove_unit(&to_host_cmd, &entry)) {
+		to_host_in_obuf = 0;
+	} else if (data_port_state != STATE_ATKBD_SETLEDS &&
+		   queue_remove_unit(&to_host, &entry)) {
+		to_host_in_obuf = ++to_host_taken;
+	} else {
+		irq_unlock(key);
+		return 0;
+	}
+
+	/* Write to host. */
+	if (entry.chan == CHAN_AUX && IS_ENABLED(CONFIG_8042_AUX)) {
+		lpc_aux_put_char(entry.byte, i8042_aux_irq_enabled);
+		kblog_put('A', entry.byte);
+	} else {
+		lpc_keyboard_put_char(entry.byte, i8042_keyboard_irq_enabled);
+		kblog_put('K', entry.byte);
+	}
+	irq_unlock(key);
+
+	return 1;
+}
+
+/**
+ * Whether bytes may go to the host without the task looking first: the
+ * keyboard is enabled, and there's no host command to answer beforehand.
+ */
+static int i8042_fast_path_open(void)
+{
+	return IS_ENABLED(CONFIG_8042_FAST_PATH) && keyboard_enabled &&
+	       queue_is_empty(&from_host);
+}
+
+/**
+ * Send a scan code to the host.
+ *
+ * The EC lib will push the scan code bytes to host via port 0x60 and assert
+ * the IBF flag to trigger an interrupt.  The EC lib must queue them if the
+ * host cannot read the previous byte away in time.
+ *
+ * @param len		Number of bytes to send to the host
+ * @param bytes		Data to send
+ * @param chan		Channel to send data on
+ */
+static void i8042_send_to_host(int len, const uint8_t *bytes, uint8_t chan,
+			       int is_typematic)
+{
+	/* Enqueue output data if there's space */
+	mutex_lock(&to_host_mutex);
+	i8042_queue_to_host(len, bytes, chan, is_typematic);
 	mutex_unlock(&to_host_mutex);
 
 	/* Wake up the task to move from queue to host */
 	task_wake(TASK_ID_KEYPROTO);
 }
 
+/**
+ * Send the scan code of a key event to the host.
+ *
+ * With CONFIG_8042_FAST_PATH, the first byte goes to the output buffer right
+ * away if the host read the previous one, and the host reading it pulls the
+ * next ones (see keyboard_host_read()). The task is only woken up otherwise.
+ *
+ * @param len		Number of bytes to send to the host
+ * @param bytes		Data to send
+ */
+static void i8042_send_key(int len, const uint8_t *bytes)
+{
+	mutex_lock(&to_host_mutex);
+	if (i8042_queue_to_host(len, bytes, CHAN_KBD, 0))
+		kblatency_queued();
+	mutex_unlock(&to_host_mutex);
+
+	if (i8042_fast_path_open() && i8042_put_next_byte())
+		return;
+
+	task_wake(TASK_ID_KEYPROTO);
+}
+
+void keyboard_host_read(void)
+{
+	uint32_t key;
+
+	key = irq_lock();
+	if (!lpc_keyboard_has_char())
+		kblatency_host_read();
+	irq_unlock(key);
+
+	/* Keep the host fed without a round trip through the task. */
+	if (i8042_fast_path_open() && i8042_put_next_byte())
+		return;
+
+	task_wake(TASK_ID_KEYPROTO);
+}
+
 /* Change to set 1 if the I8042_XLATE flag is set. */
 static enum scancode_set_list acting_code_set(enum scancode_set_list set)
 {
@@ -437,11 +701,16 @@ test_export_static void reset_rate_and_delay(void)
 
 void keyboard_clear_buffer(void)
 {
+	uint32_t key;
+
 	CPRINTS("KB Clear Buffer");
 	mutex_lock(&to_host_mutex);
 	kblog_put('x', queue_count(&to_host));
+	key = irq_lock();
 	queue_init(&to_host);
 	queue_init(&to_host_cmd);
+	kblatency_flush();
+	irq_unlock(key);
 	mutex_unlock(&to_host_mutex);
 	lpc_keyboard_clear_buffer();
 }
@@ -485,7 +754,7 @@ void keyboard_state_changed(int row, int col, int is_pressed)
 	if (ret == EC_SUCCESS) {
 		ASSERT(len > 0);
 		if (keystroke_enabled)
-			i8042_send_to_host(len, scan_code, CHAN_KBD, 0);
+			i8042_send_key(len, scan_code);
 	}
 
 	if (is_pressed) {
@@ -932,7 +1201,6 @@ void keyboard_protocol_task(void *u)
 
 		while (1) {
 			timestamp_t t = get_time();
-			struct data_byte entry;
 
 			/* Handle typematic */
 			if (!typematic_len) {
@@ -987,25 +1255,8 @@ void keyboard_protocol_task(void *u)
 				break;
 			}
 
-			/*
-			 * We know DBBOUT is empty but we need act quickly as
-			 * the host might be sending a byte to DBBIN.
-			 *
-			 * So be cautious if you're adding any code below up to
-			 * lpc_keyboard_put_char since that'll increase the race
-			 * condition. For example, you don't want to add CPRINTS
-			 * or kblog_put.
-			 *
-			 * We should claim OBF=1 atomically to prevent the host
-			 * from writing to DBBIN (i.e. set-ibf-if-not-obf). It's
-			 * not possible for NPCX because NPCX's HIKMST-IBF is
-			 * read-only.
-			 */
-
-			/* Get a char from buffer. */
-			if (queue_count(&to_host_cmd)) {
-				queue_remove_unit(&to_host_cmd, &entry);
-			} else if (data_port_state == STATE_ATKBD_SETLEDS) {
+			if (data_port_state == STATE_ATKBD_SETLEDS &&
+			    queue_is_empty(&to_host_cmd)) {
 				/*
 				 * to_host_cmd == empty and to_host != empty.
 				 * We're in SETLEDS thus expecting the 2nd byte.
@@ -1030,24 +1281,10 @@ void keyboard_protocol_task(void *u)
 				 */
 				CPRINTS("KB SETLEDS timeout");
 				data_port_state = STATE_ATKBD_CMD;
-				queue_remove_unit(&to_host, &entry);
-			} else {
-				/* to_host isn't empty && not in SETLEDS */
-				queue_remove_unit(&to_host, &entry);
 			}
 
-			/* Write to host. */
-			if (entry.chan == CHAN_AUX &&
-			    IS_ENABLED(CONFIG_8042_AUX)) {
-				lpc_aux_put_char(entry.byte,
-						 i8042_aux_irq_enabled);
-				kblog_put('A', entry.byte);
-			} else {
-				lpc_keyboard_put_char(
-					entry.byte, i8042_keyboard_irq_enabled);
-				kblog_put('K', entry.byte);
-			}
-			retries = 0;
+			if (i8042_put_next_byte())
+				retries = 0;
 		}
 	}
 }
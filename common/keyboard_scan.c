@@ -542,6 +542,11 @@ static int has_ghosting(const uint8_t *state)
 	return 0;
 }
 
+uint32_t keyboard_scan_get_read_time(void)
+{
+	return scan_time[scan_time_index];
+}
+
 /* Inform keyboard module if scanning is enabled */
 test_mockable_static void key_state_changed(int row, int col, uint8_t state)
 {
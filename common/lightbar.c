@@ -19,6 +19,7 @@
 #include "lb_common.h"
 #include "lid_switch.h"
 #include "lightbar.h"
+#include "lightbyte.h"
 #include "motion_sense.h"
 #include "pwm.h"
 #include "system.h"
@@ -379,34 +380,43 @@ void demo_tap(void)
 /* Helper functions and data. */
 /******************************************************************************/
 
-#define F(x) (x * FP_SCALE)
+/*
+ * A smooth ramp from 0.0 to 1.0, given at 33 points and filled in at compile
+ * time for all the 129 steps that cycle_010() looks up.
+ */
+#define F(x) ((int)(x * FP_SCALE))
+#define STEPS(a, b)                              \
+	F(a), F(a) + ((F(b) - F(a)) >> 2),       \
+		F(a) + ((F(b) - F(a)) * 2 >> 2), \
+		F(a) + ((F(b) - F(a)) * 3 >> 2)
 static const uint16_t _ramp_table[] = {
-	F(0.000000), F(0.002408), F(0.009607), F(0.021530), F(0.038060),
-	F(0.059039), F(0.084265), F(0.113495), F(0.146447), F(0.182803),
-	F(0.222215), F(0.264302), F(0.308658), F(0.354858), F(0.402455),
-	F(0.450991), F(0.500000), F(0.549009), F(0.597545), F(0.645142),
-	F(0.691342), F(0.735698), F(0.777785), F(0.817197), F(0.853553),
-	F(0.886505), F(0.915735), F(0.940961), F(0.961940), F(0.978470),
-	F(0.990393), F(0.997592), F(1.000000),
+	STEPS(0.000000, 0.002408), STEPS(0.002408, 0.009607),
+	STEPS(0.009607, 0.021530), STEPS(0.021530, 0.038060),
+	STEPS(0.038060, 0.059039), STEPS(0.059039, 0.084265),
+	STEPS(0.084265, 0.113495), STEPS(0.113495, 0.146447),
+	STEPS(0.146447, 0.182803), STEPS(0.182803, 0.222215),
+	STEPS(0.222215, 0.264302), STEPS(0.264302, 0.308658),
+	STEPS(0.308658, 0.354858), STEPS(0.354858, 0.402455),
+	STEPS(0.402455, 0.450991), STEPS(0.450991, 0.500000),
+	STEPS(0.500000, 0.549009), STEPS(0.549009, 0.597545),
+	STEPS(0.597545, 0.645142), STEPS(0.645142, 0.691342),
+	STEPS(0.691342, 0.735698), STEPS(0.735698, 0.777785),
+	STEPS(0.777785, 0.817197), STEPS(0.817197, 0.853553),
+	STEPS(0.853553, 0.886505), STEPS(0.886505, 0.915735),
+	STEPS(0.915735, 0.940961), STEPS(0.940961, 0.961940),
+	STEPS(0.961940, 0.978470), STEPS(0.978470, 0.990393),
+	STEPS(0.990393, 0.997592), STEPS(0.997592, 1.000000),
+	F(1.000000),
 };
+#undef STEPS
 #undef F
+BUILD_ASSERT(ARRAY_SIZE(_ramp_table) == 129);
 
 /* This function provides a smooth ramp up from 0.0 to 1.0 and back to 0.0,
  * for input from 0x00 to 0xff. */
 static inline int cycle_010(uint8_t i)
 {
-	uint8_t bucket, index;
-
-	if (i == 128)
-		return FP_SCALE;
-	else if (i > 128)
-		i = 256 - i;
-
-	bucket = i >> 2;
-	index = i & 0x3;
-
-	return _ramp_table[bucket] +
-	       ((_ramp_table[bucket + 1] - _ramp_table[bucket]) * index >> 2);
+	return _ramp_table[i <= 128 ? i : 256 - i];
 }
 
 /******************************************************************************/
@@ -1113,51 +1123,24 @@ static uint32_t sequence_TAP(void)
 /* When a program halts, return this. */
 #define PROGRAM_FINISHED 2
 
-static struct lightbar_program cur_prog;
 static struct lightbar_program next_prog;
+/* The running program, decoded when it starts. */
+static struct lightbyte_inst prog_insts[LIGHTBYTE_MAX_INSTS];
 static uint8_t pc;
 
 static uint8_t led_desc[NUM_LEDS][LB_CONT_MAX][3];
 static uint32_t lb_wait_delay;
 static uint32_t lb_ramp_delay;
-/* Get one byte of data pointed to by the pc and advance
- * the pc forward.
- */
-static inline uint32_t decode_8(uint8_t *dest)
-{
-	if (pc >= cur_prog.size) {
-		CPRINTS("pc 0x%02x out of bounds", pc);
-		return EC_RES_INVALID_PARAM;
-	}
-	*dest = cur_prog.data[pc++];
-	return EC_SUCCESS;
-}
-
-/* Get four bytes of data pointed to by the pc and advance
- * the pc forward that amount.
- */
-static inline uint32_t decode_32(uint32_t *dest)
-{
-	if (pc >= cur_prog.size - 3) {
-		CPRINTS("pc 0x%02x near or out of bounds", pc);
-		return EC_RES_INVALID_PARAM;
-	}
-	*dest = cur_prog.data[pc++] << 24;
-	*dest |= cur_prog.data[pc++] << 16;
-	*dest |= cur_prog.data[pc++] << 8;
-	*dest |= cur_prog.data[pc++];
-	return EC_SUCCESS;
-}
 
 /* ON - turn on lightbar */
-static uint32_t lightbyte_ON(void)
+static uint32_t lightbyte_ON(const struct lightbyte_inst *inst)
 {
 	lb_on();
 	return EC_SUCCESS;
 }
 
 /* OFF - turn off lightbar */
-static uint32_t lightbyte_OFF(void)
+static uint32_t lightbyte_OFF(const struct lightbyte_inst *inst)
 {
 	lb_off();
 	return EC_SUCCESS;
@@ -1166,9 +1149,10 @@ static uint32_t lightbyte_OFF(void)
 /* JUMP xx - jump to immediate location
  * Changes the pc to the one-byte immediate argument.
  */
-static uint32_t lightbyte_JUMP(void)
+static uint32_t lightbyte_JUMP(const struct lightbyte_inst *inst)
 {
-	return decode_8(&pc);
+	pc = inst->arg[0];
+	return EC_SUCCESS;
 }
 
 /* JUMP_BATTERY aa bb - switch on battery level
@@ -1176,19 +1160,13 @@ static uint32_t lightbyte_JUMP(void)
  * If the battery is high, changes pc to bb.
  * Otherwise, continues execution as normal.
  */
-static uint32_t lightbyte_JUMP_BATTERY(void)
+static uint32_t lightbyte_JUMP_BATTERY(const struct lightbyte_inst *inst)
 {
-	uint8_t low_pc, high_pc;
-	if (decode_8(&low_pc) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-	if (decode_8(&high_pc) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-
 	get_battery_level();
 	if (st.battery_level == 0)
-		pc = low_pc;
+		pc = inst->arg[0];
 	else if (st.battery_level == 3)
-		pc = high_pc;
+		pc = inst->arg[1];
 
 	return EC_SUCCESS;
 }
@@ -1196,14 +1174,10 @@ static uint32_t lightbyte_JUMP_BATTERY(void)
 /* JUMP_IF_CHARGING xx - conditional jump to location
  * Changes the pc to xx if the device is charging.
  */
-static uint32_t lightbyte_JUMP_IF_CHARGING(void)
+static uint32_t lightbyte_JUMP_IF_CHARGING(const struct lightbyte_inst *inst)
 {
-	uint8_t charge_pc;
-	if (decode_8(&charge_pc) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-
 	if (st.battery_is_charging)
-		pc = charge_pc;
+		pc = inst->arg[0];
 
 	return EC_SUCCESS;
 }
@@ -1213,9 +1187,10 @@ static uint32_t lightbyte_JUMP_IF_CHARGING(void)
  * microseconds. Future WAIT instructions will wait for this
  * much time.
  */
-static uint32_t lightbyte_SET_WAIT_DELAY(void)
+static uint32_t lightbyte_SET_WAIT_DELAY(const struct lightbyte_inst *inst)
 {
-	return decode_32(&lb_wait_delay);
+	lb_wait_delay = inst->delay;
+	return EC_SUCCESS;
 }
 
 /* SET_RAMP_DELAY xx xx xx xx - change ramp speed
@@ -1223,16 +1198,17 @@ static uint32_t lightbyte_SET_WAIT_DELAY(void)
  * the four-byte immediate argument, which represents a duration
  * in milliseconds.
  */
-static uint32_t lightbyte_SET_RAMP_DELAY(void)
+static uint32_t lightbyte_SET_RAMP_DELAY(const struct lightbyte_inst *inst)
 {
-	return decode_32(&lb_ramp_delay);
+	lb_ramp_delay = inst->delay;
+	return EC_SUCCESS;
 }
 
 /* WAIT - yield processor for some time
  * Yields the processor for some amount of time set by the most
  * recent SET_WAIT_DELAY instruction.
  */
-static uint32_t lightbyte_WAIT(void)
+static uint32_t lightbyte_WAIT(const struct lightbyte_inst *inst)
 {
 	if (lb_wait_delay != 0)
 		WAIT_OR_RET(lb_wait_delay);
@@ -1244,13 +1220,9 @@ static uint32_t lightbyte_WAIT(void)
  * Sets the current brightness to the given one-byte
  * immediate argument.
  */
-static uint32_t lightbyte_SET_BRIGHTNESS(void)
+static uint32_t lightbyte_SET_BRIGHTNESS(const struct lightbyte_inst *inst)
 {
-	uint8_t val;
-	if (decode_8(&val) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-
-	lb_set_brightness(val);
+	lb_set_brightness(inst->arg[0]);
 	return EC_SUCCESS;
 }
 
@@ -1272,57 +1244,28 @@ static uint32_t lightbyte_SET_BRIGHTNESS(void)
  * In SET_COLOR_RGB, these bits are don't-cares, as there should
  * always be three bytes that follow, which correspond to a
  * complete RGB specification.
+ *
+ * lightbyte_decode() unpacks cc and checks the control and color.
  */
-static uint32_t lightbyte_SET_COLOR_SINGLE(void)
+static uint32_t lightbyte_SET_COLOR_SINGLE(const struct lightbyte_inst *inst)
 {
-	uint8_t packed_loc, led, control, color, value;
 	int i;
-	if (decode_8(&packed_loc) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-	if (decode_8(&value) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-
-	led = packed_loc >> 4;
-	control = (packed_loc >> 2) & 0x3;
-	color = packed_loc & 0x3;
-
-	if (control >= LB_CONT_MAX)
-		return EC_RES_INVALID_PARAM;
 
 	for (i = 0; i < NUM_LEDS; i++)
-		if (led & BIT(i))
-			led_desc[i][control][color] = value;
+		if (inst->arg[0] & BIT(i))
+			led_desc[i][inst->arg[1]][inst->arg[2]] = inst->rgb[0];
 
 	return EC_SUCCESS;
 }
 
-static uint32_t lightbyte_SET_COLOR_RGB(void)
+static uint32_t lightbyte_SET_COLOR_RGB(const struct lightbyte_inst *inst)
 {
-	uint8_t packed_loc, r, g, b, led, control;
 	int i;
 
-	/* gross */
-	if (decode_8(&packed_loc) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-	if (decode_8(&r) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-	if (decode_8(&g) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-	if (decode_8(&b) != EC_SUCCESS)
-		return EC_RES_INVALID_PARAM;
-
-	led = packed_loc >> 4;
-	control = (packed_loc >> 2) & 0x3;
-
-	if (control >= LB_CONT_MAX)
-		return EC_RES_INVALID_PARAM;
-
 	for (i = 0; i < NUM_LEDS; i++)
-		if (led & BIT(i)) {
-			led_desc[i][control][LB_COL_RED] = r;
-			led_desc[i][control][LB_COL_GREEN] = g;
-			led_desc[i][control][LB_COL_BLUE] = b;
-		}
+		if (inst->arg[0] & BIT(i))
+			memcpy(led_desc[i][inst->arg[1]], inst->rgb,
+			       sizeof(inst->rgb));
 
 	return EC_SUCCESS;
 }
@@ -1331,7 +1274,7 @@ static uint32_t lightbyte_SET_COLOR_RGB(void)
  * Gets the current state of the LEDs and puts them in COLOR0.
  * Good for the beginning of a program if you need to fade in.
  */
-static uint32_t lightbyte_GET_COLORS(void)
+static uint32_t lightbyte_GET_COLORS(const struct lightbyte_inst *inst)
 {
 	int i;
 	for (i = 0; i < NUM_LEDS; i++)
@@ -1345,7 +1288,7 @@ static uint32_t lightbyte_GET_COLORS(void)
 /* SWAP_COLORS - swaps beginning and end colors in state
  * Exchanges COLOR0 and COLOR1 on all LEDs.
  */
-static uint32_t lightbyte_SWAP_COLORS(void)
+static uint32_t lightbyte_SWAP_COLORS(const struct lightbyte_inst *inst)
 {
 	int i, j, tmp;
 	for (i = 0; i < NUM_LEDS; i++)
@@ -1400,7 +1343,7 @@ static uint32_t ramp_all_leds(int stop_at)
  * their respective COLOR0, and takes them via interpolation to
  * COLOR1, with the delay time passing in between each step.
  */
-static uint32_t lightbyte_RAMP_ONCE(void)
+static uint32_t lightbyte_RAMP_ONCE(const struct lightbyte_inst *inst)
 {
 	/* special case for instantaneous set */
 	if (lb_ramp_delay == 0) {
@@ -1418,7 +1361,7 @@ static uint32_t lightbyte_RAMP_ONCE(void)
  * to COLOR0, then performs a ramp (as in RAMP_ONCE) to COLOR1,
  * and finally back to COLOR0.
  */
-static uint32_t lightbyte_CYCLE_ONCE(void)
+static uint32_t lightbyte_CYCLE_ONCE(const struct lightbyte_inst *inst)
 {
 	/* special case for instantaneous set */
 	if (lb_ramp_delay == 0) {
@@ -1438,7 +1381,7 @@ static uint32_t lightbyte_CYCLE_ONCE(void)
  *
  * If the ramp delay is zero, this instruction will error out.
  */
-static uint32_t lightbyte_CYCLE(void)
+static uint32_t lightbyte_CYCLE(const struct lightbyte_inst *inst)
 {
 	int w, i, r, g, b;
 
@@ -1473,37 +1416,34 @@ static uint32_t lightbyte_CYCLE(void)
 /* HALT - return with success
  * Show's over. Go back to what you were doing before.
  */
-static uint32_t lightbyte_HALT(void)
+static uint32_t lightbyte_HALT(const struct lightbyte_inst *inst)
 {
 	return PROGRAM_FINISHED;
 }
 
-#undef GET_INTERP_VALUE
-
-#define OP(NAME, BYTES, MNEMONIC) NAME,
-#include "lightbar_opcode_list.h"
-enum lightbyte_opcode { LIGHTBAR_OPCODE_TABLE MAX_OPCODE };
-#undef OP
+/* Stop at a fault found by lightbyte_decode(). */
+static uint32_t lightbyte_FAULT(const struct lightbyte_inst *inst)
+{
+	CPRINTS("LB PROGRAM pc: 0x%02x, invalid instruction", inst->arg[0]);
+	return EC_RES_INVALID_PARAM;
+}
 
 #define OP(NAME, BYTES, MNEMONIC) lightbyte_##NAME,
 #include "lightbar_opcode_list.h"
-static uint32_t (*lightbyte_dispatch[])(void) = { LIGHTBAR_OPCODE_TABLE };
-#undef OP
-
-#define OP(NAME, BYTES, MNEMONIC) MNEMONIC,
-#include "lightbar_opcode_list.h"
-static const char *const lightbyte_names[] = { LIGHTBAR_OPCODE_TABLE };
+static uint32_t (*const lightbyte_dispatch[])(const struct lightbyte_inst *) =
+	{ LIGHTBAR_OPCODE_TABLE lightbyte_FAULT };
 #undef OP
 
 static uint32_t sequence_PROGRAM(void)
 {
+	const struct lightbyte_inst *inst;
 	uint8_t saved_brightness;
-	uint8_t next_inst;
 	uint32_t rc;
-	uint8_t old_pc;
+	int n;
 
 	/* load next program */
-	memcpy(&cur_prog, &next_prog, sizeof(struct lightbar_program));
+	n = lightbyte_decode(&next_prog, prog_insts);
+	CPRINTS("LB PROGRAM decoded %d instructions", n);
 
 	/* reset program state */
 	saved_brightness = lb_get_brightness();
@@ -1515,30 +1455,18 @@ static uint32_t sequence_PROGRAM(void)
 	lb_on();
 	lb_set_brightness(255);
 
-	/* decode-execute loop */
+	/* dispatch loop, over instructions that need no more checks */
 	for (;;) {
-		old_pc = pc;
-		if (decode_8(&next_inst) != EC_SUCCESS)
-			return EC_RES_INVALID_PARAM;
-
-		if (next_inst >= MAX_OPCODE) {
-			CPRINTS("LB PROGRAM pc: 0x%02x, "
-				"found invalid opcode 0x%02x",
-				old_pc, next_inst);
+		inst = &prog_insts[pc++];
+		rc = lightbyte_dispatch[inst->op](inst);
+		if (rc) {
 			lb_set_brightness(saved_brightness);
-			return EC_RES_INVALID_PARAM;
-		} else {
-			CPRINTS("LB PROGRAM pc: 0x%02x, opcode 0x%02x -> %s",
-				old_pc, next_inst, lightbyte_names[next_inst]);
-			rc = lightbyte_dispatch[next_inst]();
-			if (rc) {
-				lb_set_brightness(saved_brightness);
-				return rc;
-			}
+			return rc;
 		}
 
 		/* yield processor in case we are stuck in a tight loop */
-		WAIT_OR_RET(100);
+		if (pc <= inst - prog_insts)
+			WAIT_OR_RET(100);
 	}
 }
 
@@ -0,0 +1,112 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Lightbyte program decoder, shared by the EC and util/lbcc */
+
+#include "ec_commands.h"
+#include "lightbar.h"
+#include "lightbyte.h"
+
+#define OP(NAME, BYTES, MNEMONIC) BYTES,
+#include "lightbar_opcode_list.h"
+static const uint8_t num_operands[] = { LIGHTBAR_OPCODE_TABLE };
+#undef OP
+
+/* Byte offset that starts no instruction */
+#define NOT_AN_INST 0xff
+
+static void set_fault(struct lightbyte_inst *inst, uint8_t pc)
+{
+	inst->op = LIGHTBYTE_FAULT;
+	inst->arg[0] = pc;
+}
+
+int lightbyte_decode(const struct lightbar_program *prog,
+		     struct lightbyte_inst *insts)
+{
+	/* Instruction index of each byte offset */
+	uint8_t inst_at[EC_LB_PROG_LEN];
+	const uint8_t *data = prog->data;
+	const int size = prog->size < EC_LB_PROG_LEN ? prog->size :
+							EC_LB_PROG_LEN;
+	struct lightbyte_inst *inst;
+	int pc = 0, n = 0, targets, i;
+
+	for (i = 0; i < EC_LB_PROG_LEN; i++)
+		inst_at[i] = NOT_AN_INST;
+
+	/* Decode up to the end, or to the first opcode we can't skip. */
+	while (pc < size) {
+		const uint8_t *arg = &data[pc + 1];
+		uint8_t op = data[pc];
+
+		if (op >= MAX_OPCODE || pc + 1 + num_operands[op] > size)
+			break;
+
+		inst = &insts[n];
+		inst_at[pc] = n++;
+		inst->op = op;
+		switch (op) {
+		case JUMP:
+		case JUMP_IF_CHARGING:
+		case SET_BRIGHTNESS:
+			/* Jump targets are still byte offsets here */
+			inst->arg[0] = arg[0];
+			break;
+		case JUMP_BATTERY:
+			inst->arg[0] = arg[0];
+			inst->arg[1] = arg[1];
+			break;
+		case SET_WAIT_DELAY:
+		case SET_RAMP_DELAY:
+			inst->delay = (uint32_t)arg[0] << 24 | arg[1] << 16 |
+				      arg[2] << 8 | arg[3];
+			break;
+		case SET_COLOR_SINGLE:
+		case SET_COLOR_RGB:
+			inst->arg[0] = arg[0] >> 4;
+			inst->arg[1] = (arg[0] >> 2) & 0x3;
+			inst->arg[2] = arg[0] & 0x3;
+			inst->rgb[0] = arg[1];
+			if (op == SET_COLOR_RGB) {
+				inst->arg[2] = LB_COL_RED;
+				inst->rgb[1] = arg[2];
+				inst->rgb[2] = arg[3];
+			}
+			if (inst->arg[1] >= LB_CONT_MAX ||
+			    inst->arg[2] >= LB_COL_ALL)
+				set_fault(inst, pc);
+			break;
+		default:
+			break;
+		}
+		pc += 1 + num_operands[op];
+	}
+	/* Where the program goes when it runs out of instructions */
+	set_fault(&insts[n++], pc);
+
+	/* Resolve jump targets, giving the bad ones a fault of their own. */
+	for (inst = insts; inst < insts + n; inst++) {
+		if (inst->op == JUMP || inst->op == JUMP_IF_CHARGING)
+			targets = 1;
+		else if (inst->op == JUMP_BATTERY)
+			targets = 2;
+		else
+			continue;
+
+		for (i = 0; i < targets; i++) {
+			uint8_t target = inst->arg[i];
+
+			if (target < size && inst_at[target] != NOT_AN_INST) {
+				inst->arg[i] = inst_at[target];
+			} else {
+				set_fault(&insts[n], target);
+				inst->arg[i] = n++;
+			}
+		}
+	}
+
+	return n;
+}
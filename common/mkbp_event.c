@@ -414,15 +414,17 @@ static const struct mkbp_event_source *find_mkbp_event_source(uint8_t type)
 #endif
 }
 
-static enum ec_status mkbp_get_next_event(struct host_cmd_handler_args *args)
+/*
+ * Take the next pending event and put its data in data. Returns 0 when no
+ * event is pending; otherwise 1, with the event data size or a negative
+ * error in *data_size.
+ */
+static int take_next_event(uint8_t *event_type, uint8_t *data, int *data_size)
 {
 	static int last;
 	int i, evt;
-	struct ec_response_get_next_event *r = args->response;
 	const struct mkbp_event_source *src;
 
-	int data_size = -EC_ERROR_BUSY;
-
 	do {
 		/*
 		 * Find the next event to service.  We do this in a round-robin
@@ -434,21 +436,19 @@ static enum ec_status mkbp_get_next_event(struct host_cmd_handler_args *args)
 				break;
 		mutex_unlock(&state.lock);
 
-		if (i == EC_MKBP_EVENT_COUNT) {
-			if (set_inactive_if_no_events())
-				return EC_RES_UNAVAILABLE;
-			/* An event was set just now, restart loop. */
-			continue;
-		}
+		if (i == EC_MKBP_EVENT_COUNT)
+			return 0;
 
 		evt = (i + last) % EC_MKBP_EVENT_COUNT;
 		last = evt + 1;
 
 		src = find_mkbp_event_source(evt);
-		if (src == NULL)
-			return EC_RES_ERROR;
+		if (src == NULL) {
+			*data_size = -EC_ERROR_UNKNOWN;
+			return 1;
+		}
 
-		r->event_type = evt;
+		*event_type = evt;
 
 		/*
 		 * get_data() can return -EC_ERROR_BUSY which indicates that the
@@ -458,13 +458,88 @@ static enum ec_status mkbp_get_next_event(struct host_cmd_handler_args *args)
 		 * event instead.  Therefore, we have to service that button
 		 * event first.
 		 */
-		data_size = src->get_data((uint8_t *)&r->data);
-		if (data_size == -EC_ERROR_BUSY) {
+		*data_size = src->get_data(data);
+		if (*data_size == -EC_ERROR_BUSY) {
 			mutex_lock(&state.lock);
 			state.events |= BIT(evt);
 			mutex_unlock(&state.lock);
 		}
-	} while (data_size == -EC_ERROR_BUSY);
+	} while (*data_size == -EC_ERROR_BUSY);
+
+	return 1;
+}
+
+#ifdef CONFIG_MKBP_EVENT_BATCH
+/* Version 3: as many events as fit in the response */
+static enum ec_status mkbp_get_next_events(struct host_cmd_handler_args *args)
+{
+	struct ec_response_get_next_event_v3 *r = args->response;
+	uint8_t *out = r->records;
+	const uint8_t *end = (uint8_t *)args->response + args->response_max;
+	struct ec_mkbp_event_record *rec;
+	int data_size;
+
+	if (args->response_max < sizeof(*r) + EC_MKBP_EVENT_RECORD_MAX_SIZE)
+		return EC_RES_RESPONSE_TOO_BIG;
+
+	r->count = 0;
+	r->flags = 0;
+
+	/* Only take an event when its data fits, whatever the type */
+	while (end - out >= EC_MKBP_EVENT_RECORD_MAX_SIZE &&
+	       r->count < UINT8_MAX) {
+		rec = (struct ec_mkbp_event_record *)out;
+		if (!take_next_event(&rec->event_type, rec->data,
+				     &data_size)) {
+			if (r->count || set_inactive_if_no_events())
+				break;
+			/* An event was set just now, try again. */
+			continue;
+		}
+
+		/* Like version 2, an event whose data can't be read is lost */
+		if (data_size < 0) {
+			if (!r->count)
+				return EC_RES_ERROR;
+			continue;
+		}
+
+		rec->size = data_size;
+		out += sizeof(*rec) + data_size;
+		r->count++;
+	}
+
+	if (!r->count)
+		return EC_RES_UNAVAILABLE;
+
+	if (!set_inactive_if_no_events())
+		r->flags |= EC_MKBP_HAS_MORE_EVENTS;
+	args->response_size = out - (uint8_t *)r;
+
+	return EC_RES_SUCCESS;
+}
+
+#define MKBP_BATCH_VER_MASK EC_VER_MASK(3)
+#else
+#define MKBP_BATCH_VER_MASK 0
+#endif /* CONFIG_MKBP_EVENT_BATCH */
+
+static enum ec_status mkbp_get_next_event(struct host_cmd_handler_args *args)
+{
+	struct ec_response_get_next_event *r = args->response;
+	int data_size;
+
+#ifdef CONFIG_MKBP_EVENT_BATCH
+	if (args->version >= 3)
+		return mkbp_get_next_events(args);
+#endif
+
+	while (!take_next_event(&r->event_type, (uint8_t *)&r->data,
+				&data_size)) {
+		if (set_inactive_if_no_events())
+			return EC_RES_UNAVAILABLE;
+		/* An event was set just now, restart loop. */
+	}
 
 	/* If there are no more events and we support the "more" flag, set it */
 	if (!set_inactive_if_no_events() && args->version >= 2)
@@ -477,7 +552,8 @@ static enum ec_status mkbp_get_next_event(struct host_cmd_handler_args *args)
 	return EC_RES_SUCCESS;
 }
 DECLARE_HOST_COMMAND(EC_CMD_GET_NEXT_EVENT, mkbp_get_next_event,
-		     EC_VER_MASK(0) | EC_VER_MASK(1) | EC_VER_MASK(2));
+		     EC_VER_MASK(0) | EC_VER_MASK(1) | EC_VER_MASK(2) |
+			     MKBP_BATCH_VER_MASK);
 
 #ifdef CONFIG_MKBP_HOST_EVENT_WAKEUP_MASK
 #ifdef CONFIG_MKBP_USE_HOST_EVENT
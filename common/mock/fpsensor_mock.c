@@ -13,6 +13,7 @@
 #include "mock/fpsensor_mock.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #ifndef TEST_BUILD
 #error "Mocks should only be in the test build."
@@ -59,6 +60,11 @@ int fp_sensor_acquire_image_with_mode(uint8_t *image_data, int mode)
 	return mock_ctrl_fp_sensor.fp_sensor_acquire_image_with_mode_return;
 }
 
+void fp_sensor_get_capture_timing(struct fp_sensor_capture_timing *timing)
+{
+	memset(timing, 0, sizeof(*timing));
+}
+
 int fp_finger_match(void *templ, uint32_t templ_count, uint8_t *image,
 		    int32_t *match_index, uint32_t *update_bitmap)
 {
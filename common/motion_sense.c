@@ -495,8 +495,10 @@ static void update_sense_data(uint8_t *lpc_status, int *psample_id)
 	 * the counter and clear the busy bit after writing the sensor
 	 * data. On the host side, the host needs to make sure the busy
 	 * bit is not set and that the counter remains the same before
-	 * and after reading the data.
+	 * and after reading the data. Newer hosts check
+	 * EC_MEMMAP_MOTION_SEQ instead, which also covers the ALS data.
 	 */
+	host_memmap_write_begin(EC_MEMMAP_MOTION_SEQ);
 	*lpc_status |= EC_MEMMAP_ACC_STATUS_BUSY_BIT;
 
 	/*
@@ -542,6 +544,7 @@ static void update_sense_data(uint8_t *lpc_status, int *psample_id)
 	 */
 	*psample_id = (*psample_id + 1) & EC_MEMMAP_ACC_STATUS_SAMPLE_ID_MASK;
 	*lpc_status = EC_MEMMAP_ACC_STATUS_PRESENCE_BIT | *psample_id;
+	host_memmap_write_end(EC_MEMMAP_MOTION_SEQ);
 }
 #endif
 
@@ -218,8 +218,10 @@ static int add_entropy(uint8_t *dst, const uint8_t *src, const uint8_t *add,
 	for (int i = 0; i < CONFIG_ROLLBACK_SECRET_LOCAL_ENTROPY_SIZE; i++) {
 		uint8_t extra;
 
-		if (!board_get_entropy(&extra, 1))
+		if (!board_get_entropy(&extra, 1)) {
+			SHA256_abort(&ctx);
 			goto failed;
+		}
 		SHA256_update(&ctx, &extra, 1);
 	}
 #endif
@@ -186,7 +186,8 @@ int rwsig_check_signature(void)
 
 	/* SHA-256 Hash of the RW firmware */
 	SHA256_init(&ctx);
-	SHA256_update(&ctx, rwdata, rwlen);
+	/* Storage is mapped, so this hashes in place and can't fail */
+	SHA256_update_flash(&ctx, CONFIG_EC_WRITABLE_STORAGE_OFF, rwlen);
 	hash = SHA256_final(&ctx);
 
 	good = rsa_verify(key, sig, hash, rsa_workbuf);
@@ -211,6 +211,11 @@ void SHA256_update(struct sha256_ctx *ctx, const uint8_t *data, uint32_t len)
 	ctx->tot_len += (block_nb + 1) << 6;
 }
 
+void SHA256_abort(struct sha256_ctx *ctx)
+{
+	/* Nothing to release for the software implementation */
+}
+
 /*
  * Specialized SHA256_init + SHA256_update that takes the first data block of
  * size SHA256_BLOCK_SIZE as input.
@@ -0,0 +1,68 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* SHA256 over flash contents, independent of the SHA256 backend */
+
+#include "common.h"
+#include "flash.h"
+#include "sha256.h"
+#include "shared_mem.h"
+#include "util.h"
+
+#ifdef CONFIG_MAPPED_STORAGE
+
+int SHA256_update_flash(struct sha256_ctx *ctx, int offset, int size)
+{
+	/*
+	 * Feed the mapped flash straight to the backend; both the software
+	 * transform and the hardware engines consume whole blocks in place.
+	 */
+	crec_flash_lock_mapped_storage(1);
+	SHA256_update(ctx,
+		      (const uint8_t *)((uintptr_t)CONFIG_MAPPED_STORAGE_BASE +
+					offset),
+		      size);
+	crec_flash_lock_mapped_storage(0);
+
+	return EC_SUCCESS;
+}
+
+#else /* !CONFIG_MAPPED_STORAGE */
+
+/* Bytes read from flash per SHA256_update() call */
+#define SHA256_FLASH_CHUNK_SIZE 1024
+
+/* Check that the chunk fits in shared memory. */
+SHARED_MEM_CHECK_SIZE(SHA256_FLASH_CHUNK_SIZE);
+
+int SHA256_update_flash(struct sha256_ctx *ctx, int offset, int size)
+{
+	int chunk = MIN(size, SHA256_FLASH_CHUNK_SIZE);
+	char *buf;
+	int rv;
+
+	if (size == 0)
+		return EC_SUCCESS;
+
+	/* Get the buffer up front so BUSY leaves the hash untouched */
+	rv = shared_mem_acquire(chunk, &buf);
+	if (rv != EC_SUCCESS)
+		return rv;
+
+	while (size) {
+		chunk = MIN(size, SHA256_FLASH_CHUNK_SIZE);
+		rv = crec_flash_read(offset, chunk, buf);
+		if (rv != EC_SUCCESS)
+			break;
+		SHA256_update(ctx, (const uint8_t *)buf, chunk);
+		offset += chunk;
+		size -= chunk;
+	}
+
+	shared_mem_release(buf);
+	return rv;
+}
+
+#endif /* CONFIG_MAPPED_STORAGE */
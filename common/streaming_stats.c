@@ -0,0 +1,124 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Streaming statistics over windows of motion sensor samples */
+
+#include "common.h"
+#include "streaming_stats.h"
+#include "util.h"
+
+void stats_window_init(struct stats_window *w, int16_t *history, int size,
+		       int axes)
+{
+	memset(w, 0, sizeof(*w));
+	w->history = history;
+	w->size = size;
+	w->axes = axes;
+	memset(history, 0, size * axes * sizeof(*history));
+}
+
+/*
+ * Update the sum and n^2 * variance of an axis from the value leaving the
+ * window and the one replacing it. Integer math keeps this exact.
+ *
+ * n: window size
+ * x: data in the old window
+ * x': data in the new window
+ * x_0: oldest value in the window, will be replaced by x_n
+ * x_n: new coming value
+ *
+ * n^2 * var(x') = n^2 * var(x) + (x_n - x_0) *
+ *                 (n * (x_n + x_0) - sum(x') - sum(x))
+ */
+void stats_window_add(struct stats_window *w, const int *x)
+{
+	int16_t *slot = &w->history[w->idx * w->axes];
+	int a;
+
+	for (a = 0; a < w->axes; a++) {
+		const int x_n = CLAMP(x[a], INT16_MIN, INT16_MAX);
+		const int x_0 = slot[a];
+		const int sum_diff = x_n - x_0;
+		const int32_t new_sum = w->sum[a] + sum_diff;
+
+		w->n2_var[a] += sum_diff * ((int64_t)w->size * (x_n + x_0) -
+					    new_sum - w->sum[a]);
+		w->sum[a] = new_sum;
+		slot[a] = x_n;
+	}
+
+	w->idx = (w->idx + 1 >= w->size) ? 0 : w->idx + 1;
+	if (w->count < w->size)
+		w->count++;
+}
+
+uint64_t stats_window_variance(const struct stats_window *w, int axis)
+{
+	return w->n2_var[axis] / w->size / w->size;
+}
+
+void stats_window_min_max(const struct stats_window *w, int axis, int *min,
+			  int *max)
+{
+	const int16_t *p = &w->history[axis];
+	int i;
+
+	*min = INT16_MAX;
+	*max = INT16_MIN;
+	for (i = 0; i < w->size; i++, p += w->axes) {
+		*min = MIN(*min, *p);
+		*max = MAX(*max, *p);
+	}
+}
+
+void stats_batch_add(struct stats_batch *b, fp_t x, fp_t y, fp_t z)
+{
+	const fpv3_t v = { x, y, z };
+	int a;
+
+	if (b->count == 0) {
+		for (a = 0; a < 3; a++) {
+			b->origin[a] = v[a];
+			b->sum[a] = INT_TO_FP(0);
+			b->sum_sq[a] = INT_TO_FP(0);
+		}
+	}
+	b->count++;
+
+	for (a = 0; a < 3; a++) {
+		const fp_t delta = v[a] - b->origin[a];
+
+		b->sum[a] += delta;
+		b->sum_sq[a] += fp_sq(delta);
+	}
+}
+
+int stats_batch_compute(const struct stats_batch *b, bool unbiased,
+			fpv3_t mean, fpv3_t var)
+{
+	fp_t inv_count, inv_dof;
+	int a;
+
+	if (b->count < (unbiased ? 2 : 1))
+		return EC_ERROR_INVAL;
+
+	inv_count = fp_div(INT_TO_FP(1), INT_TO_FP(b->count));
+	inv_dof = unbiased ? fp_div(INT_TO_FP(1), INT_TO_FP(b->count - 1)) :
+			     inv_count;
+
+	for (a = 0; a < 3; a++) {
+		/* Mean relative to the origin */
+		const fp_t delta = fp_mul(b->sum[a], inv_count);
+
+		/* (sum(d^2) - sum(d)^2 / n) / dof */
+		if (var)
+			var[a] = fp_mul(b->sum_sq[a] - fp_mul(delta, b->sum[a]),
+					inv_dof);
+		if (mean)
+			mean[a] = delta + b->origin[a];
+	}
+
+	return EC_SUCCESS;
+}
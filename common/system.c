@@ -73,6 +73,24 @@ BUILD_ASSERT((sizeof(struct panic_data) + sizeof(struct jump_data) +
 	      JUMP_TAG_MAX_SIZE) <= CONFIG_PRESERVED_END_OF_RAM_SIZE,
 	     "End of ram data size is too small for panic and jump data");
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+#define JUMP_TAG_SPACE(size) (sizeof(struct jump_tag) + ROUNDUP4(size))
+
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+#define PD_DISC_CACHE_TAG_SPACE JUMP_TAG_SPACE(JUMP_TAG_MAX_SIZE)
+#else
+#define PD_DISC_CACHE_TAG_SPACE 0
+#endif
+
+/* ...and for all the warm state tags at their largest, see sysjump.h */
+BUILD_ASSERT((sizeof(struct panic_data) + sizeof(struct jump_data) +
+	      JUMP_TAG_SPACE(SYSJUMP_TAG_VBOOT_HASH_SIZE) +
+	      JUMP_TAG_SPACE(JUMP_TAG_MAX_SIZE) /* CBI */ +
+	      JUMP_TAG_SPACE(sizeof(struct battery_static_info)) +
+	      PD_DISC_CACHE_TAG_SPACE) <= CONFIG_PRESERVED_END_OF_RAM_SIZE,
+	     "End of ram data size is too small for the warm state tags");
+#endif
+
 STATIC_IF(CONFIG_HIBERNATE) uint32_t hibernate_seconds;
 STATIC_IF(CONFIG_HIBERNATE) uint32_t hibernate_microseconds;
 
@@ -418,6 +436,18 @@ test_mockable const uint8_t *system_get_jump_tag(uint16_t tag, int *version,
 	return NULL;
 }
 
+const void *system_get_jump_data(uint16_t tag, int version, int size)
+{
+	const uint8_t *data;
+	int data_version, data_size;
+
+	data = system_get_jump_tag(tag, &data_version, &data_size);
+	if (!data || data_version != version || data_size != size)
+		return NULL;
+
+	return data;
+}
+
 test_mockable void system_disable_jump(void)
 {
 	disable_jump = 1;
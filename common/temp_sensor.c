@@ -37,6 +37,7 @@ static void update_mapped_memory(void)
 	int i, t;
 	uint8_t *mptr = host_get_memmap(EC_MEMMAP_TEMP_SENSOR);
 
+	host_memmap_write_begin(EC_MEMMAP_THERMAL_SEQ);
 	for (i = 0; i < TEMP_SENSOR_COUNT; i++, mptr++) {
 		/*
 		 * Switch to second range if first one is full, or stop if
@@ -61,6 +62,7 @@ static void update_mapped_memory(void)
 			*mptr = EC_TEMP_SENSOR_ERROR;
 		}
 	}
+	host_memmap_write_end(EC_MEMMAP_THERMAL_SEQ);
 }
 /* Run after other TEMP tasks, so sensors will have updated first. */
 DECLARE_HOOK(HOOK_SECOND, update_mapped_memory, HOOK_PRIO_TEMP_SENSOR_DONE);
@@ -53,15 +53,17 @@ static int is_touchpad_block(uint32_t block_offset, size_t body_size)
 #endif
 
 /*
- * Verify that the passed in block fits into the valid area. If it does, and
- * is destined to the base address of the area - erase the area contents.
+ * Verify that the passed in block fits into the valid area. If it does, is
+ * destined to the base address of the area and erase is set - erase the area
+ * contents.
  *
  * Return success, or indication of an erase failure or chunk not fitting into
  * valid area.
  *
  * TODO(b/36375666): Each board/chip should be able to re-define this.
  */
-static uint8_t check_update_chunk(uint32_t block_offset, size_t body_size)
+static uint8_t check_update_chunk(uint32_t block_offset, size_t body_size,
+				  bool erase)
 {
 	uint32_t base;
 	uint32_t size;
@@ -76,7 +78,7 @@ static uint8_t check_update_chunk(uint32_t block_offset, size_t body_size)
 		 * If this is the first chunk for this section, it needs to
 		 * be erased.
 		 */
-		if (block_offset == base) {
+		if (erase && block_offset == base) {
 			if (crec_flash_physical_erase(base, size) !=
 			    EC_SUCCESS) {
 				CPRINTF("%s:%d erase failure of 0x%x..+0x%x\n",
@@ -93,7 +95,7 @@ static uint8_t check_update_chunk(uint32_t block_offset, size_t body_size)
 		return UPDATE_SUCCESS;
 #endif
 
-	CPRINTF("%s:%d %x, %d section base %x top %x\n", __func__, __LINE__,
+	CPRINTF("%s:%d %x, %zu section base %x top %x\n", __func__, __LINE__,
 		block_offset, body_size, update_section.base_offset,
 		update_section.top_offset);
 
@@ -266,7 +268,7 @@ void fw_update_command_handler(void *body, size_t cmd_size,
 	}
 
 	/* Check if the block will fit into the valid area. */
-	*error_code = check_update_chunk(block_offset, body_size);
+	*error_code = check_update_chunk(block_offset, body_size, true);
 	if (*error_code)
 		return;
 
@@ -293,7 +295,8 @@ void fw_update_command_handler(void *body, size_t cmd_size,
 	}
 #endif
 
-	CPRINTF("update: 0x%x\n", block_offset + CONFIG_PROGRAM_MEMORY_BASE);
+	CPRINTF("update: 0x%x\n",
+		(uint32_t)(block_offset + CONFIG_PROGRAM_MEMORY_BASE));
 	if (crec_flash_physical_write(block_offset, body_size, update_data) !=
 	    EC_SUCCESS) {
 		*error_code = UPDATE_WRITE_FAILURE;
@@ -319,3 +322,302 @@ void fw_update_command_handler(void *body, size_t cmd_size,
 void fw_update_complete(void)
 {
 }
+
+#ifdef CONFIG_UPDATE_WINDOW
+/* Bytes programmed at a time, letting the USB receive path run in between */
+#define WINDOW_WRITE_SLICE 256
+BUILD_ASSERT(WINDOW_WRITE_SLICE % CONFIG_FLASH_WRITE_SIZE == 0);
+
+/* Erase banks of the biggest section, for the erased bitmap */
+#define WINDOW_BANKS                                                   \
+	((CONFIG_RO_SIZE > CONFIG_RW_SIZE ? CONFIG_RO_SIZE : CONFIG_RW_SIZE) / \
+	 CONFIG_FLASH_ERASE_SIZE)
+
+struct window_block {
+	uint8_t buf[sizeof(struct update_command) + CONFIG_UPDATE_PDU_SIZE];
+	uint32_t size;
+};
+
+static struct window_block window_ring[CONFIG_UPDATE_WINDOW_BLOCKS];
+/* Blocks the host may send ahead, 0 when no windowed transfer is open */
+static int window_size;
+/* Number of the next block to receive, and of the next to program */
+static uint32_t window_head;
+static uint32_t window_tail;
+
+/* Progress through the block at the tail */
+static enum {
+	BLOCK_NEW,
+	BLOCK_ERASING,
+	BLOCK_WRITING,
+} window_phase;
+/* Next bank to erase, or bytes written */
+static uint32_t window_progress;
+
+/* Set while dropping blocks until the one at resume_offset */
+static bool window_rewinding;
+static uint32_t window_resume_offset;
+
+/* Banks of the update section erased during this transfer */
+static uint32_t window_erased[DIV_ROUND_UP(WINDOW_BANKS, 32)];
+
+/* Get the erase bank at a flash offset, and where it starts */
+static int bank_at(uint32_t offset, uint32_t *start, uint32_t *size)
+{
+#ifdef CONFIG_FLASH_MULTIPLE_REGION
+	int bank = crec_flash_bank_index(offset);
+
+	*start = crec_flash_bank_start_offset(bank);
+	*size = crec_flash_bank_erase_size(bank);
+	return bank;
+#else
+	*size = CONFIG_FLASH_ERASE_SIZE;
+	*start = offset - offset % CONFIG_FLASH_ERASE_SIZE;
+	return offset / CONFIG_FLASH_ERASE_SIZE;
+#endif
+}
+
+/* Index in window_erased of the bank at a flash offset, or -1 */
+static int erased_index(uint32_t offset)
+{
+	uint32_t start, size;
+	int base = bank_at(update_section.base_offset, &start, &size);
+	int index = bank_at(offset, &start, &size) - base;
+
+	return index < WINDOW_BANKS ? index : -1;
+}
+
+static bool bank_erased(uint32_t offset)
+{
+	int i = erased_index(offset);
+
+	return i >= 0 && (window_erased[i / 32] & BIT(i % 32));
+}
+
+int fw_update_window_open(int window)
+{
+	window_size = CLAMP(window, 1, CONFIG_UPDATE_WINDOW_BLOCKS);
+	window_head = 0;
+	window_tail = 0;
+	window_phase = BLOCK_NEW;
+	window_rewinding = false;
+	memset(window_erased, 0, sizeof(window_erased));
+
+	return window_size;
+}
+
+void fw_update_window_close(void)
+{
+	window_size = 0;
+	window_head = 0;
+	window_tail = 0;
+	window_phase = BLOCK_NEW;
+}
+
+bool fw_update_window_is_open(void)
+{
+	return window_size != 0;
+}
+
+void *fw_update_window_get_buffer(void)
+{
+	if (!window_size || window_head - window_tail >= window_size)
+		return NULL;
+
+	return window_ring[window_head % CONFIG_UPDATE_WINDOW_BLOCKS].buf;
+}
+
+static void window_program(void);
+DECLARE_DEFERRED(window_program);
+
+void fw_update_window_submit(size_t cmd_size)
+{
+	window_ring[window_head % CONFIG_UPDATE_WINDOW_BLOCKS].size = cmd_size;
+	window_head++;
+	hook_call_deferred(&window_program_data, 0);
+}
+
+static void window_ack(uint8_t return_value, enum update_block_status status)
+{
+	struct window_block *b =
+		&window_ring[window_tail % CONFIG_UPDATE_WINDOW_BLOCKS];
+	struct update_command *cmd = (struct update_command *)b->buf;
+	struct update_block_ack ack = {
+		.seq = cmd->block_digest,
+		.return_value = return_value,
+		.status = status,
+	};
+
+	if (status == UPDATE_BLOCK_REWIND)
+		ack.resume_offset = htobe32(window_resume_offset);
+
+	window_tail++;
+	window_phase = BLOCK_NEW;
+	fw_update_window_ack(&ack);
+}
+
+/* Decide what to do with a new block: drop it, skip it, or program it */
+static void window_start_block(struct update_command *cmd, size_t body_size)
+{
+	uint32_t block_offset = be32toh(cmd->block_base);
+	void *update_data = cmd + 1;
+	uint32_t start, size;
+	uint8_t rv;
+
+	if (window_rewinding) {
+		if (block_offset != window_resume_offset) {
+			window_ack(UPDATE_SUCCESS, UPDATE_BLOCK_DISCARDED);
+			return;
+		}
+		window_rewinding = false;
+	}
+
+	if (!body_size) {
+		window_ack(UPDATE_GEN_ERROR, UPDATE_BLOCK_DISCARDED);
+		return;
+	}
+	if (!contents_allowed(block_offset, body_size, update_data)) {
+		window_ack(UPDATE_ROLLBACK_ERROR, UPDATE_BLOCK_DISCARDED);
+		return;
+	}
+	rv = check_update_chunk(block_offset, body_size, false);
+	if (rv == UPDATE_SUCCESS && chunk_came_too_soon(block_offset))
+		rv = UPDATE_RATE_LIMIT_ERROR;
+	if (rv != UPDATE_SUCCESS) {
+		window_ack(rv, UPDATE_BLOCK_DISCARDED);
+		return;
+	}
+
+#ifdef CONFIG_TOUCHPAD_VIRTUAL_OFF
+	if (is_touchpad_block(block_offset, body_size)) {
+		if (touchpad_update_write(
+			    block_offset - CONFIG_TOUCHPAD_VIRTUAL_OFF,
+			    body_size, update_data) != EC_SUCCESS)
+			rv = UPDATE_WRITE_FAILURE;
+		else
+			new_chunk_written(block_offset);
+		window_ack(rv, UPDATE_BLOCK_WRITTEN);
+		return;
+	}
+#endif
+
+	if (!memcmp(update_data,
+		    (void *)(block_offset + CONFIG_PROGRAM_MEMORY_BASE),
+		    body_size)) {
+		window_ack(UPDATE_SUCCESS, UPDATE_BLOCK_SKIPPED);
+		return;
+	}
+
+	/*
+	 * The first bank may have started in earlier blocks that were
+	 * skipped. Their contents will be gone once the bank is erased, so
+	 * have the host send them again.
+	 */
+	bank_at(block_offset, &start, &size);
+	if (start < block_offset && !bank_erased(block_offset)) {
+		window_rewinding = true;
+		window_resume_offset = start;
+	}
+
+	window_phase = BLOCK_ERASING;
+	window_progress = start;
+}
+
+/*
+ * Erase the next bank the block needs. Returns EC_SUCCESS when none are
+ * left, EC_ERROR_BUSY when there may be more.
+ */
+static int window_erase_step(uint32_t block_offset, size_t body_size)
+{
+	uint32_t start, size;
+	int i;
+
+	while (window_progress < block_offset + body_size) {
+		bank_at(window_progress, &start, &size);
+		i = erased_index(start);
+		window_progress = start + size;
+		if (i >= 0 && (window_erased[i / 32] & BIT(i % 32)))
+			continue;
+
+		if (i < 0 || crec_flash_physical_erase(start, size)) {
+			CPRINTF("%s:%d erase failure of 0x%x..+0x%x\n",
+				__func__, __LINE__, start, size);
+			return EC_ERROR_UNKNOWN;
+		}
+		window_erased[i / 32] |= BIT(i % 32);
+		return EC_ERROR_BUSY;
+	}
+
+	return EC_SUCCESS;
+}
+
+/* Program the blocks received, a slice at a time */
+static void window_program(void)
+{
+	struct window_block *b;
+	struct update_command *cmd;
+	uint32_t block_offset;
+	size_t body_size;
+	int len, rv;
+
+	if (!window_size || window_tail == window_head)
+		return;
+
+	b = &window_ring[window_tail % CONFIG_UPDATE_WINDOW_BLOCKS];
+	cmd = (struct update_command *)b->buf;
+	block_offset = be32toh(cmd->block_base);
+	body_size = b->size > sizeof(*cmd) ? b->size - sizeof(*cmd) : 0;
+
+	switch (window_phase) {
+	case BLOCK_NEW:
+		window_start_block(cmd, body_size);
+		break;
+	case BLOCK_ERASING:
+		rv = window_erase_step(block_offset, body_size);
+		if (rv == EC_ERROR_BUSY)
+			break;
+		if (rv) {
+			window_ack(UPDATE_ERASE_FAILURE,
+				   UPDATE_BLOCK_DISCARDED);
+			break;
+		}
+		if (window_rewinding) {
+			window_ack(UPDATE_SUCCESS, UPDATE_BLOCK_REWIND);
+			break;
+		}
+		window_phase = BLOCK_WRITING;
+		window_progress = 0;
+		break;
+	case BLOCK_WRITING:
+		len = MIN(body_size - window_progress, WINDOW_WRITE_SLICE);
+		if (crec_flash_physical_write(block_offset + window_progress,
+					      len,
+					      (char *)(cmd + 1) +
+						      window_progress)) {
+			CPRINTF("%s:%d update write error\n", __func__,
+				__LINE__);
+			window_ack(UPDATE_WRITE_FAILURE,
+				   UPDATE_BLOCK_DISCARDED);
+			break;
+		}
+		window_progress += len;
+		if (window_progress < body_size)
+			break;
+
+		new_chunk_written(block_offset);
+		if (memcmp(cmd + 1,
+			   (void *)(block_offset + CONFIG_PROGRAM_MEMORY_BASE),
+			   body_size)) {
+			CPRINTF("%s:%d update verification error\n", __func__,
+				__LINE__);
+			window_ack(UPDATE_VERIFY_ERROR, UPDATE_BLOCK_DISCARDED);
+			break;
+		}
+		window_ack(UPDATE_SUCCESS, UPDATE_BLOCK_WRITTEN);
+		break;
+	}
+
+	if (window_tail != window_head)
+		hook_call_deferred(&window_program_data, 0);
+}
+#endif /* CONFIG_UPDATE_WINDOW */
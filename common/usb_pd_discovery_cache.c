@@ -0,0 +1,241 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Cache of the alternate mode discovery results of recently seen port
+ * partners and cables, so that a replug only needs Discover Identity.
+ */
+
+#include "console.h"
+#include "hooks.h"
+#include "system.h"
+#include "sysjump.h"
+#include "task.h"
+#include "usb_pd.h"
+#include "util.h"
+
+#ifdef CONFIG_COMMON_RUNTIME
+#define CPRINTS(format, args...) cprints(CC_USBPD, format, ##args)
+#else
+#define CPRINTS(format, args...)
+#endif
+
+/* SVIDs and mode VDOs kept per entry; bigger results are not cached */
+#define DISC_CACHE_SVIDS 4
+#define DISC_CACHE_VDOS 8
+
+struct disc_cache_entry {
+	/*
+	 * Discover Identity response, the cache key. It holds the VID, XID,
+	 * PID and bcdDevice, along with the product type VDOs.
+	 */
+	uint32_t identity[VDO_MAX_OBJECTS];
+	/* Identity VDO count, 0 for an unused entry */
+	uint8_t identity_cnt;
+	/* TCPCI_MSG_SOP or TCPCI_MSG_SOP_PRIME */
+	uint8_t type;
+	uint8_t svid_cnt;
+	uint8_t mode_cnt[DISC_CACHE_SVIDS];
+	uint16_t svid[DISC_CACHE_SVIDS];
+	/* Mode VDOs of all SVIDs, back to back */
+	uint32_t mode_vdo[DISC_CACHE_VDOS];
+	/* Value of use_count when last stored or restored, for LRU */
+	uint32_t last_use;
+};
+
+static struct disc_cache_entry cache[CONFIG_USB_PD_DISCOVERY_CACHE_SIZE];
+static uint32_t use_count;
+K_MUTEX_DEFINE(cache_lock);
+
+static bool entry_matches(const struct disc_cache_entry *e,
+			  enum tcpci_msg_type type,
+			  const struct pd_discovery *disc)
+{
+	return e->identity_cnt && e->type == type &&
+	       e->identity_cnt == disc->identity_cnt &&
+	       !memcmp(e->identity, disc->identity.raw_value,
+		       e->identity_cnt * sizeof(uint32_t));
+}
+
+static struct disc_cache_entry *find_entry(enum tcpci_msg_type type,
+					   const struct pd_discovery *disc)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++)
+		if (entry_matches(&cache[i], type, disc))
+			return &cache[i];
+
+	return NULL;
+}
+
+/* Entry to replace for a new result: an unused one, or the least recent */
+static struct disc_cache_entry *victim_entry(void)
+{
+	struct disc_cache_entry *victim = &cache[0];
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(cache); i++) {
+		if (!cache[i].identity_cnt)
+			return &cache[i];
+		if (use_count - cache[i].last_use >
+		    use_count - victim->last_use)
+			victim = &cache[i];
+	}
+
+	return victim;
+}
+
+void pd_discovery_cache_store(int port, enum tcpci_msg_type type)
+{
+	const struct pd_discovery *disc = pd_get_am_discovery(port, type);
+	struct disc_cache_entry new_entry = {
+		.identity_cnt = disc->identity_cnt,
+		.type = type,
+		.svid_cnt = disc->svid_cnt,
+	};
+	struct disc_cache_entry *e;
+	int vdo_cnt = 0;
+	int i;
+
+	/* Only complete results are worth replaying */
+	if (disc->identity_discovery != PD_DISC_COMPLETE ||
+	    disc->svids_discovery != PD_DISC_COMPLETE ||
+	    !disc->identity_cnt || disc->svid_cnt > DISC_CACHE_SVIDS)
+		return;
+
+	memcpy(new_entry.identity, disc->identity.raw_value,
+	       disc->identity_cnt * sizeof(uint32_t));
+	for (i = 0; i < disc->svid_cnt; i++) {
+		const struct svid_mode_data *mode = &disc->svids[i];
+
+		if (mode->discovery != PD_DISC_COMPLETE ||
+		    vdo_cnt + mode->mode_cnt > DISC_CACHE_VDOS)
+			return;
+
+		new_entry.svid[i] = mode->svid;
+		new_entry.mode_cnt[i] = mode->mode_cnt;
+		memcpy(&new_entry.mode_vdo[vdo_cnt], mode->mode_vdo,
+		       mode->mode_cnt * sizeof(uint32_t));
+		vdo_cnt += mode->mode_cnt;
+	}
+
+	mutex_lock(&cache_lock);
+	e = find_entry(type, disc);
+	if (!e)
+		e = victim_entry();
+	new_entry.last_use = ++use_count;
+	*e = new_entry;
+	mutex_unlock(&cache_lock);
+}
+
+bool pd_discovery_cache_restore(int port, enum tcpci_msg_type type)
+{
+	struct pd_discovery *disc =
+		pd_get_am_discovery_and_notify_access(port, type);
+	struct disc_cache_entry *e;
+	int vdo_cnt = 0;
+	int i;
+
+	if (disc->identity_discovery != PD_DISC_COMPLETE ||
+	    disc->svids_discovery != PD_DISC_NEEDED)
+		return false;
+
+	mutex_lock(&cache_lock);
+	e = find_entry(type, disc);
+	if (!e) {
+		mutex_unlock(&cache_lock);
+		return false;
+	}
+
+	disc->svid_cnt = e->svid_cnt;
+	for (i = 0; i < e->svid_cnt; i++) {
+		struct svid_mode_data *mode = &disc->svids[i];
+
+		mode->svid = e->svid[i];
+		mode->mode_cnt = e->mode_cnt[i];
+		memcpy(mode->mode_vdo, &e->mode_vdo[vdo_cnt],
+		       mode->mode_cnt * sizeof(uint32_t));
+		mode->discovery = PD_DISC_COMPLETE;
+		vdo_cnt += mode->mode_cnt;
+	}
+	/* Mode discovery went through every SVID */
+	disc->svid_idx = disc->svid_cnt;
+	disc->svids_discovery = PD_DISC_COMPLETE;
+	e->last_use = ++use_count;
+	mutex_unlock(&cache_lock);
+
+	CPRINTS("C%d: SOP%s discovery restored from cache", port,
+		type == TCPCI_MSG_SOP ? "" : "'");
+	return true;
+}
+
+void pd_discovery_cache_clear(void)
+{
+	mutex_lock(&cache_lock);
+	memset(cache, 0, sizeof(cache));
+	mutex_unlock(&cache_lock);
+}
+
+#ifdef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+#define DISC_CACHE_HOOK_VERSION 1
+
+/* A jump tag holds fewer entries than the cache, keep the most recent */
+#define DISC_CACHE_JUMP_ENTRIES \
+	MIN(ARRAY_SIZE(cache), JUMP_TAG_MAX_SIZE / sizeof(cache[0]))
+
+static void disc_cache_preserve(void)
+{
+	struct disc_cache_entry saved[DISC_CACHE_JUMP_ENTRIES];
+	uint32_t age_limit = UINT32_MAX;
+	int cnt = 0;
+
+	/* Take entries from the most recent down */
+	while (cnt < ARRAY_SIZE(saved)) {
+		const struct disc_cache_entry *next = NULL;
+		int i;
+
+		for (i = 0; i < ARRAY_SIZE(cache); i++) {
+			uint32_t age = use_count - cache[i].last_use;
+
+			if (!cache[i].identity_cnt || age >= age_limit)
+				continue;
+			if (!next || age < use_count - next->last_use)
+				next = &cache[i];
+		}
+		if (!next)
+			break;
+
+		saved[cnt++] = *next;
+		age_limit = use_count - next->last_use;
+	}
+
+	if (cnt)
+		system_add_jump_tag(SYSJUMP_TAG_PD_DISC_CACHE,
+				    DISC_CACHE_HOOK_VERSION,
+				    cnt * sizeof(saved[0]), saved);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, disc_cache_preserve, HOOK_PRIO_DEFAULT);
+
+static void disc_cache_restore_jump(void)
+{
+	const struct disc_cache_entry *prev;
+	int version, size;
+	int cnt, i;
+
+	prev = (const struct disc_cache_entry *)system_get_jump_tag(
+		SYSJUMP_TAG_PD_DISC_CACHE, &version, &size);
+	if (!prev || version != DISC_CACHE_HOOK_VERSION ||
+	    size % sizeof(*prev))
+		return;
+
+	cnt = MIN(size / sizeof(*prev), ARRAY_SIZE(cache));
+	/* Saved from the most recent down: replay the LRU order */
+	for (i = 0; i < cnt; i++) {
+		cache[i] = prev[i];
+		cache[i].last_use = cnt - i;
+	}
+	use_count = cnt;
+}
+DECLARE_HOOK(HOOK_INIT, disc_cache_restore_jump, HOOK_PRIO_FIRST);
+#endif /* CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP */
@@ -42,6 +42,10 @@
  *
  * In the end of the successful image transfer and programming, the host sends
  * the reset command, and the device reboots itself.
+ *
+ * During a windowed transfer (CONFIG_UPDATE_WINDOW), blocks are reassembled
+ * straight into the programmer's ring of buffers instead, and the programmer
+ * sends the confirmations as it goes through them.
  */
 
 struct consumer const update_consumer;
@@ -70,6 +74,8 @@ static uint8_t
 	block_buffer[sizeof(struct update_command) + CONFIG_UPDATE_PDU_SIZE];
 static uint32_t block_size;
 static uint32_t block_index;
+/* Where the block is reassembled, block_buffer or a window buffer */
+static uint8_t *block_ptr = block_buffer;
 
 #ifdef CONFIG_USB_PAIRING
 #define KEY_CONTEXT "device-identity"
@@ -347,6 +353,24 @@ static int try_vendor_command(struct consumer const *consumer, size_t count)
 			return 1;
 		}
 #endif
+#ifdef CONFIG_UPDATE_WINDOW
+		case UPDATE_EXTRA_CMD_SET_WINDOW: {
+			struct update_window_response resp = {
+				.status = EC_RES_SUCCESS,
+			};
+
+			if (data_count != 1) {
+				response = EC_RES_INVALID_PARAM;
+				break;
+			}
+
+			resp.window = fw_update_window_open(
+				(uint8_t)buffer[header_size]);
+			CPRINTS("FW update: window of %d blocks", resp.window);
+			QUEUE_ADD_UNITS(&update_to_usb, &resp, sizeof(resp));
+			return 1;
+		}
+#endif
 #ifdef CONFIG_USB_CONSOLE_READ
 		/*
 		 * TODO(b/112877237): move this to a new interface, so we can
@@ -405,8 +429,21 @@ static void send_error_reset(uint8_t resp_value)
 	QUEUE_ADD_UNITS(&update_to_usb, &resp_value, 1);
 	rx_state_ = rx_idle;
 	data_was_transferred = 0;
+	if (IS_ENABLED(CONFIG_UPDATE_WINDOW))
+		fw_update_window_close();
 }
 
+#ifdef CONFIG_UPDATE_WINDOW
+/* All the confirmations of a window must fit in the queue to the host */
+BUILD_ASSERT(CONFIG_UPDATE_WINDOW_BLOCKS * sizeof(struct update_block_ack) <=
+	     64);
+
+void fw_update_window_ack(const struct update_block_ack *ack)
+{
+	QUEUE_ADD_UNITS(&update_to_usb, ack, sizeof(*ack));
+}
+#endif
+
 /* Called to deal with data from the host */
 static void update_out_handler(struct consumer const *consumer, size_t count)
 {
@@ -422,6 +459,8 @@ static void update_out_handler(struct consumer const *consumer, size_t count)
 	/* If timeout exceeds 5 seconds - let's start over. */
 	if ((delta_time > 5000000) && (rx_state_ != rx_idle)) {
 		rx_state_ = rx_idle;
+		if (IS_ENABLED(CONFIG_UPDATE_WINDOW))
+			fw_update_window_close();
 		CPRINTS("FW update: recovering after timeout");
 	}
 
@@ -498,6 +537,8 @@ static void update_out_handler(struct consumer const *consumer, size_t count)
 					fw_update_complete();
 					data_was_transferred = 0;
 				}
+				if (IS_ENABLED(CONFIG_UPDATE_WINDOW))
+					fw_update_window_close();
 
 				resp_value = 0;
 				QUEUE_ADD_UNITS(&update_to_usb, &resp_value, 1);
@@ -530,20 +571,31 @@ static void update_out_handler(struct consumer const *consumer, size_t count)
 			return;
 		}
 
+		block_ptr = block_buffer;
+		if (IS_ENABLED(CONFIG_UPDATE_WINDOW) &&
+		    fw_update_window_is_open()) {
+			block_ptr = fw_update_window_get_buffer();
+			if (!block_ptr) {
+				CPRINTS("Update window overrun.");
+				send_error_reset(UPDATE_GEN_ERROR);
+				return;
+			}
+		}
+
 		/*
 		 * Copy the rest of the message into the block buffer to pass
 		 * to the updater.
 		 */
 		block_index = sizeof(upfr) -
 			      offsetof(struct update_frame_header, cmd);
-		memcpy(block_buffer, &upfr.cmd, block_index);
+		memcpy(block_ptr, &upfr.cmd, block_index);
 		block_size -= block_index;
 		rx_state_ = rx_inside_block;
 		return;
 	}
 
 	/* Must be inside block. */
-	QUEUE_REMOVE_UNITS(consumer->queue, block_buffer + block_index, count);
+	QUEUE_REMOVE_UNITS(consumer->queue, block_ptr + block_index, count);
 	block_index += count;
 	block_size -= count;
 
@@ -560,17 +612,24 @@ static void update_out_handler(struct consumer const *consumer, size_t count)
 		return; /* More to come. */
 	}
 
-	/*
-	 * Ok, the entire block has been received and reassembled, pass it to
-	 * the updater for verification and programming.
-	 */
-	fw_update_command_handler(block_buffer, block_index, &resp_size);
-
 	/*
 	 * There was at least an attempt to program the flash, set the
 	 * flag.
 	 */
 	data_was_transferred = 1;
+
+	/* The programmer confirms windowed blocks once through with them */
+	if (IS_ENABLED(CONFIG_UPDATE_WINDOW) && fw_update_window_is_open()) {
+		fw_update_window_submit(block_index);
+		rx_state_ = rx_outside_block;
+		return;
+	}
+
+	/*
+	 * Ok, the entire block has been received and reassembled, pass it to
+	 * the updater for verification and programming.
+	 */
+	fw_update_command_handler(block_buffer, block_index, &resp_size);
 	resp_value = block_buffer[0];
 	QUEUE_ADD_UNITS(&update_to_usb, &resp_value, sizeof(resp_value));
 	rx_state_ = rx_outside_block;
@@ -11,6 +11,7 @@ ifneq ($(CONFIG_USB_PD_TCPMV2),)
 all-obj-$(CONFIG_USB_PD_TCPMV2)+=$(_usbc_dir)usb_pd_timer.o
 all-obj-$(CONFIG_USB_PD_TCPMV2)+=$(_usbc_dir)usb_sm.o
 all-obj-$(CONFIG_USB_PD_TCPMV2)+=$(_usbc_dir)usbc_task.o
+all-obj-$(CONFIG_USB_PD_SM_TRACE)+=$(_usbc_dir)usb_sm_trace.o
 
 # Type-C state machines
 ifneq ($(CONFIG_USB_TYPEC_SM),)
@@ -1537,3 +1537,13 @@ static __const_data const struct usb_state dpm_states[] = {
 		.run   = dpm_data_reset_run,
 	},
 };
+
+#ifdef CONFIG_USB_PD_SM_TRACE
+static void dpm_sm_trace_init(void)
+{
+	usb_sm_trace_register(EC_PD_SM_DPM, dpm_states,
+			      ARRAY_SIZE(dpm_states), dpm_state_names,
+			      ARRAY_SIZE(dpm_state_names));
+}
+DECLARE_HOOK(HOOK_INIT, dpm_sm_trace_init, HOOK_PRIO_FIRST);
+#endif /* CONFIG_USB_PD_SM_TRACE */
@@ -212,14 +212,30 @@ bool pd_timer_is_expired(int port, enum pd_task_timer timer)
 	return pd_timer_is_inactive(port, timer);
 }
 
-void pd_timer_manage_expired(int port)
+static enum pd_timer_range pd_timer_get_range(enum pd_task_timer timer)
 {
+	if (timer <= DPM_TIMER_END)
+		return DPM_TIMER_RANGE;
+	if (timer <= PE_TIMER_END)
+		return PE_TIMER_RANGE;
+	if (timer <= PR_TIMER_END)
+		return PR_TIMER_RANGE;
+	return TC_TIMER_RANGE;
+}
+
+uint32_t pd_timer_manage_expired(int port)
+{
+	uint32_t ranges = 0;
 	int timer;
 
 	for (timer = 0; timer < PD_TIMER_COUNT; ++timer)
 		if (pd_timer_is_active(port, timer) &&
-		    pd_timer_is_expired(port, timer))
+		    pd_timer_is_expired(port, timer)) {
 			pd_timer_inactive(port, timer);
+			ranges |= BIT(pd_timer_get_range(timer));
+		}
+
+	return ranges;
 }
 
 int pd_timer_next_expiration(int port)
@@ -74,8 +74,12 @@
 #define CPRINTS_L2(format, args...) CPRINTS_LX(2, format, ##args)
 #define CPRINTS_L3(format, args...) CPRINTS_LX(3, format, ##args)
 
-#define PE_SET_FN(port, _fn) \
-	atomic_or(ATOMIC_ELEM(pe[port].flags_a, (_fn)), ATOMIC_MASK(_fn))
+/* Flags and DPM requests set from outside the PE are new input for it */
+#define PE_MARK_PENDING(port) usbc_sm_mark_pending(port, BIT(USBC_SM_PE))
+
+#define PE_SET_FN(port, _fn)                                             \
+	(atomic_or(ATOMIC_ELEM(pe[port].flags_a, (_fn)), ATOMIC_MASK(_fn)), \
+	 PE_MARK_PENDING(port))
 #define PE_CLR_FN(port, _fn)                                    \
 	atomic_clear_bits(ATOMIC_ELEM(pe[port].flags_a, (_fn)), \
 			  ATOMIC_MASK(_fn))
@@ -89,14 +93,16 @@
 /*
  * TODO(b/229655319): support more than 32 bits
  */
-#define PE_SET_MASK(port, mask) atomic_or(&pe[port].flags_a[0], (mask))
+#define PE_SET_MASK(port, mask) \
+	(atomic_or(&pe[port].flags_a[0], (mask)), PE_MARK_PENDING(port))
 #define PE_CLR_MASK(port, mask) atomic_clear_bits(&pe[port].flags_a[0], (mask))
 
 /*
  * These macros SET, CLEAR, and CHECK, a DPM (Device Policy Manager)
  * Request. The Requests are listed in usb_pe_sm.h.
  */
-#define PE_SET_DPM_REQUEST(port, req) atomic_or(&pe[port].dpm_request, (req))
+#define PE_SET_DPM_REQUEST(port, req) \
+	(atomic_or(&pe[port].dpm_request, (req)), PE_MARK_PENDING(port))
 #define PE_CLR_DPM_REQUEST(port, req) \
 	atomic_clear_bits(&pe[port].dpm_request, (req))
 #define PE_CHK_DPM_REQUEST(port, req) (pe[port].dpm_request & (req))
@@ -5765,6 +5771,28 @@ static void pe_vdm_send_request_exit(int port)
 	pd_timer_disable(port, PE_TIMER_VDM_RESPONSE);
 }
 
+/*
+ * Take SVID and mode discovery of a partner or cable seen before from the
+ * discovery cache, leaving nothing more to discover.
+ */
+static void pe_restore_cached_discovery(int port, enum tcpci_msg_type type)
+{
+	if (!IS_ENABLED(CONFIG_USB_PD_DISCOVERY_CACHE) ||
+	    !pd_discovery_cache_restore(port, type))
+		return;
+
+	pd_notify_event(port, type == TCPCI_MSG_SOP ?
+				      PD_STATUS_EVENT_SOP_DISC_DONE :
+				      PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
+}
+
+/* Save discovery that went through, for the next time this partner shows */
+static void pe_cache_discovery(int port, enum tcpci_msg_type type)
+{
+	if (IS_ENABLED(CONFIG_USB_PD_DISCOVERY_CACHE))
+		pd_discovery_cache_store(port, type);
+}
+
 /**
  * PE_VDM_IDENTITY_REQUEST_CBL
  * Combination of PE_INIT_PORT_VDM_Identity_Request State specific to the
@@ -5853,6 +5881,7 @@ static void pe_vdm_identity_request_cbl_run(int port)
 	case VDM_RESULT_ACK:
 		/* PE_INIT_PORT_VDM_Identity_ACKed embedded here */
 		dfp_consume_identity(port, sop, cnt, payload);
+		pe_restore_cached_discovery(port, sop);
 
 		/*
 		 * Note: If port partner runs PD 2.0, we must use PD 2.0 to
@@ -5993,6 +6022,7 @@ static void pe_init_port_vdm_identity_request_run(int port)
 
 		/* PE_INIT_PORT_VDM_Identity_ACKed embedded here */
 		dfp_consume_identity(port, sop, cnt, payload);
+		pe_restore_cached_discovery(port, sop);
 
 		break;
 	}
@@ -6123,6 +6153,11 @@ static void pe_init_vdm_svids_request_exit(int port)
 				pe[port].tx_type == TCPCI_MSG_SOP ?
 					PD_STATUS_EVENT_SOP_DISC_DONE :
 					PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
+	/* Without any SVID there are no modes to discover, so it is done */
+	else if (pd_get_svids_discovery(port, pe[port].tx_type) ==
+			 PD_DISC_COMPLETE &&
+		 pd_get_svid_count(port, pe[port].tx_type) == 0)
+		pe_cache_discovery(port, pe[port].tx_type);
 }
 
 /**
@@ -6221,12 +6256,14 @@ static void pe_init_vdm_modes_request_run(int port)
 
 static void pe_init_vdm_modes_request_exit(int port)
 {
-	if (pd_get_modes_discovery(port, pe[port].tx_type) != PD_DISC_NEEDED)
+	if (pd_get_modes_discovery(port, pe[port].tx_type) != PD_DISC_NEEDED) {
 		/* Mode discovery done, notify the AP */
 		pd_notify_event(port,
 				pe[port].tx_type == TCPCI_MSG_SOP ?
 					PD_STATUS_EVENT_SOP_DISC_DONE :
 					PD_STATUS_EVENT_SOP_PRIME_DISC_DONE);
+		pe_cache_discovery(port, pe[port].tx_type);
+	}
 }
 
 /**
@@ -8741,6 +8778,16 @@ static __const_data const struct usb_state pe_states[] = {
 #endif /* CONFIG_USB_PD_REV30 */
 };
 
+#ifdef CONFIG_USB_PD_SM_TRACE
+static void pe_sm_trace_init(void)
+{
+	usb_sm_trace_register(EC_PD_SM_PE, pe_states,
+			      ARRAY_SIZE(pe_states), pe_state_names,
+			      ARRAY_SIZE(pe_state_names));
+}
+DECLARE_HOOK(HOOK_INIT, pe_sm_trace_init, HOOK_PRIO_FIRST);
+#endif /* CONFIG_USB_PD_SM_TRACE */
+
 #ifdef TEST_BUILD
 /* TODO(b/173791979): Unit tests shouldn't need to access internal states */
 const struct test_sm_data test_pe_sm_data[] = {
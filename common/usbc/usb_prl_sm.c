@@ -49,10 +49,11 @@
 #ifdef DEBUG_PRINT_FLAG_NAMES
 __maybe_unused static void print_flag(const char *group, int set_or_clear,
 				      int flag);
-#define SET_FLAG(group, flags, flag)        \
-	do {                                \
-		print_flag(group, 1, flag); \
-		atomic_or(flags, (flag));   \
+#define SET_FLAG(port, group, flags, flag)                    \
+	do {                                                     \
+		print_flag(group, 1, flag);                   \
+		atomic_or(flags, (flag));                     \
+		usbc_sm_mark_pending(port, BIT(USBC_SM_PRL)); \
 	} while (0)
 #define CLR_FLAG(group, flags, flag)                \
 	do {                                        \
@@ -62,31 +63,38 @@ __maybe_unused static void print_flag(const char *group, int set_or_clear,
 			print_flag(group, 0, flag); \
 	} while (0)
 #else
-#define SET_FLAG(group, flags, flag) atomic_or(flags, (flag))
+#define SET_FLAG(port, group, flags, flag)                    \
+	do {                                                  \
+		atomic_or(flags, (flag));                     \
+		usbc_sm_mark_pending(port, BIT(USBC_SM_PRL)); \
+	} while (0)
 #define CLR_FLAG(group, flags, flag) atomic_clear_bits(flags, (flag))
 #endif
 
-#define RCH_SET_FLAG(port, flag) SET_FLAG("RCH", &rch[port].flags, (flag))
+#define RCH_SET_FLAG(port, flag) \
+	SET_FLAG(port, "RCH", &rch[port].flags, (flag))
 #define RCH_CLR_FLAG(port, flag) CLR_FLAG("RCH", &rch[port].flags, (flag))
 #define RCH_CHK_FLAG(port, flag) (rch[port].flags & (flag))
 
-#define TCH_SET_FLAG(port, flag) SET_FLAG("TCH", &tch[port].flags, (flag))
+#define TCH_SET_FLAG(port, flag) \
+	SET_FLAG(port, "TCH", &tch[port].flags, (flag))
 #define TCH_CLR_FLAG(port, flag) CLR_FLAG("TCH", &tch[port].flags, (flag))
 #define TCH_CHK_FLAG(port, flag) (tch[port].flags & (flag))
 
 #define PRL_TX_SET_FLAG(port, flag) \
-	SET_FLAG("PRL_TX", &prl_tx[port].flags, (flag))
+	SET_FLAG(port, "PRL_TX", &prl_tx[port].flags, (flag))
 #define PRL_TX_CLR_FLAG(port, flag) \
 	CLR_FLAG("PRL_TX", &prl_tx[port].flags, (flag))
 #define PRL_TX_CHK_FLAG(port, flag) (prl_tx[port].flags & (flag))
 
 #define PRL_HR_SET_FLAG(port, flag) \
-	SET_FLAG("PRL_HR", &prl_hr[port].flags, (flag))
+	SET_FLAG(port, "PRL_HR", &prl_hr[port].flags, (flag))
 #define PRL_HR_CLR_FLAG(port, flag) \
 	CLR_FLAG("PRL_HR", &prl_hr[port].flags, (flag))
 #define PRL_HR_CHK_FLAG(port, flag) (prl_hr[port].flags & (flag))
 
-#define PDMSG_SET_FLAG(port, flag) SET_FLAG("PDMSG", &pdmsg[port].flags, (flag))
+#define PDMSG_SET_FLAG(port, flag) \
+	SET_FLAG(port, "PDMSG", &pdmsg[port].flags, (flag))
 #define PDMSG_CLR_FLAG(port, flag) CLR_FLAG("PDMSG", &pdmsg[port].flags, (flag))
 #define PDMSG_CHK_FLAG(port, flag) (pdmsg[port].flags & (flag))
 
@@ -2613,6 +2621,27 @@ prl_event_log_append(enum prl_event_log_state_kind kind, int port)
 }
 #endif
 
+#ifdef CONFIG_USB_PD_SM_TRACE
+static void prl_sm_trace_init(void)
+{
+	usb_sm_trace_register(EC_PD_SM_PRL_TX, prl_tx_states,
+			      ARRAY_SIZE(prl_tx_states), prl_tx_state_names,
+			      ARRAY_SIZE(prl_tx_state_names));
+	usb_sm_trace_register(EC_PD_SM_PRL_HR, prl_hr_states,
+			      ARRAY_SIZE(prl_hr_states), prl_hr_state_names,
+			      ARRAY_SIZE(prl_hr_state_names));
+#ifdef CONFIG_USB_PD_EXTENDED_MESSAGES
+	usb_sm_trace_register(EC_PD_SM_RCH, rch_states,
+			      ARRAY_SIZE(rch_states), rch_state_names,
+			      ARRAY_SIZE(rch_state_names));
+	usb_sm_trace_register(EC_PD_SM_TCH, tch_states,
+			      ARRAY_SIZE(tch_states), tch_state_names,
+			      ARRAY_SIZE(tch_state_names));
+#endif
+}
+DECLARE_HOOK(HOOK_INIT, prl_sm_trace_init, HOOK_PRIO_FIRST);
+#endif /* CONFIG_USB_PD_SM_TRACE */
+
 #ifdef TEST_BUILD
 
 const struct test_sm_data test_prl_sm_data[] = {
@@ -29,6 +29,16 @@ struct internal_ctx {
 BUILD_ASSERT(sizeof(struct internal_ctx) ==
 	     member_size(struct sm_ctx, internal));
 
+#ifdef CONFIG_USBC_SM_SKIP_IDLE
+/* Run functions called on each port, including parent states */
+static uint32_t run_calls[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+uint32_t usb_sm_get_run_calls(int port)
+{
+	return run_calls[port];
+}
+#endif
+
 /* Gets the first shared parent state between a and b (inclusive) */
 static usb_state_ptr shared_parent_state(usb_state_ptr a, usb_state_ptr b)
 {
@@ -121,6 +131,9 @@ void set_state(const int port, struct sm_ctx *const ctx,
 		return;
 	}
 
+	if (IS_ENABLED(CONFIG_USB_PD_SM_TRACE))
+		usb_sm_trace_record(port, ctx->current, new_state);
+
 	/*
 	 * Determine the last state that was entered. Normally it is current,
 	 * but we could have called set_state within an entry phase, so we
@@ -161,6 +174,9 @@ void set_state(const int port, struct sm_ctx *const ctx,
 	 */
 	internal->running = false;
 
+	/* Any state machine may act on the new state, so run them all */
+	usbc_sm_mark_pending(port, USBC_SM_ALL);
+
 	/*
 	 * Since we are changing states, we want to ensure that we process the
 	 * next state's run method as soon as we can to ensure that we don't
@@ -186,8 +202,12 @@ static void call_run_functions(const int port,
 	if (!internal->running)
 		return;
 
-	if (current->run)
+	if (current->run) {
+#ifdef CONFIG_USBC_SM_SKIP_IDLE
+		run_calls[port]++;
+#endif
 		current->run(port);
+	}
 
 	call_run_functions(port, internal, current->parent);
 }
@@ -0,0 +1,176 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * USB-PD state machine transition trace: a ring buffer per port of every
+ * state change, cheap enough to leave on without perturbing PD timing.
+ */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "timer.h"
+#include "usb_pd.h"
+#include "usb_sm.h"
+#include "util.h"
+
+#define TRACE_SIZE CONFIG_USB_PD_SM_TRACE_SIZE
+BUILD_ASSERT(POWER_OF_TWO(TRACE_SIZE));
+BUILD_ASSERT(TRACE_SIZE <= UINT8_MAX);
+
+struct trace_table {
+	const struct usb_state *states;
+	const char *const *names;
+	uint8_t count;
+	uint8_t names_count;
+};
+
+static struct trace_table tables[EC_PD_SM_COUNT];
+
+static struct port_trace {
+	struct ec_pd_sm_trace_entry ring[TRACE_SIZE];
+	/* Number of the next entry, and of the oldest not cleared */
+	uint32_t head;
+	uint32_t tail;
+	/* Task events of the current port task wakeup */
+	uint32_t event;
+} trace[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+void usb_sm_trace_register(enum ec_pd_sm machine,
+			   const struct usb_state *states, int count,
+			   const char *const *names, int names_count)
+{
+	struct trace_table *t = &tables[machine];
+
+	t->states = states;
+	t->count = MIN(count, EC_PD_SM_STATE_NONE);
+	t->names = names;
+	t->names_count = MIN(names_count, EC_PD_SM_STATE_NONE);
+}
+
+void usb_sm_trace_set_event(int port, uint32_t event)
+{
+	trace[port].event = event;
+}
+
+/* Find the state machine of a state, and the index of the state */
+static int find_state(usb_state_ptr state, uint8_t *index)
+{
+	int m;
+
+	for (m = 0; m < EC_PD_SM_COUNT; m++) {
+		const struct trace_table *t = &tables[m];
+
+		if (t->states && state >= t->states &&
+		    state < t->states + t->count) {
+			*index = state - t->states;
+			return m;
+		}
+	}
+
+	return -1;
+}
+
+void usb_sm_trace_record(int port, usb_state_ptr from, usb_state_ptr to)
+{
+	struct port_trace *pt = &trace[port];
+	struct ec_pd_sm_trace_entry *e;
+	uint8_t old_state = EC_PD_SM_STATE_NONE;
+	uint8_t new_state = EC_PD_SM_STATE_NONE;
+	int machine;
+
+	/* Either state tells the machine, one of them may be NULL */
+	machine = to ? find_state(to, &new_state) : -1;
+	if (machine < 0)
+		machine = from ? find_state(from, &old_state) : -1;
+	else if (from)
+		find_state(from, &old_state);
+	if (machine < 0)
+		return;
+
+	e = &pt->ring[pt->head & (TRACE_SIZE - 1)];
+	e->timestamp = get_time().le.lo;
+	e->event = pt->event;
+	e->machine = machine;
+	e->old_state = old_state;
+	e->new_state = new_state;
+	e->reserved = 0;
+	pt->head++;
+}
+
+static enum ec_status trace_read(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_pd_sm_trace *p = args->params;
+	struct ec_response_pd_sm_trace *r = args->response;
+	const struct port_trace *pt = &trace[p->port];
+	const uint32_t head = pt->head;
+	uint32_t oldest = pt->tail;
+	uint32_t seq = p->seq;
+	int max, i;
+
+	/* The ring only holds the most recent entries */
+	if (head - oldest > TRACE_SIZE)
+		oldest = head - TRACE_SIZE;
+	if ((int32_t)(seq - oldest) < 0 || (int32_t)(seq - head) > 0)
+		seq = oldest;
+
+	max = (args->response_max - sizeof(*r)) / sizeof(r->entries[0]);
+	r->seq = seq;
+	r->head = head;
+	r->count = MIN(MIN(head - seq, max), UINT8_MAX);
+	memset(r->reserved, 0, sizeof(r->reserved));
+	for (i = 0; i < r->count; i++)
+		r->entries[i] = pt->ring[(seq + i) & (TRACE_SIZE - 1)];
+
+	args->response_size = sizeof(*r) + r->count * sizeof(r->entries[0]);
+	return EC_RES_SUCCESS;
+}
+
+static enum ec_status trace_state_name(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_pd_sm_trace *p = args->params;
+	const struct trace_table *t;
+	const char *name;
+	int len;
+
+	if (p->machine >= EC_PD_SM_COUNT)
+		return EC_RES_INVALID_PARAM;
+
+	t = &tables[p->machine];
+	if (p->state >= t->count)
+		return EC_RES_INVALID_PARAM;
+
+	/* Names may be compiled out, or missing for some states */
+	name = p->state < t->names_count ? t->names[p->state] : NULL;
+	if (!name)
+		return EC_RES_UNAVAILABLE;
+
+	len = strlen(name) + 1;
+	if (len > args->response_max)
+		return EC_RES_OVERFLOW;
+
+	memcpy(args->response, name, len);
+	args->response_size = len;
+	return EC_RES_SUCCESS;
+}
+
+static enum ec_status hc_pd_sm_trace(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_pd_sm_trace *p = args->params;
+
+	if (p->port >= board_get_usb_pd_port_count())
+		return EC_RES_INVALID_PARAM;
+
+	switch (p->cmd) {
+	case EC_PD_SM_TRACE_READ:
+		return trace_read(args);
+	case EC_PD_SM_TRACE_CLEAR:
+		trace[p->port].tail = trace[p->port].head;
+		return EC_RES_SUCCESS;
+	case EC_PD_SM_TRACE_STATE_NAME:
+		return trace_state_name(args);
+	default:
+		return EC_RES_INVALID_PARAM;
+	}
+}
+DECLARE_HOST_COMMAND(EC_CMD_PD_SM_TRACE, hc_pd_sm_trace, EC_VER_MASK(0));
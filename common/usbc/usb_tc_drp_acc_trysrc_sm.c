@@ -4182,6 +4182,16 @@ static __const_data const struct usb_state tc_states[] = {
 #endif
 };
 
+#ifdef CONFIG_USB_PD_SM_TRACE
+static void tc_sm_trace_init(void)
+{
+	usb_sm_trace_register(EC_PD_SM_TC, tc_states,
+			      ARRAY_SIZE(tc_states), tc_state_names,
+			      ARRAY_SIZE(tc_state_names));
+}
+DECLARE_HOOK(HOOK_INIT, tc_sm_trace_init, HOOK_PRIO_FIRST);
+#endif /* CONFIG_USB_PD_SM_TRACE */
+
 #if defined(TEST_BUILD) && defined(USB_PD_DEBUG_LABELS)
 const struct test_sm_data test_tc_sm_data[] = {
 	{
@@ -51,6 +51,70 @@ extern int _GPIO_CCD_MODE_ODL;
 
 static uint8_t paused[CONFIG_USB_PD_PORT_MAX_COUNT];
 
+#ifdef CONFIG_USBC_SM_SKIP_IDLE
+/* Bitmask of BIT(enum usbc_sm) with input the state machine has not seen */
+static atomic_t sm_pending[CONFIG_USB_PD_PORT_MAX_COUNT];
+static struct usbc_sm_stats sm_stats[CONFIG_USB_PD_PORT_MAX_COUNT];
+/* usb_sm_get_run_calls() at the last reset */
+static uint32_t sm_run_calls_base[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+void usbc_sm_set_pending(int port, uint32_t sms)
+{
+	atomic_or(&sm_pending[port], sms);
+}
+
+void usbc_sm_get_stats(int port, struct usbc_sm_stats *stats)
+{
+	*stats = sm_stats[port];
+	stats->run_calls = usb_sm_get_run_calls(port) - sm_run_calls_base[port];
+}
+
+void usbc_sm_reset_stats(int port)
+{
+	memset(&sm_stats[port], 0, sizeof(sm_stats[port]));
+	sm_run_calls_base[port] = usb_sm_get_run_calls(port);
+}
+
+/*
+ * Note the input brought by a wakeup. Only a bare timeout, with no timer of
+ * theirs expiring, leaves the gated state machines without new input.
+ */
+static void usbc_sm_wakeup(int port, uint32_t evt, uint32_t expired)
+{
+	sm_stats[port].wakeups++;
+
+	if (evt & ~TASK_EVENT_TIMER)
+		usbc_sm_set_pending(port, USBC_SM_ALL);
+	if (expired & BIT(PE_TIMER_RANGE))
+		usbc_sm_set_pending(port, BIT(USBC_SM_PE));
+	if (expired & BIT(PR_TIMER_RANGE))
+		usbc_sm_set_pending(port, BIT(USBC_SM_PRL));
+}
+
+/*
+ * Consume the pending input of a state machine right before running it, so
+ * that input from the ones run before it in this iteration is seen now.
+ */
+static bool usbc_sm_run(int port, enum usbc_sm sm)
+{
+	if (atomic_clear_bits(&sm_pending[port], BIT(sm)) & BIT(sm)) {
+		sm_stats[port].runs++;
+		return true;
+	}
+	sm_stats[port].skipped++;
+	return false;
+}
+#else
+static inline void usbc_sm_wakeup(int port, uint32_t evt, uint32_t expired)
+{
+}
+
+static inline bool usbc_sm_run(int port, enum usbc_sm sm)
+{
+	return true;
+}
+#endif /* CONFIG_USBC_SM_SKIP_IDLE */
+
 void tc_pause_event_loop(int port)
 {
 	paused[port] = 1;
@@ -69,6 +133,7 @@ void tc_start_event_loop(int port)
 	 */
 	if (paused[port]) {
 		paused[port] = 0;
+		usbc_sm_mark_pending(port, USBC_SM_ALL);
 		task_set_event(PD_PORT_TO_TASK_ID(port), TASK_EVENT_WAKE);
 	}
 }
@@ -78,6 +143,7 @@ static void pd_task_init(int port)
 	if (IS_ENABLED(CONFIG_USB_TYPEC_SM))
 		tc_state_init(port);
 	paused[port] = 0;
+	usbc_sm_mark_pending(port, USBC_SM_ALL);
 
 	/*
 	 * Since most boards configure the TCPC interrupt as edge
@@ -118,10 +184,16 @@ static bool pd_task_loop(int port)
 {
 	/* wait for next event/packet or timeout expiration */
 	const uint32_t evt = task_wait_event(pd_task_timeout(port));
+	uint32_t expired = 0;
 
 	/* Manage expired PD Timers on timeouts */
 	if (evt & TASK_EVENT_TIMER)
-		pd_timer_manage_expired(port);
+		expired = pd_timer_manage_expired(port);
+
+	usbc_sm_wakeup(port, evt, expired);
+
+	if (IS_ENABLED(CONFIG_USB_PD_SM_TRACE))
+		usb_sm_trace_set_event(port, evt);
 
 	/*
 	 * Re-use TASK_EVENT_RESET_DONE in tests to restart the USB task
@@ -146,11 +218,13 @@ static bool pd_task_loop(int port)
 		dpm_run(port, evt, tc_get_pd_enabled(port));
 
 	/* Run policy engine state machine */
-	if (IS_ENABLED(CONFIG_USB_PE_SM))
+	if (IS_ENABLED(CONFIG_USB_PE_SM) && usbc_sm_run(port, USBC_SM_PE))
 		pe_run(port, evt, tc_get_pd_enabled(port));
 
 	/* Run protocol state machine */
-	if (IS_ENABLED(CONFIG_USB_PRL_SM) || IS_ENABLED(CONFIG_TEST_USB_PE_SM))
+	if ((IS_ENABLED(CONFIG_USB_PRL_SM) ||
+	     IS_ENABLED(CONFIG_TEST_USB_PE_SM)) &&
+	    usbc_sm_run(port, USBC_SM_PRL))
 		prl_run(port, evt, tc_get_pd_enabled(port));
 
 	/* Run TypeC state machine */
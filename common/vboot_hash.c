@@ -14,9 +14,9 @@
 #include "host_command.h"
 #include "printf.h"
 #include "sha256.h"
-#include "shared_mem.h"
 #include "stdbool.h"
 #include "stdint.h"
+#include "sysjump.h"
 #include "system.h"
 #include "task.h"
 #include "timer.h"
@@ -33,16 +33,17 @@ struct vboot_hash_tag {
 	uint32_t size;
 };
 
+#define VBOOT_HASH_SYSJUMP_VERSION 1
+BUILD_ASSERT(sizeof(struct vboot_hash_tag) == SYSJUMP_TAG_VBOOT_HASH_SIZE);
+
 #define CHUNK_SIZE 1024 /* Bytes to hash per deferred call */
 #define WORK_INTERVAL_US 100 /* Delay between deferred calls */
 
-/* Check that CHUNK_SIZE fits in shared memory. */
-SHARED_MEM_CHECK_SIZE(CHUNK_SIZE);
-
 static uint32_t data_offset;
 static uint32_t data_size;
 static uint32_t curr_pos;
 static const uint8_t *hash; /* Hash, or NULL if not valid */
+static int hash_nonce_size; /* Size of the nonce hashed before the data */
 static int want_abort;
 static int in_progress;
 #define VBOOT_HASH_DEFERRED true
@@ -71,78 +72,30 @@ void vboot_hash_abort(void)
 		want_abort = 0;
 		data_size = 0;
 		hash = NULL;
-#ifdef CONFIG_SHA256_HW_ACCELERATE
 		SHA256_abort(&ctx);
-#endif
 	}
 }
 
 static void vboot_hash_next_chunk(void);
 DECLARE_DEFERRED(vboot_hash_next_chunk);
 
-#ifndef CONFIG_MAPPED_STORAGE
-
-static int read_and_hash_chunk(int offset, int size)
-{
-	char *buf;
-	int rv;
-
-	if (size == 0)
-		return EC_SUCCESS;
-
-	rv = shared_mem_acquire(size, &buf);
-	if (rv == EC_ERROR_BUSY) {
-		/* Couldn't update hash right now; try again later */
-		hook_call_deferred(&vboot_hash_next_chunk_data,
-				   WORK_INTERVAL_US);
-		return rv;
-	} else if (rv != EC_SUCCESS) {
-		vboot_hash_abort();
-		return rv;
-	}
-
-	rv = crec_flash_read(offset, size, buf);
-	if (rv == EC_SUCCESS)
-		SHA256_update(&ctx, (const uint8_t *)buf, size);
-	else
-		vboot_hash_abort();
-
-	shared_mem_release(buf);
-	return rv;
-}
-
-#endif
-
 #ifdef CONFIG_CONSOLE_VERBOSE
 #define SHA256_PRINT_SIZE SHA256_DIGEST_SIZE
 #else
 #define SHA256_PRINT_SIZE 4
 #endif
 
-static void hash_next_chunk(size_t size)
-{
-#ifdef CONFIG_MAPPED_STORAGE
-	crec_flash_lock_mapped_storage(1);
-	SHA256_update(&ctx,
-		      (const uint8_t *)((uintptr_t)CONFIG_MAPPED_STORAGE_BASE +
-					data_offset + curr_pos),
-		      size);
-	crec_flash_lock_mapped_storage(0);
-#else
-	if (read_and_hash_chunk(data_offset + curr_pos, size) != EC_SUCCESS)
-		return;
-#endif
-}
-
 static void vboot_hash_all_chunks(void)
 {
 	char str_buf[hex_str_buf_size(SHA256_PRINT_SIZE)];
 
-	do {
-		size_t size = MIN(CHUNK_SIZE, data_size - curr_pos);
-		hash_next_chunk(size);
-		curr_pos += size;
-	} while (curr_pos < data_size);
+	if (SHA256_update_flash(&ctx, data_offset, data_size) != EC_SUCCESS) {
+		in_progress = 0;
+		clock_enable_module(MODULE_FAST_CPU, 0);
+		vboot_hash_abort();
+		return;
+	}
+	curr_pos = data_size;
 
 	hash = SHA256_final(&ctx);
 	snprintf_hex_buffer(str_buf, sizeof(str_buf),
@@ -160,6 +113,7 @@ static void vboot_hash_all_chunks(void)
 static void vboot_hash_next_chunk(void)
 {
 	int size;
+	int rv;
 
 	/* Handle abort */
 	if (want_abort) {
@@ -171,7 +125,18 @@ static void vboot_hash_next_chunk(void)
 
 	/* Compute the next chunk of hash */
 	size = MIN(CHUNK_SIZE, data_size - curr_pos);
-	hash_next_chunk(size);
+	rv = SHA256_update_flash(&ctx, data_offset + curr_pos, size);
+	if (rv == EC_ERROR_BUSY) {
+		/* Couldn't update hash right now; try again later */
+		hook_call_deferred(&vboot_hash_next_chunk_data,
+				   WORK_INTERVAL_US);
+		return;
+	} else if (rv != EC_SUCCESS) {
+		in_progress = 0;
+		clock_enable_module(MODULE_FAST_CPU, 0);
+		vboot_hash_abort();
+		return;
+	}
 
 	curr_pos += size;
 	if (curr_pos >= data_size) {
@@ -238,6 +203,7 @@ static int vboot_hash_start(uint32_t offset, uint32_t size,
 	data_size = size;
 	curr_pos = 0;
 	hash = NULL;
+	hash_nonce_size = nonce_size;
 	want_abort = 0;
 	in_progress = 1;
 
@@ -296,6 +262,46 @@ static uint32_t get_rw_size(void)
 #endif
 }
 
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+/* The RW hash doesn't change across a jump, unless the flash was written */
+static void vboot_hash_preserve(void)
+{
+	struct vboot_hash_tag tag;
+
+	/* A hash with a nonce is of no use to the next image */
+	if (!hash || in_progress || hash_nonce_size)
+		return;
+
+	memcpy(tag.hash, hash, sizeof(tag.hash));
+	tag.offset = data_offset;
+	tag.size = data_size;
+	system_add_jump_struct(SYSJUMP_TAG_VBOOT_HASH,
+			       VBOOT_HASH_SYSJUMP_VERSION, &tag);
+}
+DECLARE_HOOK(HOOK_SYSJUMP, vboot_hash_preserve, HOOK_PRIO_DEFAULT);
+
+/* Take the hash of the region the previous image hashed, if it's the same */
+static void vboot_hash_restore(uint32_t offset, uint32_t size)
+{
+	static uint8_t saved_hash[SHA256_DIGEST_SIZE];
+	const struct vboot_hash_tag *tag;
+
+	tag = system_get_jump_struct(SYSJUMP_TAG_VBOOT_HASH,
+				     VBOOT_HASH_SYSJUMP_VERSION,
+				     struct vboot_hash_tag);
+	if (!tag || tag->offset != offset || tag->size != size)
+		return;
+
+	memcpy(saved_hash, tag->hash, sizeof(saved_hash));
+	data_offset = offset;
+	data_size = size;
+	curr_pos = size;
+	hash_nonce_size = 0;
+	hash = saved_hash;
+	CPRINTS("hash taken over 0x%08x 0x%08x", offset, size);
+}
+#endif /* CONFIG_SYSJUMP_WARM_STATE */
+
 static void vboot_hash_init(void)
 {
 #ifdef CONFIG_HOSTCMD_EVENTS
@@ -317,10 +323,15 @@ static void vboot_hash_init(void)
 		 * Start computing the hash of RW firmware only if we haven't
 		 * done it before.
 		 */
+		uint32_t offset = flash_get_rw_offset(system_get_active_copy());
+
+#ifdef CONFIG_SYSJUMP_WARM_STATE
+		if (!hash && !in_progress)
+			vboot_hash_restore(offset, get_rw_size());
+#endif
 		if (!hash) {
-			vboot_hash_start(
-				flash_get_rw_offset(system_get_active_copy()),
-				get_rw_size(), NULL, 0, VBOOT_HASH_DEFERRED);
+			vboot_hash_start(offset, get_rw_size(), NULL, 0,
+					 VBOOT_HASH_DEFERRED);
 		}
 	}
 }
@@ -216,6 +216,16 @@ int fp_sensor_acquire_image_with_mode(uint8_t *image_data, int mode)
 	return elan_sensor_acquire_image_with_mode(image_data, mode);
 }
 
+/**
+ * Get the timing of the last image acquisition.
+ *
+ * @param[out] timing  phases of the last acquisition
+ */
+void fp_sensor_get_capture_timing(struct fp_sensor_capture_timing *timing)
+{
+	elan_get_capture_timing(timing);
+}
+
 /**
  * Returns the status of the finger on the sensor.
  *
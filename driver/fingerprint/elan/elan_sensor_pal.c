@@ -14,7 +14,6 @@
 #include "gpio.h"
 #include "link_defs.h"
 #include "math_util.h"
-#include "shared_mem.h"
 #include "spi.h"
 #include "system.h"
 #include "timer.h"
@@ -113,24 +112,54 @@ int elan_write_reg_vector(const uint8_t *reg_table, int length)
 	return ret;
 }
 
+/*
+ * Image lines read per SPI transaction: while the MCU works on the lines of
+ * one half of rx_buf, the DMA fills the other half with the next ones.
+ */
+#define READ_LINES (CONFIG_SPI_RX_BUF_SIZE / 2 / RAW_DATA_SIZE)
+BUILD_ASSERT(READ_LINES > 0);
+
+static struct fp_sensor_capture_timing capture_timing;
+
+/*
+ * Lines come from the sensor as big endian pixels, followed by dummy bytes.
+ */
+static void convert_lines(uint16_t *short_raw, const uint8_t *data,
+			  int first_line, int lines)
+{
+	int line, i;
+
+	for (line = 0; line < lines; line++) {
+		const uint8_t *src = data + line * RAW_DATA_SIZE;
+		uint16_t *dst = short_raw + (first_line + line) * IMAGE_HEIGHT;
+
+		for (i = 0; i < IMAGE_HEIGHT; i++)
+			dst[i] = (src[2 * i] << 8) | src[2 * i + 1];
+	}
+}
+
+/* Start reading the next lines of the image into buf. */
+static int read_lines_async(uint8_t *buf, int lines)
+{
+	tx_buf[0] = START_READ_IMAGE;
+	return spi_transaction_async(&spi_devices[0], tx_buf, 2, buf,
+				     lines * RAW_DATA_SIZE);
+}
+
 int raw_capture(uint16_t *short_raw)
 {
-	int ret = 0, i = 0, image_index = 0, index = 0;
+	uint8_t *const buf[2] = { rx_buf, rx_buf + READ_LINES * RAW_DATA_SIZE };
+	int ret = 0;
 	int cnt_timer = 0;
-	int dma_loop = 0, dma_len = 0;
+	int first_line, lines, next_lines, i;
 	uint8_t regdata[4] = { 0 };
-	char *img_buf;
+	timestamp_t start, t0;
 
+	memset(&capture_timing, 0, sizeof(capture_timing));
 	memset(short_raw, 0, sizeof(uint16_t) * IMAGE_TOTAL_PIXEL);
 
-	ret = shared_mem_acquire(sizeof(uint8_t) * IMG_BUF_SIZE, &img_buf);
-	if (ret) {
-		LOGE_SA("%s Can't get shared mem\n", __func__);
-		return ret;
-	}
-	memset(img_buf, 0, sizeof(uint8_t) * IMG_BUF_SIZE);
-
 	/* Write start scans command to fp sensor */
+	start = get_time();
 	if (elan_write_cmd(START_SCAN) < 0) {
 		ret = ELAN_ERROR_SPI;
 		LOGE_SA("%s SPISendCommand( SSP2, START_SCAN ) fail ret = %d",
@@ -155,41 +184,55 @@ int raw_capture(uint16_t *short_raw)
 			goto exit;
 		}
 	}
+	capture_timing.scan_us = time_since32(start);
 
-	/* Read the image from fp sensor */
-	dma_loop = 4;
-	dma_len = IMG_BUF_SIZE / dma_loop;
-
-	for (i = 0; i < dma_loop; i++) {
-		memset(tx_buf, 0, CONFIG_SPI_TX_BUF_SIZE);
-		memset(rx_buf, 0, CONFIG_SPI_RX_BUF_SIZE);
-		tx_buf[0] = START_READ_IMAGE;
-		ret = spi_transaction(&spi_devices[0], tx_buf, 2, rx_buf,
-				      dma_len);
-		memcpy(&img_buf[dma_len * i], rx_buf, dma_len);
-	}
+	/*
+	 * Read the image from fp sensor. Each batch of lines is converted
+	 * while the next one arrives.
+	 */
+	start = get_time();
+	memset(tx_buf, 0, CONFIG_SPI_TX_BUF_SIZE);
+	lines = MIN(READ_LINES, IMAGE_WIDTH);
+	ret = read_lines_async(buf[0], lines);
+	for (i = 0, first_line = 0; !ret && first_line < IMAGE_WIDTH; i++) {
+		ret = spi_transaction_flush(&spi_devices[0]);
+		if (ret)
+			break;
 
-	/* Remove dummy byte */
-	for (image_index = 1; image_index < IMAGE_WIDTH; image_index++)
-		memcpy(&img_buf[RAW_PIXEL_SIZE * image_index],
-		       &img_buf[RAW_DATA_SIZE * image_index], RAW_PIXEL_SIZE);
+		next_lines = MIN(READ_LINES, IMAGE_WIDTH - first_line - lines);
+		if (next_lines)
+			ret = read_lines_async(buf[(i + 1) % 2], next_lines);
 
-	for (index = 0; index < IMAGE_TOTAL_PIXEL; index++)
-		short_raw[index] =
-			(img_buf[index * 2] << 8) + img_buf[index * 2 + 1];
+		t0 = get_time();
+		convert_lines(short_raw, buf[i % 2], first_line, lines);
+		capture_timing.process_us += time_since32(t0);
 
-exit:
-	if (img_buf != NULL) {
-		always_memset(img_buf, 0, sizeof(uint8_t) * IMG_BUF_SIZE);
-		shared_mem_release(img_buf);
+		first_line += lines;
+		lines = next_lines;
 	}
+	capture_timing.readout_us = time_since32(start);
+	/*
+	 * A transaction that failed leaves CS asserted, and its DMA may still
+	 * be writing to rx_buf.
+	 */
+	if (ret) {
+		spi_transaction_flush(&spi_devices[0]);
+		ret = ELAN_ERROR_SPI;
+	}
+	always_memset(rx_buf, 0, sizeof(rx_buf));
 
+exit:
 	if (ret != 0)
 		LOGE_SA("%s error = %d", __func__, ret);
 
 	return ret;
 }
 
+void elan_get_capture_timing(struct fp_sensor_capture_timing *timing)
+{
+	*timing = capture_timing;
+}
+
 int elan_execute_calibration(void)
 {
 	int retry_time = 0;
@@ -7,6 +7,8 @@
 #ifndef ELAN_SENSOR_PAL_H_
 #define ELAN_SENSOR_PAL_H_
 
+struct fp_sensor_capture_timing;
+
 /* ELAN error codes */
 enum elan_error_code {
 	ELAN_ERROR_NONE = 0,
@@ -105,6 +107,13 @@ int elan_write_reg_vector(const uint8_t *reg_table, int length);
  */
 int raw_capture(uint16_t *short_raw);
 
+/**
+ * Get the timing of the last raw capture.
+ *
+ * @param[out] timing  phases of the last capture
+ */
+void elan_get_capture_timing(struct fp_sensor_capture_timing *timing);
+
 /**
  * Execute calibrate ELAN fingerprint sensor flow.
  *
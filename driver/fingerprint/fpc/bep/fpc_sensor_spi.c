@@ -12,6 +12,7 @@
 #include "fpsensor_utils.h"
 #include "gpio.h"
 #include "spi.h"
+#include "timer.h"
 #include "util.h"
 
 #include <stdbool.h>
@@ -31,9 +32,12 @@ int __unused fpc_sensor_spi_write_read(uint8_t *write, uint8_t *read,
 	int rc = 0;
 
 	if (size == FP_SENSOR_REAL_IMAGE_SIZE_FPC) {
+		timestamp_t start = get_time();
+
 		rc |= spi_transaction(SPI_FP_DEVICE, write, size, read,
 				      SPI_READBACK_ALL);
 		spi_transaction_flush(SPI_FP_DEVICE);
+		fpc_set_readout_time(time_since32(start));
 	} else if (size <= SPI_BUF_SIZE) {
 		memcpy(spi_buf, write, size);
 		rc |= spi_transaction_async(SPI_FP_DEVICE, spi_buf, size,
@@ -4,6 +4,7 @@
  */
 
 #include <stddef.h>
+#include <string.h>
 
 #include <include/fpsensor.h>
 #include <include/fpsensor_state.h>
@@ -51,3 +52,21 @@ int fpc_fp_maintenance(uint16_t *error_state)
 
 	return EC_SUCCESS;
 }
+
+/* Time taken by the last transfer of an image from the sensor */
+static uint32_t readout_us;
+
+void fpc_set_readout_time(uint32_t us)
+{
+	readout_us = us;
+}
+
+void fp_sensor_get_capture_timing(struct fp_sensor_capture_timing *timing)
+{
+	/*
+	 * The FPC library scans and reads out the image in one call, only
+	 * the image transfer can be told apart, from the SPI callbacks.
+	 */
+	memset(timing, 0, sizeof(*timing));
+	timing->readout_us = readout_us;
+}
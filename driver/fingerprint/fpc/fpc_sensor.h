@@ -20,4 +20,12 @@
 
 int fpc_fp_maintenance(uint16_t *error_state);
 
+/**
+ * Record how long the transfer of an image from the sensor took, for
+ * fp_sensor_get_capture_timing().
+ *
+ * @param[in] us  duration of the transfer
+ */
+void fpc_set_readout_time(uint32_t us);
+
 #endif /* __CROS_EC_DRIVER_FINGERPRINT_FPC_FPC_SENSOR_H_ */
@@ -6,6 +6,7 @@
 
 #include "common.h"
 #include "console.h"
+#include "driver/fingerprint/fpc/fpc_sensor.h"
 #include "fpc_sensor_pal.h"
 #include "fpsensor.h"
 #include "fpsensor_utils.h"
@@ -37,8 +38,14 @@ int fpc_pal_delay_us(uint64_t us)
 int fpc_pal_spi_writeread(fpc_device_t device, uint8_t *tx_buf, uint8_t *rx_buf,
 			  uint32_t size)
 {
-	return spi_transaction(SPI_FP_DEVICE, tx_buf, size, rx_buf,
-			       SPI_READBACK_ALL);
+	timestamp_t start = get_time();
+	int rv = spi_transaction(SPI_FP_DEVICE, tx_buf, size, rx_buf,
+				 SPI_READBACK_ALL);
+
+	/* Only the image takes a whole frame's worth of pixels. */
+	if (size >= FP_SENSOR_RES_X_FPC * FP_SENSOR_RES_Y_FPC)
+		fpc_set_readout_time(time_since32(start));
+	return rv;
 }
 
 int fpc_pal_wait_irq(fpc_device_t device, fpc_pal_irq_t irq_type)
@@ -24,6 +24,7 @@
 #include "usb_pd_flags.h"
 #include "usb_pd_tcpc.h"
 #include "usb_pd_tcpm.h"
+#include "usb_sm.h"
 #include "util.h"
 
 #define CPRINTF(format, args...) cprintf(CC_USBPD, format, ##args)
@@ -892,6 +893,7 @@ int tcpm_enqueue_message(const int port)
 	atomic_add(&q->head, 1);
 
 	/* Wake PD task up so it can process incoming RX messages */
+	usbc_sm_mark_pending(port, BIT(USBC_SM_PRL));
 	task_set_event(PD_PORT_TO_TASK_ID(port), TASK_EVENT_WAKE);
 
 	return EC_SUCCESS;
@@ -45,13 +45,68 @@ static atomic_t flags[CONFIG_USB_PD_PORT_MAX_COUNT];
 /* Coordinate mux accesses by-port among the tasks */
 static mutex_t mux_lock[CONFIG_USB_PD_PORT_MAX_COUNT];
 
+/* Mode set statistics of each port, protected by mux_lock */
+static struct mux_set_stats {
+	uint32_t sets; /* Mode sets completed */
+	uint32_t elided; /* Chip writes skipped, chip already in that state */
+	uint32_t last_us; /* Latency of the last set, from request to done */
+	uint32_t max_us; /* Longest latency */
+} mux_stats[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+#ifdef CONFIG_USB_MUX_SHADOW_STATE
+/* Chips further down a chain are written on every set */
+#define MUX_SHADOW_CHIPS 4
+
+/* Last state programmed into each chip, valid if its bit is set */
+static mux_state_t mux_shadow[CONFIG_USB_PD_PORT_MAX_COUNT][MUX_SHADOW_CHIPS];
+static uint8_t mux_shadow_valid[CONFIG_USB_PD_PORT_MAX_COUNT];
+
+static bool mux_shadow_matches(int port, int chip, mux_state_t state)
+{
+	return chip < MUX_SHADOW_CHIPS &&
+	       (mux_shadow_valid[port] & BIT(chip)) &&
+	       mux_shadow[port][chip] == state;
+}
+
+static void mux_shadow_update(int port, int chip, mux_state_t state)
+{
+	if (chip < MUX_SHADOW_CHIPS) {
+		mux_shadow[port][chip] = state;
+		mux_shadow_valid[port] |= BIT(chip);
+	}
+}
+
+/* Forget the state of a chip, or of the whole chain for chip < 0 */
+static void mux_shadow_invalidate(int port, int chip)
+{
+	if (chip < 0)
+		mux_shadow_valid[port] = 0;
+	else if (chip < MUX_SHADOW_CHIPS)
+		mux_shadow_valid[port] &= ~BIT(chip);
+}
+#else
+static bool mux_shadow_matches(int port, int chip, mux_state_t state)
+{
+	return false;
+}
+
+static void mux_shadow_update(int port, int chip, mux_state_t state)
+{
+}
+
+static void mux_shadow_invalidate(int port, int chip)
+{
+}
+#endif /* CONFIG_USB_MUX_SHADOW_STATE */
+
 /* Coordinate which task requires an ACK event */
 static task_id_t ack_task[CONFIG_USB_PD_PORT_MAX_COUNT] = {
 	[0 ... CONFIG_USB_PD_PORT_MAX_COUNT - 1] = TASK_ID_INVALID
 };
 
 static void perform_mux_set(int port, int index, mux_state_t mux_mode,
-			    enum usb_switch usb_mode, int polarity);
+			    enum usb_switch usb_mode, int polarity,
+			    timestamp_t requested);
 static void perform_mux_hpd_update(int port, int index, mux_state_t hpd_state);
 
 enum mux_config_type {
@@ -65,9 +120,32 @@ enum mux_config_type {
 	USB_MUX_HPD_UPDATE,
 };
 
+/*
+ * Mux sets run either in the USB_MUX task, which services every port in
+ * turn, or in one USB_MUX_C<n> task per port so a slow chain on one port
+ * does not hold up the others. Per-port tasks must be declared in port
+ * order, for every port.
+ */
+#if defined(HAS_TASK_USB_MUX) && defined(HAS_TASK_USB_MUX_C0)
+#error "Declare either the USB_MUX task or the USB_MUX_C<n> tasks"
+#elif defined(HAS_TASK_USB_MUX_C0)
+#define HAS_USB_MUX_TASK
+#define MUX_TASK_ID(port) (TASK_ID_USB_MUX_C0 + (port))
+#if CONFIG_USB_PD_PORT_MAX_COUNT > 1
+BUILD_ASSERT(TASK_ID_USB_MUX_C1 == TASK_ID_USB_MUX_C0 + 1);
+#endif
+#if CONFIG_USB_PD_PORT_MAX_COUNT > 2
+BUILD_ASSERT(TASK_ID_USB_MUX_C2 == TASK_ID_USB_MUX_C0 + 2);
+#endif
+#if CONFIG_USB_PD_PORT_MAX_COUNT > 3
+BUILD_ASSERT(TASK_ID_USB_MUX_C3 == TASK_ID_USB_MUX_C0 + 3);
+#endif
+#elif defined(HAS_TASK_USB_MUX)
+#define HAS_USB_MUX_TASK
+#define MUX_TASK_ID(port) TASK_ID_USB_MUX
+#else
 /* Define a USB mux task ID for the purpose of linking */
-#ifndef HAS_TASK_USB_MUX
-#define TASK_ID_USB_MUX TASK_ID_INVALID
+#define MUX_TASK_ID(port) TASK_ID_INVALID
 #endif
 
 /*
@@ -93,16 +171,14 @@ struct mux_queue_entry {
 	mux_state_t mux_mode; /* For both HPD and mux set */
 	enum usb_switch usb_config; /* Set only */
 	int polarity; /* Set only */
-#ifdef DEBUG_MUX_QUEUE_TIME
 	timestamp_t enqueued_time;
-#endif
 };
 
 /*
  * Note: test builds won't optimize out the mux task code and thereby require
  * the queue to link
  */
-#if defined(TEST_BUILD) || defined(HAS_TASK_USB_MUX)
+#if defined(TEST_BUILD) || defined(HAS_USB_MUX_TASK)
 /*
  * Note: QUEUE macros cannot be used to initialize this array, since they rely
  * on anonymous data structs for allocation which results in all entries
@@ -127,7 +203,7 @@ static int init_mux_mutex(void)
 	for (port = 0; port < CONFIG_USB_PD_PORT_MAX_COUNT; port++) {
 		k_mutex_init(&mux_lock[port]);
 
-		if (IS_ENABLED(HAS_TASK_USB_MUX))
+		if (IS_ENABLED(HAS_USB_MUX_TASK))
 			k_mutex_init(&queue_lock[port]);
 	}
 
@@ -142,7 +218,7 @@ mux_task_enqueue(int port, int index, enum mux_config_type type,
 {
 	struct mux_queue_entry new_entry;
 
-	if (!IS_ENABLED(HAS_TASK_USB_MUX))
+	if (!IS_ENABLED(HAS_USB_MUX_TASK))
 		return;
 
 	new_entry.type = type;
@@ -150,21 +226,19 @@ mux_task_enqueue(int port, int index, enum mux_config_type type,
 	new_entry.mux_mode = mux_mode;
 	new_entry.usb_config = usb_config;
 	new_entry.polarity = polarity;
-#ifdef DEBUG_MUX_QUEUE_TIME
 	new_entry.enqueued_time = get_time();
-#endif
 
 	mutex_lock(&queue_lock[port]);
 
 	if (queue_add_unit(&mux_queue[port], &new_entry) == 0)
 		CPRINTS("Error: Dropping port %d mux %d", port, type);
 	else
-		task_wake(TASK_ID_USB_MUX);
+		task_wake(MUX_TASK_ID(port));
 
 	mutex_unlock(&queue_lock[port]);
 }
 
-#ifdef HAS_TASK_USB_MUX
+#ifdef HAS_USB_MUX_TASK
 static void init_queue_structs(void)
 {
 	int i;
@@ -181,6 +255,56 @@ static void init_queue_structs(void)
 DECLARE_HOOK(HOOK_INIT, init_queue_structs, HOOK_PRIO_FIRST);
 #endif
 
+/*
+ * Process the first item in the queue of a port, and return true if more
+ * items are waiting.
+ */
+__maybe_unused static bool mux_task_service(int port)
+{
+	/*
+	 * Leave the item in the queue until we've completed its operation so
+	 * the PD task can tell it is still pending. Note this should be safe
+	 * to do unlocked, as only the task servicing this port changes the
+	 * queue head.
+	 */
+	struct mux_queue_entry next;
+
+	if (!queue_count(&mux_queue[port]))
+		return false;
+
+	queue_peek_units(&mux_queue[port], &next, 0, 1);
+
+#ifdef DEBUG_MUX_QUEUE_TIME
+	CPRINTS("C%d: Start mux set queued %d us ago", port,
+		time_since32(next.enqueued_time));
+#endif
+	if (next.type == USB_MUX_SET_MODE)
+		perform_mux_set(port, next.index, next.mux_mode,
+				next.usb_config, next.polarity,
+				next.enqueued_time);
+	else if (next.type == USB_MUX_HPD_UPDATE)
+		perform_mux_hpd_update(port, next.index, next.mux_mode);
+	else
+		CPRINTS("Error: Unknown mux task type:"
+			"%d",
+			next.type);
+
+#ifdef DEBUG_MUX_QUEUE_TIME
+	CPRINTS("C%d: Completed mux set queued %d "
+		"us ago",
+		port, time_since32(next.enqueued_time));
+#endif
+	/*
+	 * Lock since the tail is changing, which would disrupt any calls
+	 * iterating the queue.
+	 */
+	mutex_lock(&queue_lock[port]);
+	queue_advance_head(&mux_queue[port], 1);
+	mutex_unlock(&queue_lock[port]);
+
+	return queue_count(&mux_queue[port]) != 0;
+}
+
 __maybe_unused void usb_mux_task(void *u)
 {
 	bool items_waiting = true;
@@ -198,57 +322,24 @@ __maybe_unused void usb_mux_task(void *u)
 		 * Round robin the ports, so no one port can monopolize the task
 		 */
 		for (port = 0; port < board_get_usb_pd_port_count(); port++) {
-			if (queue_count(&mux_queue[port])) {
-				/*
-				 * Process our first item.  Leave it in the
-				 * queue until we've completed its operation so
-				 * the PD task can tell it is still pending.
-				 * Note this should be safe to do unlocked, as
-				 * this task is the only one which changes the
-				 * queue head.
-				 */
-				struct mux_queue_entry next;
-
-				queue_peek_units(&mux_queue[port], &next, 0, 1);
+			/*
+			 * Force the task to run again if this queue has more
+			 * items to process.
+			 */
+			if (mux_task_service(port))
+				items_waiting = true;
+		}
+	}
+}
 
-#ifdef DEBUG_MUX_QUEUE_TIME
-				CPRINTS("C%d: Start mux set queued %d us ago",
-					port, time_since32(next.enqueued_time));
-#endif
-				if (next.type == USB_MUX_SET_MODE)
-					perform_mux_set(port, next.index,
-							next.mux_mode,
-							next.usb_config,
-							next.polarity);
-				else if (next.type == USB_MUX_HPD_UPDATE)
-					perform_mux_hpd_update(port, next.index,
-							       next.mux_mode);
-				else
-					CPRINTS("Error: Unknown mux task type:"
-						"%d",
-						next.type);
+/* USB_MUX_C<n> task, servicing only the port given as its parameter */
+__maybe_unused void usb_mux_port_task(void *u)
+{
+	const int port = (intptr_t)u;
 
-#ifdef DEBUG_MUX_QUEUE_TIME
-				CPRINTS("C%d: Completed mux set queued %d "
-					"us ago",
-					port, time_since32(next.enqueued_time));
-#endif
-				/*
-				 * Lock since the tail is changing, which would
-				 * disrupt any calls iterating the queue.
-				 */
-				mutex_lock(&queue_lock[port]);
-				queue_advance_head(&mux_queue[port], 1);
-				mutex_unlock(&queue_lock[port]);
-
-				/*
-				 * Force the task to run again if this queue has
-				 * more items to process.
-				 */
-				if (queue_count(&mux_queue[port]))
-					items_waiting = true;
-			}
-		}
+	while (1) {
+		if (!mux_task_service(port))
+			task_wait_event(-1);
 	}
 }
 
@@ -289,6 +380,8 @@ static int configure_mux(int port, int index, enum mux_config_type config,
 
 		switch (config) {
 		case USB_MUX_INIT:
+			mux_shadow_invalidate(port, chip);
+
 			if (drv && drv->init) {
 				rv = drv->init(mux_ptr);
 				if (rv)
@@ -302,6 +395,8 @@ static int configure_mux(int port, int index, enum mux_config_type config,
 			break;
 
 		case USB_MUX_LOW_POWER:
+			mux_shadow_invalidate(port, chip);
+
 			if (drv && drv->enter_low_power_mode)
 				rv = drv->enter_low_power_mode(mux_ptr);
 
@@ -322,6 +417,8 @@ static int configure_mux(int port, int index, enum mux_config_type config,
 			break;
 
 		case USB_MUX_CHIPSET_RESET:
+			mux_shadow_invalidate(port, chip);
+
 			if (drv && drv->chipset_reset)
 				rv = drv->chipset_reset(mux_ptr);
 
@@ -337,16 +434,28 @@ static int configure_mux(int port, int index, enum mux_config_type config,
 			    (mux_ptr->flags & USB_MUX_FLAG_POLARITY_INVERTED))
 				lcl_state ^= USB_PD_MUX_POLARITY_INVERTED;
 
-			if (drv && drv->set) {
-				rv = drv->set(mux_ptr, lcl_state,
-					      &ack_required);
-				if (rv)
-					break;
-			}
+			/* The chip is known to be in that state already */
+			if (mux_shadow_matches(port, chip, lcl_state)) {
+				mux_stats[port].elided++;
+			} else {
+				mux_shadow_invalidate(port, chip);
+
+				if (drv && drv->set) {
+					rv = drv->set(mux_ptr, lcl_state,
+						      &ack_required);
+					if (rv)
+						break;
+				}
+
+				/* Apply board specific setting */
+				if (mux_ptr->board_set)
+					rv = mux_ptr->board_set(mux_ptr,
+								lcl_state);
 
-			/* Apply board specific setting */
-			if (mux_ptr->board_set)
-				rv = mux_ptr->board_set(mux_ptr, lcl_state);
+				if (rv == EC_SUCCESS)
+					mux_shadow_update(port, chip,
+							  lcl_state);
+			}
 
 			/* Inform the AP its selected mux is set */
 			if (IS_ENABLED(CONFIG_USB_MUX_AP_CONTROL)) {
@@ -393,8 +502,8 @@ static int configure_mux(int port, int index, enum mux_config_type config,
 			 * This should only be called from the PD task or usb
 			 * mux task
 			 */
-			if (IS_ENABLED(HAS_TASK_USB_MUX)) {
-				assert(task_get_current() == TASK_ID_USB_MUX);
+			if (IS_ENABLED(HAS_USB_MUX_TASK)) {
+				assert(task_get_current() == MUX_TASK_ID(port));
 			} else {
 #if defined(CONFIG_ZEPHYR) && defined(TEST_BUILD)
 				assert(port == TASK_ID_TO_PD_PORT(
@@ -486,8 +595,22 @@ void usb_mux_init(int port)
 		atomic_clear_bits(&flags[port], USB_MUX_FLAG_IN_LPM);
 }
 
+/* Account for a completed mode set, requested at the given time */
+static void record_mux_set(int port, timestamp_t requested)
+{
+	struct mux_set_stats *stats = &mux_stats[port];
+	const uint32_t latency = time_since32(requested);
+
+	mutex_lock(&mux_lock[port]);
+	stats->sets++;
+	stats->last_us = latency;
+	stats->max_us = MAX(stats->max_us, latency);
+	mutex_unlock(&mux_lock[port]);
+}
+
 static void perform_mux_set(int port, int index, mux_state_t mux_mode,
-			    enum usb_switch usb_mode, int polarity)
+			    enum usb_switch usb_mode, int polarity,
+			    timestamp_t requested)
 {
 	mux_state_t mux_state;
 	const int should_enter_low_power_mode =
@@ -507,8 +630,11 @@ static void perform_mux_set(int port, int index, mux_state_t mux_mode,
 	 * flag is only set if the mux set() operation succeeded previously for
 	 * the same disconnected state.
 	 */
-	if (should_enter_low_power_mode && (flags[port] & USB_MUX_FLAG_IN_LPM))
+	if (should_enter_low_power_mode &&
+	    (flags[port] & USB_MUX_FLAG_IN_LPM)) {
+		record_mux_set(port, requested);
 		return;
+	}
 
 	if (exit_low_power_mode(port) != EC_SUCCESS)
 		return;
@@ -531,6 +657,8 @@ static void perform_mux_set(int port, int index, mux_state_t mux_mode,
 	 */
 	if (should_enter_low_power_mode)
 		enter_low_power_mode(port);
+
+	record_mux_set(port, requested);
 }
 
 void usb_mux_set(int port, mux_state_t mux_mode, enum usb_switch usb_mode,
@@ -540,13 +668,13 @@ void usb_mux_set(int port, mux_state_t mux_mode, enum usb_switch usb_mode,
 		return;
 
 	/* Block if we have no mux task, but otherwise queue it up and return */
-	if (IS_ENABLED(HAS_TASK_USB_MUX))
+	if (IS_ENABLED(HAS_USB_MUX_TASK))
 		mux_task_enqueue(port, TYPEC_USB_MUX_SET_ALL_CHIPS,
 				 USB_MUX_SET_MODE, mux_mode, usb_mode,
 				 polarity);
 	else
 		perform_mux_set(port, TYPEC_USB_MUX_SET_ALL_CHIPS, mux_mode,
-				usb_mode, polarity);
+				usb_mode, polarity, get_time());
 }
 
 void usb_mux_set_single(int port, int index, mux_state_t mux_mode,
@@ -556,11 +684,12 @@ void usb_mux_set_single(int port, int index, mux_state_t mux_mode,
 		return;
 
 	/* Block if we have no mux task, but otherwise queue it up and return */
-	if (IS_ENABLED(HAS_TASK_USB_MUX))
+	if (IS_ENABLED(HAS_USB_MUX_TASK))
 		mux_task_enqueue(port, index, USB_MUX_SET_MODE, mux_mode,
 				 usb_mode, polarity);
 	else
-		perform_mux_set(port, index, mux_mode, usb_mode, polarity);
+		perform_mux_set(port, index, mux_mode, usb_mode, polarity,
+				get_time());
 }
 
 bool usb_mux_set_completed(int port)
@@ -569,7 +698,7 @@ bool usb_mux_set_completed(int port)
 	struct queue_iterator it;
 
 	/* No mux task, no items waiting to process */
-	if (!IS_ENABLED(HAS_TASK_USB_MUX))
+	if (!IS_ENABLED(HAS_USB_MUX_TASK))
 		return true;
 
 	/* Lock the queue so we can scroll through the items left to do */
@@ -665,7 +794,7 @@ test_mockable void usb_mux_hpd_update(int port, mux_state_t hpd_state)
 		return;
 
 	/* Send to the mux task if present to maintain sequencing with sets */
-	if (IS_ENABLED(HAS_TASK_USB_MUX))
+	if (IS_ENABLED(HAS_USB_MUX_TASK))
 		mux_task_enqueue(port, TYPEC_USB_MUX_SET_ALL_CHIPS,
 				 USB_MUX_HPD_UPDATE, hpd_state, 0, 0);
 	else
@@ -751,6 +880,9 @@ static void usb_mux_reset_in_g3(void)
 				atomic_clear_bits(&flags[port],
 						  USB_MUX_FLAG_INIT |
 							  USB_MUX_FLAG_IN_LPM);
+				mutex_lock(&mux_lock[port]);
+				mux_shadow_invalidate(port, -1);
+				mutex_unlock(&mux_lock[port]);
 			}
 			mux_chain = mux_chain->next;
 		}
@@ -794,6 +926,10 @@ static int command_typec(int argc, const char **argv)
 			 !!(mux_state & USB_PD_MUX_SAFE_MODE),
 			 !!(mux_state & USB_PD_MUX_TBT_COMPAT_ENABLED),
 			 !!(mux_state & USB_PD_MUX_USB4_ENABLED));
+		ccprintf("Mux sets: %u (%u chip writes elided), last %u us, "
+			 "max %u us\n",
+			 mux_stats[port].sets, mux_stats[port].elided,
+			 mux_stats[port].last_us, mux_stats[port].max_us);
 
 		return EC_SUCCESS;
 	}
@@ -837,6 +973,30 @@ static enum ec_status hc_usb_pd_mux_info(struct host_cmd_handler_args *args)
 DECLARE_HOST_COMMAND(EC_CMD_USB_PD_MUX_INFO, hc_usb_pd_mux_info,
 		     EC_VER_MASK(0));
 
+static enum ec_status hc_usb_pd_mux_stats(struct host_cmd_handler_args *args)
+{
+	const struct ec_params_usb_pd_mux_stats *p = args->params;
+	struct ec_response_usb_pd_mux_stats *r = args->response;
+	int port = p->port;
+
+	if (port >= board_get_usb_pd_port_count())
+		return EC_RES_INVALID_PARAM;
+
+	mutex_lock(&mux_lock[port]);
+	r->set_count = mux_stats[port].sets;
+	r->elided_count = mux_stats[port].elided;
+	r->last_latency_us = mux_stats[port].last_us;
+	r->max_latency_us = mux_stats[port].max_us;
+	if (p->flags & EC_USB_PD_MUX_STATS_FLAG_RESET)
+		memset(&mux_stats[port], 0, sizeof(mux_stats[port]));
+	mutex_unlock(&mux_lock[port]);
+
+	args->response_size = sizeof(*r);
+	return EC_RES_SUCCESS;
+}
+DECLARE_HOST_COMMAND(EC_CMD_USB_PD_MUX_STATS, hc_usb_pd_mux_stats,
+		     EC_VER_MASK(0));
+
 /*
  * Allow board or driver code to set the "done" event for muxes that have
  * interrupt-driven completion
@@ -0,0 +1,210 @@
+/*
+ * Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/*
+ * CPU time per animation frame of the lightbar sequences and programs.
+ *
+ * Each task wait ends a frame. Nothing sleeps here: the waits return at
+ * once and the clock jumps forward by their timeout instead, so that only
+ * the work that the EC does between two waits is timed.
+ */
+
+/* The sequences and their message state are static. */
+#include "../../common/lightbar.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <unistd.h>
+
+static const char usage[] =
+	"\n"
+	"Usage:  %s [-n FRAMES] [SEQUENCE | PROGRAM.bin]...\n"
+	"\n"
+	"Runs each lightbar sequence or lightbyte program for up to FRAMES\n"
+	"frames (default 10000), and prints the CPU time per frame. With no\n"
+	"argument, runs all the sequences that the EC shows by itself.\n"
+	"\n";
+
+static int frames, max_frames = 10000;
+static uint64_t fake_now;
+
+uint32_t task_wait_event(int timeout_us)
+{
+	if (timeout_us > 0)
+		fake_now += timeout_us;
+
+	/* Enough, make the sequence return. */
+	if (++frames >= max_frames) {
+		pending_msg = LIGHTBAR_NUM_SEQUENCES;
+		return PENDING_MSG;
+	}
+	return TASK_EVENT_TIMER;
+}
+
+void task_set_event(task_id_t tskid, uint32_t event)
+{
+}
+
+timestamp_t get_time(void)
+{
+	timestamp_t ret;
+
+	ret.val = fake_now;
+	return ret;
+}
+
+void cprintf(int zero, const char *fmt, ...)
+{
+}
+
+void cprints(int zero, const char *fmt, ...)
+{
+}
+
+int system_add_jump_tag(uint16_t tag, int version, int size, const void *data)
+{
+	return 0;
+}
+
+uint8_t *system_get_jump_tag(uint16_t tag, int *version, int *size)
+{
+	return 0;
+}
+
+/* The LEDs, as lb_common.c would drive them */
+static uint8_t leds[NUM_LEDS][3];
+static int brightness = 0xc0;
+
+void lb_set_brightness(unsigned int newval)
+{
+	brightness = newval;
+}
+
+uint8_t lb_get_brightness(void)
+{
+	return brightness;
+}
+
+void lb_set_rgb(unsigned int led, int red, int green, int blue)
+{
+	int i;
+
+	for (i = 0; i < NUM_LEDS; i++)
+		if (led >= NUM_LEDS || led == i) {
+			leds[i][0] = red;
+			leds[i][1] = green;
+			leds[i][2] = blue;
+		}
+}
+
+int lb_get_rgb(unsigned int led, uint8_t *red, uint8_t *green, uint8_t *blue)
+{
+	led %= NUM_LEDS;
+	*red = leds[led][0];
+	*green = leds[led][1];
+	*blue = leds[led][2];
+	return 0;
+}
+
+void lb_init(int use_lock)
+{
+}
+
+void lb_off(void)
+{
+}
+
+void lb_on(void)
+{
+}
+
+void lb_hc_cmd_dump(struct ec_response_lightbar *out)
+{
+}
+
+void lb_hc_cmd_reg(const struct ec_params_lightbar *in)
+{
+}
+
+int lb_power(int enabled)
+{
+	return 1;
+}
+
+static uint64_t cpu_time_ns(void)
+{
+	struct timespec t;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+
+static void bench(const char *name, enum lightbar_sequence seq)
+{
+	uint64_t start, ns;
+
+	st.cur_seq = seq;
+	pending_msg = seq;
+	frames = 0;
+
+	start = cpu_time_ns();
+	lightbar_cmds[seq].sequence();
+	ns = cpu_time_ns() - start;
+
+	printf("%-32s %8d frames %10.1f us", name, frames, ns / 1000.0);
+	if (frames)
+		printf(" %10.3f us/frame", ns / 1000.0 / frames);
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	enum lightbar_sequence seq;
+	const char *arg;
+	int c, i;
+
+	while ((c = getopt(argc, argv, "n:")) != -1) {
+		switch (c) {
+		case 'n':
+			max_frames = atoi(optarg);
+			if (max_frames > 0)
+				break;
+			/* fall through */
+		default:
+			fprintf(stderr, usage, argv[0]);
+			return 1;
+		}
+	}
+
+	lightbar_restore_state();
+
+	if (optind == argc) {
+		for (seq = LIGHTBAR_S5; seq <= LIGHTBAR_S3S5; seq++)
+			bench(lightbar_cmds[seq].string, seq);
+		return 0;
+	}
+
+	for (i = optind; i < argc; i++) {
+		arg = argv[i];
+		if (strstr(arg, ".bin")) {
+			if (lb_load_program(arg, &next_prog))
+				return 1;
+			bench(arg, LIGHTBAR_PROGRAM);
+			continue;
+		}
+
+		seq = find_msg_by_name(arg);
+		if (seq >= LIGHTBAR_NUM_SEQUENCES) {
+			fprintf(stderr, "Unknown sequence %s\n", arg);
+			return 1;
+		}
+		bench(lightbar_cmds[seq].string, seq);
+	}
+	return 0;
+}
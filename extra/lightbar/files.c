@@ -0,0 +1,196 @@
+/*
+ * Copyright 2014 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Loading of parameters and programs, for the simulator and the benchmark */
+
+#include "simulation.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Copied from util/ectool.c */
+int lb_read_params_from_file(const char *filename, struct lightbar_params_v1 *p)
+{
+	FILE *fp;
+	char buf[80];
+	int val[4];
+	int r = 1;
+	int line = 0;
+	int want, got;
+	int i;
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		fprintf(stderr, "Can't open %s: %s\n", filename,
+			strerror(errno));
+		return 1;
+	}
+
+	/* We must read the correct number of params from each line */
+#define READ(N)                                                             \
+	do {                                                                \
+		line++;                                                     \
+		want = (N);                                                 \
+		got = -1;                                                   \
+		if (!fgets(buf, sizeof(buf), fp))                           \
+			goto done;                                          \
+		got = sscanf(buf, "%i %i %i %i", &val[0], &val[1], &val[2], \
+			     &val[3]);                                      \
+		if (want != got)                                            \
+			goto done;                                          \
+	} while (0)
+
+	/* Do it */
+	READ(1);
+	p->google_ramp_up = val[0];
+	READ(1);
+	p->google_ramp_down = val[0];
+	READ(1);
+	p->s3s0_ramp_up = val[0];
+	READ(1);
+	p->s0_tick_delay[0] = val[0];
+	READ(1);
+	p->s0_tick_delay[1] = val[0];
+	READ(1);
+	p->s0a_tick_delay[0] = val[0];
+	READ(1);
+	p->s0a_tick_delay[1] = val[0];
+	READ(1);
+	p->s0s3_ramp_down = val[0];
+	READ(1);
+	p->s3_sleep_for = val[0];
+	READ(1);
+	p->s3_ramp_up = val[0];
+	READ(1);
+	p->s3_ramp_down = val[0];
+	READ(1);
+	p->tap_tick_delay = val[0];
+	READ(1);
+	p->tap_gate_delay = val[0];
+	READ(1);
+	p->tap_display_time = val[0];
+
+	READ(1);
+	p->tap_pct_red = val[0];
+	READ(1);
+	p->tap_pct_green = val[0];
+	READ(1);
+	p->tap_seg_min_on = val[0];
+	READ(1);
+	p->tap_seg_max_on = val[0];
+	READ(1);
+	p->tap_seg_osc = val[0];
+	READ(3);
+	p->tap_idx[0] = val[0];
+	p->tap_idx[1] = val[1];
+	p->tap_idx[2] = val[2];
+
+	READ(2);
+	p->osc_min[0] = val[0];
+	p->osc_min[1] = val[1];
+	READ(2);
+	p->osc_max[0] = val[0];
+	p->osc_max[1] = val[1];
+	READ(2);
+	p->w_ofs[0] = val[0];
+	p->w_ofs[1] = val[1];
+
+	READ(2);
+	p->bright_bl_off_fixed[0] = val[0];
+	p->bright_bl_off_fixed[1] = val[1];
+
+	READ(2);
+	p->bright_bl_on_min[0] = val[0];
+	p->bright_bl_on_min[1] = val[1];
+
+	READ(2);
+	p->bright_bl_on_max[0] = val[0];
+	p->bright_bl_on_max[1] = val[1];
+
+	READ(3);
+	p->battery_threshold[0] = val[0];
+	p->battery_threshold[1] = val[1];
+	p->battery_threshold[2] = val[2];
+
+	READ(4);
+	p->s0_idx[0][0] = val[0];
+	p->s0_idx[0][1] = val[1];
+	p->s0_idx[0][2] = val[2];
+	p->s0_idx[0][3] = val[3];
+
+	READ(4);
+	p->s0_idx[1][0] = val[0];
+	p->s0_idx[1][1] = val[1];
+	p->s0_idx[1][2] = val[2];
+	p->s0_idx[1][3] = val[3];
+
+	READ(4);
+	p->s3_idx[0][0] = val[0];
+	p->s3_idx[0][1] = val[1];
+	p->s3_idx[0][2] = val[2];
+	p->s3_idx[0][3] = val[3];
+
+	READ(4);
+	p->s3_idx[1][0] = val[0];
+	p->s3_idx[1][1] = val[1];
+	p->s3_idx[1][2] = val[2];
+	p->s3_idx[1][3] = val[3];
+
+	for (i = 0; i < ARRAY_SIZE(p->color); i++) {
+		READ(3);
+		p->color[i].r = val[0];
+		p->color[i].g = val[1];
+		p->color[i].b = val[2];
+	}
+
+#undef READ
+
+	/* Yay */
+	r = 0;
+done:
+	if (r)
+		fprintf(stderr, "problem with line %d: wanted %d, got %d\n",
+			line, want, got);
+	fclose(fp);
+	return r;
+}
+
+int lb_load_program(const char *filename, struct lightbar_program *prog)
+{
+	FILE *fp;
+	size_t got;
+	int rc;
+
+	fp = fopen(filename, "rb");
+	if (!fp) {
+		fprintf(stderr, "Can't open %s: %s\n", filename,
+			strerror(errno));
+		return 1;
+	}
+
+	rc = fseek(fp, 0, SEEK_END);
+	if (rc) {
+		fprintf(stderr, "Couldn't find end of file %s", filename);
+		fclose(fp);
+		return 1;
+	}
+	rc = (int)ftell(fp);
+	if (rc > EC_LB_PROG_LEN) {
+		fprintf(stderr, "File %s is too long, aborting\n", filename);
+		fclose(fp);
+		return 1;
+	}
+	rewind(fp);
+
+	memset(prog->data, 0, EC_LB_PROG_LEN);
+	got = fread(prog->data, 1, EC_LB_PROG_LEN, fp);
+	if (rc != got)
+		fprintf(stderr, "Warning: did not read entire file\n");
+	prog->size = got;
+	fclose(fp);
+	return 0;
+}
@@ -8,6 +8,7 @@
 
 #include "lb_common.h"
 #include "lightbar.h"
+#include "lightbyte.h"
 
 #include <stdint.h>
 #include <stdio.h>
@@ -46,6 +47,7 @@ int fake_consolecmd_lightbar(int argc, char *argv[]);
 	extern int __build_assertion_##line[1 - 2 * !(cond)] \
 		__attribute__((unused))
 #define _BA0_(c, x) _BA1_(c, x)
+#undef BUILD_ASSERT
 #define BUILD_ASSERT(cond) _BA0_(cond, __LINE__)
 
 #define BUILD_CHECK_INLINE(value, cond_true) ((value) / (!!(cond_true)))
@@ -118,7 +120,7 @@ uint8_t *system_get_jump_tag(uint16_t tag, int *version, int *size);
 #define DECLARE_CONSOLE_COMMAND(X, fn, Y...)            \
 	int fake_consolecmd_##X(int argc, char *argv[]) \
 	{                                               \
-		return fn(argc, argv);                  \
+		return fn(argc, (const char **)argv);   \
 	}
 
 #endif /* __EXTRA_SIMULATION_H */
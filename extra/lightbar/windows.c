@@ -214,7 +214,7 @@ int lb_get_rgb(unsigned int led, uint8_t *red, uint8_t *green, uint8_t *blue)
 	return 0;
 }
 
-void lb_init(void)
+void lb_init(int use_lock)
 {
 	if (fake_power)
 		lb_set_rgb(NUM_LEDS, 0, 0, 0);
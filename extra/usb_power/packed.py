@@ -0,0 +1,204 @@
+#!/usr/bin/env python3
+# Copyright 2023 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Delta packed frames of the USB power interface.
+
+Decodes the frames sent in response to the next command once the packed
+format is selected, see chip/stm32/usb_power.h.  The encoder mirrors the
+firmware, for tests and to compare stream sizes:
+
+    ./extra/usb_power/packed.py --inas 8 --integration-us 1100
+"""
+
+import argparse
+import math
+import random
+import struct
+import sys
+
+
+HEADER = struct.Struct("<BBBBHQ")
+
+# Largest frame the firmware sends, USB_POWER_PACKED_SIZE
+FRAME_SIZE = 512
+
+
+class FrameError(Exception):
+    """A packed frame does not decode."""
+
+
+def zigzag(value):
+    """Map a signed value to an unsigned one, small magnitudes first."""
+    return ((value << 1) ^ (value >> 31)) & 0xFFFFFFFF
+
+
+def unzigzag(value):
+    """Undo zigzag()."""
+    return (value >> 1) ^ -(value & 1)
+
+
+def put_varint(out, value):
+    """Append value in groups of 7 bits, least significant first."""
+    while value >= 0x80:
+        out.append((value & 0x7F) | 0x80)
+        value >>= 7
+    out.append(value)
+
+
+def get_varint(data, pos):
+    """Read a varint at pos, returning it and the position after it."""
+    value = 0
+    shift = 0
+    while True:
+        if pos >= len(data) or shift > 28:
+            raise FrameError("truncated varint")
+        byte = data[pos]
+        pos += 1
+        value |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return value, pos
+
+
+def to_s16(value):
+    """Interpret a 16 bit register value as signed."""
+    value &= 0xFFFF
+    return value - 0x10000 if value & 0x8000 else value
+
+
+def decode(data, integration_us):
+    """Decode a packed frame.
+
+    Args:
+      data: bytes of one response to the next command.
+      integration_us: integration time returned by the start command.
+
+    Returns:
+      status, count of sample times missed, and a list of
+      (timestamp_us, [signed reading of each INA]) tuples.
+    """
+    if len(data) < HEADER.size:
+        raise FrameError("short frame")
+    status, size, sets, missed, length, timestamp = HEADER.unpack_from(data)
+    if len(data) != HEADER.size + length:
+        raise FrameError(
+            "frame of %d bytes, header says %d"
+            % (len(data), HEADER.size + length)
+        )
+
+    samples = []
+    pos = HEADER.size
+    prev = [0] * size
+    for i in range(sets):
+        if i:
+            delta, pos = get_varint(data, pos)
+            timestamp += integration_us + unzigzag(delta)
+        values = []
+        for j in range(size):
+            delta, pos = get_varint(data, pos)
+            values.append(prev[j] + unzigzag(delta))
+        samples.append((timestamp, values))
+        prev = values
+
+    if pos != len(data):
+        raise FrameError("%d bytes left over" % (len(data) - pos))
+    return status, missed, samples
+
+
+def encode(samples, integration_us, missed=0):
+    """Pack (timestamp_us, readings) tuples like the firmware does.
+
+    Returns the frame and how many samples went into it.
+    """
+    size = len(samples[0][1])
+    set_max = 5 + 3 * size
+    out = bytearray()
+    prev = None
+    count = 0
+    for timestamp, values in samples:
+        if count == 255 or HEADER.size + len(out) + set_max > FRAME_SIZE:
+            break
+        values = [to_s16(v) for v in values]
+        if prev:
+            put_varint(out, zigzag(timestamp - prev[0] - integration_us))
+        for j, value in enumerate(values):
+            put_varint(out, zigzag(value - (prev[1][j] if prev else 0)))
+        prev = (timestamp, values)
+        count += 1
+
+    header = HEADER.pack(
+        0, size, count, min(missed, 255), len(out), samples[0][0]
+    )
+    return header + bytes(out), count
+
+
+def record_size(ina_count):
+    """Size of a record in the unpacked format, USB_POWER_RECORD_SIZE."""
+    return (2 + 8 + 2 * ina_count + 3) // 4 * 4
+
+
+def synthetic_trace(ina_count, integration_us, count, jitter_us):
+    """Readings of slowly varying rails with some noise."""
+    rng = random.Random(ina_count)
+    base = [rng.randrange(200, 8000) for _ in range(ina_count)]
+    timestamp = 0
+    samples = []
+    for i in range(count):
+        timestamp += integration_us + rng.randint(-jitter_us, jitter_us)
+        values = []
+        for j, level in enumerate(base):
+            wave = level * 0.2 * math.sin(i / (20.0 + j))
+            values.append(int(level + wave + rng.gauss(0, 6)) & 0xFFFF)
+        samples.append((timestamp, values))
+    return samples
+
+
+def bench(ina_count, integration_us, count, jitter_us):
+    """Compare the stream sizes of both formats and check the round trip."""
+    samples = synthetic_trace(ina_count, integration_us, count, jitter_us)
+
+    packed = 0
+    frames = 0
+    pos = 0
+    while pos < len(samples):
+        frame, n = encode(samples[pos:], integration_us)
+        _, _, decoded = decode(frame, integration_us)
+        for (t, v), (dt, dv) in zip(samples[pos : pos + n], decoded):
+            if t != dt or [to_s16(x) for x in v] != dv:
+                sys.exit("round trip mismatch at sample %d" % pos)
+        packed += len(frame)
+        frames += 1
+        pos += n
+
+    raw = record_size(ina_count) * count
+    print(
+        "%d INAs, %d samples, %dus apart" % (ina_count, count, integration_us)
+    )
+    # The host reads up to FRAME_SIZE bytes per next command either way
+    print(
+        "records: %5.1f bytes/sample, %5.1f samples per next command"
+        % (raw / count, FRAME_SIZE // record_size(ina_count))
+    )
+    print(
+        "packed:  %5.1f bytes/sample, %5.1f samples per next command"
+        % (packed / count, count / frames)
+    )
+
+
+def main(argv):
+    """Run the size comparison."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--inas", type=int, default=8)
+    parser.add_argument("--integration-us", type=int, default=1100)
+    parser.add_argument("--samples", type=int, default=10000)
+    parser.add_argument(
+        "--jitter-us", type=int, default=20, help="sample time jitter"
+    )
+    args = parser.parse_args(argv)
+    bench(args.inas, args.integration_us, args.samples, args.jitter_us)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -0,0 +1,86 @@
+# Copyright 2023 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Unit tests for the packed USB power frames."""
+
+import struct
+import unittest
+
+from usb_power import packed
+
+
+class TestPacked(unittest.TestCase):
+    """Test to verify packed frames decode as the firmware encodes them."""
+
+    def test_Varint(self):
+        """Varints round trip, seven bits per byte."""
+        for value in (0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 0x1FFFE, 0xFFFFFFFF):
+            out = bytearray()
+            packed.put_varint(out, value)
+            self.assertEqual(len(out), max(1, (value.bit_length() + 6) // 7))
+            self.assertEqual(packed.get_varint(out, 0), (value, len(out)))
+
+    def test_Zigzag(self):
+        """Small magnitudes of either sign get small codes."""
+        self.assertEqual(
+            [packed.zigzag(v) for v in (0, -1, 1, -2, 2)], [0, 1, 2, 3, 4]
+        )
+        for value in (-65535, -300, 0, 300, 65535):
+            self.assertEqual(packed.unzigzag(packed.zigzag(value)), value)
+
+    def test_DecodeFrame(self):
+        """A frame written out by hand decodes."""
+        data = bytes(
+            [
+                # 200 and -3 (0xfffd)
+                0x90,
+                0x03,
+                0x05,
+                # 10us late, then +1 and -1
+                0x14,
+                0x02,
+                0x01,
+            ]
+        )
+        frame = struct.pack("<BBBBHQ", 0, 2, 2, 3, len(data), 5000) + data
+        status, missed, samples = packed.decode(frame, 100)
+        self.assertEqual(status, 0)
+        self.assertEqual(missed, 3)
+        self.assertEqual(samples, [(5000, [200, -3]), (5110, [201, -4])])
+
+    def test_RoundTrip(self):
+        """Encoded traces decode to the same readings and times."""
+        trace = packed.synthetic_trace(4, 1100, 500, 50)
+        pos = 0
+        while pos < len(trace):
+            frame, count = packed.encode(trace[pos:], 1100)
+            self.assertLessEqual(len(frame), packed.FRAME_SIZE)
+            _, _, samples = packed.decode(frame, 1100)
+            self.assertEqual(len(samples), count)
+            for (t, values), (dt, dvalues) in zip(trace[pos:], samples):
+                self.assertEqual(t, dt)
+                self.assertEqual([packed.to_s16(v) for v in values], dvalues)
+            pos += count
+
+    def test_FullScaleSwing(self):
+        """Readings going from one end of the range to the other."""
+        trace = [(0, [0x7FFF]), (10, [0x8000]), (20, [0x7FFF])]
+        frame, count = packed.encode(trace, 10)
+        self.assertEqual(count, 3)
+        _, _, samples = packed.decode(frame, 10)
+        self.assertEqual([v for _, v in samples], [[32767], [-32768], [32767]])
+
+    def test_BadFrames(self):
+        """Truncated or inconsistent frames are refused."""
+        frame, _ = packed.encode(packed.synthetic_trace(2, 100, 10, 0), 100)
+        with self.assertRaises(packed.FrameError):
+            packed.decode(frame[:10], 100)
+        with self.assertRaises(packed.FrameError):
+            packed.decode(frame[:-1], 100)
+        with self.assertRaises(packed.FrameError):
+            packed.decode(frame + b"\0", 100)
+
+
+if __name__ == "__main__":
+    unittest.main()
@@ -23,6 +23,7 @@ import sys
 import time
 import traceback
 
+import packed  # pylint:disable=import-error
 from stats_manager import StatsManager  # pylint:disable=import-error
 import usb  # pylint:disable=import-error
 
@@ -103,6 +104,11 @@ class Spower(object):
     CMD_START = 0x0003
     CMD_NEXT = 0x0004
     CMD_SETTIME = 0x0005
+    CMD_SETFORMAT = 0x0006
+
+    # Formats of the responses to CMD_NEXT.
+    FORMAT_RECORDS = 0x00
+    FORMAT_PACKED = 0x01
 
     # Map between header channel number (0-47)
     # and INA I2C bus/addr on sweetberry.
@@ -233,6 +239,11 @@ class Spower(object):
         self._logger.debug("Writer endpoint: 0x%x", write_ep.bEndpointAddress)
 
         self.clear_ina_struct()
+        self._packed = False
+        self._integration_us = 0
+        # Samples read, and sample times the device reported missing.
+        self.samples = 0
+        self.missed = 0
 
         self._logger.debug("Found power logging USB endpoint.")
 
@@ -391,6 +402,7 @@ class Spower(object):
         actual_us = 0
         if len(read) == 5:
             ret, actual_us = struct.unpack("<BI", read)
+            self._integration_us = actual_us
             self._logger.debug(
                 "Command START: %s %dus",
                 "success" if ret == 0 else "failure",
@@ -401,6 +413,25 @@ class Spower(object):
 
         return actual_us
 
+    def set_format(self, use_packed):
+        """Select delta packed frames or records for the data read.
+
+        Args:
+          use_packed: bool, whether to ask for packed frames.
+
+        Returns:
+          whether packed frames will be read: firmware without them refuses
+          the command and keeps sending records.
+        """
+        fmt = self.FORMAT_PACKED if use_packed else self.FORMAT_RECORDS
+        cmd = struct.pack("<HB", self.CMD_SETFORMAT, fmt)
+        ret = self.wr_command(cmd)
+        self._logger.debug(
+            "Command SETFORMAT: %s", "success" if ret == 0 else "failure"
+        )
+        self._packed = use_packed and ret == 0
+        return self._packed
+
     def add_ina_name(self, name_tuple):
         """Add INA from board config.
 
@@ -499,6 +530,8 @@ class Spower(object):
         """
         try:
             expected_bytes = self.report_size(len(self._inas))
+            if self._packed:
+                expected_bytes = packed.HEADER.size
             cmd = struct.pack("<H", self.CMD_NEXT)
             bytesread = self.wr_command(cmd, read_count=expected_bytes)
         except usb.core.USBError as e:
@@ -514,6 +547,9 @@ class Spower(object):
                 )
             return None
 
+        if self._packed:
+            return self.interpret_frame(bytes(bytesread))
+
         if len(bytesread) % expected_bytes != 0:
             self._logger.debug(
                 "READ LINE WARNING: expected %d, got %d",
@@ -530,8 +566,34 @@ class Spower(object):
             record = self.interpret_line(bytesread[start:end])
             values.append(record)
 
+        self.samples += len(values)
         return values
 
+    def interpret_frame(self, data):
+        """Interpret a delta packed frame of power records.
+
+        Args:
+          data: bytes of one packed frame.
+
+        Returns:
+          list of dicts containing name, value of recorded data, or None.
+        """
+        try:
+            status, missed, samples = packed.decode(data, self._integration_us)
+        except packed.FrameError as e:
+            self._logger.error("READ FRAME FAILED: %s", e)
+            return None
+
+        if missed:
+            self._logger.debug("READ FRAME: %d samples missed", missed)
+        self.missed += missed
+        self.samples += len(samples)
+
+        return [
+            self.make_record(status, timestamp, raw_values)
+            for timestamp, raw_values in samples
+        ]
+
     def interpret_line(self, data):
         """Interpret a power record from INAs
 
@@ -560,17 +622,34 @@ class Spower(object):
         self._logger.debug(
             "READ LINE: st:%d size:%d time:%dus", status, size, timestamp
         )
+        raw_values = [
+            struct.unpack_from("<h", data, self.report_header_size() + 2 * i)[
+                0
+            ]
+            for i in range(0, size)
+        ]
+
+        return self.make_record(status, timestamp, raw_values)
+
+    def make_record(self, status, timestamp, raw_values):
+        """Scale raw INA readings into a record.
+
+        Args:
+          status: status byte the readings came with.
+          timestamp: time of the readings in us.
+          raw_values: signed register value of each INA.
+
+        Returns:
+          dict containing name, value of recorded data.
+        """
         ftimestamp = float(timestamp) / 1000000.0
 
         record = {"ts": ftimestamp, "status": status, "berry": self._board}
 
-        for i in range(0, size):
-            idx = self.report_header_size() + 2 * i
+        for i, raw_val in enumerate(raw_values):
             name = self._inas[i]["name"]
             name_tuple = (self._inas[i]["name"], self._inas[i]["type"])
 
-            raw_val = struct.unpack("<h", data[idx : idx + 2])[0]
-
             if self._inas[i]["type"] == Spower.INA_POWER:
                 val = raw_val * self._inas[i]["uWscale"]
             elif self._inas[i]["type"] == Spower.INA_BUSV:
@@ -627,6 +706,7 @@ class powerlog(object):
         stats_json_dir=None,
         print_raw_data=True,
         raw_data_dir=None,
+        use_packed=False,
     ):
         """Init the powerlog class and set the variables.
 
@@ -647,6 +727,8 @@ class powerlog(object):
                           is to print.
           raw_data_dir: directory to save sweetberry readings raw data; if None then
                         do not save the raw data.
+          use_packed: read delta packed frames from sweetberries supporting
+                      them, rather than records; default is records.
         """
         self._logger = logging.getLogger(__name__)
         self._data = StatsManager()
@@ -699,6 +781,10 @@ class powerlog(object):
                 self._pwr[key].set_time(time.time() * 1000000)
             else:
                 self._pwr[key].set_time(0)
+            if use_packed and not self._pwr[key].set_format(True):
+                self._logger.info(
+                    "Sweetberry %s sends records, not packed frames", key
+                )
 
     def process_scenario(self, name_list):
         """Return list of tuples indicating name and type.
@@ -782,7 +868,8 @@ class powerlog(object):
         forever = False
         if not seconds:
             forever = True
-        end_time = time.time() + seconds
+        start_time = time.time()
+        end_time = start_time + seconds
         try:
             pending_records = []
             while forever or end_time > time.time():
@@ -842,8 +929,18 @@ class powerlog(object):
             self._logger.info("\nCTRL+C caught.")
 
         finally:
+            elapsed = time.time() - start_time
             for key in self._pwr:
                 self._pwr[key].stop()
+                self._logger.info(
+                    "Sweetberry %s: %d samples in %.1fs, %.0f samples/s, "
+                    "%d missed",
+                    key,
+                    self._pwr[key].samples,
+                    elapsed,
+                    self._pwr[key].samples / elapsed,
+                    self._pwr[key].missed,
+                )
             self._data.CalculateStats()
             if self._print_stats:
                 print(self._data.SummaryToString())
@@ -988,6 +1085,14 @@ def main(argv=None):
         "raw data will be saved to where %(prog)s is located; if this flag "
         "is not set, then do not save raw data",
     )
+    parser.add_argument(
+        "--packed",
+        dest="use_packed",
+        default=False,
+        action="store_true",
+        help="Read delta packed frames rather than fixed size records from "
+        "sweetberries that support them, for higher sample rates",
+    )
     parser.add_argument(
         "-v",
         "--verbose",
@@ -1052,6 +1157,7 @@ def main(argv=None):
         stats_json_dir=stats_json_dir,
         print_raw_data=print_raw_data,
         raw_data_dir=raw_data_dir,
+        use_packed=args.use_packed,
     )
 
     # Start logging.
@@ -24,6 +24,7 @@
 #endif
 
 #include "compile_time_macros.h"
+#include "ec_commands.h"
 #include "misc_util.h"
 #include "update_fw.h"
 #include "usb_descriptor.h"
@@ -72,8 +73,12 @@ static struct first_response_pdu targ;
 
 static uint16_t protocol_version;
 static uint16_t header_type;
+/* Blocks to send ahead of their confirmations, 0 for one at a time */
+static int window_request = 4;
+/* Blocks the target lets us send ahead, 0 if it does not support it */
+static int window;
 static char *progname;
-static char *short_opts = "bd:efg:hjlnp:rsS:tuw";
+static char *short_opts = "bd:efg:hjlnp:rsS:tuwW:";
 static const struct option long_opts[] = {
 	/* name    hasarg *flag val */
 	{ "binvers", 1, NULL, 'b' },
@@ -92,6 +97,7 @@ static const struct option long_opts[] = {
 	{ "tp_info", 0, NULL, 't' },
 	{ "unlock_rollback", 0, NULL, 'u' },
 	{ "unlock_rw", 0, NULL, 'w' },
+	{ "window", 1, NULL, 'W' },
 	{},
 };
 
@@ -128,6 +134,9 @@ static void usage(int errs)
 	       "  -t,--tp_info             Get touchpad information\n"
 	       "  -u,--unlock_rollback     Tell EC to unlock the rollback region\n"
 	       "  -w,--unlock_rw           Tell EC to unlock the RW region\n"
+	       "  -W,--window  <blocks>    Blocks to send ahead of their "
+	       "confirmation\n"
+	       "                           (default 4, 0 for one at a time)\n"
 	       "\n",
 	       progname, VID, PID);
 
@@ -485,14 +494,11 @@ static void usb_findit(uint16_t vid, uint16_t pid, char *serialno,
 	printf("READY\n-------\n");
 }
 
-static int transfer_block(struct usb_endpoint *uep,
-			  struct update_frame_header *ufh,
-			  uint8_t *transfer_data_ptr, size_t payload_size)
+static void send_block(struct usb_endpoint *uep,
+		       struct update_frame_header *ufh,
+		       uint8_t *transfer_data_ptr, size_t payload_size)
 {
 	size_t transfer_size;
-	uint32_t reply;
-	int actual;
-	int r;
 
 	/* First send the header. */
 	xfer(uep, ufh, sizeof(*ufh), NULL, 0, 0);
@@ -507,6 +513,17 @@ static int transfer_block(struct usb_endpoint *uep,
 		transfer_data_ptr += chunk_size;
 		transfer_size += chunk_size;
 	}
+}
+
+static int transfer_block(struct usb_endpoint *uep,
+			  struct update_frame_header *ufh,
+			  uint8_t *transfer_data_ptr, size_t payload_size)
+{
+	uint32_t reply;
+	int actual;
+	int r;
+
+	send_block(uep, ufh, transfer_data_ptr, payload_size);
 
 	/* Now get the reply. */
 	r = libusb_bulk_transfer(uep->devh, uep->ep_num | 0x80, (void *)&reply,
@@ -529,6 +546,140 @@ static int transfer_block(struct usb_endpoint *uep,
 	return 0;
 }
 
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report_throughput(size_t data_len, double start)
+{
+	double elapsed = now_seconds() - start;
+
+	printf("sent 0x%zx bytes in %.2f s (%.1f KiB/s)\n", data_len, elapsed,
+	       elapsed > 0 ? data_len / 1024.0 / elapsed : 0);
+}
+
+/* A block sent during a windowed transfer, not confirmed yet */
+struct inflight_block {
+	uint32_t seq;
+	uint32_t offset;
+};
+
+/*
+ * Transfer a section with up to 'window' blocks in flight. The target skips
+ * the blocks that are already in flash and erases as it goes, so the whole
+ * section is sent.
+ */
+static void transfer_section_windowed(struct transfer_descriptor *td,
+				      uint8_t *data_ptr, uint32_t section_addr,
+				      size_t data_len)
+{
+	struct inflight_block inflight[UINT8_MAX];
+	struct update_block_ack acks[64 / sizeof(struct update_block_ack)];
+	int head = 0, count = 0;
+	uint32_t seq = 0;
+	size_t offset = 0;
+	size_t sent = 0;
+	int written = 0, skipped = 0, rewinds = 0;
+	int rewinding = 0;
+	size_t resume = 0;
+	double start = now_seconds();
+
+	printf("sending 0x%zx bytes to %#x, %d blocks ahead\n", data_len,
+	       section_addr, window);
+	while (offset < data_len || count) {
+		int actual, r, i;
+
+		/* Fill the window, unless blocks in flight are being dropped */
+		while (!rewinding && offset < data_len && count < window) {
+			struct update_frame_header ufh;
+			size_t payload_size =
+				MIN(data_len - offset,
+				    targ.common.maximum_pdu_size);
+			int slot = (head + count) % ARRAY_SIZE(inflight);
+			struct inflight_block *b = &inflight[slot];
+
+			ufh.block_size = htobe32(payload_size + sizeof(ufh));
+			ufh.cmd.block_base = htobe32(section_addr + offset);
+			ufh.cmd.block_digest = htobe32(seq);
+			send_block(&td->uep, &ufh, data_ptr + offset,
+				   payload_size);
+
+			b->seq = seq++;
+			b->offset = offset;
+			count++;
+			offset += payload_size;
+			sent += payload_size;
+		}
+
+		/* Several confirmations may come in one USB packet */
+		r = libusb_bulk_transfer(td->uep.devh, td->uep.ep_num | 0x80,
+					 (void *)acks, sizeof(acks), &actual,
+					 5000);
+		if (r) {
+			USB_ERROR("libusb_bulk_transfer", r);
+			shut_down(&td->uep);
+		}
+		if (actual % sizeof(acks[0])) {
+			fprintf(stderr, "Unexpected confirmation size %d\n",
+				actual);
+			shut_down(&td->uep);
+		}
+
+		for (i = 0; i < actual / (int)sizeof(acks[0]); i++) {
+			struct inflight_block *b = &inflight[head];
+
+			if (!count || be32toh(acks[i].seq) != b->seq) {
+				fprintf(stderr, "Unexpected confirmation %u\n",
+					be32toh(acks[i].seq));
+				shut_down(&td->uep);
+			}
+			if (acks[i].return_value) {
+				fprintf(stderr,
+					"Error: status %#x at offset %#x\n",
+					acks[i].return_value,
+					section_addr + b->offset);
+				exit(update_error);
+			}
+			head = (head + 1) % ARRAY_SIZE(inflight);
+			count--;
+
+			switch (acks[i].status) {
+			case UPDATE_BLOCK_WRITTEN:
+				written++;
+				break;
+			case UPDATE_BLOCK_SKIPPED:
+				skipped++;
+				break;
+			case UPDATE_BLOCK_REWIND:
+				rewinds++;
+				rewinding = 1;
+				resume = be32toh(acks[i].resume_offset) -
+					 section_addr;
+				break;
+			}
+		}
+
+		/* Go back once all the blocks in flight are dropped */
+		if (rewinding && !count) {
+			if (resume >= offset) {
+				fprintf(stderr, "Bad resume offset %#zx\n",
+					resume + section_addr);
+				shut_down(&td->uep);
+			}
+			offset = resume;
+			rewinding = 0;
+		}
+	}
+
+	report_throughput(sent, start);
+	printf("%d blocks written, %d already in flash, %d rewinds\n",
+	       written, skipped, rewinds);
+}
+
 /**
  * Transfer an image section (typically RW or RO).
  *
@@ -548,11 +699,22 @@ static void transfer_section(struct transfer_descriptor *td, uint8_t *data_ptr,
 	 *
 	 * FIXME: We can be smarter than this and skip blocks within the image.
 	 */
+	size_t total_len;
+	double start;
+
+	if (window) {
+		transfer_section_windowed(td, data_ptr, section_addr,
+					  data_len);
+		return;
+	}
+
 	if (smart_update)
 		while (data_len && (data_ptr[data_len - 1] == 0xff))
 			data_len--;
 
 	printf("sending 0x%zx bytes to %#x\n", data_len, section_addr);
+	total_len = data_len;
+	start = now_seconds();
 	while (data_len) {
 		size_t payload_size;
 		uint32_t block_base;
@@ -583,6 +745,7 @@ static void transfer_section(struct transfer_descriptor *td, uint8_t *data_ptr,
 		data_ptr += payload_size;
 		section_addr += payload_size;
 	}
+	report_throughput(total_len, start);
 }
 
 /*
@@ -741,7 +904,41 @@ static void pick_sections(struct transfer_descriptor *td)
 	}
 }
 
-static void setup_connection(struct transfer_descriptor *td)
+static int ext_cmd_over_usb(struct usb_endpoint *uep, uint16_t subcommand,
+			    void *cmd_body, size_t body_size, void *resp,
+			    size_t *resp_size, int allow_less);
+
+/*
+ * Ask the target for a windowed transfer. Targets that don't support it
+ * answer with a single error byte, as do targets still in the middle of an
+ * aborted transfer, which go back to idle: try twice.
+ */
+static void negotiate_window(struct transfer_descriptor *td)
+{
+	uint8_t request = window_request;
+	struct update_window_response resp;
+	size_t resp_size;
+	int tries;
+
+	window = 0;
+	for (tries = 0; tries < 2; tries++) {
+		memset(&resp, 0, sizeof(resp));
+		resp_size = sizeof(resp);
+		ext_cmd_over_usb(&td->uep, UPDATE_EXTRA_CMD_SET_WINDOW,
+				 &request, sizeof(request), &resp, &resp_size,
+				 1);
+		if (resp.status == EC_RES_SUCCESS && resp.window) {
+			window = resp.window;
+			printf("target accepts %d blocks ahead\n", window);
+			return;
+		}
+		if (resp.status == EC_RES_INVALID_COMMAND)
+			break;
+	}
+	printf("target takes one block at a time\n");
+}
+
+static void setup_connection(struct transfer_descriptor *td, int want_window)
 {
 	size_t rxed_size;
 	size_t i;
@@ -770,6 +967,9 @@ static void setup_connection(struct transfer_descriptor *td)
 		printf("flush\n");
 	}
 
+	if (want_window && window_request)
+		negotiate_window(td);
+
 	memset(&ufh, 0, sizeof(ufh));
 	ufh.block_size = htobe32(sizeof(ufh));
 	do_xfer(&td->uep, &ufh, sizeof(ufh), &start_resp, sizeof(start_resp), 1,
@@ -1120,6 +1320,13 @@ int main(int argc, char *argv[])
 		case 'w':
 			extra_command = UPDATE_EXTRA_CMD_UNLOCK_RW;
 			break;
+		case 'W':
+			window_request = atoi(optarg);
+			if (window_request < 0 || window_request > UINT8_MAX) {
+				printf("Invalid window: \"%s\"\n", optarg);
+				errorcnt++;
+			}
+			break;
 		case 0: /* auto-handled option */
 			break;
 		case '?':
@@ -1165,7 +1372,7 @@ int main(int argc, char *argv[])
 
 	usb_findit(vid, pid, serialno, &td.uep);
 
-	setup_connection(&td);
+	setup_connection(&td, data != NULL);
 
 	if (show_fw_ver) {
 		printf("Current versions:\n");
@@ -502,6 +502,9 @@ void battery_memmap_refresh(enum battery_index index);
 
 /**
  * Set which index to present in host memory mapped region.
+ *
+ * The region is marked invalid right away, and filled in with the battery
+ * by the hook task. Safe to call from interrupts.
  */
 void battery_memmap_set_index(enum battery_index index);
 #endif /* CONFIG_BATTERY_V2 */
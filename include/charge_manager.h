@@ -218,6 +218,24 @@ int charge_manager_get_active_charge_port(void);
  */
 int charge_manager_get_selected_charge_port(void);
 
+#ifdef TEST_BUILD
+/* Refresh counters, to check that changes which come together share one */
+struct charge_manager_refresh_stats {
+	/* Runs of the deferred refresh */
+	uint32_t refreshes;
+	/* Refreshes that had to select the charge port again */
+	uint32_t selections;
+};
+
+/**
+ * Get the refresh counters, and reset them.
+ *
+ * @param stats	[OUT] Counters since the last call
+ */
+void charge_manager_get_refresh_stats(
+	struct charge_manager_refresh_stats *stats);
+#endif
+
 /**
  * Get the power limit set by charge manager.
  *
@@ -26,6 +26,12 @@
 #define CHARGE_POLL_PERIOD_CHARGE (MSEC * 250)
 #define CHARGE_POLL_PERIOD_SHORT (MSEC * 100)
 #define CHARGE_MIN_SLEEP_USEC (MSEC * 50)
+/*
+ * With CONFIG_CHARGER_STEADY_STATE_POLL, the periods above are doubled up to
+ * this once the charge loop inputs stopped changing for CHARGE_STEADY_LOOPS.
+ */
+#define CHARGE_POLL_PERIOD_STEADY (4 * SECOND)
+#define CHARGE_STEADY_LOOPS 8
 /* If a board hasn't provided a max sleep, use 1 minute as default */
 #ifndef CHARGE_MAX_SLEEP_USEC
 #define CHARGE_MAX_SLEEP_USEC MINUTE
@@ -430,6 +430,27 @@ void print_charger_debug(int chgnum);
  */
 void print_charger_prochot(int chgnum);
 
+/*
+ * With CONFIG_CHARGER_SHADOW_REGS, a current, voltage or input current limit
+ * the charger was given less than this long ago is not written again.
+ */
+#define CHARGER_SHADOW_TIMEOUT (30 * SECOND)
+
+/* Writes of charger limits, for CONFIG_CHARGER_SHADOW_REGS */
+struct charger_write_stats {
+	/* Writes passed on to the charger driver */
+	uint32_t written;
+	/* Writes of a value the charger already had */
+	uint32_t skipped;
+};
+
+/**
+ * Get the count of charger limit writes since boot.
+ *
+ * @param stats: [OUT] Write counts.
+ */
+void charger_get_write_stats(struct charger_write_stats *stats);
+
 /**
  * Get the value of CONFIG_CHARGER_MIN_BAT_PCT_FOR_POWER_ON
  */
@@ -914,6 +914,13 @@
 /* Leave safe mode when battery pct meets or exceeds this value */
 #define CONFIG_CHARGE_MANAGER_BAT_PCT_SAFE_MODE_EXIT 2
 
+/*
+ * Delay (ms) from a charge change to the refresh it schedules, so that the
+ * changes which come together on attach are handled by a single refresh.
+ * Without it, refreshes run as soon as possible.
+ */
+#undef CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS
+
 /* The hardware has some input current ramping/back-off mechanism */
 #undef CONFIG_CHARGE_RAMP_HW
 
@@ -1344,6 +1351,19 @@
  */
 #undef CONFIG_CHARGER_PROFILE_OVERRIDE_COMMON
 
+/*
+ * Don't write a charge current, charge voltage or input current limit that
+ * the charger was given recently, to save I2C transactions while the charge
+ * loop keeps asking for the same values.
+ */
+#undef CONFIG_CHARGER_SHADOW_REGS
+
+/*
+ * Poll the battery and charger less often, up to CHARGE_POLL_PERIOD_STEADY,
+ * while nothing the charge loop looks at changes.
+ */
+#undef CONFIG_CHARGER_STEADY_STATE_POLL
+
 /*
  * Battery voltage threshold ranges for charge profile override.
  * Override it in board.h if battery has multiple threshold ranges.
@@ -2232,6 +2252,12 @@
 #undef CONFIG_FP_SENSOR_ELAN80
 #undef CONFIG_FP_SENSOR_ELAN515
 
+/*
+ * Use the chip's AES and HASH peripherals for the fingerprint crypto when
+ * the chip variant has them, falling back to software otherwise.
+ */
+#undef CONFIG_FP_CRYPTO_HW_ACCELERATE
+
 /*****************************************************************************/
 
 /* Include a flashmap in the compiled firmware image */
@@ -2613,6 +2639,19 @@
 /* Command to get the EC uptime (and optionally AP reset stats) */
 #define CONFIG_HOSTCMD_GET_UPTIME_INFO
 
+/*
+ * Collect per-command call counts, error counts and execution time histograms
+ * in the host command task, reported by EC_CMD_HOSTCMD_STATS and the hcstats
+ * console command.
+ */
+#undef CONFIG_HOSTCMD_STATS
+
+/*
+ * Number of distinct host commands CONFIG_HOSTCMD_STATS can track. Must be a
+ * power of two; each slot costs 52 bytes of RAM.
+ */
+#define CONFIG_HOSTCMD_STATS_SLOTS 32
+
 /* Include host command to control I2C busses (get, set speed, etc.) */
 #undef CONFIG_HOSTCMD_I2C_CONTROL
 
@@ -2631,6 +2670,15 @@
 /* Enable debugging and profiling statistics for hook functions */
 #undef CONFIG_HOOK_DEBUG
 
+/*
+ * Time each HOOK_INIT routine at boot, reported by EC_CMD_HOOK_INIT_TIMES
+ * and the inittimes console command.
+ */
+#undef CONFIG_HOOK_INIT_TIMES
+
+/* Number of init hooks CONFIG_HOOK_INIT_TIMES lists, 12 bytes of RAM each */
+#define CONFIG_HOOK_INIT_TIMES_SLOTS 64
+
 /*****************************************************************************/
 /* CRC configuration */
 
@@ -3165,6 +3213,21 @@
  */
 #undef CONFIG_8042_AUX
 
+/*
+ * Let the 8042 output buffer be fed from the key scan task and from the
+ * interrupt of the host reading it, instead of going through the keyboard
+ * protocol task for each byte. You will need to call keyboard_host_read()
+ * from the output buffer empty interrupt.
+ */
+#undef CONFIG_8042_FAST_PATH
+
+/*
+ * Time key events from the keyboard matrix read to the host reading their
+ * scan code, and report it with EC_CMD_8042_LATENCY. Also relies on
+ * keyboard_host_read() being called.
+ */
+#undef CONFIG_8042_LATENCY
+
 /*****************************************************************************/
 
 /*
@@ -3360,6 +3423,11 @@
 #undef CONFIG_HOST_INTERFACE_ESPI
 /* Support host command interface over USB. */
 #undef CONFIG_HOST_INTERFACE_USB
+/*
+ * Support host command interface over a UNIX socket. Emulator only; used to
+ * drive host builds with ectool --socket.
+ */
+#undef CONFIG_HOST_INTERFACE_SOCKET
 
 /*
  * SLP signals (SLP_S3, SLP_S4, and SLP_S5) use virtual wires instead of
@@ -3439,6 +3507,9 @@
 /* Need for a math library */
 #undef CONFIG_MATH_UTIL
 
+/* Need for streaming statistics over windows of sensor samples */
+#undef CONFIG_STREAMING_STATS
+
 /* Include sensor online calibration (requires CONFIG_FPU) */
 #undef CONFIG_ONLINE_CALIB
 
@@ -3530,6 +3601,12 @@
 /* Support MKBP event */
 #undef CONFIG_MKBP_EVENT
 
+/*
+ * Support version 3 of EC_CMD_GET_NEXT_EVENT, which returns all the pending
+ * MKBP events that fit in the response instead of one per host command.
+ */
+#undef CONFIG_MKBP_EVENT_BATCH
+
 /* MKBP events are sent by using host event */
 #undef CONFIG_MKBP_USE_HOST_EVENT
 
@@ -4600,6 +4677,13 @@
 #define CONFIG_USB_PE_SM
 #define CONFIG_USB_DPM_SM
 
+/*
+ * Skip the Policy Engine and Protocol Layer on USB-C port task wakeups that
+ * bring them no new input (events, expired timers, received messages, flags
+ * set by other layers or state changes), rather than running them every 5ms.
+ */
+#undef CONFIG_USBC_SM_SKIP_IDLE
+
 /* Enables PD Console commands */
 #define CONFIG_USB_PD_CONSOLE_CMD
 
@@ -4620,6 +4704,19 @@
 /* Support for automatic USB PD Discovery VDM probing and storage */
 #undef CONFIG_USB_PD_DISCOVERY
 
+/*
+ * Cache the SVIDs and modes discovered on recently seen port partners and
+ * cables, keyed by their Discover Identity response. On a replug, a matching
+ * identity skips Discover SVIDs and Discover Modes.
+ */
+#undef CONFIG_USB_PD_DISCOVERY_CACHE
+
+/* Number of port partners and cables in the discovery cache */
+#define CONFIG_USB_PD_DISCOVERY_CACHE_SIZE 4
+
+/* Keep the most recent discovery cache entries across sysjumps */
+#undef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+
 /*
  * Do not enter USB PD alternate modes or USB4 automatically. Wait for the AP to
  * direct the EC to enter a mode. This requires AP software support.
@@ -4801,6 +4898,16 @@
  */
 #define CONFIG_USB_PD_PRL_EVENT_LOG_CAPACITY 128
 
+/*
+ * Record every transition of the USB-PD state machines, with a timestamp and
+ * the task events that caused it, in a ring buffer per port. It is read with
+ * EC_CMD_PD_SM_TRACE, and checked against the spec timers by `ectool
+ * pdtrace`.
+ */
+#undef CONFIG_USB_PD_SM_TRACE
+/* Number of transitions kept per port, a power of two */
+#define CONFIG_USB_PD_SM_TRACE_SIZE 64
+
 /* The size in bytes of the FIFO used for event logging */
 #define CONFIG_EVENT_LOG_SIZE 512
 
@@ -5513,6 +5620,12 @@
 /* Allow the AP to send commands for mux control */
 #undef CONFIG_USB_MUX_AP_CONTROL
 
+/*
+ * Remember the state last programmed into each mux of a chain, and skip
+ * setting a mux to the state it is already in.
+ */
+#undef CONFIG_USB_MUX_SHADOW_STATE
+
 /* Support the AMD FP5 USB/DP Mux */
 #undef CONFIG_USB_MUX_AMD_FP5
 
@@ -5599,6 +5712,15 @@
  */
 #undef CONFIG_USB_SPI_IGNORE_HOST_SIDE_ENABLE
 
+/*
+ * Let the host post serial flash writes: they are answered once received,
+ * and go out on the SPI bus while the next command comes in.  Requires
+ * CONFIG_USB_SPI_FLASH_EXTENSIONS.
+ */
+#undef CONFIG_USB_SPI_POSTED_WRITES
+/* Number of posted writes queued, each takes a USB SPI buffer of RAM. */
+#define CONFIG_USB_SPI_POSTED_DEPTH 2
+
 /*****************************************************************************/
 /* USB I2C config */
 #undef CONFIG_USB_I2C
@@ -5744,6 +5866,15 @@
 /* PDU size for fw update over USB (or TPM). */
 #define CONFIG_UPDATE_PDU_SIZE 1024
 
+/*
+ * Let the host send several update PDUs ahead of their confirmations, and
+ * program them as they come in, skipping those already in flash. See
+ * UPDATE_EXTRA_CMD_SET_WINDOW.
+ */
+#undef CONFIG_UPDATE_WINDOW
+/* Number of PDUs buffered, each takes CONFIG_UPDATE_PDU_SIZE of RAM */
+#define CONFIG_UPDATE_WINDOW_BLOCKS 4
+
 /* DFU firmware upgrade options */
 /*
  * Enables DFU USB Runtime identifier.
@@ -5895,6 +6026,13 @@
 #undef CONFIG_SYSTEM_BOOT_TIME_LOGGING
 #endif /* CONFIG_ZEPHYR */
 
+/*
+ * Hand state that is slow to get to the next image on a sysjump: the RW hash,
+ * the CBI image and the static battery info. The next image checks that the
+ * state still holds before using it.
+ */
+#undef CONFIG_SYSJUMP_WARM_STATE
+
 /*
  * The USB port used for CCD. Defaults to 0/C0.
  */
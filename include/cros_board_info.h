@@ -70,6 +70,12 @@ enum cbi_storage_type {
 struct cbi_storage_driver {
 	/* Write the whole CBI from RAM to storage media (i.e. sync) */
 	int (*store)(uint8_t *cache);
+	/*
+	 * Optional. Write len bytes at offset from RAM to storage media, so
+	 * that only the bytes that changed need to be rewritten. If NULL,
+	 * store is used instead.
+	 */
+	int (*store_range)(uint8_t *cache, int offset, int len);
 	/*
 	 * Read blocks from storage media to RAM. Note that the granularity
 	 * of load function is asymmetrical to that of the store function.
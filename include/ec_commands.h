@@ -159,7 +159,11 @@ extern "C" {
 #define EC_MEMMAP_SWITCHES_VERSION 0x25 /* Version of data in 0x30 - 0x33 */
 #define EC_MEMMAP_EVENTS_VERSION 0x26 /* Version of data in 0x34 - 0x3f */
 #define EC_MEMMAP_HOST_CMD_FLAGS 0x27 /* Host cmd interface flags (8 bits) */
-/* Unused 0x28 - 0x2f */
+/* Sequence counters (8 bits), valid if EC_MEMMAP_ID_VERSION returns >= 2 */
+#define EC_MEMMAP_THERMAL_SEQ 0x28 /* Temp sensors 0x00-0x0f, 0x18-0x1f */
+#define EC_MEMMAP_BATTERY_SEQ 0x29 /* Battery data 0x40 - 0x7f */
+#define EC_MEMMAP_MOTION_SEQ 0x2a /* ALS and motion data 0x80 - 0xa5 */
+/* Unused 0x2b - 0x2f */
 #define EC_MEMMAP_SWITCHES 0x30 /* 8 bits */
 /* Unused 0x31 - 0x33 */
 #define EC_MEMMAP_HOST_EVENTS 0x34 /* 64 bits */
@@ -211,6 +215,15 @@ extern "C" {
  */
 #define EC_MEMMAP_NO_ACPI 0xe0
 
+/*
+ * The EC writes the regions with a sequence counter field by field. The
+ * counter is odd while the region is being updated, and moves on at each
+ * update. To get a consistent snapshot of a region, the host reads the
+ * counter, then the region, then the counter again, and starts over if the
+ * counter was odd or changed.
+ */
+#define EC_MEMMAP_SEQ_ID_VERSION 2
+
 /* Define the format of the accelerometer mapped memory status byte. */
 #define EC_MEMMAP_ACC_STATUS_SAMPLE_ID_MASK 0x0f
 #define EC_MEMMAP_ACC_STATUS_BUSY_BIT BIT(4)
@@ -4020,6 +4033,32 @@ struct ec_response_get_next_event_v1 {
 	union ec_response_get_next_data_v1 data;
 } __ec_align1;
 
+/*
+ * Version 3 returns as many pending events as fit in the response, taken
+ * in the same round-robin order as one at a time. Each event is a struct
+ * ec_mkbp_event_record, packed one after the other. The response must have
+ * room for at least one event with the largest data.
+ */
+struct ec_mkbp_event_record {
+	uint8_t event_type;
+	/* Size of the data that follows */
+	uint8_t size;
+	uint8_t data[];
+} __ec_align1;
+
+#define EC_MKBP_EVENT_RECORD_MAX_SIZE       \
+	(sizeof(struct ec_mkbp_event_record) + \
+	 sizeof(union ec_response_get_next_data_v1))
+
+struct ec_response_get_next_event_v3 {
+	/* Number of events that follow */
+	uint8_t count;
+	/* EC_MKBP_HAS_MORE_EVENTS if events are still pending */
+	uint8_t flags;
+	/* Followed by count struct ec_mkbp_event_record */
+	uint8_t records[];
+} __ec_align1;
+
 /* Bit indices for buttons and switches.*/
 /* Buttons */
 #define EC_MKBP_POWER_BUTTON 0
@@ -7716,12 +7755,36 @@ struct ec_params_fp_frame {
 	uint32_t size;
 } __ec_align4;
 
+/*
+ * Version 1 only serves FP_FRAME_INDEX_RAW_IMAGE, compressed: 'size' is the
+ * number of frame bytes wanted from the offset, and the response carries as
+ * many of them as fit in the largest response the transport allows, packed
+ * as described in include/fpsensor_frame_codec.h.
+ */
+struct ec_response_fp_frame_packed {
+	/* Number of frame bytes in the packed data. */
+	uint32_t size;
+	/* Bits per sample the frame was packed with, 8 or 16. */
+	uint8_t sample_bits;
+	uint8_t reserved[3];
+	uint8_t data[];
+} __ec_align4;
+
 /* Load a template into the MCU */
 #define EC_CMD_FP_TEMPLATE 0x0405
 
 /* Flag in the 'size' field indicating that the full template has been sent */
 #define FP_TEMPLATE_COMMIT 0x80000000
 
+/*
+ * Version 1 loads several templates in one go: offset runs over the
+ * templates sent back to back, each template_size bytes long (see
+ * EC_CMD_FP_INFO), and chunks must come in order, the first one at offset
+ * 0 starting a new batch. Each template is decrypted as it arrives and is
+ * valid once its last byte is received. FP_TEMPLATE_COMMIT ends the batch,
+ * on a template boundary.
+ */
+
 struct ec_params_fp_template {
 	uint32_t offset;
 	uint32_t size;
@@ -8064,6 +8127,205 @@ struct ec_response_get_boot_time {
 	uint16_t cnt;
 } __ec_align4;
 
+/*****************************************************************************/
+/*
+ * Host command execution statistics.
+ *
+ * Returns call/error counts and log2-bucketed execution time histograms for
+ * each host command the EC has processed since boot (or since the last reset
+ * of the statistics), plus a histogram of the delay between a request being
+ * received by the host interface and being dispatched by the host command
+ * task.
+ *
+ * Histogram bucket i counts samples in [2^i, 2^(i+1)) microseconds. Bucket 0
+ * also counts samples under 1 us and the last bucket counts everything above
+ * its lower bound. Bucket counters saturate instead of wrapping.
+ *
+ * Entries are returned in table order starting at index; the host should
+ * keep incrementing index by the returned count until it reaches total.
+ */
+#define EC_CMD_HOSTCMD_STATS 0x0605
+
+#define EC_HOSTCMD_STATS_BUCKETS 16
+
+/* Reset all statistics after (atomically with) reading them */
+#define EC_HOSTCMD_STATS_FLAG_RESET BIT(0)
+
+struct ec_params_hostcmd_stats {
+	uint8_t index; /* First entry to return */
+	uint8_t flags; /* EC_HOSTCMD_STATS_FLAG_* */
+} __ec_align1;
+
+struct ec_hostcmd_stats_entry {
+	uint16_t command; /* EC_CMD_* */
+	uint16_t reserved;
+	uint32_t calls; /* Number of times the command was processed */
+	uint32_t errors; /* Number of non-EC_RES_SUCCESS results */
+	uint32_t max_us; /* Longest execution time */
+	uint32_t total_us; /* Sum of execution times (wraps) */
+	uint16_t hist[EC_HOSTCMD_STATS_BUCKETS]; /* Execution time histogram */
+} __ec_align4;
+
+struct ec_response_hostcmd_stats {
+	uint8_t total; /* Number of entries in use on the EC */
+	uint8_t count; /* Number of entries in this response */
+	uint16_t reserved;
+	/* Commands that could not be tracked because the table was full */
+	uint32_t untracked;
+	/* Delay from host interface receive to task dispatch */
+	uint16_t queue_hist[EC_HOSTCMD_STATS_BUCKETS];
+	struct ec_hostcmd_stats_entry entries[];
+} __ec_align4;
+
+/*
+ * USB-C SS mux mode set statistics of a port. Latency is measured from the
+ * PD stack requesting a set to the whole mux chain being configured.
+ */
+#define EC_CMD_USB_PD_MUX_STATS 0x0606
+
+/* Reset the port statistics after (atomically with) reading them */
+#define EC_USB_PD_MUX_STATS_FLAG_RESET BIT(0)
+
+struct ec_params_usb_pd_mux_stats {
+	uint8_t port; /* USB-C port number */
+	uint8_t flags; /* EC_USB_PD_MUX_STATS_FLAG_* */
+} __ec_align1;
+
+struct ec_response_usb_pd_mux_stats {
+	uint32_t set_count; /* Mode sets completed */
+	/* Chip writes skipped since the chip was already in that state */
+	uint32_t elided_count;
+	uint32_t last_latency_us; /* Latency of the last mode set */
+	uint32_t max_latency_us; /* Longest mode set latency */
+} __ec_align4;
+
+/*
+ * USB-PD state machine transition trace of a port.
+ *
+ * The EC records every state change of the Type-C, Policy Engine, Protocol
+ * Layer and Device Policy Manager state machines in a ring buffer per port.
+ * Entries are numbered from boot; READ returns the oldest entries still
+ * held from seq on. The host should keep reading from seq + count until it
+ * reaches head.
+ */
+#define EC_CMD_PD_SM_TRACE 0x0607
+
+enum ec_pd_sm_trace_cmd {
+	EC_PD_SM_TRACE_READ = 0,
+	EC_PD_SM_TRACE_CLEAR = 1,
+	/* Name of a state, as a NUL-terminated string */
+	EC_PD_SM_TRACE_STATE_NAME = 2,
+};
+
+/* State machines of a port */
+enum ec_pd_sm {
+	EC_PD_SM_TC = 0,
+	EC_PD_SM_PE = 1,
+	EC_PD_SM_PRL_TX = 2,
+	EC_PD_SM_PRL_HR = 3,
+	EC_PD_SM_RCH = 4,
+	EC_PD_SM_TCH = 5,
+	EC_PD_SM_DPM = 6,
+	EC_PD_SM_COUNT,
+};
+
+/* State of a state machine not started yet, or stopped */
+#define EC_PD_SM_STATE_NONE 0xff
+
+struct ec_params_pd_sm_trace {
+	uint8_t port; /* USB-C port number */
+	uint8_t cmd; /* enum ec_pd_sm_trace_cmd */
+	uint8_t machine; /* STATE_NAME: enum ec_pd_sm */
+	uint8_t state; /* STATE_NAME: state index */
+	uint32_t seq; /* READ: first entry to return */
+} __ec_align4;
+
+struct ec_pd_sm_trace_entry {
+	uint32_t timestamp; /* EC time of the transition, in us (wraps) */
+	/* Task events of the port task wakeup that led to the transition */
+	uint32_t event;
+	uint8_t machine; /* enum ec_pd_sm */
+	uint8_t old_state; /* State index, or EC_PD_SM_STATE_NONE */
+	uint8_t new_state; /* State index, or EC_PD_SM_STATE_NONE */
+	uint8_t reserved;
+} __ec_align4;
+
+struct ec_response_pd_sm_trace {
+	uint32_t seq; /* Number of entries[0] */
+	uint32_t head; /* Number the next recorded entry will get */
+	uint8_t count; /* Number of entries in this response */
+	uint8_t reserved[3];
+	struct ec_pd_sm_trace_entry entries[];
+} __ec_align4;
+
+/*
+ * Time each HOOK_INIT routine took at the last boot of the running image.
+ *
+ * Entries are returned in the order the hooks ran, starting at index; the
+ * host should keep incrementing index by the returned count until it reaches
+ * total. Routines are code addresses, to look up in the symbols of the image.
+ */
+#define EC_CMD_HOOK_INIT_TIMES 0x0608
+
+/* The running image was jumped to, and may have taken over state */
+#define EC_HOOK_INIT_TIMES_FLAG_JUMPED BIT(0)
+
+struct ec_params_hook_init_times {
+	uint8_t index; /* First entry to return */
+} __ec_align1;
+
+struct ec_hook_init_time {
+	uint32_t routine; /* Address of the hook routine */
+	uint32_t time_us; /* Time the routine took */
+	uint16_t priority; /* HOOK_PRIO_* of the hook */
+	uint16_t reserved;
+} __ec_align4;
+
+struct ec_response_hook_init_times {
+	uint8_t total; /* Number of entries on the EC */
+	uint8_t count; /* Number of entries in this response */
+	uint8_t flags; /* EC_HOOK_INIT_TIMES_FLAG_* */
+	uint8_t untracked; /* Hooks run after the table was full */
+	uint32_t total_us; /* Time taken by all the HOOK_INIT routines */
+	struct ec_hook_init_time entries[];
+} __ec_align4;
+
+/*
+ * Time key events take to reach the host through the 8042 interface.
+ *
+ * A key event is timed from the keyboard matrix read that saw it, to the
+ * queueing of its scan code, to the host reading the last byte of the scan
+ * code from the output buffer. Times are in us.
+ */
+#define EC_CMD_8042_LATENCY 0x0609
+
+/* Reset the statistics after (atomically with) reading them */
+#define EC_8042_LATENCY_FLAG_RESET BIT(0)
+
+enum ec_8042_latency_stage {
+	EC_8042_LATENCY_QUEUE = 0, /* Matrix read to scan code queued */
+	EC_8042_LATENCY_SEND = 1, /* Scan code queued to host read */
+	EC_8042_LATENCY_TOTAL = 2, /* Matrix read to host read */
+	EC_8042_LATENCY_COUNT,
+};
+
+struct ec_params_8042_latency {
+	uint8_t flags; /* EC_8042_LATENCY_FLAG_* */
+} __ec_align1;
+
+struct ec_8042_latency_stat {
+	uint32_t min_us;
+	uint32_t max_us;
+	uint32_t total_us; /* Sum over all the events (wraps) */
+} __ec_align4;
+
+struct ec_response_8042_latency {
+	uint32_t count; /* Key events timed */
+	/* Key events not timed: too many in flight, or output flushed */
+	uint32_t untracked;
+	struct ec_8042_latency_stat stages[EC_8042_LATENCY_COUNT];
+} __ec_align4;
+
 /*****************************************************************************/
 /*
  * Reserve a range of host commands for board-specific, experimental, or
@@ -146,6 +146,30 @@ int fp_sensor_acquire_image_with_mode(uint8_t *image_data, int mode);
  */
 int fp_maintenance(void);
 
+/**
+ * Time spent in each phase of an image acquisition.
+ *
+ * Drivers fill in the phases they can tell apart, and leave the others at 0.
+ */
+struct fp_sensor_capture_timing {
+	/* From the start of the scan until the image can be read out */
+	uint32_t scan_us;
+	/* Reading the image out of the sensor */
+	uint32_t readout_us;
+	/*
+	 * Part of readout_us spent converting the lines already received,
+	 * while the following ones were still coming in.
+	 */
+	uint32_t process_us;
+};
+
+/**
+ * Get the timing of the last fp_sensor_acquire_image_with_mode().
+ *
+ * @param[out] timing phases of the last acquisition
+ */
+void fp_sensor_get_capture_timing(struct fp_sensor_capture_timing *timing);
+
 #ifdef __cplusplus
 }
 #endif
@@ -100,6 +100,48 @@ enum ec_error_list aes_gcm_decrypt(const uint8_t *key, int key_size,
 				   const uint8_t *nonce, int nonce_size,
 				   const uint8_t *tag, int tag_size);
 
+/**
+ * Start decrypting a message using AES-GCM128, in pieces as it arrives.
+ *
+ * Only one message can be decrypted this way at a time: starting another
+ * one drops the previous one.
+ *
+ * @param key the key to use in AES.
+ * @param key_size the size of |key| in bytes.
+ * @param nonce the nonce value to use in GCM128.
+ * @param nonce_size the size of |nonce| in bytes.
+ * @return EC_SUCCESS on success and error code otherwise.
+ */
+enum ec_error_list aes_gcm_decrypt_start(const uint8_t *key, int key_size,
+					 const uint8_t *nonce, int nonce_size);
+
+/**
+ * Decrypt the next piece of the message started by aes_gcm_decrypt_start().
+ *
+ * @param plaintext buffer to hold decryption result, may be |ciphertext|.
+ * @param ciphertext the next |text_size| bytes of cipher text.
+ * @param text_size size of both |ciphertext| and output plaintext in bytes.
+ * @return EC_SUCCESS on success and error code otherwise.
+ */
+enum ec_error_list aes_gcm_decrypt_update(uint8_t *plaintext,
+					  const uint8_t *ciphertext,
+					  int text_size);
+
+/**
+ * Check the tag of the message once all of it is decrypted, and forget its
+ * key.
+ *
+ * @param tag the tag to compare against.
+ * @param tag_size the length of tag to compare against.
+ * @return EC_SUCCESS if the tag matches and error code otherwise.
+ */
+enum ec_error_list aes_gcm_decrypt_finish(const uint8_t *tag, int tag_size);
+
+/**
+ * Forget the key of a message which will not be finished.
+ */
+void aes_gcm_decrypt_abort(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,93 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Backends for the symmetric crypto of the fingerprint MCU */
+
+#ifndef __CROS_EC_FPSENSOR_CRYPTO_BACKEND_H
+#define __CROS_EC_FPSENSOR_CRYPTO_BACKEND_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Template encryption, key derivation and the fpsensor_auth commands get
+ * their AES and HMAC from a backend: the BoringSSL software one, or the
+ * chip's crypto peripherals with CONFIG_FP_CRYPTO_HW_ACCELERATE. Arguments
+ * are checked by the callers, backends only compute.
+ */
+struct fp_crypto_backend {
+	const char *name;
+
+	/**
+	 * Get the backend ready. Only called once, before any other
+	 * operation; may be NULL.
+	 *
+	 * @return EC_SUCCESS, or an error if the backend can't be used.
+	 */
+	enum ec_error_list (*init)(void);
+
+	/**
+	 * AES-GCM with a 96-bit nonce and no additional data.
+	 *
+	 * @param key AES key of key_size (16 or 32) bytes.
+	 * @param in message of text_size bytes.
+	 * @param out where to write the result, may be |in|.
+	 * @param tag tag_size bytes tag: written when encrypting, checked
+	 * when decrypting.
+	 * @return EC_SUCCESS, or EC_ERROR_UNKNOWN when decrypting with a bad
+	 * tag.
+	 */
+	enum ec_error_list (*aes_gcm_encrypt)(const uint8_t *key, int key_size,
+					      const uint8_t *in, uint8_t *out,
+					      int text_size,
+					      const uint8_t *nonce,
+					      uint8_t *tag, int tag_size);
+	enum ec_error_list (*aes_gcm_decrypt)(const uint8_t *key, int key_size,
+					      const uint8_t *in, uint8_t *out,
+					      int text_size,
+					      const uint8_t *nonce,
+					      const uint8_t *tag, int tag_size);
+
+	/**
+	 * AES-256-CTR in place, the counter being the whole 16 bytes of iv.
+	 */
+	enum ec_error_list (*aes_ctr)(const uint8_t *key, const uint8_t *iv,
+				      uint8_t *data, size_t data_size);
+
+	/**
+	 * HMAC-SHA256 of message, SHA256_DIGEST_SIZE bytes written to output.
+	 */
+	void (*hmac_sha256)(uint8_t *output, const uint8_t *key, int key_len,
+			    const uint8_t *message, int message_len);
+};
+
+/* Software implementation, always available */
+extern const struct fp_crypto_backend fp_crypto_software;
+
+#ifdef CONFIG_FP_CRYPTO_HW_ACCELERATE
+/* Chip crypto peripherals, when the chip variant has them */
+extern const struct fp_crypto_backend fp_crypto_hardware;
+#endif
+
+/**
+ * Backend used by the fingerprint crypto.
+ *
+ * On first use, picks the hardware one if it is there and agrees with the
+ * software one on known messages, both AES key sizes and a counter that
+ * wraps included, the software one otherwise.
+ */
+const struct fp_crypto_backend *fp_crypto_backend(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CROS_EC_FPSENSOR_CRYPTO_BACKEND_H */
@@ -0,0 +1,75 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Compression of raw fingerprint frames sent to the host */
+
+#ifndef __CROS_EC_FPSENSOR_FRAME_CODEC_H
+#define __CROS_EC_FPSENSOR_FRAME_CODEC_H
+
+#include "common.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Frames are packed in blocks of FP_FRAME_PACK_BLOCK samples of 8 or 16 bits
+ * (little endian). Each sample is replaced by its difference with the one
+ * before it in the frame, mapped to an unsigned value (0, -1, 1, -2, ...)
+ * and Rice coded: the value shifted right by k in unary (that many 1 bits,
+ * then a 0 bit), then its k low bits. A block starts with 4 bits giving k,
+ * the cheapest for the block, or FP_FRAME_PACK_VERBATIM when the samples
+ * are stored as they are. Bits are filled from the least significant one,
+ * and a chunk is padded to a whole byte.
+ *
+ * Only the sample before a chunk is needed to unpack it, so the MCU packs
+ * each chunk on request straight from the frame buffer, without keeping
+ * any state between host commands.
+ */
+#define FP_FRAME_PACK_BLOCK 32
+#define FP_FRAME_PACK_VERBATIM 0xF
+
+/**
+ * Pack frame samples from an offset, in as many blocks as fit.
+ *
+ * @param frame the whole frame.
+ * @param frame_size size of the frame in bytes.
+ * @param start offset of the first sample to pack, in bytes.
+ * @param sample_bits 8 or 16.
+ * @param out where to write the packed chunk.
+ * @param out_size size of out in bytes.
+ * @param packed set to the number of frame bytes packed.
+ *
+ * @return size of the packed chunk in bytes.
+ */
+size_t fp_frame_pack(const uint8_t *frame, size_t frame_size, size_t start,
+		     int sample_bits, uint8_t *out, size_t out_size,
+		     size_t *packed);
+
+/**
+ * Unpack a chunk written by fp_frame_pack().
+ *
+ * @param in the packed chunk.
+ * @param in_size size of the chunk in bytes.
+ * @param sample_bits 8 or 16, as the chunk was packed with.
+ * @param frame the frame, unpacked up to start.
+ * @param start offset of the first sample of the chunk, in bytes.
+ * @param size number of frame bytes in the chunk.
+ *
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if the chunk does not unpack to
+ * exactly size bytes.
+ */
+enum ec_error_list fp_frame_unpack(const uint8_t *in, size_t in_size,
+				   int sample_bits, uint8_t *frame,
+				   size_t start, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __CROS_EC_FPSENSOR_FRAME_CODEC_H */
@@ -72,6 +72,12 @@ void fp_clear_finger_context(uint16_t idx);
  */
 void fp_reset_and_clear_context(void);
 
+/**
+ * Stop loading a batch of templates with EC_CMD_FP_TEMPLATE version 1,
+ * wiping its key. The templates already loaded are kept.
+ */
+void fp_template_batch_end(void);
+
 /*
  * Get the next FP event.
  *
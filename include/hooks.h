@@ -305,6 +305,15 @@ struct hook_data {
  */
 void hook_notify(enum hook_type type);
 
+/**
+ * Call a HOOK_INIT routine and note the time it took, for
+ * CONFIG_HOOK_INIT_TIMES.
+ *
+ * @param routine	Hook routine to call.
+ * @param priority	Priority the hook was declared with.
+ */
+void hook_call_init_timed(void (*routine)(void), int priority);
+
 /*
  * CONFIG_PLATFORM_EC_HOOKS is enabled by default during a Zephyr
  * build, but can be disabled via Kconfig if desired (leaving the stub
@@ -163,6 +163,24 @@ void host_command_init(void);
  */
 uint8_t *host_get_memmap(int offset);
 
+/**
+ * Start updating a region of the memory-mapped buffer.
+ *
+ * Makes the sequence counter of the region odd, so that the host retries
+ * the reads that overlap the update. Calls may nest, from tasks or
+ * interrupts: the counter only moves on the outermost ones.
+ *
+ * @param seq_offset    EC_MEMMAP_*_SEQ counter of the region
+ */
+void host_memmap_write_begin(int seq_offset);
+
+/**
+ * Finish updating a region of the memory-mapped buffer.
+ *
+ * @param seq_offset    EC_MEMMAP_*_SEQ counter of the region
+ */
+void host_memmap_write_end(int seq_offset);
+
 /**
  * Process a host command and return its response
  *
@@ -282,6 +300,28 @@ bool host_command_in_process_ended(void);
  */
 uint8_t host_command_get_saved_result(void);
 
+/**
+ * Account one processed host command in the host command statistics.
+ *
+ * Only available with CONFIG_HOSTCMD_STATS.
+ *
+ * @param command	Command number (EC_CMD_...)
+ * @param result	Result returned by the handler (EC_RES_...)
+ * @param exec_us	Time spent in the handler, in microseconds
+ */
+void host_command_stats_record(uint16_t command, uint16_t result,
+			       uint32_t exec_us);
+
+/**
+ * Account the delay between a request arriving at the host interface and the
+ * host command task dispatching it.
+ *
+ * Only available with CONFIG_HOSTCMD_STATS.
+ *
+ * @param queue_us	Queueing delay, in microseconds
+ */
+void host_command_stats_record_queue(uint32_t queue_us);
+
 /**
  * Find the handler for a command in Zephyr OS.
  *
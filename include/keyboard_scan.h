@@ -101,6 +101,13 @@ enum kb_scan_disable_masks {
 	KB_SCAN_DISABLE_USB_SUSPENDED = (1 << 3),
 };
 
+/**
+ * Return the time of the last keyboard matrix read, as the low 32 bits of
+ * get_time(). From keyboard_state_changed(), that of the read which saw the
+ * change.
+ */
+uint32_t keyboard_scan_get_read_time(void);
+
 #ifdef HAS_TASK_KEYSCAN
 /**
  * Enable/disable keyboard scanning. Scanning will be disabled if any disable
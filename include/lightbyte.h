@@ -0,0 +1,65 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Pre-decoded lightbyte programs, shared by the EC and util/lbcc */
+
+#ifndef __CROS_EC_LIGHTBYTE_H
+#define __CROS_EC_LIGHTBYTE_H
+
+#include "ec_commands.h"
+
+#define OP(NAME, BYTES, MNEMONIC) NAME,
+#include "lightbar_opcode_list.h"
+enum lightbyte_opcode { LIGHTBAR_OPCODE_TABLE MAX_OPCODE };
+#undef OP
+
+/*
+ * Decoded instruction that stops the program with an error: an invalid
+ * opcode or operand, a jump to anything but an instruction, or the end of
+ * the program.
+ */
+#define LIGHTBYTE_FAULT MAX_OPCODE
+
+/*
+ * Every instruction takes at least one byte, and so does every jump target
+ * that needs a fault of its own. Add one for falling off the end.
+ */
+#define LIGHTBYTE_MAX_INSTS (EC_LB_PROG_LEN + 1)
+
+struct lightbyte_inst {
+	/* enum lightbyte_opcode, or LIGHTBYTE_FAULT */
+	uint8_t op;
+	/*
+	 * JUMP, JUMP_IF_CHARGING: target instruction index in arg[0].
+	 * JUMP_BATTERY: low and high target instruction indexes.
+	 * SET_BRIGHTNESS: brightness in arg[0].
+	 * SET_COLOR_*: LED mask, enum lb_control, and enum lb_color.
+	 * LIGHTBYTE_FAULT: byte offset of the fault, for the logs.
+	 */
+	uint8_t arg[3];
+	union {
+		/* SET_WAIT_DELAY, SET_RAMP_DELAY */
+		uint32_t delay;
+		/* SET_COLOR_SINGLE: value in rgb[0], SET_COLOR_RGB: all */
+		uint8_t rgb[3];
+	};
+};
+
+/**
+ * Decode a lightbyte program.
+ *
+ * All the operands are checked and the jump targets resolved to instruction
+ * indexes once, so that the interpreter needs neither. Errors turn into
+ * LIGHTBYTE_FAULT instructions, to be hit at the same point of the program
+ * as the bytecode would have hit them.
+ *
+ * @param prog		Program to decode
+ * @param insts		Decoded program, LIGHTBYTE_MAX_INSTS long
+ * @return Number of decoded instructions, faults included.
+ */
+int lightbyte_decode(const struct lightbar_program *prog,
+		     struct lightbyte_inst *insts);
+
+#endif /* __CROS_EC_LIGHTBYTE_H */
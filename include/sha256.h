@@ -38,9 +38,38 @@ struct sha256_ctx {
 #endif
 #endif
 
+/*
+ * SHA256 backend interface.
+ *
+ * Exactly one backend provides these: the software implementation in
+ * common/sha256.c, or a chip's hardware accelerator (selected by
+ * CONFIG_SHA256_HW_ACCELERATE, with its context in sha256_chip.h). Callers
+ * must not depend on the layout of struct sha256_ctx.
+ *
+ * SHA256_final() returns a pointer to the digest, which lives in ctx and is
+ * valid until ctx is reused. SHA256_abort() releases any hardware held by an
+ * unfinished hash; it is a no-op for the software backend.
+ */
 void SHA256_init(struct sha256_ctx *ctx);
 void SHA256_update(struct sha256_ctx *ctx, const uint8_t *data, uint32_t len);
 uint8_t *SHA256_final(struct sha256_ctx *ctx);
+void SHA256_abort(struct sha256_ctx *ctx);
+
+/**
+ * Hash a region of flash.
+ *
+ * With CONFIG_MAPPED_STORAGE, this hashes straight out of the memory-mapped
+ * flash without copying. Otherwise the region is read through a shared memory
+ * bounce buffer.
+ *
+ * @param ctx		Hash context, already initialized
+ * @param offset	Flash offset of the region
+ * @param size		Size of the region in bytes
+ * @return EC_SUCCESS; EC_ERROR_BUSY if no buffer was available (nothing has
+ *	   been hashed, so the caller may retry later); or another error if
+ *	   the read failed, in which case the hash is no longer valid.
+ */
+int SHA256_update_flash(struct sha256_ctx *ctx, int offset, int size);
 
 void hmac_SHA256(uint8_t *output, const uint8_t *key, const int key_len,
 		 const uint8_t *message, const int message_len);
@@ -119,6 +119,14 @@ int spi_transaction_flush(const struct spi_device_t *spi_device);
 /* Wait for async response received but do not de-assert chip select */
 int spi_transaction_wait(const struct spi_device_t *spi_device);
 
+/*
+ * Lock the SPI port of a device against spi_transaction() calls, for a
+ * sequence of spi_transaction_async() calls that must not be interleaved
+ * with other transactions. Not all controllers implement these.
+ */
+void spi_transaction_lock(const struct spi_device_t *spi_device);
+void spi_transaction_unlock(const struct spi_device_t *spi_device);
+
 /*
  * Get SPI protocol information. This function is called in runtime if board's
  * host command transport is SPI.
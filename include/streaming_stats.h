@@ -0,0 +1,132 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Streaming statistics over windows of motion sensor samples */
+
+#ifndef __CROS_EC_STREAMING_STATS_H
+#define __CROS_EC_STREAMING_STATS_H
+
+#include "common.h"
+#include "math_util.h"
+#include "stdbool.h"
+#include "vec3.h"
+
+#include <stdint.h>
+
+#define STATS_WINDOW_MAX_AXES 3
+
+/**
+ * Sliding window over the last `size` integer samples of up to
+ * STATS_WINDOW_MAX_AXES axes, with O(1) mean and variance updates.
+ *
+ * Samples are kept as int16_t, saturating anything outside of that range.
+ * With at most UINT16_MAX samples, the sum fits in 32 bits and n^2 * var in
+ * 64 bits, so nothing can overflow.
+ */
+struct stats_window {
+	/* size * axes samples, interleaved by axis */
+	int16_t *history;
+	/* Samples in a full window */
+	uint16_t size;
+	/* Next sample to replace */
+	uint16_t idx;
+	/* Samples added since init, up to size */
+	uint16_t count;
+	uint8_t axes;
+	/* sum(history) */
+	int32_t sum[STATS_WINDOW_MAX_AXES];
+	/* size^2 * var(history) */
+	uint64_t n2_var[STATS_WINDOW_MAX_AXES];
+};
+
+/**
+ * Start an empty window. Until it is full, the missing samples count as 0.
+ *
+ * @param history Storage for size * axes samples
+ * @param size Number of samples in the window, at most UINT16_MAX
+ * @param axes Number of values per sample, at most STATS_WINDOW_MAX_AXES
+ */
+void stats_window_init(struct stats_window *w, int16_t *history, int size,
+		       int axes);
+
+/**
+ * Add a sample to the window, replacing the oldest one once it is full.
+ *
+ * @param x One value for each axis
+ */
+void stats_window_add(struct stats_window *w, const int *x);
+
+/** Return true once size samples have been added. */
+static inline bool stats_window_full(const struct stats_window *w)
+{
+	return w->count == w->size;
+}
+
+/** Return the mean of an axis, rounded toward zero. */
+static inline int stats_window_mean(const struct stats_window *w, int axis)
+{
+	return w->sum[axis] / w->size;
+}
+
+/**
+ * Return size^2 times the population variance of an axis. This is exact, so
+ * callers combining axes should do so before dividing.
+ */
+static inline uint64_t stats_window_n2_variance(const struct stats_window *w,
+						int axis)
+{
+	return w->n2_var[axis];
+}
+
+/** Return the population variance of an axis, rounded down. */
+uint64_t stats_window_variance(const struct stats_window *w, int axis);
+
+/**
+ * Find the extremes of an axis. This walks the window, so it is O(size) and
+ * meant for occasional queries rather than every sample.
+ */
+void stats_window_min_max(const struct stats_window *w, int axis, int *min,
+			  int *max);
+
+/**
+ * Mean and variance of a batch of 3-axis fp_t samples, in O(1) per sample
+ * and without storing them.
+ *
+ * The sums are taken relative to the first sample (the "assumed mean"), which
+ * keeps them small for still sensors, where they are used, and so avoids both
+ * fixed-point overflow and the cancellation of sum(x^2) - sum(x)^2 / n.
+ */
+struct stats_batch {
+	uint32_t count;
+	/* First sample of the batch */
+	fpv3_t origin;
+	/* sum(x - origin) */
+	fpv3_t sum;
+	/* sum((x - origin)^2) */
+	fpv3_t sum_sq;
+};
+
+/** Start a new batch. */
+static inline void stats_batch_reset(struct stats_batch *b)
+{
+	b->count = 0;
+}
+
+/** Add a sample to the batch. */
+void stats_batch_add(struct stats_batch *b, fp_t x, fp_t y, fp_t z);
+
+/**
+ * Compute the mean and variance of each axis of the batch.
+ *
+ * @param unbiased Use the sample variance (divide by count - 1) rather than
+ *                 the population variance (divide by count)
+ * @param mean [OUT] Mean of the batch, may be NULL
+ * @param var [OUT] Variance of the batch, may be NULL
+ * @return EC_SUCCESS, or EC_ERROR_INVAL if there are too few samples
+ */
+int stats_batch_compute(const struct stats_batch *b, bool unbiased,
+			fpv3_t mean, fpv3_t var);
+
+#endif /* __CROS_EC_STREAMING_STATS_H */
@@ -23,6 +23,19 @@
 
 #define JUMP_TAG_MAX_SIZE 255
 
+/*
+ * Tags of the state handed to the next image by CONFIG_SYSJUMP_WARM_STATE
+ * and CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP. Other tags are defined by the
+ * modules that use them; keep all of them distinct.
+ */
+#define SYSJUMP_TAG_VBOOT_HASH 0x5648 /* "VH" */
+#define SYSJUMP_TAG_CBI 0x4342 /* "CB" */
+#define SYSJUMP_TAG_BATTERY_STATIC 0x4253 /* "BS" */
+#define SYSJUMP_TAG_PD_DISC_CACHE 0x5043 /* "PC" */
+
+/* Size of the SYSJUMP_TAG_VBOOT_HASH data: a SHA-256 digest, offset, size */
+#define SYSJUMP_TAG_VBOOT_HASH_SIZE 40
+
 #if !defined(CONFIG_RAM_SIZE) || !(CONFIG_RAM_SIZE > 0)
 /* Disable check by setting jump data min address to zero */
 #define JUMP_DATA_MIN_ADDRESS 0
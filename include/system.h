@@ -248,6 +248,28 @@ int system_add_jump_tag(uint16_t tag, int version, int size, const void *data);
  */
 const uint8_t *system_get_jump_tag(uint16_t tag, int *version, int *size);
 
+/**
+ * Retrieve jump data of a known layout
+ *
+ * Like system_get_jump_tag(), but only returns the data if the previous image
+ * stored it with the same version and size, i.e. the same layout.
+ *
+ * @param tag		Data type to retrieve
+ * @param version	Version the data must have
+ * @param size		Size the data must have
+ * @return		A pointer to the data, or NULL.
+ */
+const void *system_get_jump_data(uint16_t tag, int version, int size);
+
+/*
+ * Preserve a struct across a jump, from a HOOK_SYSJUMP handler, and get it
+ * back in the next image. Bump the version whenever the struct changes.
+ */
+#define system_add_jump_struct(tag, version, ptr) \
+	system_add_jump_tag(tag, version, sizeof(*(ptr)), ptr)
+#define system_get_jump_struct(tag, version, type) \
+	((const type *)system_get_jump_data(tag, version, sizeof(type)))
+
 /**
  * Return the address just past the last usable byte in RAM.
  */
@@ -8,6 +8,7 @@
 
 #include "compile_time_macros.h"
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /*
@@ -31,6 +32,30 @@
  *
  * The connection establishment response is described by the
  * first_response_pdu structure below.
+ *
+ * Waiting for each confirmation before sending the next block adds the USB
+ * round trip and the flash programming time of every block. With
+ * CONFIG_UPDATE_WINDOW, the host can instead send
+ * UPDATE_EXTRA_CMD_SET_WINDOW before the connection establishment PDU, and
+ * get the number of blocks it may send ahead of their confirmations in
+ * struct update_window_response. For the rest of that transfer:
+ *
+ * - The block_digest field of each PDU carries a sequence number instead of
+ *   a digest, echoed back in the confirmation.
+ * - Blocks are confirmed with a struct update_block_ack, in order, once
+ *   programmed. The EC programs blocks while the next ones come in.
+ * - Blocks which already match the flash contents are not programmed, and
+ *   the target section is erased bank by bank as needed rather than all at
+ *   once. The host therefore sends the whole section, 0xff padding included.
+ * - When a block needs to erase a bank whose beginning was in earlier,
+ *   skipped blocks, the EC erases it, drops the block, and asks the host to
+ *   send again from the start of the bank (UPDATE_BLOCK_REWIND). Blocks
+ *   already in flight are dropped too (UPDATE_BLOCK_DISCARDED) until the
+ *   block at that offset arrives.
+ *
+ * Targets without CONFIG_UPDATE_WINDOW reply to UPDATE_EXTRA_CMD_SET_WINDOW
+ * with a single EC_RES_INVALID_COMMAND byte, and the host falls back to one
+ * block at a time.
  */
 
 #define UPDATE_PROTOCOL_VERSION 6
@@ -169,8 +194,35 @@ enum update_extra_command {
 	UPDATE_EXTRA_CMD_TOUCHPAD_DEBUG = 8,
 	UPDATE_EXTRA_CMD_CONSOLE_READ_INIT = 9,
 	UPDATE_EXTRA_CMD_CONSOLE_READ_NEXT = 10,
+	UPDATE_EXTRA_CMD_SET_WINDOW = 11,
+};
+
+/* Response to UPDATE_EXTRA_CMD_SET_WINDOW, which takes a 1 byte window */
+struct update_window_response {
+	uint8_t status; /* = EC_RES_SUCCESS */
+	uint8_t window; /* Blocks the host may send ahead, at least 1 */
+} __packed;
+
+/* What happened to a block of a windowed transfer */
+enum update_block_status {
+	UPDATE_BLOCK_WRITTEN = 0,
+	/* The flash already held the contents of the block */
+	UPDATE_BLOCK_SKIPPED = 1,
+	/* Dropped while waiting for the block at resume_offset */
+	UPDATE_BLOCK_DISCARDED = 2,
+	/* Dropped, send again from resume_offset */
+	UPDATE_BLOCK_REWIND = 3,
 };
 
+/* Confirmation of a block of a windowed transfer */
+struct update_block_ack {
+	uint32_t seq; /* block_digest of the PDU, as received */
+	uint8_t return_value; /* UPDATE_SUCCESS or error */
+	uint8_t status; /* enum update_block_status */
+	uint16_t reserved;
+	uint32_t resume_offset; /* Big endian, for UPDATE_BLOCK_REWIND */
+} __packed;
+
 /*
  * Pair challenge (from host), note that the packet, with header, must fit
  * in a single USB packet (64 bytes), so its maximum length is 50 bytes.
@@ -244,6 +296,42 @@ void fw_update_complete(void);
 /* Verify integrity of the PDU received. */
 int update_pdu_valid(struct update_command *cmd_body, size_t cmd_size);
 
+/**
+ * Start a windowed transfer, see UPDATE_EXTRA_CMD_SET_WINDOW.
+ *
+ * @param window Blocks the host asks to send ahead
+ * @return Blocks the host may send ahead, up to CONFIG_UPDATE_WINDOW_BLOCKS
+ */
+int fw_update_window_open(int window);
+
+/* End the windowed transfer, dropping blocks not programmed yet */
+void fw_update_window_close(void);
+
+/* Return true during a windowed transfer */
+bool fw_update_window_is_open(void);
+
+/**
+ * Get the buffer to receive the next block of a windowed transfer into,
+ * starting with its struct update_command.
+ *
+ * @return Buffer of sizeof(struct update_command) + CONFIG_UPDATE_PDU_SIZE
+ *         bytes, or NULL if the host sent more blocks than the window.
+ */
+void *fw_update_window_get_buffer(void);
+
+/**
+ * Queue the block received into the last buffer for programming.
+ *
+ * @param cmd_size Size of the block, including its struct update_command
+ */
+void fw_update_window_submit(size_t cmd_size);
+
+/**
+ * Send the confirmation of a block of a windowed transfer to the host.
+ * Provided by the transport, called from the hook task.
+ */
+void fw_update_window_ack(const struct update_block_ack *ack);
+
 /* Various update command return values. */
 enum {
 	UPDATE_SUCCESS = 0,
@@ -2012,6 +2012,31 @@ void dfp_consume_svids(int port, enum tcpci_msg_type type, int cnt,
 void dfp_consume_modes(int port, enum tcpci_msg_type type, int cnt,
 		       uint32_t *payload);
 
+/**
+ * Save completed SVID and mode discovery of a port partner or cable in the
+ * discovery cache, keyed by its Discover Identity response. Incomplete or
+ * failed discovery is not saved.
+ *
+ * @param port    USB-C port number
+ * @param type    Transmit type (SOP, SOP') of the discovered partner
+ */
+void pd_discovery_cache_store(int port, enum tcpci_msg_type type);
+
+/**
+ * Look up the Discover Identity response just consumed in the discovery
+ * cache and, on a hit, restore SVID and mode discovery from it as complete.
+ *
+ * @param port    USB-C port number
+ * @param type    Transmit type (SOP, SOP') of the discovered partner
+ * @return        True if discovery was restored, with nothing left to discover
+ */
+bool pd_discovery_cache_restore(int port, enum tcpci_msg_type type);
+
+/**
+ * Forget all partners and cables in the discovery cache
+ */
+void pd_discovery_cache_clear(void);
+
 /**
  * Returns true if connected VPD supports Charge Through
  *
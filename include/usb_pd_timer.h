@@ -320,8 +320,9 @@ bool pd_timer_is_expired(int port, enum pd_task_timer timer);
  * part of the pd_timer_next_expiration decision.
  *
  * @param port USB-C port number
+ * @return Bitmask of BIT(enum pd_timer_range) with newly expired timers
  */
-void pd_timer_manage_expired(int port);
+uint32_t pd_timer_manage_expired(int port);
 
 /*
  * pd_timer_next_expiration
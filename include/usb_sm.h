@@ -8,7 +8,9 @@
 #ifndef __CROS_EC_USB_SM_H
 #define __CROS_EC_USB_SM_H
 
+#include "common.h"
 #include "compiler.h" /* for typeof() on Zephyr */
+#include "ec_commands.h"
 
 /* Function pointer that implements a portion of a usb state */
 typedef void (*state_execution)(const int port);
@@ -90,6 +92,86 @@ void set_state(int port, struct sm_ctx *ctx, usb_state_ptr new_state);
  */
 void run_state(int port, struct sm_ctx *ctx);
 
+/*
+ * State machines that the USB-C port task skips on wakeups that bring them
+ * no new input, with CONFIG_USBC_SM_SKIP_IDLE. The Type-C and Device Policy
+ * Manager layers poll hardware and other modules, so they always run.
+ */
+enum usbc_sm {
+	USBC_SM_PE,
+	USBC_SM_PRL,
+	USBC_SM_COUNT
+};
+
+#define USBC_SM_ALL (BIT(USBC_SM_COUNT) - 1)
+
+/**
+ * Note new input for state machines of a port, so that the port task runs
+ * them on its next iteration.
+ *
+ * @param port USB-C port number
+ * @param sms  Bitmask of BIT(enum usbc_sm)
+ */
+void usbc_sm_set_pending(int port, uint32_t sms);
+
+/* Same as above, and compiled out without CONFIG_USBC_SM_SKIP_IDLE */
+static inline void usbc_sm_mark_pending(int port, uint32_t sms)
+{
+	if (IS_ENABLED(CONFIG_USBC_SM_SKIP_IDLE))
+		usbc_sm_set_pending(port, sms);
+}
+
+/* State machine loop statistics of a port, for CONFIG_USBC_SM_SKIP_IDLE */
+struct usbc_sm_stats {
+	/* Iterations of the port task loop */
+	uint32_t wakeups;
+	/* Gated state machines run, and skipped */
+	uint32_t runs;
+	uint32_t skipped;
+	/* State run functions called, including parents, by run_state() */
+	uint32_t run_calls;
+};
+
+/**
+ * Get the state machine loop statistics of a port.
+ *
+ * @param port  USB-C port number
+ * @param stats [OUT] Counters since the last reset
+ */
+void usbc_sm_get_stats(int port, struct usbc_sm_stats *stats);
+
+/* Reset the state machine loop statistics of a port */
+void usbc_sm_reset_stats(int port);
+
+/* Count the run functions called by run_state(), for usbc_sm_get_stats() */
+uint32_t usb_sm_get_run_calls(int port);
+
+/**
+ * Register the states of a state machine with the transition trace, so that
+ * set_state() can tell which machine and state a transition is about.
+ *
+ * @param machine     State machine the states belong to
+ * @param states      State table of the machine
+ * @param count       Number of states in the table
+ * @param names       Names of the states, NULL entries when compiled out
+ * @param names_count Number of names
+ */
+void usb_sm_trace_register(enum ec_pd_sm machine,
+			   const struct usb_state *states, int count,
+			   const char *const *names, int names_count);
+
+/**
+ * Note the task events that woke up the port task, for the transitions
+ * that follow.
+ *
+ * @param port  USB-C port number
+ * @param event Task events of this iteration of the port task
+ */
+void usb_sm_trace_set_event(int port, uint32_t event);
+
+/* Add a transition to the trace of a port, called by set_state() */
+void usb_sm_trace_record(int port, usb_state_ptr from, usb_state_ptr to);
+
 #ifdef TEST_BUILD
 /*
  * Struct for test builds that allow unit tests to easily iterate through
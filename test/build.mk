@@ -52,11 +52,14 @@ test-list-host += fpsensor_auth_commands
 test-list-host += fpsensor_auth_crypto_stateful
 test-list-host += fpsensor_auth_crypto_stateless
 test-list-host += fpsensor_crypto
+test-list-host += fpsensor_frame_codec
 test-list-host += fpsensor_state
+test-list-host += fpsensor_template_load
 test-list-host += gettimeofday
 test-list-host += gyro_cal
 test-list-host += hooks
 test-list-host += host_command
+test-list-host += host_socket
 test-list-host += i2c_bitbang
 test-list-host += inductive_charging
 # This test times out in the CQ, and generally doesn't seem useful.
@@ -70,6 +73,7 @@ test-list-host += is_enabled_error
 endif
 test-list-host += kasa
 test-list-host += kb_8042
+test-list-host += kb_8042_fast
 test-list-host += kb_mkbp
 test-list-host += kb_scan
 test-list-host += kb_scan_strict
@@ -109,14 +113,17 @@ test-list-host += static_if_error
 # toolchain's C standard library.
 test-list-host += stdlib
 test-list-host += std_vector
+test-list-host += sysjump_warm_state
 test-list-host += system
 test-list-host += tablet_broken_sensor
 test-list-host += tablet_no_sensor
 test-list-host += thermal
 test-list-host += timer
 test-list-host += timer_dos
+test-list-host += update_fw_window
 test-list-host += uptime
 test-list-host += usb_common
+test-list-host += usb_mux
 test-list-host += usb_pd_int
 test-list-host += usb_pd
 test-list-host += usb_pd_console
@@ -124,6 +131,8 @@ test-list-host += usb_pd_giveback
 test-list-host += usb_pd_rev30
 test-list-host += usb_pd_pdo_fixed
 test-list-host += usb_pd_timer
+test-list-host += usb_pd_discovery_cache
+test-list-host += usb_pd_sm_trace
 test-list-host += usb_ppc
 test-list-host += usb_sm_framework_h3
 test-list-host += usb_sm_framework_h2
@@ -134,6 +143,7 @@ test-list-host += usb_typec_ctvpd
 test-list-host += usb_typec_drp_acc_trysrc
 test-list-host += usb_prl_old
 test-list-host += usb_tcpmv2_compliance
+test-list-host += usb_tcpmv2_compliance_skip_idle
 test-list-host += usb_prl
 test-list-host += usb_prl_noextended
 test-list-host += usb_pe_drp_old
@@ -146,6 +156,7 @@ test-list-host += vboot
 test-list-host += version
 test-list-host += x25519
 test-list-host += stillness_detector
+test-list-host += streaming_stats
 -include private/test/build.mk
 endif
 
@@ -162,6 +173,8 @@ cov-dont-test += fpsensor
 cov-dont-test += fpsensor_crypto
 # fpsensor_state: genhtml looks for build/host/fpsensor_state/cryptoc/util.c
 cov-dont-test += fpsensor_state
+# fpsensor_template_load: genhtml looks for build/host/fpsensor_template_load/cryptoc/util.c
+cov-dont-test += fpsensor_template_load
 # version: Only works in a chroot.
 cov-dont-test += version
 # interrupt: The test often times out if enabled for coverage.
@@ -213,20 +226,24 @@ fpsensor_auth_commands-y=fpsensor_auth_commands.o
 fpsensor_auth_crypto_stateful-y=fpsensor_auth_crypto_stateful.o
 fpsensor_auth_crypto_stateless-y=fpsensor_auth_crypto_stateless.o
 fpsensor_crypto-y=fpsensor_crypto.o
+fpsensor_frame_codec-y=fpsensor_frame_codec.o
 fpsensor_hw-rw=fpsensor_hw.o
 fpsensor_state-y=fpsensor_state.o
+fpsensor_template_load-y=fpsensor_template_load.o
 ftrapv-y=ftrapv.o
 gettimeofday-y=gettimeofday.o
 global_initialization-y=global_initialization.o
 gyro_cal-y=gyro_cal.o gyro_cal_init_for_test.o
 hooks-y=hooks.o
 host_command-y=host_command.o
+host_socket-y=host_socket.o comm-socket.o comm-host.o misc_util.o
 i2c_bitbang-y=i2c_bitbang.o
 inductive_charging-y=inductive_charging.o
 interrupt-y=interrupt.o
 irq_locking-y=irq_locking.o
 is_enabled-y=is_enabled.o
 kb_8042-y=kb_8042.o
+kb_8042_fast-y=kb_8042.o
 kb_mkbp-y=kb_mkbp.o
 kb_scan-y=kb_scan.o
 kb_scan_strict-y=kb_scan.o
@@ -277,6 +294,7 @@ stdlib-y=stdlib.o
 std_vector-y=std_vector.o
 stm32f_rtc-y=stm32f_rtc.o
 stress-y=stress.o
+sysjump_warm_state-y=sysjump_warm_state.o
 system-y=system.o
 system_is_locked-y=system_is_locked.o
 tablet_broken_sensor-y=tablet_broken_sensor.o
@@ -286,8 +304,10 @@ timer_calib-y=timer_calib.o
 timer_dos-y=timer_dos.o
 timer-y=timer.o
 tpm_seed_clear-y=tpm_seed_clear.o
+update_fw_window-y=update_fw_window.o
 uptime-y=uptime.o
 usb_common-y=usb_common_test.o fake_battery.o
+usb_mux-y=usb_mux.o
 usb_pd_int-y=usb_pd_int.o
 usb_pd-y=usb_pd.o
 usb_pd_console-y=usb_pd_console.o
@@ -327,6 +347,10 @@ usb_tcpmv2_compliance-y=usb_tcpmv2_compliance.o usb_tcpmv2_compliance_common.o \
 	usb_tcpmv2_td_pd_snk3_e12.o \
 	usb_tcpmv2_td_pd_vndi3_e3.o \
 	usb_tcpmv2_td_pd_other.o
+usb_tcpmv2_compliance_skip_idle-y=$(usb_tcpmv2_compliance-y)
+usb_pd_discovery_cache-y=usb_pd_discovery_cache.o \
+	usb_tcpmv2_compliance_common.o
+usb_pd_sm_trace-y=usb_pd_sm_trace.o usb_tcpmv2_compliance_common.o
 utils-y=utils.o
 utils_str-y=utils_str.o
 vboot-y=vboot.o
@@ -335,6 +359,7 @@ float-y=fp.o
 fp-y=fp.o
 x25519-y=x25519.o
 stillness_detector-y=stillness_detector.o
+streaming_stats-y=streaming_stats.o
 
 host-is_enabled_error: TEST_SCRIPT=is_enabled_error.sh
 is_enabled_error-y=is_enabled_error.o.cmd
@@ -349,3 +374,13 @@ run-genvif_test:
 # This test requires C++ exceptions to be enabled.
 $(out)/RW/test/exception.o: CXXFLAGS+=-fexceptions
 $(out)/RO/test/exception.o: CXXFLAGS+=-fexceptions
+
+# host_socket links ectool's host side and needs its util/ headers.
+$(out)/RW/test/host_socket.o: CFLAGS+=-Iutil
+$(out)/RO/test/host_socket.o: CFLAGS+=-Iutil
+$(out)/RW/test/comm-socket.o: CFLAGS+=-Iutil
+$(out)/RO/test/comm-socket.o: CFLAGS+=-Iutil
+$(out)/RW/test/comm-host.o: CFLAGS+=-Iutil
+$(out)/RO/test/comm-host.o: CFLAGS+=-Iutil
+$(out)/RW/test/misc_util.o: CFLAGS+=-Iutil
+$(out)/RO/test/misc_util.o: CFLAGS+=-Iutil
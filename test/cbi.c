@@ -15,6 +15,19 @@
 #include "util.h"
 #include "write_protect.h"
 
+/* EEPROM transactions; a read is one, each page written is two */
+static int eeprom_xfers;
+
+void i2c_start_xfer_notify(const int port, const uint16_t addr_flags)
+{
+	if (port == I2C_PORT_EEPROM && addr_flags == I2C_ADDR_EEPROM_FLAGS)
+		eeprom_xfers++;
+}
+
+void i2c_end_xfer_notify(const int port, const uint16_t addr_flags)
+{
+}
+
 static void test_setup(void)
 {
 	/* Make sure that write protect is disabled */
@@ -272,6 +285,133 @@ DECLARE_EC_TEST(test_bad_crc)
 	return EC_SUCCESS;
 }
 
+static int populate_boot_tags(void)
+{
+	uint32_t d32 = 0x12345678;
+
+	/* A typical factory image, with the tags queried at boot last */
+	zassert_equal(cbi_set_board_info(CBI_TAG_BOARD_VERSION, (void *)&d32,
+					 sizeof(d32)),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_OEM_ID, (void *)&d32, 1),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_DRAM_PART_NUM,
+					 "0123456789abcdefghij", 21),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_OEM_NAME, "oem", 4),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_MODEL_ID, (void *)&d32, 1),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_SKU_ID, (void *)&d32,
+					 sizeof(d32)),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_FW_CONFIG, (void *)&d32,
+					 sizeof(d32)),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(CBI_TAG_SSFC, (void *)&d32,
+					 sizeof(d32)),
+		      EC_SUCCESS);
+
+	return EC_SUCCESS;
+}
+
+DECLARE_EC_TEST(test_boot_access_count)
+{
+	uint32_t sku, fw_config, ssfc, board_version;
+	int i;
+
+	zassert_equal(populate_boot_tags(), EC_SUCCESS);
+	/* Updates the CRC and writes the image out */
+	zassert_equal(cbi_set_fw_config(0x12345678), EC_SUCCESS);
+
+	/* Cold boot: every board init step asks for its own fields */
+	cbi_invalidate_cache();
+	eeprom_xfers = 0;
+	for (i = 0; i < 32; i++) {
+		zassert_equal(cbi_get_board_version(&board_version),
+			      EC_SUCCESS);
+		zassert_equal(cbi_get_sku_id(&sku), EC_SUCCESS);
+		zassert_equal(cbi_get_fw_config(&fw_config), EC_SUCCESS);
+		zassert_equal(cbi_get_ssfc(&ssfc), EC_SUCCESS);
+	}
+	zassert_equal(sku, 0x12345678);
+	zassert_equal(fw_config, 0x12345678);
+	zassert_equal(ssfc, 0x12345678);
+
+	/* The image is read once for all the lookups: header, then body */
+	zassert_true(eeprom_xfers < 4 * i);
+	zassert_equal(eeprom_xfers, 2);
+
+	return EC_SUCCESS;
+}
+
+static int set_cbi(enum cbi_data_tag tag, uint32_t value)
+{
+	struct {
+		struct ec_params_set_cbi p;
+		uint32_t value;
+	} params = {
+		.p = { .tag = tag, .size = sizeof(value) },
+		.value = value,
+	};
+
+	return test_send_host_command(EC_CMD_SET_CROS_BOARD_INFO, 0, &params,
+				      sizeof(params), NULL, 0);
+}
+
+DECLARE_EC_TEST(test_partial_write)
+{
+	struct cbi_header h;
+	uint32_t d32;
+	uint8_t d8 = 0xa5;
+	uint8_t size;
+	int full_pages;
+
+	zassert_equal(populate_boot_tags(), EC_SUCCESS);
+
+	/* A new image is written out in full */
+	eeprom_xfers = 0;
+	zassert_equal(set_cbi(CBI_TAG_SSFC, 0x12345678), EC_RES_SUCCESS);
+	full_pages = eeprom_xfers / 2;
+	zassert_equal(cbi_config.drv->load(0, (uint8_t *)&h, sizeof(h)),
+		      EC_SUCCESS);
+	zassert_equal(full_pages, (h.total_size + 7) / 8);
+
+	/* Change one byte of FW_CONFIG: its page, then the header's */
+	eeprom_xfers = 0;
+	zassert_equal(set_cbi(CBI_TAG_FW_CONFIG, 0x12345679), EC_RES_SUCCESS);
+	zassert_true(eeprom_xfers / 2 < full_pages);
+	zassert_equal(eeprom_xfers / 2, 2);
+
+	/* Writing the same value again only rewrites the header */
+	eeprom_xfers = 0;
+	zassert_equal(set_cbi(CBI_TAG_FW_CONFIG, 0x12345679), EC_RES_SUCCESS);
+	zassert_equal(eeprom_xfers / 2, 1);
+
+	/* Growing an item moves everything after it; add a new one too */
+	d32 = 0x12345679;
+	zassert_equal(cbi_set_board_info(CBI_TAG_OEM_ID, (void *)&d32,
+					 sizeof(d32)),
+		      EC_SUCCESS);
+	zassert_equal(cbi_set_board_info(0xff, &d8, sizeof(d8)), EC_SUCCESS);
+	zassert_equal(set_cbi(CBI_TAG_SKU_ID, 0x1234567a), EC_RES_SUCCESS);
+
+	/* What was written must read back as a valid image */
+	cbi_invalidate_cache();
+	zassert_equal(cbi_get_oem_id(&d32), EC_SUCCESS);
+	zassert_equal(d32, 0x12345679);
+	zassert_equal(cbi_get_fw_config(&d32), EC_SUCCESS);
+	zassert_equal(d32, 0x12345679);
+	zassert_equal(cbi_get_sku_id(&d32), EC_SUCCESS);
+	zassert_equal(d32, 0x1234567a);
+	size = sizeof(d8);
+	d8 = 0;
+	zassert_equal(cbi_get_board_info(0xff, &d8, &size), EC_SUCCESS);
+	zassert_equal(d8, 0xa5);
+
+	return EC_SUCCESS;
+}
+
 TEST_SUITE(test_suite_cbi)
 {
 	ztest_test_suite(
@@ -289,6 +429,10 @@ TEST_SUITE(test_suite_cbi)
 		ztest_unit_test_setup_teardown(test_all_tags, test_setup,
 					       test_teardown),
 		ztest_unit_test_setup_teardown(test_bad_crc, test_setup,
+					       test_teardown),
+		ztest_unit_test_setup_teardown(test_boot_access_count,
+					       test_setup, test_teardown),
+		ztest_unit_test_setup_teardown(test_partial_write, test_setup,
 					       test_teardown));
 	ztest_run_test_suite(test_cbi);
 }
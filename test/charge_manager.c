@@ -28,16 +28,23 @@ BUILD_ASSERT((int)CHARGE_SUPPLIER_COUNT == (int)CHARGE_SUPPLIER_TEST_COUNT);
 BUILD_ASSERT(ARRAY_SIZE(supplier_priority) == CHARGE_SUPPLIER_COUNT);
 
 static unsigned int active_charge_limit = CHARGE_SUPPLIER_NONE;
+static int active_charge_supplier = CHARGE_SUPPLIER_NONE;
 static unsigned int active_charge_port = CHARGE_PORT_NONE;
 static unsigned int charge_port_to_reject = CHARGE_PORT_NONE;
 static int new_power_request[CONFIG_USB_PD_PORT_MAX_COUNT];
 static enum pd_power_role power_role[CONFIG_USB_PD_PORT_MAX_COUNT];
 
+/* Charger and port switch updates, which cost I2C writes on boards */
+static int charge_limit_writes;
+static int active_port_writes;
+
 /* Callback functions called by CM on state change */
 __override void board_set_charge_limit(int port, int supplier, int charge_ma,
 				       int max_ma, int charge_mv)
 {
 	active_charge_limit = charge_ma;
+	active_charge_supplier = supplier;
+	charge_limit_writes++;
 }
 
 __override uint8_t board_get_usb_pd_port_count(void)
@@ -58,6 +65,7 @@ int board_set_active_charge_port(int charge_port)
 		return EC_ERROR_INVAL;
 
 	active_charge_port = charge_port;
+	active_port_writes++;
 	return EC_SUCCESS;
 }
 
@@ -267,6 +275,26 @@ static int test_priority(void)
 	TEST_ASSERT(active_charge_port == 1);
 	TEST_ASSERT(active_charge_limit == 3000);
 
+	/*
+	 * Add a tied charge from an earlier supplier on the active port,
+	 * verify that the later supplier on the active port stays selected.
+	 */
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST5, 1, &charge);
+	wait_for_charge_manager_refresh();
+	TEST_ASSERT(active_charge_port == 1);
+	TEST_ASSERT(active_charge_supplier == CHARGE_SUPPLIER_TEST6);
+
+	/*
+	 * Remove it, verify that the earlier supplier on the active port is
+	 * preferred to the tied charge on the other port.
+	 */
+	charge.current = 0;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST6, 1, &charge);
+	wait_for_charge_manager_refresh();
+	TEST_ASSERT(active_charge_port == 1);
+	TEST_ASSERT(active_charge_supplier == CHARGE_SUPPLIER_TEST5);
+	TEST_ASSERT(active_charge_limit == 3000);
+
 	return EC_SUCCESS;
 }
 
@@ -782,6 +810,83 @@ static int test_unknown_dualrole_capability(void)
 	return EC_SUCCESS;
 }
 
+/* Report BC1.2, Type-C and PD charge on a port, the way an attach does */
+static void attach_charger(int port, int gap_ms)
+{
+	struct charge_port_info charge = { .current = 500, .voltage = 5000 };
+
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST6, port, &charge);
+	if (gap_ms)
+		msleep(gap_ms);
+	charge.current = 1500;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST4, port, &charge);
+	if (gap_ms)
+		msleep(gap_ms);
+	charge.current = 3000;
+	charge.voltage = 20000;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST2, port, &charge);
+	wait_for_charge_manager_refresh();
+}
+
+static int test_refresh_coalescing(void)
+{
+	struct charge_manager_refresh_stats stats;
+	struct charge_port_info charge = { .current = 3000, .voltage = 20000 };
+
+	/* Updates spread out over the attach each get a refresh */
+	initialize_charge_table(0, 5000, 5000);
+	charge_manager_get_refresh_stats(&stats);
+	charge_limit_writes = 0;
+	active_port_writes = 0;
+	attach_charger(0, 2 * CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS);
+	TEST_EQ(active_charge_port, 0, "%d");
+	TEST_EQ(active_charge_limit, 3000, "%d");
+	charge_manager_get_refresh_stats(&stats);
+	TEST_EQ(stats.refreshes, 3, "%u");
+	TEST_EQ(charge_limit_writes, 3, "%d");
+	TEST_EQ(active_port_writes, 3, "%d");
+
+	/* Updates that come together share one refresh */
+	initialize_charge_table(0, 5000, 5000);
+	charge_manager_get_refresh_stats(&stats);
+	charge_limit_writes = 0;
+	active_port_writes = 0;
+	attach_charger(0, 0);
+	TEST_EQ(active_charge_port, 0, "%d");
+	TEST_EQ(active_charge_limit, 3000, "%d");
+	charge_manager_get_refresh_stats(&stats);
+	TEST_EQ(stats.refreshes, 1, "%u");
+	TEST_EQ(stats.selections, 1, "%u");
+	TEST_EQ(charge_limit_writes, 1, "%d");
+	TEST_EQ(active_port_writes, 1, "%d");
+
+	/* A ceiling change on the charge port doesn't select it again */
+	charge_manager_set_ceil(0, CEIL_REQUESTOR_PD, 1000);
+	wait_for_charge_manager_refresh();
+	TEST_EQ(active_charge_limit, 1000, "%d");
+	charge_manager_get_refresh_stats(&stats);
+	TEST_EQ(stats.refreshes, 1, "%u");
+	TEST_EQ(stats.selections, 0, "%u");
+	TEST_EQ(active_port_writes, 1, "%d");
+
+	/*
+	 * A charge change on another port that can't win selects again, but
+	 * keeps the port, so the port switch isn't written.
+	 */
+	charge.current = 500;
+	charge.voltage = 5000;
+	charge_manager_update_charge(CHARGE_SUPPLIER_TEST7, 1, &charge);
+	wait_for_charge_manager_refresh();
+	TEST_EQ(active_charge_port, 0, "%d");
+	charge_manager_get_refresh_stats(&stats);
+	TEST_EQ(stats.refreshes, 1, "%u");
+	TEST_EQ(stats.selections, 1, "%u");
+	TEST_EQ(charge_limit_writes, 2, "%d");
+	TEST_EQ(active_port_writes, 1, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, const char **argv)
 {
 	test_reset();
@@ -795,6 +900,7 @@ void run_test(int argc, const char **argv)
 	RUN_TEST(test_dual_role);
 	RUN_TEST(test_rejected_port);
 	RUN_TEST(test_unknown_dualrole_capability);
+	RUN_TEST(test_refresh_coalescing);
 
 	/* Some handlers are still running after the test ends. */
 	sleep(2);
@@ -0,0 +1 @@
+../util/comm-host.cc
\ No newline at end of file
@@ -0,0 +1 @@
+../util/comm-socket.cc
\ No newline at end of file
@@ -5,6 +5,7 @@
 
 #include "compile_time_macros.h"
 #include "fpsensor_crypto.h"
+#include "fpsensor_crypto_backend.h"
 #include "fpsensor_state.h"
 
 extern "C" {
@@ -755,8 +756,103 @@ test_static int test_command_read_match_secret_unreadable(void)
 	return EC_SUCCESS;
 }
 
+test_static int test_crypto_backend_selection(void)
+{
+	/* No crypto peripherals on host. */
+	TEST_ASSERT(fp_crypto_backend() == &fp_crypto_software);
+	return EC_SUCCESS;
+}
+
+test_static int test_aes_gcm(void)
+{
+	uint8_t key[SBP_ENC_KEY_LEN];
+	uint8_t nonce[FP_CONTEXT_NONCE_BYTES];
+	uint8_t tag[FP_CONTEXT_TAG_BYTES];
+	uint8_t plaintext[37];
+	uint8_t data[sizeof(plaintext)];
+
+	memset(key, 0x5a, sizeof(key));
+	memset(nonce, 0x11, sizeof(nonce));
+	for (size_t i = 0; i < sizeof(plaintext); i++)
+		plaintext[i] = i;
+
+	/* Encrypt in place, then decrypt. */
+	memcpy(data, plaintext, sizeof(data));
+	TEST_ASSERT(aes_gcm_encrypt(key, sizeof(key), data, data, sizeof(data),
+				    nonce, sizeof(nonce), tag,
+				    sizeof(tag)) == EC_SUCCESS);
+	TEST_ASSERT(memcmp(data, plaintext, sizeof(data)) != 0);
+	TEST_ASSERT(aes_gcm_decrypt(key, sizeof(key), data, data, sizeof(data),
+				    nonce, sizeof(nonce), tag,
+				    sizeof(tag)) == EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(data, plaintext, sizeof(data));
+
+	/* A tag that doesn't match is rejected. */
+	TEST_ASSERT(aes_gcm_encrypt(key, sizeof(key), plaintext, data,
+				    sizeof(data), nonce, sizeof(nonce), tag,
+				    sizeof(tag)) == EC_SUCCESS);
+	tag[3] ^= 0x80;
+	TEST_ASSERT(aes_gcm_decrypt(key, sizeof(key), data, data, sizeof(data),
+				    nonce, sizeof(nonce), tag,
+				    sizeof(tag)) == EC_ERROR_UNKNOWN);
+
+	/* So is a nonce of the wrong size. */
+	TEST_ASSERT(aes_gcm_encrypt(key, sizeof(key), plaintext, data,
+				    sizeof(data), nonce, sizeof(nonce) - 1, tag,
+				    sizeof(tag)) == EC_ERROR_INVAL);
+	return EC_SUCCESS;
+}
+
+test_static int test_crypto_backend_aes_ctr(void)
+{
+	const struct fp_crypto_backend *backend = fp_crypto_backend();
+	uint8_t key[32];
+	uint8_t iv[16];
+	uint8_t plaintext[37];
+	uint8_t data[sizeof(plaintext)];
+
+	memset(key, 0xa5, sizeof(key));
+	/* The counter carries over its low 32 bits. */
+	memset(iv, 0xff, sizeof(iv));
+	for (size_t i = 0; i < sizeof(plaintext); i++)
+		plaintext[i] = i;
+
+	memcpy(data, plaintext, sizeof(data));
+	TEST_ASSERT(backend->aes_ctr(key, iv, data, sizeof(data)) ==
+		    EC_SUCCESS);
+	TEST_ASSERT(memcmp(data, plaintext, sizeof(data)) != 0);
+	TEST_ASSERT(backend->aes_ctr(key, iv, data, sizeof(data)) ==
+		    EC_SUCCESS);
+	TEST_ASSERT_ARRAY_EQ(data, plaintext, sizeof(data));
+	return EC_SUCCESS;
+}
+
+test_static int test_crypto_backend_hmac_sha256(void)
+{
+	/* RFC 4231, test case 2 */
+	static const char key[] = "Jefe";
+	static const char message[] = "what do ya want for nothing?";
+	static const uint8_t expected[SHA256_DIGEST_SIZE] = {
+		0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e,
+		0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+		0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83,
+		0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43,
+	};
+	uint8_t mac[SHA256_DIGEST_SIZE];
+
+	fp_crypto_backend()->hmac_sha256(mac, (const uint8_t *)key,
+					 strlen(key), (const uint8_t *)message,
+					 strlen(message));
+	TEST_ASSERT_ARRAY_EQ(mac, expected, sizeof(expected));
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, const char **argv)
 {
+	RUN_TEST(test_crypto_backend_selection);
+	RUN_TEST(test_aes_gcm);
+	RUN_TEST(test_crypto_backend_aes_ctr);
+	RUN_TEST(test_crypto_backend_hmac_sha256);
 	RUN_TEST(test_hkdf_expand);
 	RUN_TEST(test_derive_encryption_key_failure_seed_not_set);
 	RUN_TEST(test_derive_positive_match_secret_fail_seed_not_set);
@@ -0,0 +1,195 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "fpsensor_frame_codec.h"
+#include "test_util.h"
+#include "util.h"
+
+/* Raw frame of an FPC1025: a header, then 160x160 pixels of 8 bits. */
+#define FRAME_HEADER 400
+#define FRAME_WIDTH 160
+#define FRAME_HEIGHT 160
+#define FRAME_SIZE (FRAME_HEADER + FRAME_WIDTH * FRAME_HEIGHT * 2)
+
+/* Largest EC_CMD_FP_FRAME response over SPI, see the fpsensor test. */
+#define RESPONSE_MAX (544 - sizeof(struct ec_host_response))
+#define CHUNK_MAX (RESPONSE_MAX - sizeof(struct ec_response_fp_frame_packed))
+
+static uint8_t frame[FRAME_SIZE];
+static uint8_t unpacked[FRAME_SIZE];
+
+/*
+ * A finger covering the middle of the sensor: ridges about 10 pixels apart,
+ * curving across it, with some noise. The edges only see the background.
+ */
+static void make_frame(size_t size, int sample_bits)
+{
+	const int bytes = sample_bits / 8;
+	const uint32_t top = BIT(sample_bits) - 1;
+	size_t i;
+
+	for (i = 0; i < FRAME_HEADER; i++)
+		frame[i] = i < 32 ? i : 0;
+
+	for (i = 0; FRAME_HEADER + (i + 1) * bytes <= size; i++) {
+		int x = i % FRAME_WIDTH - FRAME_WIDTH / 2;
+		int y = i / FRAME_WIDTH - FRAME_HEIGHT / 2;
+		int phase = (x * 2 + y + x * y / 64 + 1000) % 20;
+		uint32_t ridge = phase < 10 ? phase : 20 - phase;
+		uint32_t pixel = top - top / 8;
+
+		if (x * x + y * y / 2 < 60 * 60)
+			pixel = top / 4 + ridge * (top / 2) / 10;
+		pixel += prng_no_seed() % 7;
+
+		frame[FRAME_HEADER + i * bytes] = pixel;
+		if (bytes == 2)
+			frame[FRAME_HEADER + i * bytes + 1] = pixel >> 8;
+	}
+}
+
+/* Move a frame across as ectool does, counting the commands it takes. */
+static enum ec_error_list transfer(size_t size, int sample_bits,
+				   size_t chunk_max, int *commands,
+				   size_t *bytes)
+{
+	uint8_t chunk[CHUNK_MAX];
+	size_t offset = 0;
+
+	*commands = 0;
+	*bytes = 0;
+	memset(unpacked, 0xAA, sizeof(unpacked));
+	while (offset < size) {
+		size_t packed;
+		size_t len = fp_frame_pack(frame, size, offset, sample_bits,
+					   chunk, chunk_max, &packed);
+
+		if (!packed)
+			return EC_ERROR_OVERFLOW;
+		if (fp_frame_unpack(chunk, len, sample_bits, unpacked, offset,
+				    packed) != EC_SUCCESS)
+			return EC_ERROR_INVAL;
+		offset += packed;
+		*bytes += len + sizeof(struct ec_response_fp_frame_packed);
+		(*commands)++;
+	}
+	return memcmp(frame, unpacked, size) ? EC_ERROR_UNKNOWN : EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_frame_8bit(void)
+{
+	const size_t size = FRAME_HEADER + FRAME_WIDTH * FRAME_HEIGHT;
+	const int raw_commands = DIV_ROUND_UP(size, RESPONSE_MAX);
+	size_t bytes;
+	int commands;
+
+	make_frame(size, 8);
+	TEST_EQ(transfer(size, 8, CHUNK_MAX, &commands, &bytes), EC_SUCCESS,
+		"%d");
+
+	ccprintf("8 bit frame of %zu bytes: %d commands copied, %d packed "
+		 "in %zu bytes\n",
+		 size, raw_commands, commands, bytes);
+	TEST_LT(commands, raw_commands, "%d");
+	TEST_LT(bytes, size, "%zu");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_frame_16bit(void)
+{
+	const size_t size = FRAME_HEADER + FRAME_WIDTH * FRAME_HEIGHT * 2;
+	const int raw_commands = DIV_ROUND_UP(size, RESPONSE_MAX);
+	size_t bytes;
+	int commands;
+
+	make_frame(size, 16);
+	TEST_EQ(transfer(size, 16, CHUNK_MAX, &commands, &bytes), EC_SUCCESS,
+		"%d");
+
+	ccprintf("16 bit frame of %zu bytes: %d commands copied, %d packed "
+		 "in %zu bytes\n",
+		 size, raw_commands, commands, bytes);
+	TEST_LT(commands, raw_commands, "%d");
+	TEST_LT(bytes, size, "%zu");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_noise(void)
+{
+	const size_t size = 8192;
+	size_t bytes;
+	int commands;
+	size_t i;
+
+	/* Nothing to predict: blocks are stored as they are. */
+	for (i = 0; i < size; i++)
+		frame[i] = prng_no_seed();
+	TEST_EQ(transfer(size, 8, CHUNK_MAX, &commands, &bytes), EC_SUCCESS,
+		"%d");
+	TEST_LE(commands, (int)DIV_ROUND_UP(size, CHUNK_MAX - 2), "%d");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_odd_sizes(void)
+{
+	size_t bytes;
+	int commands;
+	size_t i;
+
+	/* Partial last block, and chunks barely larger than a block. */
+	make_frame(FRAME_HEADER + 1001, 8);
+	TEST_EQ(transfer(FRAME_HEADER + 1001, 8, 34, &commands, &bytes),
+		EC_SUCCESS, "%d");
+	make_frame(FRAME_HEADER + 1002, 16);
+	TEST_EQ(transfer(FRAME_HEADER + 1002, 16, 65, &commands, &bytes),
+		EC_SUCCESS, "%d");
+
+	/* Too small for a block of noise: nothing is packed. */
+	for (i = 0; i < 1002; i++)
+		frame[i] = prng_no_seed();
+	TEST_EQ(transfer(1002, 16, 65, &commands, &bytes), EC_SUCCESS, "%d");
+	TEST_EQ(transfer(1002, 16, 64, &commands, &bytes), EC_ERROR_OVERFLOW,
+		"%d");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_bad_chunks(void)
+{
+	uint8_t chunk[CHUNK_MAX];
+	size_t packed;
+	size_t len;
+
+	make_frame(FRAME_SIZE, 8);
+	len = fp_frame_pack(frame, FRAME_SIZE, 0, 8, chunk, sizeof(chunk),
+			    &packed);
+	TEST_EQ(fp_frame_unpack(chunk, len, 8, unpacked, 0, packed),
+		EC_SUCCESS, "%d");
+
+	TEST_EQ(fp_frame_unpack(chunk, len - 1, 8, unpacked, 0, packed),
+		EC_ERROR_INVAL, "%d");
+	TEST_EQ(fp_frame_unpack(chunk, len, 8, unpacked, 0, packed - 32),
+		EC_ERROR_INVAL, "%d");
+	TEST_EQ(fp_frame_unpack(chunk, len, 8, unpacked, 0, packed + 32),
+		EC_ERROR_INVAL, "%d");
+
+	/* A block claiming more bits than a sample has. */
+	chunk[0] = (chunk[0] & 0xF0) | 9;
+	TEST_EQ(fp_frame_unpack(chunk, len, 8, unpacked, 0, packed),
+		EC_ERROR_INVAL, "%d");
+	return EC_SUCCESS;
+}
+
+extern "C" void run_test(int argc, const char **argv)
+{
+	RUN_TEST(test_frame_8bit);
+	RUN_TEST(test_frame_16bit);
+	RUN_TEST(test_noise);
+	RUN_TEST(test_odd_sizes);
+	RUN_TEST(test_bad_chunks);
+	test_print_result();
+}
@@ -7,6 +7,14 @@
 #include "config.h"
 #include "ec_gtest.h"
 #include "fpc_private.h"
+#include "fpsensor.h"
+#include "fpsensor_driver.h"
+
+extern "C" {
+#include "hwtimer.h"
+}
+
+#include <cinttypes>
 
 #ifdef SECTION_IS_RW
 #include "fpc/fpc_sensor.h"
@@ -31,3 +39,34 @@ TEST(FpSensor, CheckHardwareID)
 		EXPECT_EQ(fp_sensor_hwid, id >> 4);
 	};
 }
+
+/*
+ * Time the phases of a test pattern acquisition. Every driver times at
+ * least the readout of the image, and the phases fit in the acquisition.
+ */
+TEST(FpSensor, AcquisitionPhases)
+{
+	if (IS_ENABLED(SECTION_IS_RW)) {
+		static uint8_t image[FP_SENSOR_IMAGE_SIZE];
+		struct fp_sensor_capture_timing timing;
+		uint32_t start, total_us;
+
+		ASSERT_EQ(fp_sensor_init(), EC_SUCCESS);
+		start = __hw_clock_source_read();
+		EXPECT_EQ(fp_sensor_acquire_image_with_mode(
+				  image, FP_CAPTURE_PATTERN0),
+			  0);
+		total_us = __hw_clock_source_read() - start;
+		fp_sensor_get_capture_timing(&timing);
+		fp_sensor_deinit();
+
+		printf("Acquisition: %" PRIu32 " us, scan %" PRIu32
+		       " us, readout %" PRIu32 " us (processing %" PRIu32
+		       " us)\n",
+		       total_us, timing.scan_us, timing.readout_us,
+		       timing.process_us);
+		EXPECT_GT(timing.readout_us, 0U);
+		EXPECT_LE(timing.scan_us + timing.readout_us, total_us);
+		EXPECT_LE(timing.process_us, timing.readout_us);
+	}
+}
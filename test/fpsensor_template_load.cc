@@ -0,0 +1,341 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ */
+
+/* Loading of encrypted templates with EC_CMD_FP_TEMPLATE */
+
+#include "benchmark.h"
+#include "fpsensor_crypto.h"
+#include "fpsensor_crypto_backend.h"
+#include "fpsensor_state.h"
+
+extern "C" {
+#include "builtin/assert.h"
+#include "common.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "mock/fpsensor_state_mock.h"
+#include "test_util.h"
+#include "util.h"
+}
+
+#include <cstdio>
+
+namespace
+{
+
+constexpr size_t kTemplateSize = sizeof(fp_enc_buffer);
+/* Smaller than a template, so that chunks straddle templates. */
+constexpr size_t kChunkSize = 40;
+
+/* Encrypted templates, back to back as a batch sends them. */
+uint8_t templates[FP_MAX_FINGER_COUNT][kTemplateSize];
+
+void make_templates(bool same_salt)
+{
+	for (int i = 0; i < FP_MAX_FINGER_COUNT; i++) {
+		auto *enc_info = reinterpret_cast<
+			struct ec_fp_template_encryption_metadata *>(
+			templates[i]);
+		uint8_t plaintext[kTemplateSize - sizeof(*enc_info)];
+		uint8_t key[SBP_ENC_KEY_LEN];
+
+		memset(enc_info, 0, sizeof(*enc_info));
+		enc_info->struct_version = FP_TEMPLATE_FORMAT_VERSION;
+		memset(enc_info->nonce, i + 1, sizeof(enc_info->nonce));
+		memset(enc_info->encryption_salt, same_salt ? 1 : i + 1,
+		       sizeof(enc_info->encryption_salt));
+
+		memset(plaintext, 0x10 + i, sizeof(fp_template[0]));
+		memcpy(plaintext + sizeof(fp_template[0]),
+		       default_fake_fp_positive_match_salt[i],
+		       FP_POSITIVE_MATCH_SALT_BYTES);
+
+		ASSERT(derive_encryption_key(key, enc_info->encryption_salt) ==
+		       EC_SUCCESS);
+		ASSERT(aes_gcm_encrypt(key, SBP_ENC_KEY_LEN, plaintext,
+				       templates[i] + sizeof(*enc_info),
+				       sizeof(plaintext), enc_info->nonce,
+				       FP_CONTEXT_NONCE_BYTES, enc_info->tag,
+				       FP_CONTEXT_TAG_BYTES) == EC_SUCCESS);
+	}
+}
+
+enum ec_status send_chunk(int version, uint32_t offset, const uint8_t *data,
+			  uint32_t size, bool commit)
+{
+	alignas(4) uint8_t buf[sizeof(struct ec_params_fp_template) +
+			       kTemplateSize];
+	auto *params = reinterpret_cast<struct ec_params_fp_template *>(buf);
+
+	params->offset = offset;
+	params->size = size | (commit ? FP_TEMPLATE_COMMIT : 0);
+	memcpy(params->data, data, size);
+	return test_send_host_command(
+		EC_CMD_FP_TEMPLATE, version, params,
+		offsetof(struct ec_params_fp_template, data) + size, NULL, 0);
+}
+
+/* Load templates one by one, with version 0. */
+enum ec_status load_templates_v0(int count)
+{
+	for (int i = 0; i < count; i++) {
+		for (uint32_t offset = 0; offset < kTemplateSize;) {
+			uint32_t size = MIN(kChunkSize, kTemplateSize - offset);
+			enum ec_status rv;
+
+			rv = send_chunk(0, offset, templates[i] + offset, size,
+					offset + size == kTemplateSize);
+			if (rv != EC_RES_SUCCESS)
+				return rv;
+			offset += size;
+		}
+	}
+	return EC_RES_SUCCESS;
+}
+
+/* Load templates in a single batch, with version 1. */
+enum ec_status load_templates_v1(int count)
+{
+	const uint8_t *batch = templates[0];
+	const uint32_t batch_size = count * kTemplateSize;
+
+	for (uint32_t offset = 0; offset < batch_size;) {
+		uint32_t size = MIN(kChunkSize, batch_size - offset);
+		enum ec_status rv;
+
+		rv = send_chunk(1, offset, batch + offset, size,
+				offset + size == batch_size);
+		if (rv != EC_RES_SUCCESS)
+			return rv;
+		offset += size;
+	}
+	return EC_RES_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_load(void)
+{
+	fp_reset_and_clear_context();
+	make_templates(false);
+
+	TEST_EQ(load_templates_v1(FP_MAX_FINGER_COUNT), EC_RES_SUCCESS, "%d");
+	TEST_EQ(templ_valid, FP_MAX_FINGER_COUNT, "%d");
+	for (int i = 0; i < FP_MAX_FINGER_COUNT; i++) {
+		uint8_t expected[sizeof(fp_template[0]) + 1];
+
+		memset(expected, 0x10 + i, sizeof(expected));
+		TEST_ASSERT_ARRAY_EQ(fp_template[i], expected,
+				     sizeof(fp_template[0]));
+		TEST_ASSERT_ARRAY_EQ(fp_positive_match_salt[i],
+				     default_fake_fp_positive_match_salt[i],
+				     FP_POSITIVE_MATCH_SALT_BYTES);
+	}
+
+	/* The batch is over, and there is no room left. */
+	TEST_EQ(send_chunk(1, kTemplateSize, templates[0], kChunkSize, false),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(send_chunk(1, 0, templates[0], kChunkSize, false),
+		EC_RES_OVERFLOW, "%d");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_bad_tag(void)
+{
+	auto *enc_info =
+		reinterpret_cast<struct ec_fp_template_encryption_metadata *>(
+			templates[1]);
+
+	fp_reset_and_clear_context();
+	make_templates(false);
+	enc_info->tag[0] ^= 1;
+
+	TEST_EQ(load_templates_v1(3), EC_RES_UNAVAILABLE, "%d");
+	/* Only the template before the bad one is kept. */
+	TEST_EQ(templ_valid, 1, "%d");
+	TEST_ASSERT(bytes_are_trivial(fp_positive_match_salt[1],
+				      FP_POSITIVE_MATCH_SALT_BYTES));
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_out_of_order(void)
+{
+	fp_reset_and_clear_context();
+	make_templates(false);
+
+	TEST_EQ(send_chunk(1, 0, templates[0], kChunkSize, false),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(send_chunk(1, kChunkSize + 1, templates[0] + kChunkSize + 1,
+			   4, false),
+		EC_RES_INVALID_PARAM, "%d");
+	/* The batch was dropped: the right offset does not resume it. */
+	TEST_EQ(send_chunk(1, kChunkSize, templates[0] + kChunkSize,
+			   kTemplateSize - kChunkSize, true),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(templ_valid, 0, "%d");
+
+	/* Nor can it continue from a batch never started. */
+	TEST_EQ(send_chunk(1, kChunkSize, templates[0], kChunkSize, false),
+		EC_RES_INVALID_PARAM, "%d");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_commit_mid_template(void)
+{
+	fp_reset_and_clear_context();
+	make_templates(false);
+
+	TEST_EQ(send_chunk(1, 0, templates[0], kTemplateSize, false),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(send_chunk(1, kTemplateSize, templates[1], kChunkSize, true),
+		EC_RES_INVALID_PARAM, "%d");
+	/* The template completed before the commit stays. */
+	TEST_EQ(templ_valid, 1, "%d");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_context_reset(void)
+{
+	fp_reset_and_clear_context();
+	make_templates(false);
+
+	TEST_EQ(send_chunk(1, 0, templates[0], kTemplateSize, false),
+		EC_RES_SUCCESS, "%d");
+	fp_reset_and_clear_context();
+	/* The reset ended the batch, the next template can't go on it. */
+	TEST_EQ(send_chunk(1, kTemplateSize, templates[1], kTemplateSize,
+			   true),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(templ_valid, 0, "%d");
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_user_change(void)
+{
+	struct ec_params_fp_context_v1 params = {
+		.action = FP_CONTEXT_GET_RESULT,
+	};
+
+	fp_reset_and_clear_context();
+	make_templates(false);
+
+	TEST_EQ(send_chunk(1, 0, templates[0], kTemplateSize, false),
+		EC_RES_SUCCESS, "%d");
+	memset(params.userid, 0x5a, sizeof(params.userid));
+	TEST_EQ(test_send_host_command(EC_CMD_FP_CONTEXT, 1, &params,
+				       sizeof(params), NULL, 0),
+		EC_RES_SUCCESS, "%d");
+	/* The batch was for the previous user. */
+	TEST_EQ(send_chunk(1, kTemplateSize, templates[1], kTemplateSize,
+			   true),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(templ_valid, 1, "%d");
+
+	/* Back to the user the other tests encrypt for */
+	fp_reset_and_clear_context();
+	return EC_SUCCESS;
+}
+
+test_static enum ec_error_list test_batch_load_speed(void)
+{
+	Benchmark benchmark({ .num_iterations = 20 });
+
+	/* Templates of one user usually share no salt: time the worst case */
+	make_templates(false);
+	benchmark.run("Load templates one by one", []() {
+		fp_reset_and_clear_context();
+		ASSERT(load_templates_v0(FP_MAX_FINGER_COUNT) ==
+		       EC_RES_SUCCESS);
+	});
+	benchmark.run("Load templates in a batch", []() {
+		fp_reset_and_clear_context();
+		ASSERT(load_templates_v1(FP_MAX_FINGER_COUNT) ==
+		       EC_RES_SUCCESS);
+	});
+
+	make_templates(true);
+	benchmark.run("Load templates in a batch, same salt", []() {
+		fp_reset_and_clear_context();
+		ASSERT(load_templates_v1(FP_MAX_FINGER_COUNT) ==
+		       EC_RES_SUCCESS);
+	});
+	benchmark.print_results();
+	return EC_SUCCESS;
+}
+
+/*
+ * Encryption and decryption of a template with each crypto backend. The
+ * host has no template, time one of an FPC1025 with its positive match
+ * salt instead.
+ */
+test_static enum ec_error_list test_crypto_backend_speed(void)
+{
+	constexpr size_t kFpc1025TemplateSize = 5092;
+	constexpr size_t kSize =
+		kFpc1025TemplateSize + FP_POSITIVE_MATCH_SALT_BYTES;
+	static uint8_t plaintext[kSize], ciphertext[kSize];
+	const struct fp_crypto_backend *backends[] = {
+		&fp_crypto_software,
+#ifdef CONFIG_FP_CRYPTO_HW_ACCELERATE
+		fp_crypto_backend() == &fp_crypto_hardware ?
+			&fp_crypto_hardware :
+			nullptr,
+#endif
+	};
+	/* The benchmark keeps pointers to the names. */
+	static char names[ARRAY_SIZE(backends)][2][32];
+	uint8_t key[SBP_ENC_KEY_LEN];
+	uint8_t nonce[FP_CONTEXT_NONCE_BYTES];
+	uint8_t tag[FP_CONTEXT_TAG_BYTES];
+	Benchmark benchmark({ .num_iterations = 20 });
+
+	memset(key, 0x5a, sizeof(key));
+	memset(nonce, 0x11, sizeof(nonce));
+	for (size_t i = 0; i < ARRAY_SIZE(backends); i++) {
+		const auto *backend = backends[i];
+
+		if (!backend)
+			continue;
+		snprintf(names[i][0], sizeof(names[i][0]), "Encrypt (%s)",
+			 backend->name);
+		snprintf(names[i][1], sizeof(names[i][1]), "Decrypt (%s)",
+			 backend->name);
+
+		benchmark.run(names[i][0], [&]() {
+			ASSERT(backend->aes_gcm_encrypt(
+				       key, sizeof(key), plaintext, ciphertext,
+				       kSize, nonce, tag,
+				       sizeof(tag)) == EC_SUCCESS);
+		});
+		benchmark.run(names[i][1], [&]() {
+			ASSERT(backend->aes_gcm_decrypt(
+				       key, sizeof(key), ciphertext, plaintext,
+				       kSize, nonce, tag,
+				       sizeof(tag)) == EC_SUCCESS);
+		});
+	}
+	benchmark.print_results();
+	return EC_SUCCESS;
+}
+
+} // namespace
+
+void run_test(int argc, const char **argv)
+{
+	/*
+	 * Set the TPM seed here because it can only be set once and cannot be
+	 * cleared.
+	 */
+	ASSERT(fpsensor_state_mock_set_tpm_seed(default_fake_tpm_seed) ==
+	       EC_SUCCESS);
+
+	RUN_TEST(test_batch_load);
+	RUN_TEST(test_batch_bad_tag);
+	RUN_TEST(test_batch_out_of_order);
+	RUN_TEST(test_batch_commit_mid_template);
+	RUN_TEST(test_batch_context_reset);
+	RUN_TEST(test_batch_user_change);
+	RUN_TEST(test_batch_load_speed);
+	RUN_TEST(test_crypto_backend_speed);
+	test_print_result();
+}
@@ -306,6 +306,121 @@ static int test_hostcmd_clears_unused_data(void)
 	return EC_SUCCESS;
 }
 
+static struct ec_response_hostcmd_stats *hostcmd_stats_read(int index,
+							    int flags)
+{
+	struct ec_params_hostcmd_stats *sp =
+		(struct ec_params_hostcmd_stats *)(req_buf + sizeof(*req));
+
+	hostcmd_fill_in_default();
+	req->command = EC_CMD_HOSTCMD_STATS;
+	req->data_len = sizeof(*sp);
+	pkt.request_size = sizeof(*req) + sizeof(*sp);
+	sp->index = index;
+	sp->flags = flags;
+	hostcmd_send();
+
+	return (struct ec_response_hostcmd_stats *)(resp_buf + sizeof(*resp));
+}
+
+static int test_hostcmd_stats(void)
+{
+	struct ec_response_hostcmd_stats *sr;
+	struct ec_hostcmd_stats_entry entries[4];
+	const struct ec_hostcmd_stats_entry *hello = NULL;
+	const struct ec_hostcmd_stats_entry *invalid = NULL;
+	uint32_t queued = 0;
+	int i, n;
+
+	/* Read and reset whatever the earlier tests accumulated */
+	sr = hostcmd_stats_read(0, EC_HOSTCMD_STATS_FLAG_RESET);
+	TEST_EQ(resp->result, EC_RES_SUCCESS, "%d");
+
+	/* Two good commands and one bad one */
+	hostcmd_fill_in_default();
+	hostcmd_send();
+	req->checksum = 0;
+	hostcmd_send();
+	req->command = 0xff;
+	req->checksum = 0;
+	hostcmd_send();
+	TEST_EQ(resp->result, EC_RES_INVALID_COMMAND, "%d");
+
+	/*
+	 * The resetting stats command was recorded after the reset; each read
+	 * below is only recorded after its response is built. Our response
+	 * buffer is too small for more than one entry, so page through them.
+	 */
+	n = 0;
+	do {
+		sr = hostcmd_stats_read(n, 0);
+		TEST_EQ(resp->result, EC_RES_SUCCESS, "%d");
+		TEST_EQ(sr->total, 3, "%d");
+		TEST_EQ(sr->untracked, 0, "%d");
+		TEST_ASSERT(sr->count > 0);
+		TEST_EQ(resp->data_len,
+			(int)(sizeof(*sr) + sr->count * sizeof(sr->entries[0])),
+			"%d");
+		memcpy(&entries[n], sr->entries,
+		       sr->count * sizeof(sr->entries[0]));
+		n += sr->count;
+	} while (n < sr->total);
+	TEST_EQ(n, 3, "%d");
+
+	for (i = 0; i < n; i++) {
+		if (entries[i].command == EC_CMD_HELLO)
+			hello = &entries[i];
+		else if (entries[i].command == 0xff)
+			invalid = &entries[i];
+	}
+	TEST_ASSERT(hello);
+	TEST_ASSERT(invalid);
+	TEST_EQ(hello->calls, 2, "%d");
+	TEST_EQ(hello->errors, 0, "%d");
+	TEST_ASSERT(hello->max_us <= hello->total_us);
+	TEST_EQ(invalid->calls, 1, "%d");
+	TEST_EQ(invalid->errors, 1, "%d");
+
+	/* Every command dispatched since the reset is in the queue histogram */
+	for (i = 0; i < EC_HOSTCMD_STATS_BUCKETS; i++)
+		queued += sr->queue_hist[i];
+	TEST_EQ(queued, 3 + n, "%d");
+
+	/* Paging past the end returns only the header */
+	sr = hostcmd_stats_read(n, 0);
+	TEST_EQ(resp->result, EC_RES_SUCCESS, "%d");
+	TEST_EQ(sr->count, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_memmap_seq(void)
+{
+	uint8_t *seq = host_get_memmap(EC_MEMMAP_BATTERY_SEQ);
+	uint8_t *other = host_get_memmap(EC_MEMMAP_THERMAL_SEQ);
+	const uint8_t start = *seq;
+	const uint8_t other_start = *other;
+
+	TEST_EQ(*host_get_memmap(EC_MEMMAP_ID_VERSION),
+		EC_MEMMAP_SEQ_ID_VERSION, "%d");
+	TEST_EQ(start & 1, 0, "%d");
+
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+	TEST_EQ(*seq, (uint8_t)(start + 1), "%d");
+
+	/* Nested writers leave the counter alone until the outermost ends. */
+	host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+	TEST_EQ(*seq, (uint8_t)(start + 1), "%d");
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
+	TEST_EQ(*seq, (uint8_t)(start + 1), "%d");
+
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
+	TEST_EQ(*seq, (uint8_t)(start + 2), "%d");
+	TEST_EQ(*other, other_start, "%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, const char **argv)
 {
 	wait_for_task_started();
@@ -321,6 +436,8 @@ void run_test(int argc, const char **argv)
 	RUN_TEST(test_hostcmd_invalid_checksum);
 	RUN_TEST(test_hostcmd_reuse_response_buffer);
 	RUN_TEST(test_hostcmd_clears_unused_data);
+	RUN_TEST(test_hostcmd_stats);
+	RUN_TEST(test_memmap_seq);
 
 	test_print_result();
 }
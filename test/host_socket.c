@@ -0,0 +1,491 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * End-to-end test and throughput/latency benchmark of the host command
+ * packet path, driven over the emulator's host command socket by ectool's
+ * own host side (util/comm-host.cc and util/comm-socket.cc).
+ */
+
+#include "comm-host.h"
+#include "comm-socket.h"
+#include "common.h"
+#include "console.h"
+#include "ec_commands.h"
+#include "host_command.h"
+#include "host_test.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+
+#include <pthread.h>
+
+/* Must match HOST_SOCKET_PACKET_SIZE in chip/host/host_socket.c */
+#define PACKET_SIZE 1024
+#define MAX_RESPONSE (PACKET_SIZE - sizeof(struct ec_host_response))
+
+#define HELLO_ITERATIONS 500
+#define BATCH_SIZE 32
+#define BATCH_ITERATIONS 16
+#define SNAPSHOT_ITERATIONS 200
+
+/*
+ * Battery memmap region that the EC rewrites while the client takes
+ * snapshots of it. All its bytes hold the same value, except while an
+ * update is half done.
+ */
+#define SNAPSHOT_OFFSET EC_MEMMAP_BATT_VOLT
+#define SNAPSHOT_SIZE 0x40
+/* Real time that the EC spends in each update */
+#define SNAPSHOT_UPDATE_US 500
+
+/*
+ * Upper bound on the time per HELLO, alone or batched. Nothing on the path
+ * may wait for a timer tick; this is orders of magnitude above what it
+ * takes, so that a loaded machine doesn't trip it.
+ */
+#define MAX_HELLO_US (10 * MSEC)
+
+/*
+ * unistd.h clashes with timer.h, so this sticks to the sys/socket.h calls
+ * (send/recv/shutdown) and stdio.h's remove().
+ */
+
+static char socket_path[64];
+static int client_fd = -1;
+
+static uint8_t resp_buf[PACKET_SIZE];
+static uint8_t resp_data[MAX_RESPONSE];
+
+/* Real time taken by the timed benchmarks */
+static uint64_t hello_us;
+static uint64_t batch_us;
+
+/* What the EC does to the snapshot region while the client runs */
+static volatile enum {
+	WRITER_IDLE,
+	/*
+	 * Update it once per snapshot that the client starts, yielding in
+	 * the middle of the update
+	 */
+	WRITER_RUN,
+	/* Stop in the middle of an update */
+	WRITER_HOLD,
+} memmap_writer;
+/* Set by the EC while it holds an update open */
+static volatile int memmap_writer_held;
+/* Snapshots that the client started while the EC runs */
+static volatile int snapshots_started;
+
+static uint64_t now_us(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+static int sum_bytes(const void *data, int length)
+{
+	const uint8_t *bytes = data;
+	int sum = 0;
+	int i;
+
+	for (i = 0; i < length; i++)
+		sum += bytes[i];
+	return sum;
+}
+
+static int read_all(void *buf, size_t size)
+{
+	uint8_t *p = buf;
+	ssize_t n;
+
+	while (size) {
+		n = recv(client_fd, p, size, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static int write_all(const void *buf, size_t size)
+{
+	const uint8_t *p = buf;
+	ssize_t n;
+
+	while (size) {
+		n = send(client_fd, p, size, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+/* Build a request packet in buf; return its size */
+static int build_request(uint8_t *buf, int command, int version,
+			 const void *params, int params_size)
+{
+	struct ec_host_request *r = (struct ec_host_request *)buf;
+
+	r->struct_version = EC_HOST_REQUEST_VERSION;
+	r->checksum = 0;
+	r->command = command;
+	r->command_version = version;
+	r->reserved = 0;
+	r->data_len = params_size;
+	memcpy(r + 1, params, params_size);
+	r->checksum = (uint8_t)(-sum_bytes(r, sizeof(*r) + params_size));
+
+	return sizeof(*r) + params_size;
+}
+
+/*
+ * Read one response from client_fd into resp_buf. Return the data length,
+ * or a negative value on transport or EC error.
+ */
+static int read_response(void)
+{
+	struct ec_host_response *r = (struct ec_host_response *)resp_buf;
+
+	if (read_all(r, sizeof(*r)))
+		return -1;
+	if (r->struct_version != EC_HOST_RESPONSE_VERSION ||
+	    r->data_len > MAX_RESPONSE)
+		return -1;
+	if (read_all(r + 1, r->data_len))
+		return -1;
+	if ((uint8_t)sum_bytes(r, sizeof(*r) + r->data_len))
+		return -1;
+	if (r->result)
+		return -1000 - r->result;
+
+	return r->data_len;
+}
+
+/* Send a command through ectool's socket transport, into resp_data */
+static int send_command(int command, int version, const void *params,
+			int params_size)
+{
+	return ec_command_proto(command, version, params, params_size,
+				resp_data, sizeof(resp_data));
+}
+
+/*
+ * Each benchmark runs in the client thread and returns EC_SUCCESS or an
+ * error; they must not use TEST_ASSERT, which only works in a task. The
+ * timed ones leave their timings for the test to check.
+ */
+static int bench_hello(void)
+{
+	struct ec_params_hello p;
+	struct ec_response_hello *r = (struct ec_response_hello *)resp_data;
+	uint64_t t0 = now_us();
+	int i;
+
+	for (i = 0; i < HELLO_ITERATIONS; i++) {
+		p.in_data = i;
+		if (send_command(EC_CMD_HELLO, 0, &p, sizeof(p)) != sizeof(*r))
+			return EC_ERROR_UNKNOWN;
+		if (r->out_data != i + 0x01020304)
+			return EC_ERROR_UNKNOWN;
+	}
+
+	hello_us = now_us() - t0;
+	return EC_SUCCESS;
+}
+
+static int bench_flashread(void)
+{
+	struct ec_params_flash_read p;
+	const int chunk = MAX_RESPONSE & ~3;
+	int offset;
+
+	for (offset = 0; offset < CONFIG_FLASH_SIZE_BYTES; offset += chunk) {
+		p.offset = offset;
+		p.size = MIN(chunk, CONFIG_FLASH_SIZE_BYTES - offset);
+		if (send_command(EC_CMD_FLASH_READ, 0, &p, sizeof(p)) != p.size)
+			return EC_ERROR_UNKNOWN;
+		if (memcmp(resp_data, __host_flash + offset, p.size))
+			return EC_ERROR_UNKNOWN;
+	}
+
+	return EC_SUCCESS;
+}
+
+static int bench_console(void)
+{
+	struct ec_params_console_read_v1 p = { .subcmd = CONSOLE_READ_NEXT };
+	int bytes = 0;
+	int rv;
+
+	if (send_command(EC_CMD_CONSOLE_SNAPSHOT, 0, NULL, 0) < 0)
+		return EC_ERROR_UNKNOWN;
+
+	do {
+		rv = send_command(EC_CMD_CONSOLE_READ, 1, &p, sizeof(p));
+		if (rv < 0)
+			return EC_ERROR_UNKNOWN;
+		rv = strnlen((char *)resp_data, rv);
+		bytes += rv;
+	} while (rv);
+
+	/* We've printed at least the "socket" banner by now */
+	return bytes ? EC_SUCCESS : EC_ERROR_UNKNOWN;
+}
+
+/*
+ * Queue a batch of requests with a single write before reading any of the
+ * responses, to check that the EC serves queued requests in order and
+ * without stalling between them. ectool never does this, so the batch goes
+ * over a connection of its own.
+ */
+static int bench_batch(void)
+{
+	static uint8_t batch[BATCH_SIZE * (sizeof(struct ec_host_request) +
+					   sizeof(struct ec_params_hello))];
+	struct sockaddr_un addr = { .sun_family = AF_UNIX };
+	struct ec_params_hello p;
+	struct ec_response_hello *r =
+		(struct ec_response_hello *)(resp_buf +
+					     sizeof(struct ec_host_response));
+	uint64_t t0;
+	int rv = EC_ERROR_UNKNOWN;
+	int size;
+	int i, j;
+
+	strcpy(addr.sun_path, socket_path);
+	client_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (client_fd < 0)
+		return EC_ERROR_UNKNOWN;
+	if (connect(client_fd, (struct sockaddr *)&addr, sizeof(addr)))
+		goto out;
+
+	t0 = now_us();
+	for (i = 0; i < BATCH_ITERATIONS; i++) {
+		size = 0;
+		for (j = 0; j < BATCH_SIZE; j++) {
+			p.in_data = j;
+			size += build_request(batch + size, EC_CMD_HELLO, 0, &p,
+					      sizeof(p));
+		}
+		if (write_all(batch, size))
+			goto out;
+
+		/* Responses come back in order */
+		for (j = 0; j < BATCH_SIZE; j++) {
+			if (read_response() != sizeof(*r))
+				goto out;
+			if (r->out_data != j + 0x01020304)
+				goto out;
+		}
+	}
+	batch_us = now_us() - t0;
+	rv = EC_SUCCESS;
+
+out:
+	shutdown(client_fd, SHUT_RDWR);
+	return rv;
+}
+
+static int region_is_torn(const uint8_t *region)
+{
+	int i;
+
+	for (i = 1; i < SNAPSHOT_SIZE; i++)
+		if (region[i] != region[0])
+			return 1;
+	return 0;
+}
+
+/*
+ * Take memmap snapshots while the EC updates the region, which they must
+ * never catch half done, then while it holds an update open, which they
+ * must give up on.
+ */
+static int bench_snapshot(void)
+{
+	uint8_t region[SNAPSHOT_SIZE];
+	struct timespec wait = { .tv_nsec = 100000 };
+	int i, rv;
+
+	memmap_writer = WRITER_RUN;
+	for (i = 0; i < SNAPSHOT_ITERATIONS; i++) {
+		snapshots_started++;
+		rv = ec_readmem_snapshot(EC_MEMMAP_BATTERY_SEQ, SNAPSHOT_OFFSET,
+					 sizeof(region), region);
+		if (rv != sizeof(region) || region_is_torn(region))
+			return EC_ERROR_UNKNOWN;
+	}
+
+	memmap_writer = WRITER_HOLD;
+	while (!memmap_writer_held)
+		nanosleep(&wait, NULL);
+	if (ec_readmem_snapshot(EC_MEMMAP_BATTERY_SEQ, SNAPSHOT_OFFSET,
+				sizeof(region), region) != -EBUSY)
+		return EC_ERROR_UNKNOWN;
+
+	memmap_writer = WRITER_IDLE;
+	while (memmap_writer_held)
+		nanosleep(&wait, NULL);
+	if (ec_readmem_snapshot(EC_MEMMAP_BATTERY_SEQ, SNAPSHOT_OFFSET,
+				sizeof(region), region) != sizeof(region))
+		return EC_ERROR_UNKNOWN;
+
+	return region_is_torn(region) ? EC_ERROR_UNKNOWN : EC_SUCCESS;
+}
+
+static const struct {
+	const char *name;
+	int (*run)(void);
+} benchmarks[] = {
+	{ "hello", bench_hello },
+	{ "flashread", bench_flashread },
+	{ "console", bench_console },
+	{ "snapshot", bench_snapshot },
+};
+
+static volatile int client_done;
+/* Name of what failed in the client, or NULL */
+static const char *volatile client_failed;
+
+static void *client_thread(void *arg)
+{
+	int i;
+
+	if (comm_init_alt(COMM_SOCKET, socket_path, -1)) {
+		client_failed = "connect";
+		client_done = 1;
+		return NULL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(benchmarks); i++) {
+		if (benchmarks[i].run() != EC_SUCCESS) {
+			client_failed = benchmarks[i].name;
+			break;
+		}
+	}
+	comm_socket_exit();
+
+	if (!client_failed && bench_batch() != EC_SUCCESS)
+		client_failed = "batch";
+
+	client_done = 1;
+	return NULL;
+}
+
+/*
+ * Let the other tasks run for some real time. Emulated time runs fast when
+ * all tasks are idle, so a plain sleep may give the client no time at all.
+ */
+static void yield_for_us(int us)
+{
+	uint64_t deadline = now_us() + us;
+
+	while (now_us() < deadline)
+		msleep(1);
+}
+
+/*
+ * One step of the EC side of the snapshot benchmark: rewrite the snapshot
+ * region in two halves, letting the host command task run in between.
+ *
+ * Each update races the snapshot that asked for it, and none follows until
+ * the client starts another: a snapshot may have to retry, but always ends
+ * up finding the region quiet.
+ */
+static void memmap_writer_step(void)
+{
+	uint8_t *region = host_get_memmap(SNAPSHOT_OFFSET);
+	static uint8_t value;
+	static int served;
+
+	if (!memmap_writer_held) {
+		if (memmap_writer == WRITER_IDLE ||
+		    (memmap_writer == WRITER_RUN &&
+		     served == snapshots_started)) {
+			msleep(1);
+			return;
+		}
+		served = snapshots_started;
+		host_memmap_write_begin(EC_MEMMAP_BATTERY_SEQ);
+		memset(region, ++value, SNAPSHOT_SIZE / 2);
+	}
+	if (memmap_writer == WRITER_HOLD) {
+		memmap_writer_held = 1;
+		msleep(1);
+		return;
+	}
+	yield_for_us(SNAPSHOT_UPDATE_US);
+	memset(region + SNAPSHOT_SIZE / 2, value, SNAPSHOT_SIZE / 2);
+	host_memmap_write_end(EC_MEMMAP_BATTERY_SEQ);
+	memmap_writer_held = 0;
+}
+
+static int run_client(void)
+{
+	pthread_t thread;
+	/* Emulated time runs fast when all tasks are idle, so use real time */
+	uint64_t deadline = now_us() + 30 * SECOND;
+
+	client_done = 0;
+	client_failed = NULL;
+	pthread_create(&thread, NULL, client_thread, NULL);
+
+	/* The client needs the EC tasks to run, so don't block in join */
+	while (!client_done && now_us() < deadline)
+		memmap_writer_step();
+	TEST_ASSERT(client_done);
+	pthread_join(thread, NULL);
+
+	return EC_SUCCESS;
+}
+
+static int test_socket_benchmarks(void)
+{
+	int hello_per_cmd, batch_per_cmd;
+
+	TEST_EQ(run_client(), EC_SUCCESS, "%d");
+	if (client_failed)
+		ccprintf("Benchmark %s failed\n", client_failed);
+	TEST_ASSERT(client_failed == NULL);
+
+	hello_per_cmd = hello_us / HELLO_ITERATIONS;
+	batch_per_cmd = batch_us / (BATCH_SIZE * BATCH_ITERATIONS);
+	TEST_LT(hello_per_cmd, MAX_HELLO_US, "%d");
+	TEST_LT(batch_per_cmd, MAX_HELLO_US, "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, const char **argv)
+{
+	snprintf(socket_path, sizeof(socket_path), "/tmp/ec_host_socket.%x",
+		 (int)now_us());
+	if (host_socket_open(socket_path)) {
+		ccprintf("Unable to open %s\n", socket_path);
+		test_fail();
+		return;
+	}
+
+	test_reset();
+	RUN_TEST(test_socket_benchmarks);
+
+	remove(socket_path);
+	test_print_result();
+}
@@ -129,7 +129,7 @@ int _wait_for_data(int delay_ms)
 					_irq > 0 ? true : false, "%d");    \
 			TEST_EQ(output_buffer.data, expected[_i], "0x%x"); \
 			output_buffer.full = false;                        \
-			task_wake(TASK_ID_KEYPROTO);                       \
+			keyboard_host_read();                              \
 		}                                                          \
 	} while (0)
 
@@ -237,7 +237,7 @@ static int _read_cmd_byte(uint8_t *cmd)
 
 	*cmd = output_buffer.data;
 	output_buffer.full = false;
-	task_wake(TASK_ID_KEYPROTO);
+	keyboard_host_read();
 
 	return EC_SUCCESS;
 }
@@ -575,6 +575,61 @@ test_static int test_single_key_press(void)
 	return EC_SUCCESS;
 }
 
+static int get_latency(struct ec_response_8042_latency *r, uint8_t flags)
+{
+	struct ec_params_8042_latency p = { .flags = flags };
+
+	TEST_EQ(test_send_host_command(EC_CMD_8042_LATENCY, 0, &p, sizeof(p),
+				       r, sizeof(*r)),
+		EC_RES_SUCCESS, "%d");
+	return EC_SUCCESS;
+}
+#define GET_LATENCY(r, flags) TEST_EQ(get_latency(r, flags), EC_SUCCESS, "%d")
+
+test_static int test_latency(void)
+{
+	struct ec_response_8042_latency r;
+	int i;
+
+	/* Enable the keyboard, for the fast path to be taken if there's one. */
+	WRITE_CMD_BYTE(I8042_XLATE | I8042_AUX_DIS);
+	ENABLE_KEYSTROKE(1);
+	GET_LATENCY(&r, EC_8042_LATENCY_FLAG_RESET);
+
+	/* The host takes its time to read the first key. */
+	press_key(1, 1, 1);
+	msleep(10);
+	VERIFY_LPC_CHAR("\x01");
+	press_key(1, 1, 0);
+	press_key(12, 6, 1);
+	VERIFY_LPC_CHAR("\x81\xe0\x4d");
+	press_key(12, 6, 0);
+	VERIFY_LPC_CHAR("\xe0\xcd");
+
+	GET_LATENCY(&r, EC_8042_LATENCY_FLAG_RESET);
+	TEST_EQ(r.count, 4, "%d");
+	TEST_EQ(r.untracked, 0, "%d");
+	TEST_GE(r.stages[EC_8042_LATENCY_SEND].max_us, 10 * MSEC, "%d");
+	for (i = 0; i < EC_8042_LATENCY_COUNT; i++)
+		TEST_LE(r.stages[i].min_us, r.stages[i].max_us, "%d");
+	TEST_EQ(r.stages[EC_8042_LATENCY_TOTAL].total_us,
+		r.stages[EC_8042_LATENCY_QUEUE].total_us +
+			r.stages[EC_8042_LATENCY_SEND].total_us,
+		"%d");
+
+	/* Key events flushed before the host read them are not timed. */
+	press_key(1, 1, 1);
+	press_key(1, 1, 0);
+	WAIT_FOR_DATA(30);
+	keyboard_clear_buffer();
+	output_buffer.full = false;
+	GET_LATENCY(&r, 0);
+	TEST_EQ(r.count, 0, "%d");
+	TEST_EQ(r.untracked, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
 test_static int test_disable_keystroke(void)
 {
 	ENABLE_KEYSTROKE(0);
@@ -1029,6 +1084,7 @@ void run_test(int argc, const char **argv)
 		RUN_TEST(test_atkbd_set_ex_leds);
 		RUN_TEST(test_atkbd_reset);
 		RUN_TEST(test_single_key_press);
+		RUN_TEST(test_latency);
 		RUN_TEST(test_disable_keystroke);
 		RUN_TEST(test_typematic);
 		RUN_TEST(test_scancode_set2);
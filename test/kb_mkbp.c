@@ -13,6 +13,7 @@
 #include "keyboard_mkbp.h"
 #include "keyboard_protocol.h"
 #include "keyboard_scan.h"
+#include "mkbp_fifo.h"
 #include "test_util.h"
 #include "util.h"
 
@@ -286,6 +287,177 @@ int fifo_underrun(void)
 	return EC_SUCCESS;
 }
 
+/* Events of the burst, in the order the host should see them */
+struct burst_event {
+	uint8_t type;
+	int c, r, pressed;
+};
+
+static const struct burst_event burst[] = {
+	{ EC_MKBP_EVENT_KEY_MATRIX, 0, 0, 1 },
+	{ EC_MKBP_EVENT_KEY_MATRIX, 0, 0, 0 },
+	{ EC_MKBP_EVENT_BUTTON },
+	{ EC_MKBP_EVENT_KEY_MATRIX, 1, 2, 1 },
+	{ EC_MKBP_EVENT_SWITCH },
+	{ EC_MKBP_EVENT_KEY_MATRIX, 1, 2, 0 },
+	{ EC_MKBP_EVENT_KEY_MATRIX, 3, 4, 1 },
+	{ EC_MKBP_EVENT_KEY_MATRIX, 3, 4, 0 },
+};
+
+/* A burst of keys, buttons and switches through the FIFO, and a host event */
+static int send_burst(void)
+{
+	uint32_t value = 1;
+	int i;
+
+	keyboard_clear_buffer();
+	clear_state();
+	for (i = 0; i < ARRAY_SIZE(burst); i++) {
+		if (burst[i].type == EC_MKBP_EVENT_KEY_MATRIX)
+			TEST_EQ(press_key(burst[i].c, burst[i].r,
+					  burst[i].pressed),
+				EC_SUCCESS, "%d");
+		else
+			TEST_EQ(mkbp_fifo_add(burst[i].type, (uint8_t *)&value),
+				EC_SUCCESS, "%d");
+	}
+	host_set_single_event(EC_HOST_EVENT_LID_OPEN);
+	clear_state();
+
+	return EC_SUCCESS;
+}
+
+/* Check an event against the burst, *next being the FIFO event expected */
+static int check_burst_event(uint8_t type, const uint8_t *data, int size,
+			     int *next, int *host_events)
+{
+	const struct burst_event *e = &burst[*next];
+
+	if (type == EC_MKBP_EVENT_HOST_EVENT ||
+	    type == EC_MKBP_EVENT_HOST_EVENT64) {
+		(*host_events)++;
+		return EC_SUCCESS;
+	}
+
+	TEST_LT(*next, (int)ARRAY_SIZE(burst), "%d");
+	TEST_EQ(type, e->type, "%d");
+	if (type == EC_MKBP_EVENT_KEY_MATRIX) {
+		set_state(e->c, e->r, e->pressed);
+		TEST_EQ(size, KEYBOARD_COLS_MAX, "%d");
+		TEST_ASSERT_ARRAY_EQ(data, state, KEYBOARD_COLS_MAX);
+	}
+	(*next)++;
+
+	return EC_SUCCESS;
+}
+
+/* Read the burst one event per command. Returns the number of commands. */
+static int read_burst_v2(void)
+{
+	struct ec_response_get_next_event_v1 event;
+	struct host_cmd_handler_args args = {
+		.version = 2,
+		.command = EC_CMD_GET_NEXT_EVENT,
+		.response = &event,
+		.response_max = sizeof(event),
+	};
+	int next = 0, host_events = 0, commands = 0;
+
+	do {
+		TEST_EQ(host_command_process(&args), EC_RES_SUCCESS, "%d");
+		commands++;
+		TEST_EQ(check_burst_event(event.event_type &
+						  EC_MKBP_EVENT_TYPE_MASK,
+					  (uint8_t *)&event.data,
+					  args.response_size - 1, &next,
+					  &host_events),
+			EC_SUCCESS, "%d");
+	} while (event.event_type & EC_MKBP_HAS_MORE_EVENTS);
+
+	TEST_EQ(next, (int)ARRAY_SIZE(burst), "%d");
+	TEST_EQ(host_events, 1, "%d");
+	TEST_ASSERT(FIFO_EMPTY());
+
+	return commands;
+}
+
+/* Read the burst in batches, with a response of response_max bytes */
+static int read_burst_v3(int response_max)
+{
+	static uint8_t buf[256];
+	struct ec_response_get_next_event_v3 *r = (void *)buf;
+	struct host_cmd_handler_args args = {
+		.version = 3,
+		.command = EC_CMD_GET_NEXT_EVENT,
+		.response = buf,
+		.response_max = response_max,
+	};
+	int next = 0, host_events = 0, commands = 0;
+	const struct ec_mkbp_event_record *rec;
+	const uint8_t *p;
+	int i;
+
+	do {
+		TEST_EQ(host_command_process(&args), EC_RES_SUCCESS, "%d");
+		commands++;
+		TEST_GT(r->count, 0, "%d");
+
+		p = r->records;
+		for (i = 0; i < r->count; i++) {
+			rec = (const struct ec_mkbp_event_record *)p;
+			TEST_EQ(check_burst_event(rec->event_type, rec->data,
+						  rec->size, &next,
+						  &host_events),
+				EC_SUCCESS, "%d");
+			p += sizeof(*rec) + rec->size;
+		}
+		TEST_EQ((int)(p - buf), args.response_size, "%d");
+	} while (r->flags & EC_MKBP_HAS_MORE_EVENTS);
+
+	TEST_EQ(next, (int)ARRAY_SIZE(burst), "%d");
+	TEST_EQ(host_events, 1, "%d");
+	TEST_ASSERT(FIFO_EMPTY());
+
+	return commands;
+}
+
+int test_batched_events(void)
+{
+	const int events = ARRAY_SIZE(burst) + 1;
+	struct ec_response_get_next_event_v3 r;
+	uint8_t buf[64];
+	struct host_cmd_handler_args args = {
+		.version = 3,
+		.command = EC_CMD_GET_NEXT_EVENT,
+		.response = &r,
+		.response_max = sizeof(r) + EC_MKBP_EVENT_RECORD_MAX_SIZE - 1,
+	};
+	int one, small, large;
+
+	TEST_EQ(send_burst(), EC_SUCCESS, "%d");
+	one = read_burst_v2();
+	TEST_EQ(one, events, "%d");
+
+	/* A few events per command */
+	TEST_EQ(send_burst(), EC_SUCCESS, "%d");
+	small = read_burst_v3(64);
+	TEST_GT(small, 1, "%d");
+	TEST_LT(small, one, "%d");
+
+	TEST_EQ(send_burst(), EC_SUCCESS, "%d");
+	large = read_burst_v3(256);
+	TEST_EQ(large, 1, "%d");
+
+	/* A response too small for any event, and nothing left */
+	TEST_EQ(host_command_process(&args), EC_RES_RESPONSE_TOO_BIG, "%d");
+	args.response = buf;
+	args.response_max = sizeof(buf);
+	TEST_EQ(host_command_process(&args), EC_RES_UNAVAILABLE, "%d");
+	TEST_ASSERT(FIFO_EMPTY());
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, const char **argv)
 {
 	ec_int_level = 1;
@@ -298,6 +470,7 @@ void run_test(int argc, const char **argv)
 	RUN_TEST(test_fifo_size);
 	RUN_TEST(test_enable);
 	RUN_TEST(fifo_underrun);
+	RUN_TEST(test_batched_events);
 
 	test_print_result();
 }
@@ -7,6 +7,7 @@
 #include "ec_commands.h"
 #include "host_command.h"
 #include "lightbar.h"
+#include "lightbyte.h"
 #include "test_util.h"
 #include "timer.h"
 #include "util.h"
@@ -316,6 +317,78 @@ test_static int test_als_lightbar(void)
 	return EC_SUCCESS;
 }
 
+static int set_program(const uint8_t *data, int size)
+{
+	struct ec_params_lightbar params;
+
+	params.cmd = LIGHTBAR_CMD_SET_PROGRAM;
+	params.set_program.size = size;
+	memcpy(params.set_program.data, data, size);
+	return test_send_host_command(EC_CMD_LIGHTBAR_CMD, 0, &params,
+				      sizeof(params), NULL, 0);
+}
+
+test_static int test_program_decode(void)
+{
+	const struct lightbar_program prog = {
+		.size = 14,
+		.data = {
+			ON,
+			SET_WAIT_DELAY, 0x00, 0x01, 0x86, 0xa0,
+			/* The high target is an operand */
+			JUMP_BATTERY, 0x00, 0x03,
+			/* Control 3 is not one */
+			SET_COLOR_SINGLE, 0x1c, 0x40,
+			JUMP, 0x01,
+		},
+	};
+	struct lightbyte_inst insts[LIGHTBYTE_MAX_INSTS];
+
+	TEST_EQ(lightbyte_decode(&prog, insts), 7, "%d");
+	TEST_EQ(insts[0].op, ON, "%d");
+	TEST_EQ(insts[1].op, SET_WAIT_DELAY, "%d");
+	TEST_EQ(insts[1].delay, 100000, "%u");
+	TEST_EQ(insts[2].op, JUMP_BATTERY, "%d");
+	TEST_EQ(insts[2].arg[0], 0, "%d");
+	TEST_EQ(insts[2].arg[1], 6, "%d");
+	TEST_EQ(insts[3].op, LIGHTBYTE_FAULT, "%d");
+	TEST_EQ(insts[3].arg[0], 0x09, "0x%02x");
+	TEST_EQ(insts[4].op, JUMP, "%d");
+	TEST_EQ(insts[4].arg[0], 1, "%d");
+	/* Falling off the end, then the bad jump target */
+	TEST_EQ(insts[5].op, LIGHTBYTE_FAULT, "%d");
+	TEST_EQ(insts[5].arg[0], 0x0e, "0x%02x");
+	TEST_EQ(insts[6].op, LIGHTBYTE_FAULT, "%d");
+	TEST_EQ(insts[6].arg[0], 0x03, "0x%02x");
+	return EC_SUCCESS;
+}
+
+test_static int test_program_run(void)
+{
+	const uint8_t spin[] = { JUMP, 0x00 };
+	const uint8_t bad_jump[] = { JUMP, 0x03, SET_WAIT_DELAY, 0, 0, 0, 0 };
+
+	TEST_ASSERT(set_seq(LIGHTBAR_S0) == EC_RES_SUCCESS);
+	usleep(SECOND);
+
+	/* A tight loop still lets the host in. */
+	TEST_EQ(set_program(spin, sizeof(spin)), EC_RES_SUCCESS, "%d");
+	TEST_ASSERT(set_seq(LIGHTBAR_PROGRAM) == EC_RES_SUCCESS);
+	usleep(SECOND);
+	TEST_ASSERT(get_seq() == LIGHTBAR_PROGRAM);
+	TEST_ASSERT(set_seq(LIGHTBAR_S0) == EC_RES_SUCCESS);
+	usleep(SECOND);
+	TEST_ASSERT(get_seq() == LIGHTBAR_S0);
+
+	/* A fault stops the program. */
+	TEST_EQ(set_program(bad_jump, sizeof(bad_jump)), EC_RES_SUCCESS,
+		"%d");
+	TEST_ASSERT(set_seq(LIGHTBAR_PROGRAM) == EC_RES_SUCCESS);
+	usleep(SECOND);
+	TEST_ASSERT(get_seq() == LIGHTBAR_S0);
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, const char **argv)
 {
 	/* Ensure tasks are started before running tests */
@@ -328,5 +401,7 @@ void run_test(int argc, const char **argv)
 	RUN_TEST(test_oneshots_norm_msg);
 	RUN_TEST(test_double_oneshots);
 	RUN_TEST(test_als_lightbar);
+	RUN_TEST(test_program_decode);
+	RUN_TEST(test_program_run);
 	test_print_result();
 }
@@ -0,0 +1 @@
+../util/misc_util.cc
\ No newline at end of file
@@ -7,6 +7,7 @@
 
 #include "battery_smart.h"
 #include "charge_state.h"
+#include "charger.h"
 #include "chipset.h"
 #include "common.h"
 #include "gpio.h"
@@ -29,6 +30,7 @@ test_static int is_force_discharge;
 test_static int is_hibernated;
 test_static int override_voltage, override_current, override_usec;
 test_static int display_soc;
+test_static int charge_loops;
 test_static int is_full;
 
 /* The simulation doesn't really hibernate, so we must reset this ourselves */
@@ -87,6 +89,9 @@ void system_hibernate(int sec, int usec)
 
 int charger_profile_override(struct charge_state_data *curr)
 {
+	/* Called once per iteration of the charge loop */
+	charge_loops++;
+
 	if (override_voltage)
 		curr->requested_voltage = override_voltage;
 	if (override_current)
@@ -1003,6 +1008,51 @@ test_static int test_battery_sustainer_discharge_idle(void)
 	return EC_SUCCESS;
 }
 
+/*
+ * Leave the charge loop alone for a while, and check that it polls the
+ * battery and charger less often than every old_period_us, and stops
+ * rewriting the charger limits. Each iteration reads the battery and
+ * charger parameters over I2C.
+ */
+test_static int check_steady_traffic(int old_period_us)
+{
+	const int hour_s = HOUR / SECOND;
+	const int duration_s = 10 * 60;
+	struct charger_write_stats start, end;
+	int loops, written, skipped;
+
+	charge_loops = 0;
+	charger_get_write_stats(&start);
+	sleep(duration_s);
+	charger_get_write_stats(&end);
+
+	loops = charge_loops * hour_s / duration_s;
+	written = (end.written - start.written) * hour_s / duration_s;
+	skipped = (end.skipped - start.skipped) * hour_s / duration_s;
+
+	/* Polling every CHARGE_POLL_PERIOD_STEADY, give or take the ramp */
+	TEST_LE(loops, 2 * (int)(HOUR / CHARGE_POLL_PERIOD_STEADY), "%d");
+	TEST_LT(loops, (int)(HOUR / old_period_us), "%d");
+	/* Only the periodic refresh of the shadowed limits goes through */
+	TEST_LE(written, 3 * (int)(HOUR / CHARGER_SHADOW_TIMEOUT) + 3, "%d");
+	TEST_GT(skipped, written, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_steady_state_polling(void)
+{
+	test_setup(1);
+	TEST_EQ(check_steady_traffic(CHARGE_POLL_PERIOD_CHARGE), EC_SUCCESS,
+		"%d");
+
+	test_setup(0);
+	TEST_EQ(check_steady_traffic(CHARGE_POLL_PERIOD_LONG), EC_SUCCESS,
+		"%d");
+
+	return EC_SUCCESS;
+}
+
 void run_test(int argc, const char **argv)
 {
 	RUN_TEST(test_charge_state);
@@ -1018,6 +1068,7 @@ void run_test(int argc, const char **argv)
 	RUN_TEST(test_battery_sustainer);
 	RUN_TEST(test_battery_sustainer_discharge_idle);
 	RUN_TEST(test_deep_charge_battery);
+	RUN_TEST(test_steady_state_polling);
 
 	test_print_result();
 }
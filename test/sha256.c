@@ -7,10 +7,16 @@
 
 #include "common.h"
 #include "console.h"
+#include "flash.h"
 #include "sha256.h"
 #include "test_util.h"
+#include "timer.h"
 #include "util.h"
 
+#ifdef EMU_BUILD
+#include <time.h>
+#endif
+
 /* Short Msg from NIST FIPS 180-4 (Len = 8) */
 static const uint8_t sha256_8_input[] = { 0xd3 };
 static const uint8_t sha256_8_output[SHA256_DIGEST_SIZE] = {
@@ -168,6 +174,136 @@ static int test_hmac(const uint8_t *key, int key_len, const uint8_t *input,
 	return 1;
 }
 
+#ifdef CONFIG_SHA256_HW_ACCELERATE
+#define SHA256_BACKEND "hw"
+#elif defined(CONFIG_SHA256_UNROLLED)
+#define SHA256_BACKEND "sw-unrolled"
+#else
+#define SHA256_BACKEND "sw"
+#endif
+
+#define BENCH_CHUNK_SIZE 1024
+/* Constant so it can be used in initializers, hence no MIN() */
+#define BENCH_SIZE                                                   \
+	(CONFIG_FLASH_SIZE_BYTES < 0x10000 ? CONFIG_FLASH_SIZE_BYTES : \
+					     0x10000)
+
+static uint8_t bench_buf[BENCH_CHUNK_SIZE];
+
+/* Reference hash of a flash region, read through a bounce buffer */
+static const uint8_t *flash_region_hash(struct sha256_ctx *ctx, int offset,
+					int size)
+{
+	int chunk;
+
+	SHA256_init(ctx);
+	while (size) {
+		chunk = MIN(size, BENCH_CHUNK_SIZE);
+		crec_flash_read(offset, chunk, (char *)bench_buf);
+		SHA256_update(ctx, bench_buf, chunk);
+		offset += chunk;
+		size -= chunk;
+	}
+	return SHA256_final(ctx);
+}
+
+static int test_sha256_flash(void)
+{
+	struct sha256_ctx ctx, ref_ctx;
+	static const struct {
+		int offset;
+		int size;
+	} regions[] = {
+		{ 0, BENCH_SIZE },
+		{ 0, 0 },
+		{ 1, SHA256_BLOCK_SIZE - 1 },
+		{ 0x1000, 3 * BENCH_CHUNK_SIZE + 5 },
+	};
+	int i;
+
+#ifdef EMU_BUILD
+	/* Give the emulated flash some content */
+	for (i = 0; i < CONFIG_FLASH_SIZE_BYTES; i++)
+		__host_flash[i] = i * 7 + (i >> 8);
+#endif
+
+	for (i = 0; i < ARRAY_SIZE(regions); i++) {
+		SHA256_init(&ctx);
+		if (SHA256_update_flash(&ctx, regions[i].offset,
+					regions[i].size) != EC_SUCCESS) {
+			ccprintf("SHA256_update_flash failed\n");
+			return 0;
+		}
+		if (memcmp(SHA256_final(&ctx),
+			   flash_region_hash(&ref_ctx, regions[i].offset,
+					     regions[i].size),
+			   SHA256_DIGEST_SIZE) != 0) {
+			ccprintf("SHA256 flash test failed (region %d)\n", i);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+static uint64_t bench_time_us(void)
+{
+#ifdef EMU_BUILD
+	/* The emulator's clock only moves when tasks sleep */
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+#else
+	return get_time().val;
+#endif
+}
+
+static void print_throughput(const char *name, uint64_t t0)
+{
+	uint64_t us = MAX(bench_time_us() - t0, 1);
+
+	ccprintf("%s (%s): %d bytes in %d us, %d KB/s\n", name,
+		 SHA256_BACKEND, BENCH_SIZE, (int)us,
+		 (int)((uint64_t)BENCH_SIZE * SECOND / 1024 / us));
+}
+
+/*
+ * Throughput of the backend over RAM, and over flash both in place and
+ * through the bounce buffer that a non-mapped read needs.
+ */
+static void bench_sha256(void)
+{
+	struct sha256_ctx ctx;
+	uint8_t hmac[SHA256_DIGEST_SIZE];
+	uint64_t t0;
+	int offset;
+
+	t0 = bench_time_us();
+	SHA256_init(&ctx);
+	for (offset = 0; offset < BENCH_SIZE; offset += BENCH_CHUNK_SIZE)
+		SHA256_update(&ctx, bench_buf, BENCH_CHUNK_SIZE);
+	SHA256_final(&ctx);
+	print_throughput("SHA256 ram", t0);
+
+	t0 = bench_time_us();
+	SHA256_init(&ctx);
+	SHA256_update_flash(&ctx, 0, BENCH_SIZE);
+	SHA256_final(&ctx);
+	print_throughput("SHA256 flash", t0);
+
+	t0 = bench_time_us();
+	flash_region_hash(&ctx, 0, BENCH_SIZE);
+	print_throughput("SHA256 flash (copy)", t0);
+
+	t0 = bench_time_us();
+	for (offset = 0; offset < BENCH_SIZE; offset += SHA256_BLOCK_SIZE)
+		hmac_SHA256(hmac, hmac_medium_key, sizeof(hmac_medium_key),
+			    bench_buf + offset % BENCH_CHUNK_SIZE,
+			    SHA256_BLOCK_SIZE);
+	print_throughput("HMAC 64B", t0);
+}
+
 void run_test(int argc, const char **argv)
 {
 	ccprintf("Testing short message (8 bytes)\n");
@@ -211,5 +347,13 @@ void run_test(int argc, const char **argv)
 	 * 64 bytes keys.
 	 */
 
+	ccprintf("Testing hashing from flash\n");
+	if (!test_sha256_flash()) {
+		test_fail();
+		return;
+	}
+
+	bench_sha256();
+
 	test_pass();
 }
@@ -0,0 +1,265 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Property tests of the streaming statistics against a double precision
+ * reference computed from scratch over the same samples. This build uses
+ * fixed-point fp_t (no CONFIG_FPU), the less forgiving of the two.
+ */
+
+#include "common.h"
+#include "math_util.h"
+#include "streaming_stats.h"
+#include "test_util.h"
+#include "util.h"
+
+#include <math.h>
+
+/* Enough for the largest window of 3 axes */
+static int16_t history[UINT16_MAX * STATS_WINDOW_MAX_AXES];
+/* Everything that went into the window, for the reference */
+static int samples[4 * 256 * STATS_WINDOW_MAX_AXES];
+
+static uint32_t seed;
+
+static uint32_t rand32(void)
+{
+	/* xorshift32 */
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+/* Uniform in [-range, range] */
+static int rand_range(int range)
+{
+	return (int)(rand32() % (2 * range + 1)) - range;
+}
+
+/*
+ * Check every statistic of the window after n samples have been added,
+ * against the last size samples (and zeros before the first sample).
+ */
+static int check_window(const struct stats_window *w, int n)
+{
+	const int size = w->size;
+	int a, i;
+
+	for (a = 0; a < w->axes; a++) {
+		int64_t sum = 0;
+		int64_t sum_sq = 0;
+		int64_t n2_var;
+		double mean, var;
+		int min = INT16_MAX, max = INT16_MIN;
+		int got_min, got_max;
+
+		for (i = n - size; i < n; i++) {
+			int x = i < 0 ? 0 : samples[i * w->axes + a];
+
+			x = CLAMP(x, INT16_MIN, INT16_MAX);
+			sum += x;
+			sum_sq += (int64_t)x * x;
+			min = MIN(min, x);
+			max = MAX(max, x);
+		}
+		mean = (double)sum / size;
+		var = (double)sum_sq / size - mean * mean;
+		/* n^2 * var = n * sum(x^2) - sum(x)^2, exactly */
+		n2_var = size * sum_sq - sum * sum;
+
+		TEST_EQ(w->sum[a], (int32_t)sum, "%d");
+		TEST_ASSERT(stats_window_n2_variance(w, a) == (uint64_t)n2_var);
+		TEST_EQ(stats_window_mean(w, a), (int)(sum / size), "%d");
+		TEST_ASSERT(fabs(stats_window_variance(w, a) - var) <=
+			    1.0 + var * 1e-9);
+
+		stats_window_min_max(w, a, &got_min, &got_max);
+		TEST_EQ(got_min, min, "%d");
+		TEST_EQ(got_max, max, "%d");
+	}
+
+	return EC_SUCCESS;
+}
+
+static int run_window(int size, int axes, int range)
+{
+	struct stats_window w;
+	const int total = 4 * size;
+	int i;
+
+	TEST_ASSERT(total * axes <= ARRAY_SIZE(samples));
+
+	stats_window_init(&w, history, size, axes);
+	for (i = 0; i < total; i++) {
+		int *x = &samples[i * axes];
+		int a;
+
+		for (a = 0; a < axes; a++)
+			x[a] = rand_range(range);
+		stats_window_add(&w, x);
+
+		TEST_EQ(stats_window_full(&w), i + 1 >= size, "%d");
+		TEST_EQ(check_window(&w, i + 1), EC_SUCCESS, "%d");
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_window_random(void)
+{
+	static const int sizes[] = { 1, 2, 7, 50, 250 };
+	int axes, i;
+
+	seed = 0x2545f491;
+	for (i = 0; i < ARRAY_SIZE(sizes); i++) {
+		for (axes = 1; axes <= STATS_WINDOW_MAX_AXES; axes++) {
+			/* Accelerometer noise, and the full int16_t range */
+			TEST_EQ(run_window(sizes[i], axes, 200), EC_SUCCESS,
+				"%d");
+			TEST_EQ(run_window(sizes[i], axes, INT16_MAX),
+				EC_SUCCESS, "%d");
+		}
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_window_saturate(void)
+{
+	seed = 0x9e3779b9;
+	/* Out of range samples are clamped, in the window and the reference */
+	TEST_EQ(run_window(16, 3, 100000), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_window_overflow(void)
+{
+	struct stats_window w;
+	const int extreme[2] = { INT16_MIN, INT16_MAX };
+	/* The last UINT16_MAX of 2 * UINT16_MAX + 1 alternating samples */
+	const int64_t lows = (UINT16_MAX + 1) / 2, highs = UINT16_MAX / 2;
+	const int64_t sum = lows * INT16_MIN + highs * INT16_MAX;
+	const int64_t sum_sq = lows * INT16_MIN * INT16_MIN +
+			       highs * INT16_MAX * INT16_MAX;
+	int i;
+
+	stats_window_init(&w, history, UINT16_MAX, 1);
+	for (i = 0; i < 2 * UINT16_MAX + 1; i++)
+		stats_window_add(&w, &extreme[i & 1]);
+
+	TEST_EQ(w.sum[0], (int32_t)sum, "%d");
+	TEST_ASSERT(stats_window_n2_variance(&w, 0) ==
+		    (uint64_t)(UINT16_MAX * sum_sq - sum * sum));
+
+	return EC_SUCCESS;
+}
+
+/*
+ * Feed count samples of origin + noise to a batch, and compare it to the
+ * reference. Tolerances account for the 16 fractional bits of fp_t.
+ */
+static int run_batch(double origin, double noise, int count)
+{
+	struct stats_batch b;
+	double x[3][512];
+	fpv3_t mean, var, var_u;
+	int a, i;
+
+	TEST_ASSERT(count <= ARRAY_SIZE(x[0]));
+
+	stats_batch_reset(&b);
+	for (i = 0; i < count; i++) {
+		for (a = 0; a < 3; a++) {
+			double v = origin + noise * rand_range(1000) / 1000;
+
+			/* Round to fp_t first so both sides see the same */
+			x[a][i] = FP_TO_FLOAT(FLOAT_TO_FP(v));
+		}
+		stats_batch_add(&b, FLOAT_TO_FP(x[0][i]), FLOAT_TO_FP(x[1][i]),
+				FLOAT_TO_FP(x[2][i]));
+	}
+
+	TEST_EQ(stats_batch_compute(&b, false, mean, var), EC_SUCCESS, "%d");
+	TEST_EQ(stats_batch_compute(&b, true, NULL, var_u), EC_SUCCESS, "%d");
+
+	for (a = 0; a < 3; a++) {
+		double sum = 0, sum_sq = 0, m, v, rel;
+
+		for (i = 0; i < count; i++)
+			sum += x[a][i];
+		m = sum / count;
+		for (i = 0; i < count; i++)
+			sum_sq += (x[a][i] - m) * (x[a][i] - m);
+		v = sum_sq / count;
+
+		/* The rounding of 1/count is a relative error on the result */
+		rel = count / 65536.0;
+
+		TEST_NEAR(FP_TO_FLOAT(mean[a]), m,
+			  0.0002 + fabs(m - x[a][0]) * rel, "%f");
+		TEST_NEAR(FP_TO_FLOAT(var[a]), v, 0.0002 + v * (0.01 + rel),
+			  "%f");
+		TEST_NEAR(FP_TO_FLOAT(var_u[a]), sum_sq / (count - 1),
+			  0.0002 + v * (0.01 + rel), "%f");
+	}
+
+	return EC_SUCCESS;
+}
+
+static int test_batch_random(void)
+{
+	seed = 0x12345678;
+	/* Still accelerometer, in m/s^2 */
+	TEST_EQ(run_batch(9.8, 0.05, 100), EC_SUCCESS, "%d");
+	/* Still gyroscope, in rad/s */
+	TEST_EQ(run_batch(0.01, 0.005, 50), EC_SUCCESS, "%d");
+	/* Moving */
+	TEST_EQ(run_batch(-3.0, 2.0, 200), EC_SUCCESS, "%d");
+	/*
+	 * sum(x^2) alone would be 500 * 20^2, way past what fp_t holds.
+	 * Summing relative to the first sample keeps it small.
+	 */
+	TEST_EQ(run_batch(20.0, 0.1, 500), EC_SUCCESS, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_batch_too_few(void)
+{
+	struct stats_batch b;
+	fpv3_t mean, var;
+
+	stats_batch_reset(&b);
+	TEST_EQ(stats_batch_compute(&b, false, mean, var), EC_ERROR_INVAL,
+		"%d");
+
+	stats_batch_add(&b, INT_TO_FP(1), INT_TO_FP(2), INT_TO_FP(3));
+	TEST_EQ(stats_batch_compute(&b, true, mean, var), EC_ERROR_INVAL,
+		"%d");
+	TEST_EQ(stats_batch_compute(&b, false, mean, var), EC_SUCCESS, "%d");
+	TEST_EQ(mean[Z], INT_TO_FP(3), "%d");
+	TEST_EQ(var[Z], INT_TO_FP(0), "%d");
+
+	/* A reset batch starts over from its next sample */
+	stats_batch_reset(&b);
+	stats_batch_add(&b, INT_TO_FP(5), INT_TO_FP(5), INT_TO_FP(5));
+	TEST_EQ(stats_batch_compute(&b, false, mean, var), EC_SUCCESS, "%d");
+	TEST_EQ(mean[X], INT_TO_FP(5), "%d");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, const char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_window_random);
+	RUN_TEST(test_window_saturate);
+	RUN_TEST(test_window_overflow);
+	RUN_TEST(test_batch_random);
+	RUN_TEST(test_batch_too_few);
+
+	test_print_result();
+}
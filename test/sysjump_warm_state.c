@@ -0,0 +1,178 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * State handed from RO to RW on a sysjump, and the init hook times.
+ */
+
+#include "common.h"
+#include "cros_board_info.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "i2c.h"
+#include "sysjump.h"
+#include "system.h"
+#include "test_util.h"
+#include "timer.h"
+#include "util.h"
+#include "write_protect.h"
+
+#define SKU_ID 7
+#define SLOW_INIT_US (5 * MSEC)
+
+/* Small enough for a read to take several pages */
+#define PAGE_ENTRIES 4
+
+/* EEPROM transactions */
+static int eeprom_xfers;
+
+void i2c_start_xfer_notify(const int port, const uint16_t addr_flags)
+{
+	if (port == I2C_PORT_EEPROM && addr_flags == I2C_ADDR_EEPROM_FLAGS)
+		eeprom_xfers++;
+}
+
+void i2c_end_xfer_notify(const int port, const uint16_t addr_flags)
+{
+}
+
+static void slow_init(void)
+{
+	udelay(SLOW_INIT_US);
+}
+DECLARE_HOOK(HOOK_INIT, slow_init, HOOK_PRIO_DEFAULT);
+
+test_static int test_cbi_before_jump(void)
+{
+	struct {
+		struct ec_params_set_cbi p;
+		uint32_t value;
+	} params = {
+		.p = { .tag = CBI_TAG_SKU_ID,
+		       .flag = CBI_SET_INIT,
+		       .size = sizeof(uint32_t) },
+		.value = SKU_ID,
+	};
+	uint32_t sku;
+
+	write_protect_set(0);
+	TEST_EQ(test_send_host_command(EC_CMD_SET_CROS_BOARD_INFO, 0, &params,
+				       sizeof(params), NULL, 0),
+		EC_RES_SUCCESS, "%d");
+
+	/* Read back from the EEPROM, so the cache is clean */
+	cbi_invalidate_cache();
+	eeprom_xfers = 0;
+	sku = 0;
+	TEST_EQ(cbi_get_sku_id(&sku), EC_SUCCESS, "%d");
+	TEST_EQ(sku, SKU_ID, "%u");
+	TEST_GT(eeprom_xfers, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_jump(void)
+{
+	system_run_image_copy(EC_IMAGE_RW);
+
+	/* Shouldn't reach here */
+	return EC_ERROR_UNKNOWN;
+}
+
+test_static int test_cbi_after_jump(void)
+{
+	uint32_t sku = 0;
+
+	/* The EEPROM of the emulator didn't survive, the tag did */
+	eeprom_xfers = 0;
+	TEST_EQ(cbi_get_sku_id(&sku), EC_SUCCESS, "%d");
+	TEST_EQ(sku, SKU_ID, "%u");
+	TEST_EQ(eeprom_xfers, 0, "%d");
+
+	/* Once invalidated, the cache comes from the EEPROM again */
+	cbi_invalidate_cache();
+	TEST_NE(cbi_get_sku_id(&sku), EC_SUCCESS, "%d");
+	TEST_GT(eeprom_xfers, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_jump_data_layout(void)
+{
+	const uint8_t *data;
+	int version, size;
+
+	data = system_get_jump_tag(SYSJUMP_TAG_CBI, &version, &size);
+	TEST_ASSERT(data);
+
+	/* Only taken with the version and size it was saved with */
+	TEST_EQ(system_get_jump_data(SYSJUMP_TAG_CBI, version, size), data,
+		"%p");
+	TEST_EQ(system_get_jump_data(SYSJUMP_TAG_CBI, version + 1, size),
+		NULL, "%p");
+	TEST_EQ(system_get_jump_data(SYSJUMP_TAG_CBI, version, size + 4),
+		NULL, "%p");
+
+	return EC_SUCCESS;
+}
+
+test_static int test_init_times(void)
+{
+	union {
+		struct ec_response_hook_init_times r;
+		uint8_t buf[sizeof(struct ec_response_hook_init_times) +
+			    PAGE_ENTRIES * sizeof(struct ec_hook_init_time)];
+	} resp;
+	struct ec_params_hook_init_times p = {};
+	uint32_t sum = 0, last_prio = 0;
+	bool found = false;
+	int i;
+
+	do {
+		TEST_EQ(test_send_host_command(EC_CMD_HOOK_INIT_TIMES, 0, &p,
+					       sizeof(p), &resp, sizeof(resp)),
+			EC_RES_SUCCESS, "%d");
+		TEST_LE(resp.r.count, PAGE_ENTRIES, "%d");
+		TEST_EQ(resp.r.flags, EC_HOOK_INIT_TIMES_FLAG_JUMPED, "%d");
+		TEST_EQ(resp.r.untracked, 0, "%d");
+
+		for (i = 0; i < resp.r.count; i++) {
+			const struct ec_hook_init_time *e = &resp.r.entries[i];
+
+			/* Hooks run in priority order */
+			TEST_GE(e->priority, last_prio, "%u");
+			last_prio = e->priority;
+			sum += e->time_us;
+
+			if (e->routine == (uint32_t)(uintptr_t)slow_init) {
+				TEST_EQ(e->priority, HOOK_PRIO_DEFAULT, "%u");
+				TEST_GE(e->time_us, SLOW_INIT_US, "%u");
+				found = true;
+			}
+		}
+		p.index += resp.r.count;
+	} while (resp.r.count);
+
+	TEST_EQ(p.index, resp.r.total, "%d");
+	TEST_GT(resp.r.total, PAGE_ENTRIES, "%d");
+	TEST_ASSERT(found);
+	TEST_LE(sum, resp.r.total_us, "%u");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, const char **argv)
+{
+	test_reset();
+
+	if (system_get_image_copy() == EC_IMAGE_RO) {
+		RUN_TEST(test_cbi_before_jump);
+		RUN_TEST(test_jump);
+	} else {
+		RUN_TEST(test_cbi_after_jump);
+		RUN_TEST(test_jump_data_layout);
+		RUN_TEST(test_init_times);
+	}
+
+	test_print_result();
+}
@@ -51,10 +51,24 @@
 #define CONFIG_BACKLIGHT_REQ_GPIO GPIO_PCH_BKLTEN
 #endif
 
+#ifdef TEST_CBI
+#define CONFIG_I2C_XFER_BOARD_CALLBACK
+#endif
+
+#ifdef TEST_SYSJUMP_WARM_STATE
+#define CONFIG_HOOK_INIT_TIMES
+#define CONFIG_I2C_XFER_BOARD_CALLBACK
+#define CONFIG_SYSJUMP_WARM_STATE
+#endif
+
 #ifdef TEST_CBI_WP
 #define CONFIG_EEPROM_CBI_WP
 #endif
 
+#ifdef TEST_HOST_COMMAND
+#define CONFIG_HOSTCMD_STATS
+#endif
+
 #ifdef TEST_FLASH_LOG
 #define CONFIG_CRC8
 #define CONFIG_FLASH_ERASED_VALUE32 (-1U)
@@ -64,15 +78,21 @@
 #define CONFIG_MALLOC
 #endif
 
-#ifdef TEST_KB_8042
+#if defined(TEST_KB_8042) || defined(TEST_KB_8042_FAST)
 #define CONFIG_KEYBOARD_PROTOCOL_8042
 #define CONFIG_8042_AUX
+#define CONFIG_8042_LATENCY
 #define CONFIG_KEYBOARD_DEBUG
+#ifdef TEST_KB_8042_FAST
+#define CONFIG_8042_FAST_PATH
+#endif
 #endif
 
 #ifdef TEST_KB_MKBP
 #define CONFIG_KEYBOARD_PROTOCOL_MKBP
 #define CONFIG_MKBP_EVENT
+#define CONFIG_MKBP_EVENT_BATCH
+#define CONFIG_MKBP_INPUT_DEVICES
 #define CONFIG_MKBP_USE_GPIO
 #endif
 
@@ -89,6 +109,11 @@
 #define CONFIG_MATH_UTIL
 #endif
 
+#ifdef TEST_STREAMING_STATS
+#undef CONFIG_FPU
+#define CONFIG_STREAMING_STATS
+#endif
+
 #ifdef TEST_MAG_CAL
 #define CONFIG_MAG_CALIBRATE
 #endif
@@ -115,7 +140,8 @@
 	defined(TEST_FPSENSOR_CRYPTO) ||                      \
 	defined(TEST_FPSENSOR_AUTH_CRYPTO_STATELESS) ||       \
 	defined(TEST_FPSENSOR_AUTH_CRYPTO_STATEFUL) ||        \
-	defined(TEST_FPSENSOR_AUTH_COMMANDS)
+	defined(TEST_FPSENSOR_AUTH_COMMANDS) ||               \
+	defined(TEST_FPSENSOR_TEMPLATE_LOAD)
 #define CONFIG_BORINGSSL_CRYPTO
 #define CONFIG_ROLLBACK_SECRET_SIZE 32
 #define CONFIG_SHA256
@@ -328,6 +354,8 @@ enum sensor_id {
 #define CONFIG_CHARGER_DEFAULT_CURRENT_LIMIT 4032
 #define CONFIG_CHARGER_DISCHARGE_ON_AC
 #define CONFIG_CHARGER_DISCHARGE_ON_AC_CUSTOM
+#define CONFIG_CHARGER_SHADOW_REGS
+#define CONFIG_CHARGER_STEADY_STATE_POLL
 #define CONFIG_I2C
 #define CONFIG_I2C_CONTROLLER
 int board_discharge_on_ac(int enabled);
@@ -434,6 +462,12 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_SW_CRC
 #endif
 
+#ifdef TEST_USB_MUX
+#define CONFIG_USBC_SS_MUX
+#define CONFIG_USB_MUX_SHADOW_STATE
+#define CONFIG_USB_PD_PORT_MAX_COUNT 2
+#endif
+
 #if defined(TEST_USB_PD_TIMER)
 #define CONFIG_USB_PD_PORT_MAX_COUNT 2
 #define CONFIG_MATH_UTIL
@@ -563,7 +597,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #undef CONFIG_USB_PD_HOST_CMD
 #endif
 
-#ifdef TEST_USB_TCPMV2_COMPLIANCE
+#if defined(TEST_USB_TCPMV2_COMPLIANCE) ||            \
+	defined(TEST_USB_TCPMV2_COMPLIANCE_SKIP_IDLE) || \
+	defined(TEST_USB_PD_DISCOVERY_CACHE) ||          \
+	defined(TEST_USB_PD_SM_TRACE)
 #define CONFIG_USB_DRP_ACC_TRYSRC
 #define CONFIG_USB_PD_DUAL_ROLE
 #define CONFIG_USB_PD_DUAL_ROLE_AUTO_TOGGLE
@@ -592,6 +629,15 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_PD_EXTENDED_MESSAGES
 #define CONFIG_USB_PD_DECODE_SOP
 #define CONFIG_USB_PD_3A_PORTS 0 /* Host does not define a 3.0 A PDO */
+#ifdef TEST_USB_TCPMV2_COMPLIANCE_SKIP_IDLE
+#define CONFIG_USBC_SM_SKIP_IDLE
+#endif
+#ifdef TEST_USB_PD_DISCOVERY_CACHE
+#define CONFIG_USB_PD_DISCOVERY_CACHE
+#endif
+#ifdef TEST_USB_PD_SM_TRACE
+#define CONFIG_USB_PD_SM_TRACE
+#endif
 #endif
 
 #ifdef TEST_USB_PD_INT
@@ -661,6 +707,7 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_USB_POWER_DELIVERY
 #define CONFIG_BATTERY
 #define CONFIG_BATTERY_SMART
+#define CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS 5
 #define CONFIG_I2C
 #define CONFIG_I2C_CONTROLLER
 #define I2C_PORT_BATTERY 0
@@ -682,6 +729,10 @@ int ncp15wb_calculate_temp(uint16_t adc);
 #define CONFIG_HOSTCMD_RTC
 #endif
 
+#ifdef TEST_UPDATE_FW_WINDOW
+#define CONFIG_UPDATE_WINDOW
+#endif
+
 #ifdef TEST_VBOOT
 #define CONFIG_RWSIG
 #define CONFIG_SHA256
@@ -0,0 +1,326 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Windowed firmware update: the test plays the USB transport and the host,
+ * sending blocks ahead of their confirmations.
+ */
+
+#include "byteorder.h"
+#include "common.h"
+#include "flash.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "update_fw.h"
+#include "util.h"
+
+#define BLOCK_SIZE CONFIG_UPDATE_PDU_SIZE
+#define IMAGE_SIZE (4 * BLOCK_SIZE)
+
+/* Time to get a block across USB, for the throughput comparison */
+#define TRANSFER_US 2000
+
+static uint8_t image[IMAGE_SIZE];
+
+static struct update_block_ack acks[64];
+static int ack_count;
+
+/* Flash erases and writes, and the time each one takes */
+static int flash_ops;
+static int flash_op_us;
+
+struct transfer_result {
+	int written;
+	int skipped;
+	int rewinds;
+	uint32_t time_us;
+};
+
+void fw_update_window_ack(const struct update_block_ack *ack)
+{
+	acks[ack_count++ % ARRAY_SIZE(acks)] = *ack;
+	task_wake(TASK_ID_TEST_RUNNER);
+}
+
+int flash_pre_op(void)
+{
+	flash_ops++;
+	if (flash_op_us)
+		usleep(flash_op_us);
+	return EC_SUCCESS;
+}
+
+/* Start an update like the host does, returning where the section is */
+static uint32_t section_base(void)
+{
+	union {
+		struct update_command cmd;
+		struct first_response_pdu rpdu;
+	} pdu = {};
+	size_t response_size;
+
+	fw_update_command_handler(&pdu, sizeof(pdu.cmd), &response_size);
+	return be32toh(pdu.rpdu.common.offset);
+}
+
+static uint8_t *flash_at(uint32_t offset)
+{
+	return (uint8_t *)(CONFIG_PROGRAM_MEMORY_BASE + offset);
+}
+
+static int send_block(uint32_t addr, const uint8_t *data, size_t size,
+		      uint32_t seq)
+{
+	struct update_command *cmd = fw_update_window_get_buffer();
+
+	if (!cmd)
+		return EC_ERROR_OVERFLOW;
+
+	if (flash_op_us)
+		usleep(TRANSFER_US);
+	cmd->block_digest = htobe32(seq);
+	cmd->block_base = htobe32(addr);
+	memcpy(cmd + 1, data, size);
+	fw_update_window_submit(sizeof(*cmd) + size);
+	return EC_SUCCESS;
+}
+
+/*
+ * Send an image to the start of the update section in blocks of block_size,
+ * with up to window blocks in flight, the way usb_updater2 does.
+ */
+static int transfer(const uint8_t *data, size_t len, size_t block_size,
+		    int window, struct transfer_result *result)
+{
+	const uint32_t base = section_base();
+	int count = 0, acked = 0;
+	uint32_t seq = 0;
+	size_t offset = 0, resume = 0;
+	bool rewinding = false;
+	timestamp_t start = get_time();
+
+	memset(result, 0, sizeof(*result));
+	ack_count = 0;
+	TEST_EQ(fw_update_window_open(window), window, "%d");
+
+	while (offset < len || count) {
+		while (!rewinding && offset < len && count < window) {
+			size_t size = MIN(len - offset, block_size);
+
+			TEST_EQ(send_block(base + offset, data + offset, size,
+					   seq),
+				EC_SUCCESS, "%d");
+			count++;
+			seq++;
+			offset += size;
+		}
+
+		while (acked == ack_count)
+			TEST_NE(task_wait_event(SECOND), TASK_EVENT_TIMER,
+				"%d");
+
+		for (; acked < ack_count; acked++) {
+			const struct update_block_ack *a = &acks[acked];
+
+			TEST_GT(count, 0, "%d");
+			TEST_EQ(be32toh(a->seq), seq - count, "%u");
+			TEST_EQ(a->return_value, UPDATE_SUCCESS, "%d");
+			count--;
+
+			switch (a->status) {
+			case UPDATE_BLOCK_WRITTEN:
+				result->written++;
+				break;
+			case UPDATE_BLOCK_SKIPPED:
+				result->skipped++;
+				break;
+			case UPDATE_BLOCK_REWIND:
+				result->rewinds++;
+				rewinding = true;
+				resume = be32toh(a->resume_offset) - base;
+				break;
+			}
+		}
+
+		if (rewinding && !count) {
+			TEST_LT(resume, offset, "%zu");
+			offset = resume;
+			rewinding = false;
+		}
+	}
+
+	result->time_us = get_time().val - start.val;
+	fw_update_window_close();
+	return EC_SUCCESS;
+}
+
+/* Fill the update section with something other than the image */
+static void scramble_section(void)
+{
+	uint32_t base = section_base();
+	uint8_t junk[IMAGE_SIZE];
+	int i;
+
+	for (i = 0; i < sizeof(junk); i++)
+		junk[i] = ~image[i];
+	crec_flash_physical_erase(base, IMAGE_SIZE);
+	crec_flash_physical_write(base, IMAGE_SIZE, junk);
+}
+
+static int test_full_update(void)
+{
+	struct transfer_result r;
+
+	scramble_section();
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 4, &r), EC_SUCCESS,
+		"%d");
+	TEST_EQ(r.written, IMAGE_SIZE / BLOCK_SIZE, "%d");
+	TEST_EQ(r.skipped, 0, "%d");
+	TEST_EQ(r.rewinds, 0, "%d");
+	TEST_ASSERT_ARRAY_EQ(flash_at(section_base()), image, IMAGE_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_identical_skipped(void)
+{
+	struct transfer_result r;
+
+	scramble_section();
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 4, &r), EC_SUCCESS,
+		"%d");
+
+	/* Sending the same image again does not touch the flash */
+	flash_ops = 0;
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 4, &r), EC_SUCCESS,
+		"%d");
+	TEST_EQ(r.written, 0, "%d");
+	TEST_EQ(r.skipped, IMAGE_SIZE / BLOCK_SIZE, "%d");
+	TEST_EQ(flash_ops, 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_partial_update(void)
+{
+	static uint8_t next[IMAGE_SIZE];
+	struct transfer_result r;
+
+	scramble_section();
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 4, &r), EC_SUCCESS,
+		"%d");
+
+	/* Only the blocks that changed are programmed */
+	memcpy(next, image, sizeof(next));
+	next[BLOCK_SIZE + 5] ^= 0x5a;
+	next[3 * BLOCK_SIZE] ^= 0xa5;
+	TEST_EQ(transfer(next, IMAGE_SIZE, BLOCK_SIZE, 4, &r), EC_SUCCESS,
+		"%d");
+	TEST_EQ(r.written, 2, "%d");
+	TEST_EQ(r.skipped, 2, "%d");
+	TEST_ASSERT_ARRAY_EQ(flash_at(section_base()), next, IMAGE_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_rewind(void)
+{
+	/* Half an erase bank per block */
+	const size_t block_size = CONFIG_FLASH_ERASE_SIZE / 2;
+	static uint8_t next[IMAGE_SIZE];
+	struct transfer_result r;
+
+	scramble_section();
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 4, &r), EC_SUCCESS,
+		"%d");
+
+	/*
+	 * The first half of the bank is already there, but goes away when
+	 * the bank is erased for the second half: it has to be sent again.
+	 */
+	memcpy(next, image, sizeof(next));
+	next[block_size] ^= 0xff;
+	TEST_EQ(transfer(next, 4 * block_size, block_size, 4, &r), EC_SUCCESS,
+		"%d");
+	TEST_EQ(r.rewinds, 1, "%d");
+	TEST_EQ(r.written, 2, "%d");
+	TEST_ASSERT_ARRAY_EQ(flash_at(section_base()), next, IMAGE_SIZE);
+
+	return EC_SUCCESS;
+}
+
+static int test_errors(void)
+{
+	uint32_t base = section_base();
+
+	/* The window is limited by the blocks the EC can buffer */
+	TEST_EQ(fw_update_window_open(100), CONFIG_UPDATE_WINDOW_BLOCKS, "%d");
+	fw_update_window_close();
+	TEST_EQ(fw_update_window_open(0), 1, "%d");
+	TEST_ASSERT(fw_update_window_is_open());
+
+	/* No more blocks than the window are taken */
+	ack_count = 0;
+	flash_op_us = 10 * MSEC;
+	TEST_EQ(send_block(base, image, BLOCK_SIZE, 0), EC_SUCCESS, "%d");
+	TEST_EQ(send_block(base, image, BLOCK_SIZE, 1), EC_ERROR_OVERFLOW,
+		"%d");
+	flash_op_us = 0;
+	while (!ack_count)
+		TEST_NE(task_wait_event(SECOND), TASK_EVENT_TIMER, "%d");
+
+	/* Blocks outside of the update section are refused */
+	ack_count = 0;
+	TEST_EQ(send_block(base - BLOCK_SIZE, image, BLOCK_SIZE, 7),
+		EC_SUCCESS, "%d");
+	while (!ack_count)
+		TEST_NE(task_wait_event(SECOND), TASK_EVENT_TIMER, "%d");
+	TEST_EQ(be32toh(acks[0].seq), 7, "%u");
+	TEST_EQ(acks[0].return_value, UPDATE_BAD_ADDR, "%d");
+	TEST_EQ(acks[0].status, UPDATE_BLOCK_DISCARDED, "%d");
+
+	fw_update_window_close();
+	TEST_ASSERT(!fw_update_window_is_open());
+	TEST_ASSERT(!fw_update_window_get_buffer());
+
+	return EC_SUCCESS;
+}
+
+static int test_throughput(void)
+{
+	struct transfer_result serial, windowed;
+
+	/* Slow USB and slow flash, so that overlapping them pays off */
+	flash_op_us = 50;
+	scramble_section();
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 1, &serial),
+		EC_SUCCESS, "%d");
+	scramble_section();
+	TEST_EQ(transfer(image, IMAGE_SIZE, BLOCK_SIZE, 4, &windowed),
+		EC_SUCCESS, "%d");
+	flash_op_us = 0;
+
+	TEST_LT(windowed.time_us, serial.time_us, "%u");
+
+	return EC_SUCCESS;
+}
+
+void run_test(int argc, const char **argv)
+{
+	int i;
+
+	test_reset();
+
+	for (i = 0; i < sizeof(image); i++)
+		image[i] = i * 7 + (i >> 8);
+
+	RUN_TEST(test_full_update);
+	RUN_TEST(test_identical_skipped);
+	RUN_TEST(test_partial_update);
+	RUN_TEST(test_rewind);
+	RUN_TEST(test_errors);
+	RUN_TEST(test_throughput);
+
+	test_print_result();
+}
@@ -0,0 +1,268 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * USB mux chains of two slow chips on two ports, each port with its own mux
+ * task, and muxes remembering the state they were last set to.
+ */
+
+#include "common.h"
+#include "ec_commands.h"
+#include "hooks.h"
+#include "host_command.h"
+#include "task.h"
+#include "test_util.h"
+#include "timer.h"
+#include "usb_mux.h"
+#include "usb_pd.h"
+#include "util.h"
+
+/* Time for a chip to take a new state: I2C writes and settling */
+#define CHIP_SET_US (20 * MSEC)
+#define CHAIN_CHIPS 2
+
+struct chip {
+	mux_state_t state;
+	int sets;
+};
+
+static struct chip chips[CONFIG_USB_PD_PORT_MAX_COUNT][CHAIN_CHIPS];
+
+/* The chip index along the chain stands in for the I2C address */
+static struct chip *to_chip(const struct usb_mux *me)
+{
+	return &chips[me->usb_port][me->i2c_addr_flags];
+}
+
+static int slow_init(const struct usb_mux *me)
+{
+	return EC_SUCCESS;
+}
+
+static int slow_set(const struct usb_mux *me, mux_state_t mux_state,
+		    bool *ack_required)
+{
+	struct chip *chip = to_chip(me);
+
+	*ack_required = false;
+	usleep(CHIP_SET_US);
+	chip->state = mux_state;
+	chip->sets++;
+
+	return EC_SUCCESS;
+}
+
+static int slow_get(const struct usb_mux *me, mux_state_t *mux_state)
+{
+	*mux_state = to_chip(me)->state;
+	return EC_SUCCESS;
+}
+
+static int slow_enter_low_power_mode(const struct usb_mux *me)
+{
+	to_chip(me)->state = USB_PD_MUX_NONE;
+	return EC_SUCCESS;
+}
+
+static const struct usb_mux_driver slow_mux_driver = {
+	.init = slow_init,
+	.set = slow_set,
+	.get = slow_get,
+	.enter_low_power_mode = slow_enter_low_power_mode,
+};
+
+#define SLOW_MUX(port, chip)                   \
+	{                                      \
+		.usb_port = (port),            \
+		.i2c_addr_flags = (chip),      \
+		.driver = &slow_mux_driver,    \
+	}
+
+static const struct usb_mux muxes[][CHAIN_CHIPS] = {
+	{ SLOW_MUX(0, 0), SLOW_MUX(0, 1) },
+	{ SLOW_MUX(1, 0), SLOW_MUX(1, 1) },
+};
+
+/* A retimer after the mux on each port */
+static const struct usb_mux_chain retimers[] = {
+	{ .mux = &muxes[0][1] },
+	{ .mux = &muxes[1][1] },
+};
+
+const struct usb_mux_chain usb_muxes[CONFIG_USB_PD_PORT_MAX_COUNT] = {
+	{ .mux = &muxes[0][0], .next = &retimers[0] },
+	{ .mux = &muxes[1][0], .next = &retimers[1] },
+};
+
+uint8_t board_get_usb_pd_port_count(void)
+{
+	return CONFIG_USB_PD_PORT_MAX_COUNT;
+}
+
+/* For the typec console command */
+enum tcpc_cc_polarity pd_get_polarity(int port)
+{
+	return POLARITY_CC1;
+}
+
+static int get_stats(int port, bool reset,
+		     struct ec_response_usb_pd_mux_stats *r)
+{
+	struct ec_params_usb_pd_mux_stats p = {
+		.port = port,
+		.flags = reset ? EC_USB_PD_MUX_STATS_FLAG_RESET : 0,
+	};
+
+	return test_send_host_command(EC_CMD_USB_PD_MUX_STATS, 0, &p,
+				      sizeof(p), r, sizeof(*r));
+}
+
+static void wait_set_completed(int port)
+{
+	while (!usb_mux_set_completed(port))
+		usleep(MSEC);
+}
+
+static void set_and_wait(int port, mux_state_t state)
+{
+	usb_mux_set(port, state,
+		    state == USB_PD_MUX_NONE ? USB_SWITCH_DISCONNECT :
+					       USB_SWITCH_CONNECT,
+		    0);
+	wait_set_completed(port);
+}
+
+static int test_same_state_elided(void)
+{
+	struct ec_response_usb_pd_mux_stats r;
+
+	set_and_wait(0, USB_PD_MUX_USB_ENABLED);
+	TEST_EQ(chips[0][0].sets, 1, "%d");
+	TEST_EQ(chips[0][1].sets, 1, "%d");
+
+	/* Nothing to write, for either chip */
+	set_and_wait(0, USB_PD_MUX_USB_ENABLED);
+	TEST_EQ(chips[0][0].sets, 1, "%d");
+	TEST_EQ(chips[0][1].sets, 1, "%d");
+	TEST_EQ(usb_mux_get(0), USB_PD_MUX_USB_ENABLED, "0x%x");
+
+	set_and_wait(0, USB_PD_MUX_DOCK);
+	TEST_EQ(chips[0][0].sets, 2, "%d");
+	TEST_EQ(chips[0][1].sets, 2, "%d");
+	TEST_EQ(usb_mux_get(0), USB_PD_MUX_DOCK, "0x%x");
+
+	TEST_EQ(get_stats(0, false, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.set_count, 3, "%u");
+	TEST_EQ(r.elided_count, 2, "%u");
+	/* The two chips of the chain, one after the other */
+	TEST_GE(r.last_latency_us, CHAIN_CHIPS * CHIP_SET_US, "%u");
+	TEST_GE(r.max_latency_us, r.last_latency_us, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_single_chip_elided(void)
+{
+	set_and_wait(0, USB_PD_MUX_USB_ENABLED);
+
+	/* Only the retimer is asked for a state it is not in */
+	usb_mux_set_single(0, 1, USB_PD_MUX_DOCK, USB_SWITCH_CONNECT, 0);
+	wait_set_completed(0);
+	usb_mux_set(0, USB_PD_MUX_DOCK, USB_SWITCH_CONNECT, 0);
+	wait_set_completed(0);
+
+	TEST_EQ(chips[0][0].sets, 2, "%d");
+	TEST_EQ(chips[0][1].sets, 2, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_reset_forgets_state(void)
+{
+	set_and_wait(1, USB_PD_MUX_USB_ENABLED);
+	TEST_EQ(chips[1][0].sets, 1, "%d");
+
+	/* The chips may have lost their state along with the AP */
+	hook_notify(HOOK_CHIPSET_RESET);
+	set_and_wait(1, USB_PD_MUX_USB_ENABLED);
+	TEST_EQ(chips[1][0].sets, 2, "%d");
+	TEST_EQ(chips[1][1].sets, 2, "%d");
+
+	/* So may they in low power mode, entered on disconnect */
+	set_and_wait(1, USB_PD_MUX_NONE);
+	TEST_EQ(chips[1][0].sets, 3, "%d");
+	usb_mux_set(1, USB_PD_MUX_NONE, USB_SWITCH_CONNECT, 0);
+	wait_set_completed(1);
+	TEST_EQ(chips[1][0].sets, 4, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_ports_in_parallel(void)
+{
+	struct ec_response_usb_pd_mux_stats r[2];
+	const uint32_t chain_us = CHAIN_CHIPS * CHIP_SET_US;
+	timestamp_t start = get_time();
+	uint32_t elapsed;
+
+	usb_mux_set(0, USB_PD_MUX_DOCK, USB_SWITCH_CONNECT, 1);
+	usb_mux_set(1, USB_PD_MUX_DOCK, USB_SWITCH_CONNECT, 1);
+	wait_set_completed(0);
+	wait_set_completed(1);
+	elapsed = time_since32(start);
+
+	TEST_EQ(get_stats(0, false, &r[0]), EC_RES_SUCCESS, "%d");
+	TEST_EQ(get_stats(1, false, &r[1]), EC_RES_SUCCESS, "%d");
+
+	/* One port after the other would take two chains */
+	TEST_LT(elapsed, 2 * chain_us, "%u");
+	TEST_LT(r[1].last_latency_us, 2 * chain_us, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_stats_reset(void)
+{
+	struct ec_response_usb_pd_mux_stats r;
+	struct ec_params_usb_pd_mux_stats p = {
+		.port = CONFIG_USB_PD_PORT_MAX_COUNT,
+	};
+
+	set_and_wait(0, USB_PD_MUX_USB_ENABLED);
+	TEST_EQ(get_stats(0, true, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.set_count, 1, "%u");
+	TEST_EQ(get_stats(0, false, &r), EC_RES_SUCCESS, "%d");
+	TEST_EQ(r.set_count, 0, "%u");
+	TEST_EQ(r.max_latency_us, 0, "%u");
+
+	TEST_EQ(test_send_host_command(EC_CMD_USB_PD_MUX_STATS, 0, &p,
+				       sizeof(p), &r, sizeof(r)),
+		EC_RES_INVALID_PARAM, "%d");
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	struct ec_response_usb_pd_mux_stats r;
+	int port;
+
+	for (port = 0; port < CONFIG_USB_PD_PORT_MAX_COUNT; port++) {
+		set_and_wait(port, USB_PD_MUX_NONE);
+		get_stats(port, true, &r);
+	}
+	memset(chips, 0, sizeof(chips));
+}
+
+void run_test(int argc, const char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_same_state_elided);
+	RUN_TEST(test_single_chip_elided);
+	RUN_TEST(test_reset_forgets_state);
+	RUN_TEST(test_ports_in_parallel);
+	RUN_TEST(test_stats_reset);
+
+	test_print_result();
+}
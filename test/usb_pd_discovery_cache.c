@@ -0,0 +1,197 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Time to DisplayPort mode entry with a dock that is plugged, unplugged and
+ * plugged again, with the discovery cache answering for the second attach.
+ */
+
+#include "mock/tcpci_i2c_mock.h"
+#include "mock/usb_mux_mock.h"
+#include "task.h"
+#include "tcpm/tcpci.h"
+#include "test_util.h"
+#include "timer.h"
+#include "usb_pd.h"
+#include "usb_tc_sm.h"
+#include "usb_tcpmv2_compliance.h"
+
+#define DOCK_VID 0x18d1
+#define DOCK_PID 0x5099
+#define DOCK_XID 0x1234
+#define DOCK_BCD 0x0101
+
+/* Discover Identity ACK of the dock: a modal UFP hub */
+static const uint32_t dock_identity[] = {
+	VDO_IDH(0, 1, IDH_PTYPE_HUB, 1, DOCK_VID),
+	VDO_CSTAT(DOCK_XID),
+	VDO_PRODUCT(DOCK_PID, DOCK_BCD),
+};
+
+/* A DisplayPort UFP_D receptacle with pin assignments C and D */
+static const uint32_t dock_dp_mode = VDO_MODE_DP(
+	0, MODE_DP_PIN_C | MODE_DP_PIN_D, 0, 1, MODE_DP_V13, MODE_DP_SNK);
+
+struct attach_result {
+	/* From the explicit contract to the Enter Mode request, in us */
+	uint32_t time_to_alt_mode;
+	/* Discover Identity, SVIDs and Modes requests on SOP */
+	int discovery_vdms;
+};
+
+static void vdm_ack(const uint32_t *req, const uint32_t *vdos, int cnt)
+{
+	uint32_t msg[VDO_MAX_SIZE];
+
+	msg[0] = (req[0] & ~VDO_CMDT_MASK) | VDO_CMDT(CMDT_RSP_ACK);
+	memcpy(&msg[1], vdos, cnt * sizeof(uint32_t));
+	partner_send_msg(TCPCI_MSG_SOP, PD_DATA_VENDOR_DEF, cnt + 1, 0, msg);
+}
+
+/*
+ * Answer the DUT as the dock from attach until it asks to enter
+ * DisplayPort mode.
+ */
+static int attach_dock(struct attach_result *result)
+{
+	struct possible_tx possible[] = {
+		{ TCPCI_MSG_SOP, 0, PD_DATA_VENDOR_DEF },
+		{ TCPCI_MSG_SOP_PRIME, 0, PD_DATA_VENDOR_DEF },
+		{ TCPCI_MSG_SOP, PD_CTRL_GET_SOURCE_CAP, 0 },
+		{ TCPCI_MSG_SOP, PD_CTRL_GET_SINK_CAP, 0 },
+		{ TCPCI_MSG_SOP, PD_CTRL_GET_REVISION, 0 },
+	};
+	uint64_t start;
+	uint8_t data[PD_MAX_EXTENDED_MSG_LEN];
+	const uint32_t *req = (const uint32_t *)&data[3];
+	uint32_t svids = VDO_SVID(USB_SID_DISPLAYPORT, 0);
+	int found, rv;
+
+	result->discovery_vdms = 0;
+
+	TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+		EC_SUCCESS, "%d");
+	start = get_time().val;
+
+	while (1) {
+		rv = verify_tcpci_possible_tx(possible, ARRAY_SIZE(possible),
+					      &found, data, sizeof(data), NULL,
+					      -1);
+		TEST_EQ(rv, EC_SUCCESS, "%d");
+		mock_set_alert(TCPC_REG_ALERT_TX_SUCCESS);
+		task_wait_event(10 * MSEC);
+
+		switch (found) {
+		case 0:
+			break;
+		case 1:
+			/* No cable: nothing answers on SOP' */
+			continue;
+		case 2:
+			partner_send_msg(TCPCI_MSG_SOP, PD_DATA_SOURCE_CAP, 1,
+					 0, &pdo);
+			continue;
+		default:
+			partner_send_msg(TCPCI_MSG_SOP, PD_CTRL_NOT_SUPPORTED,
+					 0, 0, NULL);
+			continue;
+		}
+
+		switch (PD_VDO_CMD(req[0])) {
+		case CMD_DISCOVER_IDENT:
+			result->discovery_vdms++;
+			vdm_ack(req, dock_identity, ARRAY_SIZE(dock_identity));
+			break;
+		case CMD_DISCOVER_SVID:
+			result->discovery_vdms++;
+			vdm_ack(req, &svids, 1);
+			break;
+		case CMD_DISCOVER_MODES:
+			result->discovery_vdms++;
+			TEST_EQ(PD_VDO_VID(req[0]), USB_SID_DISPLAYPORT,
+				"0x%x");
+			vdm_ack(req, &dock_dp_mode, 1);
+			break;
+		case CMD_ENTER_MODE:
+			TEST_EQ(PD_VDO_VID(req[0]), USB_SID_DISPLAYPORT,
+				"0x%x");
+			result->time_to_alt_mode = get_time().val - start;
+			return EC_SUCCESS;
+		default:
+			partner_send_msg(TCPCI_MSG_SOP, PD_CTRL_NOT_SUPPORTED,
+					 0, 0, NULL);
+			break;
+		}
+	}
+}
+
+static void detach_dock(void)
+{
+	mock_set_cc(MOCK_CC_DUT_IS_SRC, MOCK_CC_SRC_OPEN, MOCK_CC_SRC_OPEN);
+	mock_set_alert(TCPC_REG_ALERT_CC_STATUS);
+	task_wait_event(5 * SECOND);
+	partner_tx_msg_id_reset(TCPCI_MSG_SOP_ALL);
+}
+
+static int test_replug_skips_discovery(void)
+{
+	struct attach_result cold, cached;
+
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+
+	TEST_EQ(attach_dock(&cold), EC_SUCCESS, "%d");
+	/* Identity, SVIDs and the DisplayPort modes */
+	TEST_EQ(cold.discovery_vdms, 3, "%d");
+	TEST_EQ(pd_get_svid_count(PORT0, TCPCI_MSG_SOP), 1, "%d");
+	detach_dock();
+
+	TEST_EQ(attach_dock(&cached), EC_SUCCESS, "%d");
+	/* Only Discover Identity, to check that this is the same dock */
+	TEST_EQ(cached.discovery_vdms, 1, "%d");
+	TEST_EQ(pd_get_svid_count(PORT0, TCPCI_MSG_SOP), 1, "%d");
+	TEST_EQ(pd_get_svids_discovery(PORT0, TCPCI_MSG_SOP), PD_DISC_COMPLETE,
+		"%d");
+	TEST_ASSERT(pd_is_mode_discovered_for_svid(PORT0, TCPCI_MSG_SOP,
+						   USB_SID_DISPLAYPORT));
+	TEST_LT(cached.time_to_alt_mode, cold.time_to_alt_mode, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_different_dock_misses(void)
+{
+	struct attach_result result;
+
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+
+	/* Forgetting the dock is the same as a dock never seen before */
+	pd_discovery_cache_clear();
+	TEST_EQ(attach_dock(&result), EC_SUCCESS, "%d");
+	TEST_EQ(result.discovery_vdms, 3, "%d");
+	detach_dock();
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	partner_set_pd_rev(PD_REV30);
+	partner_tx_msg_id_reset(TCPCI_MSG_SOP_ALL);
+
+	mock_usb_mux_reset();
+	mock_tcpci_reset();
+
+	/* Restart the PD task and let it settle */
+	task_set_event(TASK_ID_PD_C0, TASK_EVENT_RESET_DONE);
+	task_wait_event(SECOND);
+}
+
+void run_test(int argc, const char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_replug_skips_discovery);
+	RUN_TEST(test_different_dock_misses);
+
+	test_print_result();
+}
@@ -0,0 +1,229 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * USB-PD state machine transition trace, read back with EC_CMD_PD_SM_TRACE
+ * over a contract negotiation.
+ */
+
+#include "ec_commands.h"
+#include "mock/tcpci_i2c_mock.h"
+#include "mock/usb_mux_mock.h"
+#include "task.h"
+#include "tcpm/tcpci.h"
+#include "test_util.h"
+#include "timer.h"
+#include "usb_pd.h"
+#include "usb_pe_sm.h"
+#include "usb_tc_sm.h"
+#include "usb_tcpmv2_compliance.h"
+
+#define TRACE_SIZE CONFIG_USB_PD_SM_TRACE_SIZE
+
+/* Small enough for a read to take several pages */
+#define PAGE_ENTRIES 5
+
+static struct ec_pd_sm_trace_entry entries[TRACE_SIZE];
+
+static enum ec_status trace_cmd(uint8_t cmd, uint8_t machine, uint8_t state,
+				uint32_t seq, void *resp, int resp_size)
+{
+	struct ec_params_pd_sm_trace p = {
+		.port = PORT0,
+		.cmd = cmd,
+		.machine = machine,
+		.state = state,
+		.seq = seq,
+	};
+
+	return test_send_host_command(EC_CMD_PD_SM_TRACE, 0, &p, sizeof(p),
+				      resp, resp_size);
+}
+
+/*
+ * Read the whole trace a page at a time, the way ectool does. Returns the
+ * number of entries, and the sequence number of the first one in *first.
+ */
+static int read_trace(uint32_t *first)
+{
+	union {
+		struct ec_response_pd_sm_trace r;
+		uint8_t buf[sizeof(struct ec_response_pd_sm_trace) +
+			    PAGE_ENTRIES * sizeof(struct ec_pd_sm_trace_entry)];
+	} resp;
+	uint32_t seq = 0;
+	int n = 0;
+
+	do {
+		if (trace_cmd(EC_PD_SM_TRACE_READ, 0, 0, seq, &resp,
+			      sizeof(resp)) != EC_RES_SUCCESS)
+			return -1;
+		if (n == 0)
+			*first = resp.r.seq;
+		else if (resp.r.seq != seq)
+			return -1;
+		if (resp.r.count > PAGE_ENTRIES ||
+		    n + resp.r.count > ARRAY_SIZE(entries))
+			return -1;
+
+		memcpy(&entries[n], resp.r.entries,
+		       resp.r.count * sizeof(entries[0]));
+		n += resp.r.count;
+		seq = resp.r.seq + resp.r.count;
+	} while (seq != resp.r.head);
+
+	return n;
+}
+
+static const char *state_name(enum ec_pd_sm machine, uint8_t state)
+{
+	static char name[64];
+
+	if (trace_cmd(EC_PD_SM_TRACE_STATE_NAME, machine, state, 0, name,
+		      sizeof(name)) != EC_RES_SUCCESS)
+		return NULL;
+
+	return name;
+}
+
+/* Index of the last entry of a state machine, or -1 */
+static int last_of(int n, enum ec_pd_sm machine)
+{
+	while (--n >= 0)
+		if (entries[n].machine == machine)
+			return n;
+
+	return -1;
+}
+
+static int test_contract_recorded(void)
+{
+	uint32_t first;
+	const char *name;
+	int n, i;
+
+	TEST_EQ(trace_cmd(EC_PD_SM_TRACE_CLEAR, 0, 0, 0, NULL, 0),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+	TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+		EC_SUCCESS, "%d");
+
+	n = read_trace(&first);
+	TEST_GT(n, 0, "%d");
+
+	for (i = 0; i < n; i++) {
+		TEST_LT(entries[i].machine, EC_PD_SM_COUNT, "%d");
+		TEST_EQ(entries[i].reserved, 0, "%d");
+		/* Each transition starts from where the last one ended */
+		if (i > 0) {
+			int prev = last_of(i, entries[i].machine);
+
+			TEST_GE(entries[i].timestamp, entries[i - 1].timestamp,
+				"%u");
+			if (prev >= 0)
+				TEST_EQ(entries[i].old_state,
+					entries[prev].new_state, "%d");
+		}
+	}
+
+	/* The last transitions lead to the states the machines are in now */
+	i = last_of(n, EC_PD_SM_TC);
+	TEST_GE(i, 0, "%d");
+	name = state_name(EC_PD_SM_TC, entries[i].new_state);
+	TEST_ASSERT(name);
+	TEST_ASSERT(!strcmp(name, tc_get_current_state(PORT0)));
+
+	i = last_of(n, EC_PD_SM_PE);
+	TEST_GE(i, 0, "%d");
+	name = state_name(EC_PD_SM_PE, entries[i].new_state);
+	TEST_ASSERT(name);
+	TEST_ASSERT(!strcmp(name, pe_get_current_state(PORT0)));
+
+	/* The protocol layer sent and received messages on the way */
+	TEST_GE(last_of(n, EC_PD_SM_PRL_TX), 0, "%d");
+
+	return EC_SUCCESS;
+}
+
+static int test_trace_wraps(void)
+{
+	uint32_t first;
+	int n, cycles;
+
+	TEST_EQ(trace_cmd(EC_PD_SM_TRACE_CLEAR, 0, 0, 0, NULL, 0),
+		EC_RES_SUCCESS, "%d");
+
+	/* Attach and detach until the ring went around */
+	for (cycles = 0; cycles < 4; cycles++) {
+		TEST_EQ(tcpci_startup(), EC_SUCCESS, "%d");
+		TEST_EQ(proc_pd_e1(PD_ROLE_DFP, INITIAL_AND_ALREADY_ATTACHED),
+			EC_SUCCESS, "%d");
+		mock_set_cc(MOCK_CC_DUT_IS_SRC, MOCK_CC_SRC_OPEN,
+			    MOCK_CC_SRC_OPEN);
+		mock_set_alert(TCPC_REG_ALERT_CC_STATUS);
+		task_wait_event(SECOND);
+		partner_tx_msg_id_reset(TCPCI_MSG_SOP_ALL);
+	}
+
+	/* Only the most recent entries are left, from a later sequence */
+	n = read_trace(&first);
+	TEST_EQ(n, TRACE_SIZE, "%d");
+	TEST_GT(first, 0, "%u");
+
+	return EC_SUCCESS;
+}
+
+static int test_clear_and_errors(void)
+{
+	struct ec_response_pd_sm_trace resp;
+	struct ec_params_pd_sm_trace p = {
+		.port = CONFIG_USB_PD_PORT_MAX_COUNT,
+		.cmd = EC_PD_SM_TRACE_READ,
+	};
+	uint32_t first;
+	char name[64];
+
+	TEST_EQ(trace_cmd(EC_PD_SM_TRACE_CLEAR, 0, 0, 0, NULL, 0),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(trace_cmd(EC_PD_SM_TRACE_READ, 0, 0, 0, &resp, sizeof(resp)),
+		EC_RES_SUCCESS, "%d");
+	TEST_EQ(resp.count, 0, "%d");
+	TEST_EQ(resp.seq, resp.head, "%u");
+	TEST_EQ(read_trace(&first), 0, "%d");
+
+	TEST_EQ(test_send_host_command(EC_CMD_PD_SM_TRACE, 0, &p, sizeof(p),
+				       &resp, sizeof(resp)),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(trace_cmd(EC_PD_SM_TRACE_STATE_NAME, EC_PD_SM_COUNT, 0, 0,
+			  name, sizeof(name)),
+		EC_RES_INVALID_PARAM, "%d");
+	TEST_EQ(trace_cmd(EC_PD_SM_TRACE_STATE_NAME, EC_PD_SM_TC,
+			  EC_PD_SM_STATE_NONE, 0, name, sizeof(name)),
+		EC_RES_INVALID_PARAM, "%d");
+
+	return EC_SUCCESS;
+}
+
+void before_test(void)
+{
+	partner_set_pd_rev(PD_REV30);
+	partner_tx_msg_id_reset(TCPCI_MSG_SOP_ALL);
+
+	mock_usb_mux_reset();
+	mock_tcpci_reset();
+
+	/* Restart the PD task and let it settle */
+	task_set_event(TASK_ID_PD_C0, TASK_EVENT_RESET_DONE);
+	task_wait_event(SECOND);
+}
+
+void run_test(int argc, const char **argv)
+{
+	test_reset();
+
+	RUN_TEST(test_contract_recorded);
+	RUN_TEST(test_trace_wraps);
+	RUN_TEST(test_clear_and_errors);
+
+	test_print_result();
+}
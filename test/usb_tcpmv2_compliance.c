@@ -8,6 +8,7 @@
 #include "task.h"
 #include "test_util.h"
 #include "timer.h"
+#include "usb_sm.h"
 #include "usb_tc_sm.h"
 #include "usb_tcpmv2_compliance.h"
 
@@ -30,10 +31,46 @@ void before_test(void)
 	tc_try_src_override(TRY_SRC_OVERRIDE_OFF);
 }
 
+#ifdef CONFIG_USBC_SM_SKIP_IDLE
+/*
+ * The compliance tests above pass with idle state machines skipped; check
+ * that skipping actually happened, and what is left to run on an idle
+ * port.
+ */
+static int test_sm_skip_idle(void)
+{
+	struct usbc_sm_stats stats;
+
+	usbc_sm_get_stats(PORT0, &stats);
+	/* Most of the time, the PE and the PRL have nothing to do */
+	TEST_GT(stats.skipped, stats.runs, "%u");
+
+	/* Sink from a non-PD supply, once the PE has given up on it */
+	TEST_EQ(test_connect_as_nonpd_sink(), EC_SUCCESS, "%d");
+	usbc_sm_reset_stats(PORT0);
+	task_wait_event(SECOND);
+
+	usbc_sm_get_stats(PORT0, &stats);
+	TEST_GT(stats.wakeups, 100, "%u");
+	/* Neither the PE nor the PRL has anything to do */
+	TEST_EQ(stats.runs, 0, "%u");
+	TEST_EQ(stats.skipped, 2 * stats.wakeups, "%u");
+	/* Only the TC state and its parent run */
+	TEST_LE(stats.run_calls, 2 * stats.wakeups, "%u");
+	TEST_EQ(tc_is_attached_snk(PORT0), true, "%d");
+
+	return EC_SUCCESS;
+}
+#endif /* CONFIG_USBC_SM_SKIP_IDLE */
+
 void run_test(int argc, const char **argv)
 {
 	test_reset();
 
+#ifdef CONFIG_USBC_SM_SKIP_IDLE
+	usbc_sm_reset_stats(PORT0);
+#endif
+
 	RUN_TEST(test_td_pd_ll_e3_dfp);
 	RUN_TEST(test_td_pd_ll_e3_ufp);
 	RUN_TEST(test_td_pd_ll_e4_dfp);
@@ -59,5 +96,9 @@ void run_test(int argc, const char **argv)
 	RUN_TEST(test_retry_count_sop);
 	RUN_TEST(test_retry_count_hard_reset);
 
+#ifdef CONFIG_USBC_SM_SKIP_IDLE
+	RUN_TEST(test_sm_skip_idle);
+#endif
+
 	test_print_result();
 }
@@ -27,14 +27,16 @@ endif
 -include private/util_flags.mk
 
 comm-objs=$(util-lock-objs:%=lock/%) comm-host.o comm-dev.o
-comm-objs+=comm-lpc.o comm-i2c.o misc_util.o comm-usb.o
+comm-objs+=comm-lpc.o comm-i2c.o misc_util.o comm-usb.o comm-socket.o
 
 iteflash-objs = iteflash.o usb_if.o
 ectool-objs=ectool.o ectool_keyscan.o ec_flash.o $(comm-objs)
 ectool-objs+=ectool_i2c.o
 ectool-objs+=../common/crc.o
+ectool-objs+=../common/fpsensor/fpsensor_frame_codec.o
 ectool_servo-objs=$(ectool-objs) comm-servo-spi.o
 lbplay-objs=lbplay.o $(comm-objs)
+lbcc-objs=lbcc.o ../common/lightbyte.o
 
 util/ectool.cc: $(out)/ec_version.h
 
@@ -4,6 +4,7 @@
  */
 
 #include "comm-host.h"
+#include "comm-socket.h"
 #include "cros_ec_dev.h"
 #include "ec_commands.h"
 #include "misc_util.h"
@@ -14,6 +15,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 
 int (*ec_command_proto)(int command, int version, const void *outdata,
 			int outsize, void *indata, int insize);
@@ -32,6 +34,7 @@ int comm_init_dev(const char *device_name) __attribute__((weak));
 int comm_init_lpc(void) __attribute__((weak));
 int comm_init_i2c(int i2c_bus) __attribute__((weak));
 int comm_init_servo_spi(const char *device_name) __attribute__((weak));
+int comm_init_socket(const char *path) __attribute__((weak));
 
 static int fake_readmem(int offset, int bytes, void *dest)
 {
@@ -66,6 +69,37 @@ static int fake_readmem(int offset, int bytes, void *dest)
 	return EC_MEMMAP_TEXT_MAX - 1;
 }
 
+/* How long to wait for the EC to finish updating a memmap region */
+#define MEMMAP_SNAPSHOT_TRIES 100
+#define MEMMAP_SNAPSHOT_RETRY_US 100
+
+int ec_readmem_snapshot(int seq_offset, int offset, int bytes, void *dest)
+{
+	uint8_t version, before, after;
+	int i, rv;
+
+	if (ec_readmem(EC_MEMMAP_ID_VERSION, 1, &version) < 0 ||
+	    version < EC_MEMMAP_SEQ_ID_VERSION)
+		return ec_readmem(offset, bytes, dest);
+
+	for (i = 0; i < MEMMAP_SNAPSHOT_TRIES; i++) {
+		if (ec_readmem(seq_offset, 1, &before) < 0)
+			return -1;
+		if (before & 1) {
+			usleep(MEMMAP_SNAPSHOT_RETRY_US);
+			continue;
+		}
+		rv = ec_readmem(offset, bytes, dest);
+		if (rv < 0)
+			return rv;
+		if (ec_readmem(seq_offset, 1, &after) < 0)
+			return -1;
+		if (before == after)
+			return rv;
+	}
+	return -EBUSY;
+}
+
 void set_command_offset(int offset)
 {
 	command_offset = offset;
@@ -90,6 +124,10 @@ int comm_init_alt(int interfaces, const char *device_name, int i2c_bus)
 	    !comm_init_servo_spi(device_name))
 		return 0;
 
+	/* The emulator socket is only used when asked for explicitly */
+	if (interfaces == COMM_SOCKET)
+		return !comm_init_socket || comm_init_socket(device_name);
+
 	/* Do not fallback to other communication methods if target is not a
 	 * cros_ec device */
 	dev_is_cros_ec = !strcmp(CROS_EC_DEV_NAME, device_name);
@@ -12,6 +12,12 @@
 #include "common.h"
 #include "ec_commands.h"
 
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /* ec_command return value for non-success result from EC */
 #define EECRESULT 1000
 
@@ -32,6 +38,7 @@ enum comm_interface {
 	COMM_I2C = BIT(2),
 	COMM_SERVO = BIT(3),
 	COMM_USB = BIT(4),
+	COMM_SOCKET = BIT(5),
 	COMM_ALL = -1
 };
 
@@ -39,7 +46,8 @@ enum comm_interface {
  * Initialize alternative interfaces
  *
  * @param interfaces	Interfaces to try; use COMM_ALL to try all of them.
- * @param device_name For DEV option, the device file to use.
+ * @param device_name For DEV option, the device file to use. For SOCKET, the
+ *		      path of the emulator's socket.
  * @param i2c_bus For I2C option, the bus number to use (or -1 to autodetect).
  * @return 0 in case of success, or error code.
  */
@@ -102,6 +110,14 @@ extern int (*ec_command_proto)(int command, int version, const void *outdata,
  */
 extern int (*ec_readmem)(int offset, int bytes, void *dest);
 
+/**
+ * Read a consistent snapshot of a memory-mapped region guarded by the
+ * sequence counter at seq_offset (EC_MEMMAP_*_SEQ), retrying while the EC
+ * updates it. ECs without sequence counters are read once, as ec_readmem()
+ * does. Returns the number of bytes read, or negative on error.
+ */
+int ec_readmem_snapshot(int seq_offset, int offset, int bytes, void *dest);
+
 /**
  * Wait for a MKBP event matching 'mask' for at most 'timeout' milliseconds.
  * Then read the incoming event content in 'buffer' (or at most
@@ -112,4 +128,8 @@ extern int (*ec_readmem)(int offset, int bytes, void *dest);
 extern int (*ec_pollevent)(unsigned long mask, void *buffer, size_t buf_size,
 			   int timeout);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif /* __UTIL_COMM_HOST_H */
@@ -0,0 +1,180 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Transport to an emulated EC (a test/ or board/host build) over the UNIX
+ * socket served by chip/host/host_socket.c. Packets on the wire are plain
+ * protocol v3 requests and responses, with no additional framing.
+ */
+
+#include "comm-host.h"
+#include "comm-socket.h"
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* Must match HOST_SOCKET_PACKET_SIZE in chip/host/host_socket.c */
+#define SOCKET_MAX_PACKET_SIZE 1024
+
+static int sock_fd = -1;
+
+static int sum_bytes(const void *data, int length)
+{
+	const uint8_t *bytes = (const uint8_t *)data;
+	int sum = 0;
+	int i;
+
+	for (i = 0; i < length; i++)
+		sum += bytes[i];
+	return sum;
+}
+
+static int read_all(void *buf, size_t size)
+{
+	uint8_t *p = (uint8_t *)buf;
+	ssize_t n;
+
+	while (size) {
+		n = read(sock_fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static int write_all(const void *buf, size_t size)
+{
+	const uint8_t *p = (const uint8_t *)buf;
+	ssize_t n;
+
+	while (size) {
+		n = write(sock_fd, p, size);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			return -1;
+		p += n;
+		size -= n;
+	}
+	return 0;
+}
+
+static int ec_command_socket(int command, int version, const void *outdata,
+			     int outsize, void *indata, int insize)
+{
+	uint8_t req_buf[SOCKET_MAX_PACKET_SIZE];
+	uint8_t resp_buf[SOCKET_MAX_PACKET_SIZE];
+	struct ec_host_request *req = (struct ec_host_request *)req_buf;
+	struct ec_host_response *resp = (struct ec_host_response *)resp_buf;
+
+	if (outsize > ec_max_outsize) {
+		fprintf(stderr, "Request is too large (%d > %d).\n", outsize,
+			ec_max_outsize);
+		return -EC_RES_ERROR;
+	}
+	if (insize > ec_max_insize) {
+		fprintf(stderr, "Response would be too large (%d > %d).\n",
+			insize, ec_max_insize);
+		return -EC_RES_ERROR;
+	}
+
+	req->struct_version = EC_HOST_REQUEST_VERSION;
+	req->checksum = 0;
+	req->command = command;
+	req->command_version = version;
+	req->reserved = 0;
+	req->data_len = outsize;
+	memcpy(req + 1, outdata, outsize);
+	req->checksum = (uint8_t)(-sum_bytes(req, sizeof(*req) + outsize));
+
+	if (write_all(req_buf, sizeof(*req) + outsize)) {
+		perror("Socket write failed");
+		return -EC_RES_ERROR;
+	}
+
+	if (read_all(resp, sizeof(*resp))) {
+		perror("Socket read failed");
+		return -EC_RES_ERROR;
+	}
+	if (resp->struct_version != EC_HOST_RESPONSE_VERSION) {
+		fprintf(stderr, "EC response version mismatch.\n");
+		return -EC_RES_INVALID_RESPONSE;
+	}
+	if (resp->data_len > sizeof(resp_buf) - sizeof(*resp)) {
+		/* Can't resynchronize the stream after this */
+		fprintf(stderr, "EC response too long.\n");
+		return -EC_RES_INVALID_RESPONSE;
+	}
+	if (read_all(resp + 1, resp->data_len)) {
+		perror("Socket read failed");
+		return -EC_RES_ERROR;
+	}
+
+	if ((uint8_t)sum_bytes(resp, sizeof(*resp) + resp->data_len)) {
+		fprintf(stderr, "Bad checksum on EC response.\n");
+		return -EC_RES_INVALID_CHECKSUM;
+	}
+
+	if (resp->result)
+		return -EECRESULT - resp->result;
+
+	if (resp->data_len > insize) {
+		fprintf(stderr, "EC returned too much data.\n");
+		return -EC_RES_RESPONSE_TOO_BIG;
+	}
+	memcpy(indata, resp + 1, resp->data_len);
+
+	return resp->data_len;
+}
+
+int comm_init_socket(const char *path)
+{
+	struct sockaddr_un addr = {};
+
+	addr.sun_family = AF_UNIX;
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return -1;
+	}
+	strcpy(addr.sun_path, path);
+
+	sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock_fd < 0) {
+		perror("Unable to create socket");
+		return -1;
+	}
+
+	if (connect(sock_fd, (struct sockaddr *)&addr, sizeof(addr))) {
+		fprintf(stderr, "Unable to connect to %s: %s\n", path,
+			strerror(errno));
+		close(sock_fd);
+		sock_fd = -1;
+		return -1;
+	}
+
+	ec_command_proto = ec_command_socket;
+	ec_max_outsize =
+		SOCKET_MAX_PACKET_SIZE - sizeof(struct ec_host_request);
+	ec_max_insize =
+		SOCKET_MAX_PACKET_SIZE - sizeof(struct ec_host_response);
+
+	return 0;
+}
+
+void comm_socket_exit(void)
+{
+	if (sock_fd >= 0)
+		close(sock_fd);
+	sock_fd = -1;
+}
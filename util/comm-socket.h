@@ -0,0 +1,32 @@
+/* Copyright 2023 The ChromiumOS Authors
+ * Use of this source code is governed by a BSD-style license that can be
+ * found in the LICENSE file.
+ *
+ * Header file for the emulator socket interface.
+ */
+
+#ifndef __UTIL_COMM_SOCKET_H
+#define __UTIL_COMM_SOCKET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Connect to the host command socket of an emulated EC.
+ *
+ * @param path  Path of the UNIX socket (EC_HOST_SOCKET of the emulator).
+ * @return      Zero if success or non-zero otherwise.
+ */
+int comm_init_socket(const char *path);
+
+/**
+ * Close the connection to the emulated EC.
+ */
+void comm_socket_exit(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* __UTIL_COMM_SOCKET_H */
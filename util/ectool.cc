@@ -6,6 +6,7 @@
 #include "battery.h"
 #include "chipset.h"
 #include "comm-host.h"
+#include "comm-socket.h"
 #include "comm-usb.h"
 #include "compile_time_macros.h"
 #include "crc.h"
@@ -13,6 +14,7 @@
 #include "ec_flash.h"
 #include "ec_version.h"
 #include "ectool.h"
+#include "fpsensor_frame_codec.h"
 #include "i2c.h"
 #include "lightbar.h"
 #include "lock/gec_lock.h"
@@ -61,6 +63,7 @@ enum {
 	OPT_ASCII,
 	OPT_I2C_BUS,
 	OPT_DEVICE,
+	OPT_SOCKET,
 };
 
 static struct option long_opts[] = { { "dev", 1, 0, OPT_DEV },
@@ -69,6 +72,7 @@ static struct option long_opts[] = { { "dev", 1, 0, OPT_DEV },
 				     { "ascii", 0, 0, OPT_ASCII },
 				     { "i2c_bus", 1, 0, OPT_I2C_BUS },
 				     { "device", 1, 0, OPT_DEVICE },
+				     { "socket", 1, 0, OPT_SOCKET },
 				     { NULL, 0, 0, 0 } };
 
 #define GEC_LOCK_TIMEOUT_SECS 30 /* 30 secs */
@@ -179,14 +183,16 @@ const char help_str[] =
 	"      Sets the value of the TPM seed.\n"
 	"  fpstats\n"
 	"      Prints timing statisitcs relating to capture and matching\n"
-	"  fptemplate [<infile>|<index 0..2>]\n"
-	"      Add a template if <infile> is provided, else dump it\n"
+	"  fptemplate [<infile>...|<index 0..2>]\n"
+	"      Add templates if <infile>s are provided, else dump one\n"
 	"  gpioget <GPIO name>\n"
 	"      Get the value of GPIO signal\n"
 	"  gpioset <GPIO name>\n"
 	"      Set the value of GPIO signal\n"
 	"  hangdetect <flags> <event_msec> <reboot_msec> | stop | start\n"
 	"      Configure or start/stop the hang detect timer\n"
+	"  hcstats [reset]\n"
+	"      Prints host command execution statistics\n"
 	"  hello\n"
 	"      Checks for basic communication with EC\n"
 	"  hibdelay [sec]\n"
@@ -207,6 +213,8 @@ const char help_str[] =
 	"      Perform I2C transfer on EC's I2C bus\n"
 	"  infopddev <port>\n"
 	"      Get info about USB type-C accessory attached to port\n"
+	"  inittimes\n"
+	"      Prints the time each init hook took at boot\n"
 	"  inventory\n"
 	"      Return the list of supported features\n"
 	"  kbfactorytest\n"
@@ -215,6 +223,8 @@ const char help_str[] =
 	"      Get keyboard ID of supported keyboards\n"
 	"  kbinfo\n"
 	"      Dump keyboard matrix dimensions\n"
+	"  kblatency [reset]\n"
+	"      Prints the time key events take to reach the host\n"
 	"  kbpress\n"
 	"      Simulate key press\n"
 	"  keyscan <beat_us> <filename>\n"
@@ -251,6 +261,8 @@ const char help_str[] =
 	"      Get All USB-PD alternate SVIDs and modes on <port>\n"
 	"  pdsetmode <port> <svid> <opos>\n"
 	"      Set USB-PD alternate SVID and mode on <port>\n"
+	"  pdtrace <port> [clear]\n"
+	"      Print USB-PD state transitions and spec timer violations\n"
 	"  port80flood\n"
 	"      Rapidly write bytes to port 80\n"
 	"  port80read\n"
@@ -370,6 +382,8 @@ const char help_str[] =
 	"as:\n"
 	"               Port, USB enabled, DP enabled, Polarity, HPD IRQ, "
 	"HPD LVL\n"
+	"  usbpdmuxstats [reset]\n"
+	"      Get USB-C SS mux set counts and latencies, optionally reset\n"
 	"  usbpdpower [port]\n"
 	"      Get USB PD power information\n"
 	"  version\n"
@@ -464,7 +478,8 @@ static int find_enum_from_text(const char *str,
 void print_help(const char *prog, int print_cmds)
 {
 	printf("Usage: %s [--dev=n] "
-	       "[--interface=dev|i2c|lpc] [--i2c_bus=n] [--device=vid:pid] ",
+	       "[--interface=dev|i2c|lpc] [--i2c_bus=n] [--device=vid:pid] "
+	       "[--socket=path] ",
 	       prog);
 	printf("[--name=cros_ec|cros_fp|cros_pd|cros_scp|cros_ish] [--ascii] ");
 	printf("<command> [params]\n\n");
@@ -474,6 +489,8 @@ void print_help(const char *prog, int print_cmds)
 	printf("  --interface Specifies the interface.\n\n");
 	printf("  --device    Specifies USB endpoint by vendor ID and product\n"
 	       "              ID (e.g. 18d1:5022).\n\n");
+	printf("  --socket    Specifies the host command socket of an\n"
+	       "              emulated EC (see EC_HOST_SOCKET).\n\n");
 	if (print_cmds)
 		puts(help_str);
 	else
@@ -519,18 +536,6 @@ static uint32_t read_mapped_mem32(uint8_t offset)
 	return val;
 }
 
-static int read_mapped_string(uint8_t offset, char *buffer, int max_size)
-{
-	int ret;
-
-	ret = ec_readmem(offset, max_size, buffer);
-	if (ret <= 0) {
-		fprintf(stderr, "failure in %s(): %d\n", __func__, ret);
-		exit(1);
-	}
-	return ret;
-}
-
 static int wait_event(long event_type,
 		      struct ec_response_get_next_event_v1 *buffer,
 		      size_t buffer_size, long timeout)
@@ -2139,6 +2144,60 @@ int cmd_apreset(int argc, char *argv[])
 
 #define FP_FRAME_INDEX_SIMPLE_IMAGE -1
 
+/*
+ * Download the start of the raw frame, compressed by the FPMCU.
+ *
+ * Each EC_CMD_FP_FRAME v1 command returns as many bytes of the frame as fit
+ * packed in the largest response. On real sensor frames, that takes about 20%
+ * fewer commands than copying the frame.
+ *
+ * @param buffer where to store the frame.
+ * @param size number of bytes of the frame to download.
+ *
+ * @returns 0 on success, negative on error.
+ */
+static int fp_download_frame_packed(uint8_t *buffer, size_t size)
+{
+	struct ec_params_fp_frame p;
+	struct ec_response_fp_frame_packed *r =
+		(struct ec_response_fp_frame_packed *)(ec_inbuf);
+	size_t offset = 0;
+	const int max_attempts = 3;
+	int num_attempts;
+	int rv = 0;
+
+	while (offset < size) {
+		p.offset = FP_FRAME_INDEX_RAW_IMAGE << FP_FRAME_INDEX_SHIFT |
+			   offset;
+		p.size = size - offset;
+		num_attempts = 0;
+		while (num_attempts < max_attempts) {
+			num_attempts++;
+			rv = ec_command(EC_CMD_FP_FRAME, 1, &p, sizeof(p), r,
+					ec_max_insize);
+			if (rv >= 0)
+				break;
+			if (rv == -EECRESULT - EC_RES_ACCESS_DENIED)
+				break;
+			usleep(100000);
+		}
+		if (rv < 0)
+			return rv;
+
+		if (rv < (int)sizeof(*r) || !r->size ||
+		    r->size > size - offset ||
+		    fp_frame_unpack(r->data, rv - sizeof(*r), r->sample_bits,
+				    buffer, offset, r->size) != EC_SUCCESS) {
+			fprintf(stderr, "Bad frame chunk at offset %zu\n",
+				offset);
+			return -1;
+		}
+		offset += r->size;
+	}
+
+	return 0;
+}
+
 /*
  * Download a frame buffer from the FPMCU.
  *
@@ -2192,6 +2251,15 @@ static void *fp_download_frame(struct ec_response_fp_info *info, int index)
 	}
 
 	ptr = (uint8_t *)(buffer);
+	if (index == FP_FRAME_INDEX_RAW_IMAGE &&
+	    ec_cmd_version_supported(EC_CMD_FP_FRAME, 1)) {
+		if (fp_download_frame_packed(ptr, size) < 0) {
+			free(buffer);
+			return NULL;
+		}
+		return buffer;
+	}
+
 	p.offset = index << FP_FRAME_INDEX_SHIFT;
 	while (size) {
 		stride = MIN(ec_max_insize, size);
@@ -2495,23 +2563,55 @@ frame_done:
 	return 0;
 }
 
-int cmd_fp_template(int argc, char *argv[])
+/*
+ * Send templates to the FPMCU. Version 0 of EC_CMD_FP_TEMPLATE takes a
+ * single template, version 1 any number of them back to back.
+ */
+static int fp_send_template(const char *buffer, int size, int version)
 {
-	struct ec_response_fp_info r;
 	struct ec_params_fp_template *p =
 		(struct ec_params_fp_template *)(ec_outbuf);
 	/* TODO(b/78544921): removing 32 bits is a workaround for the MCU bug */
 	int max_chunk = ec_max_outsize -
 			offsetof(struct ec_params_fp_template, data) - 4;
+	uint32_t offset = 0;
+	int rv = 0;
+
+	while (size) {
+		uint32_t tlen = MIN(max_chunk, size);
+
+		p->offset = offset;
+		p->size = tlen;
+		size -= tlen;
+		if (!size)
+			p->size |= FP_TEMPLATE_COMMIT;
+		memcpy(p->data, buffer + offset, tlen);
+		rv = ec_command(EC_CMD_FP_TEMPLATE, version, p,
+				tlen + offsetof(struct ec_params_fp_template,
+						data),
+				NULL, 0);
+		if (rv < 0)
+			break;
+		offset += tlen;
+	}
+	return rv;
+}
+
+int cmd_fp_template(int argc, char *argv[])
+{
+	struct ec_response_fp_info r;
 	int idx = -1;
 	char *e;
 	int size;
 	char *buffer = NULL;
-	uint32_t offset = 0;
+	char *batch = NULL;
+	int batch_size = 0;
+	int version = 0;
 	int rv = 0;
+	int i;
 
 	if (argc < 2) {
-		fprintf(stderr, "Usage: %s [<infile>|<index>]\n", argv[0]);
+		fprintf(stderr, "Usage: %s [<infile>...|<index>]\n", argv[0]);
 		return -1;
 	}
 
@@ -2526,35 +2626,47 @@ int cmd_fp_template(int argc, char *argv[])
 		free(buffer);
 		return 0;
 	}
+
+	/* Several templates are sent in a single batch when supported. */
+	if (argc > 2 && ec_cmd_version_supported(EC_CMD_FP_TEMPLATE, 1))
+		version = 1;
+
 	/* not an index, is it a filename ? */
-	buffer = read_file(argv[1], &size);
-	if (!buffer) {
-		fprintf(stderr, "Invalid parameter: %s\n", argv[1]);
-		return -1;
-	}
-	printf("sending template from: %s (%d bytes)\n", argv[1], size);
-	while (size) {
-		uint32_t tlen = MIN(max_chunk, size);
+	for (i = 1; i < argc && rv >= 0; i++) {
+		buffer = read_file(argv[i], &size);
+		if (!buffer) {
+			fprintf(stderr, "Invalid parameter: %s\n", argv[i]);
+			rv = -1;
+			break;
+		}
+		printf("sending template from: %s (%d bytes)\n", argv[i],
+		       size);
+		if (!version) {
+			rv = fp_send_template(buffer, size, 0);
+			free(buffer);
+			continue;
+		}
 
-		p->offset = offset;
-		p->size = tlen;
-		size -= tlen;
-		if (!size)
-			p->size |= FP_TEMPLATE_COMMIT;
-		memcpy(p->data, buffer + offset, tlen);
-		rv = ec_command(EC_CMD_FP_TEMPLATE, 0, p,
-				tlen + offsetof(struct ec_params_fp_template,
-						data),
-				NULL, 0);
-		if (rv < 0)
+		e = (char *)realloc(batch, batch_size + size);
+		if (!e) {
+			fprintf(stderr, "Cannot allocate memory\n");
+			free(buffer);
+			rv = -1;
 			break;
-		offset += tlen;
+		}
+		batch = e;
+		memcpy(batch + batch_size, buffer, size);
+		batch_size += size;
+		free(buffer);
 	}
+	if (rv >= 0 && version)
+		rv = fp_send_template(batch, batch_size, version);
+	free(batch);
+
 	if (rv < 0)
 		fprintf(stderr, "Failed with %d\n", rv);
 	else
 		rv = 0;
-	free(buffer);
 	return rv;
 }
 
@@ -6753,6 +6865,40 @@ int cmd_usb_pd_mux_info(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_usb_pd_mux_stats(int argc, char *argv[])
+{
+	struct ec_params_usb_pd_mux_stats p = {};
+	struct ec_response_usb_pd_mux_stats r;
+	int num_ports, rv, i;
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset"))) {
+		fprintf(stderr, "Usage: %s [reset]\n", argv[0]);
+		return -1;
+	}
+	if (argc == 2)
+		p.flags = EC_USB_PD_MUX_STATS_FLAG_RESET;
+
+	rv = ec_command(EC_CMD_USB_PD_PORTS, 0, NULL, 0, ec_inbuf,
+			ec_max_insize);
+	if (rv < 0)
+		return rv;
+	num_ports = ((struct ec_response_usb_pd_ports *)ec_inbuf)->num_ports;
+
+	for (i = 0; i < num_ports; i++) {
+		p.port = i;
+		rv = ec_command(EC_CMD_USB_PD_MUX_STATS, 0, &p, sizeof(p), &r,
+				sizeof(r));
+		if (rv < 0)
+			return rv;
+
+		printf("Port %d: sets=%u elided=%u last_us=%u max_us=%u\n", i,
+		       r.set_count, r.elided_count, r.last_latency_us,
+		       r.max_latency_us);
+	}
+
+	return 0;
+}
+
 int cmd_usb_pd_power(int argc, char *argv[])
 {
 	struct ec_params_usb_pd_power_info p;
@@ -6851,6 +6997,43 @@ int cmd_keyboard_factory_test(int argc, char *argv[])
 	return 0;
 }
 
+int cmd_kblatency(int argc, char *argv[])
+{
+	static const char *const stage_names[EC_8042_LATENCY_COUNT] = {
+		[EC_8042_LATENCY_QUEUE] = "Scan to queue",
+		[EC_8042_LATENCY_SEND] = "Queue to host",
+		[EC_8042_LATENCY_TOTAL] = "Total",
+	};
+	struct ec_params_8042_latency p = {};
+	struct ec_response_8042_latency r;
+	int rv;
+	int i;
+
+	if (argc > 1) {
+		if (strcasecmp(argv[1], "reset")) {
+			fprintf(stderr, "Usage: %s [reset]\n", argv[0]);
+			return -1;
+		}
+		p.flags |= EC_8042_LATENCY_FLAG_RESET;
+	}
+
+	rv = ec_command(EC_CMD_8042_LATENCY, 0, &p, sizeof(p), &r, sizeof(r));
+	if (rv < 0)
+		return rv;
+
+	printf("%u key events, %u not timed\n", r.count, r.untracked);
+	if (!r.count)
+		return 0;
+
+	printf("%-14s %8s %8s %8s\n", "", "min_us", "avg_us", "max_us");
+	for (i = 0; i < EC_8042_LATENCY_COUNT; i++)
+		printf("%-14s %8u %8u %8u\n", stage_names[i],
+		       r.stages[i].min_us, r.stages[i].total_us / r.count,
+		       r.stages[i].max_us);
+
+	return 0;
+}
+
 int cmd_panic_info(int argc, char *argv[])
 {
 	int rv;
@@ -8248,6 +8431,26 @@ static int get_battery_command_v0(uint8_t index)
 	return get_battery_command_print_info(index, &static_v2);
 }
 
+/* Battery data of the memory map, from EC_MEMMAP_BATT_VOLT on */
+#define BATT_MEMMAP_SIZE \
+	(EC_MEMMAP_BATT_TYPE + EC_MEMMAP_TEXT_MAX - EC_MEMMAP_BATT_VOLT)
+static uint8_t batt_memmap[BATT_MEMMAP_SIZE];
+
+static uint32_t batt_memmap32(int offset)
+{
+	uint32_t val;
+
+	memcpy(&val, batt_memmap + offset - EC_MEMMAP_BATT_VOLT, sizeof(val));
+	return val;
+}
+
+static void batt_memmap_string(int offset, char *buffer)
+{
+	memcpy(buffer, batt_memmap + offset - EC_MEMMAP_BATT_VOLT,
+	       EC_MEMMAP_TEXT_MAX);
+	buffer[EC_MEMMAP_TEXT_MAX - 1] = '\0';
+}
+
 int cmd_battery(int argc, char *argv[])
 {
 	char batt_text[EC_MEMMAP_TEXT_MAX];
@@ -8288,64 +8491,68 @@ int cmd_battery(int argc, char *argv[])
 		return -1;
 	}
 
-	flags = read_mapped_mem8(EC_MEMMAP_BATT_FLAG);
+	/* Read it all at once, so that the values go together. */
+	rv = ec_readmem_snapshot(EC_MEMMAP_BATTERY_SEQ, EC_MEMMAP_BATT_VOLT,
+				 sizeof(batt_memmap), batt_memmap);
+	if (rv < 0) {
+		fprintf(stderr, "Failed to read battery info: %d\n", rv);
+		return -1;
+	}
+
+	flags = batt_memmap[EC_MEMMAP_BATT_FLAG - EC_MEMMAP_BATT_VOLT];
 
 	printf("Battery info:\n");
 
-	rv = read_mapped_string(EC_MEMMAP_BATT_MFGR, batt_text,
-				sizeof(batt_text));
-	if (rv < 0 || !is_string_printable(batt_text))
+	batt_memmap_string(EC_MEMMAP_BATT_MFGR, batt_text);
+	if (!is_string_printable(batt_text))
 		goto cmd_error;
 	printf("  OEM name:               %s\n", batt_text);
 
-	rv = read_mapped_string(EC_MEMMAP_BATT_MODEL, batt_text,
-				sizeof(batt_text));
-	if (rv < 0 || !is_string_printable(batt_text))
+	batt_memmap_string(EC_MEMMAP_BATT_MODEL, batt_text);
+	if (!is_string_printable(batt_text))
 		goto cmd_error;
 	printf("  Model number:           %s\n", batt_text);
 
-	rv = read_mapped_string(EC_MEMMAP_BATT_TYPE, batt_text,
-				sizeof(batt_text));
-	if (rv < 0 || !is_string_printable(batt_text))
+	batt_memmap_string(EC_MEMMAP_BATT_TYPE, batt_text);
+	if (!is_string_printable(batt_text))
 		goto cmd_error;
 	printf("  Chemistry   :           %s\n", batt_text);
 
-	rv = read_mapped_string(EC_MEMMAP_BATT_SERIAL, batt_text,
-				sizeof(batt_text));
+	batt_memmap_string(EC_MEMMAP_BATT_SERIAL, batt_text);
 	printf("  Serial number:          %s\n", batt_text);
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_DCAP);
+	val = batt_memmap32(EC_MEMMAP_BATT_DCAP);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Design capacity:        %u mAh\n", val);
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_LFCC);
+	val = batt_memmap32(EC_MEMMAP_BATT_LFCC);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Last full charge:       %u mAh\n", val);
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_DVLT);
+	val = batt_memmap32(EC_MEMMAP_BATT_DVLT);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Design output voltage   %u mV\n", val);
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_CCNT);
+	val = batt_memmap32(EC_MEMMAP_BATT_CCNT);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Cycle count             %u\n", val);
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_VOLT);
+	val = batt_memmap32(EC_MEMMAP_BATT_VOLT);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Present voltage         %u mV\n", val);
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_RATE);
+	val = batt_memmap32(EC_MEMMAP_BATT_RATE);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Present current         %u mA%s\n", val,
 	       flags & EC_BATT_FLAG_DISCHARGING ? " (discharging)" : "");
 
-	val = read_mapped_mem32(EC_MEMMAP_BATT_CAP);
+	val = batt_memmap32(EC_MEMMAP_BATT_CAP);
 	if (!is_battery_range(val))
 		goto cmd_error;
 	printf("  Remaining capacity      %u mAh\n", val);
@@ -8503,6 +8710,109 @@ int cmd_boottime(int argc, char *argv[])
 	return rv;
 }
 
+static void print_hcstats_hist(const char *name, const uint16_t *hist)
+{
+	int i;
+
+	printf("  %s:", name);
+	for (i = 0; i < EC_HOSTCMD_STATS_BUCKETS; i++) {
+		if (!hist[i])
+			continue;
+		if (i == EC_HOSTCMD_STATS_BUCKETS - 1)
+			printf(" >=%uus:%u", 1U << i, hist[i]);
+		else
+			printf(" <%uus:%u", 2U << i, hist[i]);
+	}
+	printf("\n");
+}
+
+int cmd_hcstats(int argc, char *argv[])
+{
+	struct ec_params_hostcmd_stats p = {};
+	struct ec_response_hostcmd_stats *r =
+		(struct ec_response_hostcmd_stats *)ec_inbuf;
+	const int room = (ec_max_insize - sizeof(*r)) / sizeof(r->entries[0]);
+	int total = -1;
+	int rv;
+	int i;
+
+	if (argc > 2 || (argc == 2 && strcmp(argv[1], "reset"))) {
+		fprintf(stderr, "Usage: %s [reset]\n", argv[0]);
+		return -1;
+	}
+
+	printf("cmd     calls    errors   avg_us   max_us\n");
+	for (;;) {
+		/* Reset with the last read, so that nothing slips in between */
+		if (argc == 2 && total >= 0 && p.index + room >= total)
+			p.flags = EC_HOSTCMD_STATS_FLAG_RESET;
+
+		rv = ec_command(EC_CMD_HOSTCMD_STATS, 0, &p, sizeof(p), r,
+				ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < (int)(sizeof(*r) + r->count * sizeof(r->entries[0]))) {
+			fprintf(stderr, "Truncated response\n");
+			return -1;
+		}
+
+		/* That was the last read, but not a resetting one: read again */
+		total = r->total;
+		if (argc == 2 && !p.flags && p.index + r->count >= total)
+			continue;
+
+		for (i = 0; i < r->count; i++) {
+			const struct ec_hostcmd_stats_entry *e = &r->entries[i];
+
+			printf("0x%04x %8u %8u %8u %8u\n", e->command, e->calls,
+			       e->errors, e->calls ? e->total_us / e->calls : 0,
+			       e->max_us);
+			print_hcstats_hist("exec", e->hist);
+		}
+		p.index += r->count;
+		if (p.flags || !r->count || p.index >= total)
+			break;
+	}
+
+	printf("untracked: %u\n", r->untracked);
+	print_hcstats_hist("queue", r->queue_hist);
+	return 0;
+}
+
+int cmd_inittimes(int argc, char *argv[])
+{
+	struct ec_params_hook_init_times p = {};
+	struct ec_response_hook_init_times *r =
+		(struct ec_response_hook_init_times *)ec_inbuf;
+	int rv;
+	int i;
+
+	printf("   time_us prio routine\n");
+	do {
+		rv = ec_command(EC_CMD_HOOK_INIT_TIMES, 0, &p, sizeof(p), r,
+				ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < (int)(sizeof(*r) + r->count * sizeof(r->entries[0]))) {
+			fprintf(stderr, "Truncated response\n");
+			return -1;
+		}
+
+		for (i = 0; i < r->count; i++)
+			printf("%10u %4u 0x%08x\n", r->entries[i].time_us,
+			       r->entries[i].priority, r->entries[i].routine);
+		p.index += r->count;
+	} while (r->count && p.index < r->total);
+
+	if (r->untracked)
+		printf("%u more hooks not listed\n", r->untracked);
+	printf("%s boot, init hooks took %u us\n",
+	       r->flags & EC_HOOK_INIT_TIMES_FLAG_JUMPED ? "Jump" : "Cold",
+	       r->total_us);
+
+	return 0;
+}
+
 static void cmd_cbi_help(char *cmd)
 {
 	fprintf(stderr,
@@ -10566,6 +10876,189 @@ int cmd_pd_write_log(int argc, char *argv[])
 	return ec_command(EC_CMD_PD_WRITE_LOG_ENTRY, 0, &p, sizeof(p), NULL, 0);
 }
 
+static const char *const pd_sm_names[] = {
+	[EC_PD_SM_TC] = "TC",	      [EC_PD_SM_PE] = "PE",
+	[EC_PD_SM_PRL_TX] = "PRL_TX", [EC_PD_SM_PRL_HR] = "PRL_HR",
+	[EC_PD_SM_RCH] = "RCH",	      [EC_PD_SM_TCH] = "TCH",
+	[EC_PD_SM_DPM] = "DPM",
+};
+BUILD_ASSERT(ARRAY_SIZE(pd_sm_names) == EC_PD_SM_COUNT);
+
+/*
+ * USB-PD spec timers, checked against the time spent in the state that
+ * runs them. A state left early on a max timer, or late on a min timer, is
+ * fine: only the other side of the limit is a violation.
+ */
+static const struct {
+	enum ec_pd_sm machine;
+	const char *state;
+	const char *timer;
+	uint32_t min_us;
+	uint32_t max_us;
+} pd_trace_rules[] = {
+	{ EC_PD_SM_PE, "PE_SRC_Send_Capabilities", "tSenderResponse", 0,
+	  30000 },
+	{ EC_PD_SM_PE, "PE_SNK_Select_Capability", "tSenderResponse", 0,
+	  30000 },
+	{ EC_PD_SM_PE, "PE_Send_Soft_Reset", "tSenderResponse", 0, 30000 },
+	{ EC_PD_SM_PE, "PE_DRS_Send_Swap", "tSenderResponse", 0, 30000 },
+	{ EC_PD_SM_PE, "PE_PRS_SRC_SNK_Send_Swap", "tSenderResponse", 0,
+	  30000 },
+	{ EC_PD_SM_PE, "PE_PRS_SNK_SRC_Send_Swap", "tSenderResponse", 0,
+	  30000 },
+	{ EC_PD_SM_PE, "PE_INIT_PORT_VDM_Identity_Request",
+	  "tVDMSenderResponse", 0, 30000 },
+	{ EC_PD_SM_PE, "PE_INIT_VDM_SVIDs_Request", "tVDMSenderResponse", 0,
+	  30000 },
+	{ EC_PD_SM_PE, "PE_INIT_VDM_Modes_Request", "tVDMSenderResponse", 0,
+	  30000 },
+	{ EC_PD_SM_PE, "PE_SNK_Wait_for_Capabilities", "tTypeCSinkWaitCap", 0,
+	  620000 },
+	{ EC_PD_SM_PE, "PE_SNK_Transition_Sink", "tPSTransition", 0, 550000 },
+	{ EC_PD_SM_PE, "PE_PRS_SNK_SRC_Transition_To_Off", "tPSSourceOff", 0,
+	  920000 },
+	{ EC_PD_SM_PE, "PE_SRC_Hard_Reset", "tPSHardReset", 25000, 0 },
+	{ EC_PD_SM_PRL_TX, "PRL_TX_SRC_PENDING", "tSinkTx", 16000, 0 },
+};
+
+/* Names of the states of each machine, fetched from the EC on first use */
+static char *pd_trace_state_names[EC_PD_SM_COUNT][EC_PD_SM_STATE_NONE];
+
+static const char *pd_trace_state_name(int port, int machine, int state)
+{
+	struct ec_params_pd_sm_trace p = {};
+	static char number[8];
+	char **name;
+	int rv;
+
+	if (state == EC_PD_SM_STATE_NONE)
+		return "-";
+
+	name = &pd_trace_state_names[machine][state];
+	if (!*name) {
+		p.port = port;
+		p.cmd = EC_PD_SM_TRACE_STATE_NAME;
+		p.machine = machine;
+		p.state = state;
+		rv = ec_command(EC_CMD_PD_SM_TRACE, 0, &p, sizeof(p), ec_inbuf,
+				ec_max_insize);
+		if (rv > 0) {
+			((char *)ec_inbuf)[rv - 1] = '\0';
+			*name = strdup((char *)ec_inbuf);
+		}
+	}
+	if (*name)
+		return *name;
+
+	/* Labels compiled out of the EC image */
+	snprintf(number, sizeof(number), "#%d", state);
+	return number;
+}
+
+int cmd_pd_sm_trace(int argc, char *argv[])
+{
+	struct ec_params_pd_sm_trace p = {};
+	struct ec_response_pd_sm_trace *r =
+		(struct ec_response_pd_sm_trace *)ec_inbuf;
+	/* When each machine entered its current state, and if it is known */
+	uint32_t entered[EC_PD_SM_COUNT];
+	bool entered_valid[EC_PD_SM_COUNT] = {};
+	uint32_t start = 0;
+	int transitions = 0, violations = 0;
+	int rv, i, j;
+	char *e;
+
+	if (argc < 2 || argc > 3 || (argc == 3 && strcmp(argv[2], "clear"))) {
+		fprintf(stderr, "Usage: %s <port> [clear]\n", argv[0]);
+		return -1;
+	}
+
+	p.port = strtol(argv[1], &e, 0);
+	if (e && *e) {
+		fprintf(stderr, "Bad port parameter.\n");
+		return -1;
+	}
+
+	if (argc == 3) {
+		p.cmd = EC_PD_SM_TRACE_CLEAR;
+		return ec_command(EC_CMD_PD_SM_TRACE, 0, &p, sizeof(p), NULL,
+				  0);
+	}
+
+	p.cmd = EC_PD_SM_TRACE_READ;
+	do {
+		rv = ec_command(EC_CMD_PD_SM_TRACE, 0, &p, sizeof(p), ec_inbuf,
+				ec_max_insize);
+		if (rv < 0)
+			return rv;
+		if (rv < (int)sizeof(*r) ||
+		    rv < (int)(sizeof(*r) + r->count * sizeof(r->entries[0]))) {
+			fprintf(stderr, "Short response.\n");
+			return -1;
+		}
+
+		/* The EC went on to overwrite entries between two reads */
+		if (transitions && r->seq != p.seq)
+			printf("... %u transitions lost\n", r->seq - p.seq);
+
+		for (i = 0; i < r->count; i++) {
+			const struct ec_pd_sm_trace_entry *t = &r->entries[i];
+			const char *from, *to;
+			uint32_t dwell = 0;
+			bool timed;
+
+			if (t->machine >= EC_PD_SM_COUNT)
+				continue;
+			if (!transitions++)
+				start = t->timestamp;
+
+			timed = entered_valid[t->machine] &&
+				t->old_state != EC_PD_SM_STATE_NONE;
+			if (timed)
+				dwell = t->timestamp - entered[t->machine];
+			entered[t->machine] = t->timestamp;
+			entered_valid[t->machine] = true;
+
+			from = pd_trace_state_name(p.port, t->machine,
+						   t->old_state);
+			to = pd_trace_state_name(p.port, t->machine,
+						 t->new_state);
+			printf("%10.3f ms  %-6s %s -> %s  (events 0x%08x)\n",
+			       (t->timestamp - start) / 1000.0,
+			       pd_sm_names[t->machine], from, to, t->event);
+			if (!timed)
+				continue;
+
+			for (j = 0; j < (int)ARRAY_SIZE(pd_trace_rules); j++) {
+				if (pd_trace_rules[j].machine != t->machine ||
+				    strcmp(pd_trace_rules[j].state, from))
+					continue;
+				if (pd_trace_rules[j].max_us &&
+				    dwell > pd_trace_rules[j].max_us) {
+					printf("  VIOLATION %s: %u us in %s, "
+					       "max %u us\n",
+					       pd_trace_rules[j].timer, dwell,
+					       from, pd_trace_rules[j].max_us);
+					violations++;
+				}
+				if (dwell < pd_trace_rules[j].min_us) {
+					printf("  VIOLATION %s: %u us in %s, "
+					       "min %u us\n",
+					       pd_trace_rules[j].timer, dwell,
+					       from, pd_trace_rules[j].min_us);
+					violations++;
+				}
+			}
+		}
+
+		p.seq = r->seq + r->count;
+	} while (r->count && p.seq != r->head);
+
+	printf("%d transitions, %d timing violations\n", transitions,
+	       violations);
+	return violations ? 1 : 0;
+}
+
 int cmd_typec_control(int argc, char *argv[])
 {
 	struct ec_params_typec_control p;
@@ -11496,6 +11989,7 @@ const struct command commands[] = {
 	{ "gpioget", cmd_gpio_get },
 	{ "gpioset", cmd_gpio_set },
 	{ "hangdetect", cmd_hang_detect },
+	{ "hcstats", cmd_hcstats },
 	{ "hello", cmd_hello },
 	{ "hibdelay", cmd_hibdelay },
 	{ "hostevent", cmd_hostevent },
@@ -11507,11 +12001,13 @@ const struct command commands[] = {
 	{ "i2cwrite", cmd_i2c_write },
 	{ "i2cxfer", cmd_i2c_xfer },
 	{ "infopddev", cmd_pd_device_info },
+	{ "inittimes", cmd_inittimes },
 	{ "inventory", cmd_inventory },
 	{ "led", cmd_led },
 	{ "lightbar", cmd_lightbar },
 	{ "kbfactorytest", cmd_keyboard_factory_test },
 	{ "kbinfo", cmd_kbinfo },
+	{ "kblatency", cmd_kblatency },
 	{ "kbpress", cmd_kbpress },
 	{ "keyconfig", cmd_keyconfig },
 	{ "keyscan", cmd_keyscan },
@@ -11530,6 +12026,7 @@ const struct command commands[] = {
 	{ "pdcontrol", cmd_pd_control },
 	{ "pdchipinfo", cmd_pd_chip_info },
 	{ "pdwritelog", cmd_pd_write_log },
+	{ "pdtrace", cmd_pd_sm_trace },
 	{ "powerinfo", cmd_power_info },
 	{ "protoinfo", cmd_proto_info },
 	{ "pse", cmd_pse },
@@ -11582,6 +12079,7 @@ const struct command commands[] = {
 	{ "usbpd", cmd_usb_pd },
 	{ "usbpddps", cmd_usb_pd_dps },
 	{ "usbpdmuxinfo", cmd_usb_pd_mux_info },
+	{ "usbpdmuxstats", cmd_usb_pd_mux_stats },
 	{ "usbpdpower", cmd_usb_pd_power },
 	{ "version", cmd_version },
 	{ "waitevent", cmd_wait_event },
@@ -11597,6 +12095,7 @@ int main(int argc, char *argv[])
 	int interfaces = COMM_ALL;
 	int i2c_bus = -1;
 	char device_name[41] = CROS_EC_DEV_NAME;
+	const char *socket_path = NULL;
 	uint16_t vid = USB_VID_GOOGLE, pid = USB_PID_HAMMER;
 	int rv = 1;
 	int parse_error = 0;
@@ -11642,6 +12141,10 @@ int main(int argc, char *argv[])
 				parse_error = 1;
 			}
 			break;
+		case OPT_SOCKET:
+			socket_path = optarg;
+			interfaces = COMM_SOCKET;
+			break;
 		case OPT_NAME:
 			strncpy(device_name, optarg, 40);
 			device_name[40] = '\0';
@@ -11700,8 +12203,8 @@ int main(int argc, char *argv[])
 	if (!(interfaces & COMM_DEV) || comm_init_dev(device_name)) {
 		/* If dev is excluded or isn't supported, find alternative */
 
-		/* Lock is not needed for COMM_USB */
-		if (!(interfaces & COMM_USB) &&
+		/* Lock is not needed for COMM_USB or COMM_SOCKET */
+		if (!(interfaces & (COMM_USB | COMM_SOCKET)) &&
 		    acquire_gec_lock(GEC_LOCK_TIMEOUT_SECS) < 0) {
 			fprintf(stderr, "Could not acquire GEC lock.\n");
 			exit(1);
@@ -11711,6 +12214,11 @@ int main(int argc, char *argv[])
 				fprintf(stderr, "Couldn't find EC on USB.\n");
 				goto out;
 			}
+		} else if (interfaces == COMM_SOCKET) {
+			if (comm_init_alt(COMM_SOCKET, socket_path, -1)) {
+				fprintf(stderr, "Couldn't connect to EC.\n");
+				goto out;
+			}
 		} else if (comm_init_alt(interfaces, device_name, i2c_bus)) {
 			fprintf(stderr, "Couldn't find EC\n");
 			goto out;
@@ -11739,6 +12247,8 @@ out:
 
 	if (interfaces == COMM_USB)
 		comm_usb_exit();
+	else if (interfaces == COMM_SOCKET)
+		comm_socket_exit();
 
 	return !!rv;
 }
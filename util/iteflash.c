@@ -124,6 +124,7 @@ struct iteflash_config {
 	int usb_vid;
 	int usb_pid;
 	int verify; /* boolean */
+	int diff; /* boolean */
 	char *usb_serial;
 	char *i2c_dev_path;
 	const struct i2c_interface *i2c_if;
@@ -1147,6 +1148,56 @@ static void draw_spinner(uint32_t remaining, uint32_t size)
 	windex %= sizeof(wheel);
 }
 
+/* Time spent in each phase of an update, printed at the end */
+enum phase {
+	PHASE_LOAD,
+	PHASE_READ,
+	PHASE_ERASE,
+	PHASE_WRITE,
+	PHASE_VERIFY,
+	PHASE_COUNT,
+};
+
+static const char *const phase_names[PHASE_COUNT] = {
+	[PHASE_LOAD] = "load",	 [PHASE_READ] = "read",
+	[PHASE_ERASE] = "erase", [PHASE_WRITE] = "write",
+	[PHASE_VERIFY] = "verify",
+};
+
+static double phase_time[PHASE_COUNT];
+
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Account the time since start to a phase, and return the current time */
+static double phase_done(enum phase phase, double start)
+{
+	double now = now_seconds();
+
+	phase_time[phase] += now - start;
+	return now;
+}
+
+static void print_phase_times(void)
+{
+	double total = 0;
+	int i;
+
+	printf("Time spent:");
+	for (i = 0; i < PHASE_COUNT; i++) {
+		if (!phase_time[i])
+			continue;
+		printf(" %s %.2fs,", phase_names[i], phase_time[i]);
+		total += phase_time[i];
+	}
+	printf(" total %.2fs\n", total);
+}
+
 /* Note: this function must be called in follow mode */
 static int spi_send_cmd_fast_read(struct common_hnd *chnd, uint32_t addr)
 {
@@ -1444,37 +1495,19 @@ failed_erase:
 }
 
 /*
- * This function can Erase First Sector or Erase All Sector by reset value
- * Some F/W will produce the H/W watchdog reset and it will happen
- * reset issue while flash.
- * Add such function to prevent the reset issue.
+ * Erase count sectors, from the one at a page. Return zero on success, a
+ * negative error value on failures.
  */
-static int command_erase2(struct common_hnd *chnd, uint32_t len, uint32_t off,
-			  uint32_t reset)
+static int command_erase_sectors(struct common_hnd *chnd, int page, int count)
 {
 	int res = -EIO;
-	int page = 0;
-	uint32_t remaining = len;
-
-	/*
-	 * TODOD(b/<>):
-	 * Using sector erase instead of chip erase
-	 * For some new chip , the chip erase may not work
-	 * well on the original flow
-	 */
-
-	printf("Erasing flash...erase size=%d\n", len);
-
-	if (off != 0 || len != chnd->flash_size) {
-		fprintf(stderr, "Only full chip erase is supported\n");
-		return -EINVAL;
-	}
+	int i;
 
 	if (spi_flash_follow_mode(chnd, "erase") < 0)
 		goto failed_erase;
 
-	while (remaining) {
-		draw_spinner(remaining, len);
+	for (i = 0; i < count; i++, page += sector_erase_pages) {
+		draw_spinner(count - i, count);
 
 		if (spi_flash_command_short(chnd, SPI_CMD_WRITE_ENABLE,
 					    "write enable for erase") < 0)
@@ -1497,19 +1530,8 @@ static int command_erase2(struct common_hnd *chnd, uint32_t len, uint32_t off,
 		if (spi_flash_command_short(chnd, SPI_CMD_WRITE_DISABLE,
 					    "write disable for erase") < 0)
 			goto failed_erase;
-
-		if (reset) {
-			printf("\n\rreset to prevent the watchdog reset...\n");
-			break;
-		}
-
-		page += sector_erase_pages;
-		remaining -= sector_erase_pages * PAGE_SIZE;
-		draw_spinner(remaining, len);
 	}
-
-	/* No error so far */
-	printf("\n\rErasing Done.\n");
+	draw_spinner(0, count);
 	res = 0;
 
 failed_erase:
@@ -1523,6 +1545,44 @@ failed_erase:
 	return res;
 }
 
+/*
+ * This function can Erase First Sector or Erase All Sector by reset value
+ * Some F/W will produce the H/W watchdog reset and it will happen
+ * reset issue while flash.
+ * Add such function to prevent the reset issue.
+ */
+static int command_erase2(struct common_hnd *chnd, uint32_t len, uint32_t off,
+			  uint32_t reset)
+{
+	const uint32_t sector_size = sector_erase_pages * PAGE_SIZE;
+	int sectors = (len + sector_size - 1) / sector_size;
+	int res;
+
+	/*
+	 * TODOD(b/<>):
+	 * Using sector erase instead of chip erase
+	 * For some new chip , the chip erase may not work
+	 * well on the original flow
+	 */
+
+	printf("Erasing flash...erase size=%d\n", len);
+
+	if (off != 0 || len != chnd->flash_size) {
+		fprintf(stderr, "Only full chip erase is supported\n");
+		return -EINVAL;
+	}
+
+	res = command_erase_sectors(chnd, 0, reset ? 1 : sectors);
+	if (res)
+		return res;
+
+	if (reset)
+		printf("\n\rreset to prevent the watchdog reset...\n");
+	printf("\n\rErasing Done.\n");
+
+	return 0;
+}
+
 /* Return zero on success, a negative error value on failures. */
 static int read_flash(struct common_hnd *chnd)
 {
@@ -1584,26 +1644,21 @@ static int read_flash(struct common_hnd *chnd)
 	return (res < 0) ? res : 0;
 }
 
-/* Return zero on success, a negative error value on failures. */
-static int write_flash(struct common_hnd *chnd, const char *filename,
-		       uint32_t offset)
+/*
+ * Read an image into a buffer of the size of the flash. Return the size of the
+ * image, or a negative error value on failures.
+ */
+static int load_image(struct common_hnd *chnd, const char *filename,
+		      uint8_t *buffer)
 {
-	int res, written;
+	int res;
 	FILE *hnd;
 	int size = chnd->flash_size;
-	uint8_t *buffer = malloc(size);
-
-	if (!buffer) {
-		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
-			size);
-		return -ENOMEM;
-	}
 
 	hnd = fopen(filename, "r");
 	if (!hnd) {
 		fprintf(stderr, "%s: Cannot open file %s for reading\n",
 			__func__, filename);
-		free(buffer);
 		return -EIO;
 	}
 	res = fread(buffer, 1, size, hnd);
@@ -1612,22 +1667,33 @@ static int write_flash(struct common_hnd *chnd, const char *filename,
 			"%s: Failed to read %d bytes from %s with "
 			"ferror() %d\n",
 			__func__, size, filename, ferror(hnd));
-		free(buffer);
 		fclose(hnd);
 		return -EIO;
 	}
 	fclose(hnd);
 
-	printf("Writing %d bytes at 0x%08x\n", res, offset);
-	written = command_write_pages(chnd, offset, res, buffer);
-	if (written != res) {
+	return res;
+}
+
+/*
+ * The write functions below program size bytes of an image at offset, from
+ * the same offset in the buffer holding the image.
+ *
+ * Return zero on success, a negative error value on failures.
+ */
+static int write_flash(struct common_hnd *chnd, uint8_t *buffer,
+		       uint32_t offset, int size)
+{
+	int written;
+
+	printf("Writing %d bytes at 0x%08x\n", size, offset);
+	written = command_write_pages(chnd, offset, size, buffer + offset);
+	if (written != size) {
 		fprintf(stderr, "%s: Error writing to flash\n", __func__);
-		free(buffer);
 		return -EIO;
 	}
 	printf("\n\rWriting Done.\n");
 
-	free(buffer);
 	return 0;
 }
 
@@ -1638,41 +1704,13 @@ static int write_flash(struct common_hnd *chnd, const char *filename,
  * The original flow may not work on the DX chip.
  *
  */
-static int write_flash2(struct common_hnd *chnd, const char *filename,
-			uint32_t offset)
+static int write_flash2(struct common_hnd *chnd, uint8_t *buffer,
+			uint32_t offset, int size)
 {
-	int res;
+	int res = size;
 	int block_write_size = chnd->conf.block_write_size;
-	FILE *hnd;
-	int size = chnd->flash_size;
 	int cnt, two_bytes_sent, ret;
 	uint8_t addr_h, addr_m, addr_l, data_ff = 0xff;
-	uint8_t *buffer = malloc(size);
-
-	if (!buffer) {
-		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
-			size);
-		return -ENOMEM;
-	}
-
-	hnd = fopen(filename, "r");
-	if (!hnd) {
-		fprintf(stderr, "%s: Cannot open file %s for reading\n",
-			__func__, filename);
-		free(buffer);
-		return -EIO;
-	}
-	res = fread(buffer, 1, size, hnd);
-	if (res <= 0) {
-		fprintf(stderr,
-			"%s: Failed to read %d bytes from %s with "
-			"ferror() %d\n",
-			__func__, size, filename, ferror(hnd));
-		fclose(hnd);
-		free(buffer);
-		return -EIO;
-	}
-	fclose(hnd);
 
 	/* Enter follow mode */
 	if (spi_flash_follow_mode(chnd, "AAI write") < 0) {
@@ -1758,8 +1796,6 @@ failed_enter_mode:
 	else
 		printf("\n\rWriting Done.\n");
 
-	free(buffer);
-
 	return ret;
 }
 
@@ -1770,40 +1806,12 @@ failed_enter_mode:
  * The original flow may not work on the DX chip.
  *
  */
-static int write_flash3(struct common_hnd *chnd, const char *filename,
-			uint32_t offset)
+static int write_flash3(struct common_hnd *chnd, uint8_t *buf,
+			uint32_t offset, int size)
 {
-	int res, ret = 0;
+	int res = size, ret = 0;
 	int block_write_size = chnd->conf.block_write_size;
-	FILE *hnd;
-	int size = chnd->flash_size;
 	int cnt;
-	uint8_t *buf = malloc(size);
-
-	if (!buf) {
-		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
-			size);
-		return -ENOMEM;
-	}
-
-	hnd = fopen(filename, "r");
-	if (!hnd) {
-		fprintf(stderr, "%s: Cannot open file %s for reading\n",
-			__func__, filename);
-		free(buf);
-		return -EIO;
-	}
-	res = fread(buf, 1, size, hnd);
-	if (res <= 0) {
-		fprintf(stderr,
-			"%s: Failed to read %d bytes from %s with "
-			"ferror() %d\n",
-			__func__, size, filename, ferror(hnd));
-		fclose(hnd);
-		free(buf);
-		return -EIO;
-	}
-	fclose(hnd);
 
 	printf("Writing %d bytes at 0x%08x.......\n", res, offset);
 
@@ -1818,7 +1826,9 @@ static int write_flash3(struct common_hnd *chnd, const char *filename,
 
 	while (res) {
 		cnt = (res > block_write_size) ? block_write_size : res;
-		if (chnd->conf.erase && is_empty_page(&buf[offset], cnt)) {
+		/* Erased beforehand, empty pages can be skipped */
+		if ((chnd->conf.erase || chnd->conf.diff) &&
+		    is_empty_page(&buf[offset], cnt)) {
 			/* do nothing */
 		} else if (command_write_pages3(chnd, offset, cnt,
 						&buf[offset]) < 0) {
@@ -1832,7 +1842,6 @@ static int write_flash3(struct common_hnd *chnd, const char *filename,
 	}
 
 failed_write:
-	free(buf);
 	spi_flash_command_short(chnd, SPI_CMD_WRITE_DISABLE,
 				"SPI write disable");
 	spi_flash_follow_mode_exit(chnd, "Page program");
@@ -1844,54 +1853,119 @@ failed_write:
 	return ret;
 }
 
-/* Return zero on success, a non-zero value on failures. */
-static int verify_flash(struct common_hnd *chnd, const char *filename,
-			uint32_t offset)
+/*
+ * Read back size bytes at offset and compare them with the image in the
+ * buffer, at the same offset. Return zero on success, a non-zero value on
+ * failures.
+ */
+static int verify_flash(struct common_hnd *chnd, const uint8_t *buffer,
+			uint32_t offset, int size)
 {
 	int res;
-	int file_size;
-	FILE *hnd;
-	uint8_t *buffer = malloc(chnd->flash_size);
-	uint8_t *buffer2 = malloc(chnd->flash_size);
+	uint8_t *buffer2 = malloc(size);
 
-	if (!buffer || !buffer2) {
+	if (!buffer2) {
 		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
-			chnd->flash_size);
-		free(buffer);
-		free(buffer2);
+			size);
 		return -ENOMEM;
 	}
 
-	hnd = fopen(filename, "r");
-	if (!hnd) {
-		fprintf(stderr, "%s: Cannot open file %s for reading\n",
-			__func__, filename);
-		res = -EIO;
+	printf("Verify %d bytes at 0x%08x\n", size, offset);
+	res = command_read_pages(chnd, offset, size, buffer2);
+	if (res > 0)
+		res = memcmp(buffer + offset, buffer2, size);
+
+	printf("\n\rVerify %s\n", res ? "Failed!" : "Done.");
+
+	free(buffer2);
+	return res;
+}
+
+/* Write a part of the image, with the method that fits the flash */
+static int write_range(struct common_hnd *chnd, uint8_t *buffer,
+		       uint32_t offset, int size)
+{
+	if (!chnd->flash_cmd_v2)
+		return write_flash(chnd, buffer, offset, size);
+
+	switch (eflash_type) {
+	case EFLASH_TYPE_8315:
+		return write_flash2(chnd, buffer, offset, size);
+	case EFLASH_TYPE_KGD:
+		return write_flash3(chnd, buffer, offset, size);
+	default:
+		printf("Invalid EFLASH TYPE!");
+		return -EINVAL;
+	}
+}
+
+/*
+ * Read the flash back in one fast read, and only erase and write the sectors
+ * that differ from the image. Return zero on success, a non-zero value on
+ * failures.
+ */
+static int write_flash_diff(struct common_hnd *chnd, uint8_t *buffer,
+			    int size)
+{
+	const int sector_size = sector_erase_pages * PAGE_SIZE;
+	const int sectors = (size + sector_size - 1) / sector_size;
+	int i, n, changed = 0;
+	int start, len;
+	uint8_t *current, *dirty;
+	double t = now_seconds();
+	int res = -ENOMEM;
+
+	current = malloc(sectors * sector_size);
+	dirty = calloc(sectors, 1);
+	if (!current || !dirty) {
+		fprintf(stderr, "%s: Cannot allocate %d bytes\n", __func__,
+			sectors * sector_size);
 		goto exit;
 	}
+	/* The last sector is compared with erased flash past the image */
+	memset(buffer + size, 0xff, sectors * sector_size - size);
 
-	file_size = fread(buffer, 1, chnd->flash_size, hnd);
-	if (file_size <= 0) {
-		fprintf(stderr,
-			"%s: Failed to read %d bytes from %s with "
-			"ferror() %d\n",
-			__func__, chnd->flash_size, filename, ferror(hnd));
-		fclose(hnd);
-		res = -EIO;
+	printf("Reading %d bytes to compare\n", sectors * sector_size);
+	res = command_read_pages(chnd, 0, sectors * sector_size, current);
+	t = phase_done(PHASE_READ, t);
+	if (res < 0)
 		goto exit;
+
+	for (i = 0; i < sectors; i++) {
+		dirty[i] = !!memcmp(current + i * sector_size,
+				    buffer + i * sector_size, sector_size);
+		changed += dirty[i];
 	}
-	fclose(hnd);
+	printf("\n\r%d of %d sectors to update.\n", changed, sectors);
 
-	printf("Verify %d bytes at 0x%08x\n", file_size, offset);
-	res = command_read_pages(chnd, offset, chnd->flash_size, buffer2);
-	if (res > 0)
-		res = memcmp(buffer, buffer2, file_size);
+	res = 0;
+	for (i = 0; i < sectors && !res; i += n) {
+		/* Runs of changed sectors are erased and written together */
+		for (n = 0; i + n < sectors && dirty[i + n]; n++)
+			;
+		if (!n) {
+			n = 1;
+			continue;
+		}
 
-	printf("\n\rVerify %s\n", res ? "Failed!" : "Done.");
+		start = i * sector_size;
+		len = n * sector_size;
+		if (start + len > size)
+			len = size - start;
+
+		res = command_erase_sectors(chnd, start / PAGE_SIZE, n);
+		t = phase_done(PHASE_ERASE, t);
+		if (!res)
+			res = write_range(chnd, buffer, start, len);
+		t = phase_done(PHASE_WRITE, t);
+		if (!res && chnd->conf.verify)
+			res = verify_flash(chnd, buffer, start, len);
+		t = phase_done(PHASE_VERIFY, t);
+	}
 
 exit:
-	free(buffer);
-	free(buffer2);
+	free(dirty);
+	free(current);
 	return res;
 }
 
@@ -2082,6 +2156,7 @@ static int strdup_with_errmsg(const char *source, char **dest, const char *name)
 
 static const struct option longopts[] = { { "block-write-size", 1, 0, 'b' },
 					  { "debug", 0, 0, 'd' },
+					  { "diff", 0, 0, 'f' },
 					  { "erase", 0, 0, 'e' },
 					  { "help", 0, 0, 'h' },
 					  { "i2c-dev-path", 1, 0, 'D' },
@@ -2107,10 +2182,12 @@ static void display_usage(const char *program)
 		"Usage: %s [-d] [-v <VID>] [-p <PID>] \\\n"
 		"\t[-c <linux|ccd|ftdi>] [-D /dev/i2c-<N>] [-i <1|2>] [-S] \\\n"
 		"\t[-s <serial>] [-e] [-r <file>] [-W <0|1|false|true>] \\\n"
-		"\t[-w <file>] [-R base[:size]] [-m] [-b <size>]\n",
+		"\t[-w <file>] [-R base[:size]] [-m] [-b <size>] [-f]\n",
 		program);
 	fprintf(stderr, "-d, --debug : Output debug traces.\n");
 	fprintf(stderr, "-e, --erase : Erase all the flash content.\n");
+	fprintf(stderr, "-f, --diff : Read the flash back, and only erase and\n"
+			"\twrite the sectors that differ from <file>.\n");
 	fprintf(stderr, "-c, --i2c-interface <linux|ccd|ftdi> : I2C interface "
 			"to use\n");
 	fprintf(stderr, "-D, --i2c-dev-path /dev/i2c-<N> : Path to "
@@ -2189,7 +2266,7 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 	int opt, idx, ret = 0;
 
 	while (!ret &&
-	       (opt = getopt_long(argc, argv, "?b:c:D:dehi:mp:R:r:s:uv:W:w:Zz",
+	       (opt = getopt_long(argc, argv, "?b:c:D:defhi:mp:R:r:s:uv:W:w:Zz",
 				  longopts, &idx)) != -1) {
 		switch (opt) {
 		case 'b':
@@ -2220,6 +2297,9 @@ static int parse_parameters(int argc, char **argv, struct iteflash_config *conf)
 		case 'e':
 			conf->erase = 1;
 			break;
+		case 'f':
+			conf->diff = 1;
+			break;
 		case 'h':
 		case '?':
 			display_usage(argv[0]);
@@ -2401,39 +2481,61 @@ int main(int argc, char **argv)
 	if (ret)
 		goto return_after_init;
 
+	/*
+	 * Sectors are only erased one by one with the v2 commands. Without
+	 * them, write everything, which needs the whole flash erased first.
+	 */
+	if (chnd.conf.diff && (chnd.conf.erase || !chnd.flash_cmd_v2)) {
+		printf("Differential write not possible, erasing and writing "
+		       "everything\n");
+		chnd.conf.diff = 0;
+		if (chnd.conf.output_filename)
+			chnd.conf.erase = 1;
+	}
+
 	if (chnd.conf.erase) {
+		double t = now_seconds();
+
 		if (chnd.flash_cmd_v2)
 			/* Do Normal Erase Function */
 			command_erase2(&chnd, chnd.flash_size, 0, 0);
 		else
 			command_erase(&chnd, chnd.flash_size, 0);
+		phase_done(PHASE_ERASE, t);
 	}
 
 	if (chnd.conf.output_filename) {
-		if (chnd.flash_cmd_v2)
-			switch (eflash_type) {
-			case EFLASH_TYPE_8315:
-				ret = write_flash2(
-					&chnd, chnd.conf.output_filename, 0);
-				break;
-			case EFLASH_TYPE_KGD:
-				ret = write_flash3(
-					&chnd, chnd.conf.output_filename, 0);
-				break;
-			default:
-				printf("Invalid EFLASH TYPE!");
-				ret = -EINVAL;
-				break;
+		double t = now_seconds();
+		/* The image is read once, for writing and verifying */
+		uint8_t *buffer = malloc(chnd.flash_size);
+		int size;
+
+		if (!buffer) {
+			fprintf(stderr, "Cannot allocate %d bytes\n",
+				chnd.flash_size);
+			ret = -ENOMEM;
+			goto return_after_init;
+		}
+		memset(buffer, 0xff, chnd.flash_size);
+		size = load_image(&chnd, chnd.conf.output_filename, buffer);
+		t = phase_done(PHASE_LOAD, t);
+
+		if (size < 0) {
+			ret = size;
+		} else if (chnd.conf.diff) {
+			ret = write_flash_diff(&chnd, buffer, size);
+		} else {
+			ret = write_range(&chnd, buffer, 0, size);
+			t = phase_done(PHASE_WRITE, t);
+			if (!ret && chnd.conf.verify) {
+				ret = verify_flash(&chnd, buffer, 0, size);
+				phase_done(PHASE_VERIFY, t);
 			}
-		else
-			ret = write_flash(&chnd, chnd.conf.output_filename, 0);
+		}
+		free(buffer);
+		print_phase_times();
 		if (ret)
 			goto return_after_init;
-		if (chnd.conf.verify) {
-			ret = verify_flash(&chnd, chnd.conf.output_filename, 0);
-			if (ret)
-				goto return_after_init;
-		}
 	}
 
 	/* Normal exit */
@@ -8,6 +8,7 @@
 #include "ec_commands.h"
 #include "lb_common.h"
 #include "lightbar.h"
+#include "lightbyte.h"
 
 #include <errno.h>
 #include <stdarg.h>
@@ -26,6 +27,7 @@ static const char usage[] =
 	"\n"
 	"Options:\n"
 	"  -d         Decode binary to ascii\n"
+	"  -p         Decode binary to the EC's pre-decoded instructions\n"
 	"  -v         Decode output should be verbose\n"
 	"\n";
 
@@ -65,11 +67,6 @@ struct safe_lightbar_program {
 	uint8_t zeros[LB_PROG_MAX_OPERANDS];
 } __packed;
 
-#define OP(NAME, BYTES, MNEMONIC) NAME,
-#include "lightbar_opcode_list.h"
-enum lightbyte_opcode { LIGHTBAR_OPCODE_TABLE MAX_OPCODE };
-#undef OP
-
 #define OP(NAME, BYTES, MNEMONIC) BYTES,
 #include "lightbar_opcode_list.h"
 static const int num_operands[] = { LIGHTBAR_OPCODE_TABLE };
@@ -262,6 +259,59 @@ static void disassemble_prog(FILE *fp, struct safe_lightbar_program *prog)
 		}
 }
 
+/* Print the instructions that lightbyte_decode() gives the EC to run. */
+static void print_decoded_prog(FILE *fp, struct safe_lightbar_program *prog)
+{
+	struct lightbyte_inst insts[LIGHTBYTE_MAX_INSTS];
+	const struct lightbyte_inst *inst;
+	int i, n;
+
+	n = lightbyte_decode(&prog->p, insts);
+	fprintf(fp, "# %d instructions\n", n);
+
+	for (i = 0; i < n; i++) {
+		inst = &insts[i];
+		fprintf(fp, "%3d:\t", i);
+		if (inst->op == LIGHTBYTE_FAULT) {
+			fprintf(fp, "fault\t0x%02x\n", inst->arg[0]);
+			continue;
+		}
+
+		fprintf(fp, "%s", opcode_sym[inst->op]);
+		switch (inst->op) {
+		case JUMP:
+		case JUMP_IF_CHARGING:
+		case SET_BRIGHTNESS:
+			fprintf(fp, "\t%d\n", inst->arg[0]);
+			break;
+		case JUMP_BATTERY:
+			fprintf(fp, "\t%d %d\n", inst->arg[0], inst->arg[1]);
+			break;
+		case SET_WAIT_DELAY:
+		case SET_RAMP_DELAY:
+			fprintf(fp, "\t%u\n", inst->delay);
+			break;
+		case SET_COLOR_SINGLE:
+			fprintf(fp, "\t");
+			print_led_set(fp, inst->arg[0]);
+			fprintf(fp, ".%s.%s\t0x%02x\n",
+				control_sym[inst->arg[1]],
+				color_sym[inst->arg[2]], inst->rgb[0]);
+			break;
+		case SET_COLOR_RGB:
+			fprintf(fp, "\t");
+			print_led_set(fp, inst->arg[0]);
+			fprintf(fp, ".%s\t0x%02x 0x%02x 0x%02x\n",
+				control_sym[inst->arg[1]], inst->rgb[0],
+				inst->rgb[1], inst->rgb[2]);
+			break;
+		default:
+			fprintf(fp, "\n");
+			break;
+		}
+	}
+}
+
 /* We'll split each line into an array of these. */
 struct parse_s {
 	char *word;
@@ -584,6 +634,7 @@ int main(int argc, char *argv[])
 {
 	struct safe_lightbar_program safe_prog;
 	int opt_decode = 0;
+	int opt_predecoded = 0;
 	int c;
 	int errorcnt = 0;
 	const char *infile, *outfile;
@@ -596,11 +647,14 @@ int main(int argc, char *argv[])
 		progname = argv[0];
 
 	opterr = 0; /* quiet, you */
-	while ((c = getopt(argc, argv, ":dv")) != -1) {
+	while ((c = getopt(argc, argv, ":dpv")) != -1) {
 		switch (c) {
 		case 'd':
 			opt_decode = 1;
 			break;
+		case 'p':
+			opt_predecoded = 1;
+			break;
 		case 'v':
 			opt_verbose = 1;
 			break;
@@ -654,13 +708,16 @@ int main(int argc, char *argv[])
 		ofp = stdout;
 	}
 
-	if (opt_decode) {
+	if (opt_decode || opt_predecoded) {
 		read_binary(ifp, &safe_prog);
 		fclose(ifp);
 		if (hit_errors)
 			return 1;
 		fprintf(ofp, "# %s\n", infile);
-		disassemble_prog(ofp, &safe_prog);
+		if (opt_predecoded)
+			print_decoded_prog(ofp, &safe_prog);
+		else
+			disassemble_prog(ofp, &safe_prog);
 		fclose(ofp);
 	} else {
 		memset(&safe_prog, 0, sizeof(safe_prog));
@@ -0,0 +1,431 @@
+#!/usr/bin/env python3
+# Copyright 2023 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Emulator of the STM32 ROM bootloader USART protocol on a pty.
+
+Serves the AN3155 protocol for an STM32G071 with 128 KiB of flash, with the
+time the UART link and the flash operations take, so that stm32mon can be run
+against it without hardware. Like the real one, the bootloader only reads the
+UART when it waits for a frame: bytes that come in while it is busy, beyond
+what the receiver holds, are lost to an overrun. It NACKs a bad frame, then
+parses whatever follows as the next command:
+
+    ./util/stm32_bootloader_emulator.py
+    stm32mon -d /dev/pts/N -w ec.bin
+
+With --bench, flashes an image several times with the given stm32mon binary
+and reports how long each pass takes:
+
+    ./util/stm32_bootloader_emulator.py --bench build/host/util/stm32mon
+"""
+
+import argparse
+import collections
+import os
+import random
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+import tty
+
+
+ACK = 0x79
+NACK = 0x1F
+
+CMD_INIT = 0x7F
+CMD_GETCMD = 0x00
+CMD_GETVER = 0x01
+CMD_GETID = 0x02
+CMD_READMEM = 0x11
+CMD_GO = 0x21
+CMD_WRITEMEM = 0x31
+CMD_EXTERASE = 0x44
+CMD_WP = 0x63
+CMD_WU = 0x73
+CMD_RP = 0x82
+CMD_RU = 0x92
+
+BOOTLOADER_VERSION = 0x31
+COMMANDS = [
+    CMD_GETCMD,
+    CMD_GETVER,
+    CMD_GETID,
+    CMD_READMEM,
+    CMD_GO,
+    CMD_WRITEMEM,
+    CMD_EXTERASE,
+    CMD_WP,
+    CMD_WU,
+    CMD_RP,
+    CMD_RU,
+]
+
+CHIP_ID = 0x460  # STM32G071xx
+FLASH_BASE = 0x08000000
+FLASH_SIZE = 128 * 1024
+PAGE_SIZE = 2048
+
+# Datasheet figures for the STM32G0: page erase and 64-bit programming
+PAGE_ERASE_S = 0.022
+DOUBLE_WORD_WRITE_S = 0.000085
+
+# 8 data bits, even parity and a stop bit, after the start bit
+BITS_PER_BYTE = 11
+
+
+class ProtocolError(Exception):
+    """The host sent something the bootloader would NACK."""
+
+
+class Bootloader:
+    """Bootloader state and the link to the host."""
+
+    def __init__(self, fd, baudrate, latency, rx_fifo):
+        self.fd = fd
+        self.byte_time = BITS_PER_BYTE / baudrate
+        self.latency = latency
+        self.rx_fifo = rx_fifo
+        self.flash = bytearray(b"\xff" * FLASH_SIZE)
+        self.started = False
+        self.cond = threading.Condition()
+        # (arrival time, byte) still on the wire, and bytes received
+        self.line = collections.deque()
+        self.received = collections.deque()
+        self.line_free = 0.0
+        # When the bootloader last stopped polling the receiver, and for how
+        # long it has been busy since: sending, or with the flash.
+        self.busy_since = 0.0
+        self.busy_time = 0.0
+        self.eof = False
+        self.overruns = 0
+
+    def reset(self):
+        """Reset into the bootloader, which waits for autobaud again."""
+        with self.cond:
+            self.started = False
+            self.line.clear()
+            self.received.clear()
+            self.overruns = 0
+
+    def _read_link(self):
+        """Put the bytes from the host on the wire, as the UART paces them."""
+        while True:
+            try:
+                data = os.read(self.fd, 4096)
+            except OSError:
+                data = b""
+            with self.cond:
+                if not data:
+                    self.eof = True
+                    self.cond.notify()
+                    return
+                # Each transfer from the host pays for the link turnaround
+                # once, then its bytes follow each other on the line.
+                start = max(time.monotonic() + self.latency, self.line_free)
+                for i, byte in enumerate(data):
+                    self.line.append((start + (i + 1) * self.byte_time, byte))
+                self.line_free = self.line[-1][0]
+                self.cond.notify()
+
+    def _busy(self, seconds):
+        """Spend time without polling the receiver."""
+        time.sleep(seconds)
+        self.busy_time += seconds
+
+    def _receive(self, now):
+        """Receive what came in since the last recv(), overruns included."""
+        busy_until = self.busy_since + self.busy_time
+        held = 0
+        while self.line and self.line[0][0] <= now:
+            arrival, byte = self.line.popleft()
+            # Came in while polling, or there is room in the receiver. The
+            # time the emulator itself takes doesn't count.
+            busy = self.busy_since < arrival <= busy_until
+            if not busy or held < self.rx_fifo:
+                held += busy
+                self.received.append(byte)
+            else:
+                self.overruns += 1
+
+    def recv(self, count):
+        """Receive count bytes from the host."""
+        data = bytearray()
+        with self.cond:
+            self._receive(time.monotonic())
+            while len(data) < count:
+                if self.received:
+                    data.append(self.received.popleft())
+                    continue
+                # Polling the receiver, so nothing is lost meanwhile
+                now = time.monotonic()
+                if self.line and self.line[0][0] <= now:
+                    data.append(self.line.popleft()[1])
+                elif self.line:
+                    self.cond.wait(self.line[0][0] - now)
+                elif self.eof:
+                    raise EOFError
+                else:
+                    self.cond.wait()
+            self.busy_since = time.monotonic()
+            self.busy_time = 0.0
+        return bytes(data)
+
+    def send(self, data):
+        """Send bytes to the host."""
+        self._busy(len(data) * self.byte_time)
+        os.write(self.fd, bytes(data))
+
+    def ack(self):
+        """Acknowledge the last frame."""
+        self.send([ACK])
+
+    def recv_checked(self, count):
+        """Receive count bytes followed by their XOR checksum."""
+        data = self.recv(count)
+        checksum = self.recv(1)[0]
+        expected = 0
+        for byte in data:
+            expected ^= byte
+        if count == 1:
+            expected ^= 0xFF
+        if checksum != expected:
+            raise ProtocolError("bad checksum")
+        return data
+
+    def recv_address(self):
+        """Receive an address frame and acknowledge it."""
+        address = int.from_bytes(self.recv_checked(4), "big")
+        self.ack()
+        return address
+
+    def read(self, address, size):
+        """Read memory: flash, or 0xff for system memory we don't have."""
+        offset = address - FLASH_BASE
+        if 0 <= offset and offset + size <= FLASH_SIZE:
+            return self.flash[offset : offset + size]
+        return b"\xff" * size
+
+    def cmd_getcmd(self):
+        """Get the version and the commands supported."""
+        self.ack()
+        self.send([len(COMMANDS), BOOTLOADER_VERSION] + COMMANDS)
+        self.ack()
+
+    def cmd_getver(self):
+        """Get the version and the read protection status."""
+        self.ack()
+        self.send([BOOTLOADER_VERSION, 0, 0])
+        self.ack()
+
+    def cmd_getid(self):
+        """Get the chip ID."""
+        self.ack()
+        self.send([1, CHIP_ID >> 8, CHIP_ID & 0xFF])
+        self.ack()
+
+    def cmd_readmem(self):
+        """Read up to 256 bytes of memory."""
+        self.ack()
+        address = self.recv_address()
+        count = self.recv_checked(1)[0] + 1
+        self.ack()
+        self.send(self.read(address, count))
+
+    def cmd_writemem(self):
+        """Program up to 256 bytes of flash."""
+        self.ack()
+        address = self.recv_address()
+        count = self.recv(1)[0] + 1
+        data = self.recv(count)
+        checksum = self.recv(1)[0]
+        expected = count - 1
+        for byte in data:
+            expected ^= byte
+        if checksum != expected:
+            raise ProtocolError("bad checksum")
+        offset = address - FLASH_BASE
+        if offset < 0 or offset + count > FLASH_SIZE:
+            raise ProtocolError("write out of flash")
+        self._busy((count + 7) // 8 * DOUBLE_WORD_WRITE_S)
+        # Flash bits can only be cleared without an erase
+        for i, byte in enumerate(data):
+            self.flash[offset + i] &= byte
+        self.ack()
+
+    def cmd_exterase(self):
+        """Erase the whole flash, or a list of pages."""
+        self.ack()
+        head = self.recv(2)
+        count = int.from_bytes(head, "big")
+        if count == 0xFFFF:
+            if self.recv(1)[0] != head[0] ^ head[1]:
+                raise ProtocolError("bad checksum")
+            pages = range(FLASH_SIZE // PAGE_SIZE)
+        else:
+            data = self.recv(2 * (count + 1))
+            expected = head[0] ^ head[1]
+            for byte in data:
+                expected ^= byte
+            if self.recv(1)[0] != expected:
+                raise ProtocolError("bad checksum")
+            pages = [
+                int.from_bytes(data[i : i + 2], "big")
+                for i in range(0, len(data), 2)
+            ]
+        for page in pages:
+            if page >= FLASH_SIZE // PAGE_SIZE:
+                raise ProtocolError("erase out of flash")
+            self._busy(PAGE_ERASE_S)
+            start = page * PAGE_SIZE
+            self.flash[start : start + PAGE_SIZE] = b"\xff" * PAGE_SIZE
+        self.ack()
+
+    def cmd_go(self):
+        """Jump to the application: the host gets the ACKs only."""
+        self.ack()
+        self.recv_address()
+
+    def cmd_protection(self):
+        """Protection changes reset the chip, nothing to emulate."""
+        self.ack()
+        self.ack()
+
+    def serve(self):
+        """Serve commands until the pty is closed."""
+        threading.Thread(target=self._read_link, daemon=True).start()
+        handlers = {
+            CMD_GETCMD: self.cmd_getcmd,
+            CMD_GETVER: self.cmd_getver,
+            CMD_GETID: self.cmd_getid,
+            CMD_READMEM: self.cmd_readmem,
+            CMD_GO: self.cmd_go,
+            CMD_WRITEMEM: self.cmd_writemem,
+            CMD_EXTERASE: self.cmd_exterase,
+            CMD_WP: self.cmd_protection,
+            CMD_WU: self.cmd_protection,
+            CMD_RP: self.cmd_protection,
+            CMD_RU: self.cmd_protection,
+        }
+        while True:
+            try:
+                cmd = self.recv(1)[0]
+                if cmd == CMD_INIT and not self.started:
+                    self.started = True
+                    self.ack()
+                    continue
+                if self.recv(1)[0] != cmd ^ 0xFF or cmd not in handlers:
+                    raise ProtocolError("bad command 0x%02x" % cmd)
+                handlers[cmd]()
+            except ProtocolError:
+                # Back to waiting for a command, with the rest of the frame
+                # still coming in.
+                self.send([NACK])
+            except (EOFError, OSError):
+                return
+
+
+def open_pty():
+    """Open a pty, returning the master fd and the name of the slave."""
+    master, slave = os.openpty()
+    tty.setraw(slave)
+    name = os.ttyname(slave)
+    # Keep the slave open so that the master survives each stm32mon run
+    return master, name, slave
+
+
+def run_stm32mon(stm32mon, port, args):
+    """Run stm32mon, returning how long it took."""
+    start = time.monotonic()
+    result = subprocess.run(
+        [stm32mon, "-d", port, "-b", "115200"] + args,
+        check=False,
+        capture_output=True,
+        text=True,
+    )
+    if result.returncode:
+        sys.exit(result.stdout + result.stderr)
+    return time.monotonic() - start
+
+
+def bench(bootloader, port, stm32mon, size):
+    """Compare a full write with writes that skip identical pages."""
+    image = bytearray(random.getrandbits(8) for _ in range(size))
+    with tempfile.NamedTemporaryFile(suffix=".bin") as f:
+        f.write(image)
+        f.flush()
+
+        def flash(label, args):
+            bootloader.reset()
+            elapsed = run_stm32mon(stm32mon, port, args + ["-w", f.name])
+            if bootloader.flash[:size] != image:
+                sys.exit("%s: flash does not match the image" % label)
+            print(
+                "%-34s %6.2f s %6d bytes overrun"
+                % (label, elapsed, bootloader.overruns)
+            )
+
+        def change_one_page():
+            # A small change, like a version string
+            image[PAGE_SIZE + 100] ^= 0xFF
+            f.seek(0)
+            f.write(image)
+            f.flush()
+
+        flash("full write", [])
+        flash("full rewrite, same image", [])
+        flash("skip identical, same image", ["-S"])
+        flash("skip identical, batched", ["-S", "-B"])
+        change_one_page()
+        flash("skip identical, one page", ["-S"])
+        change_one_page()
+        flash("skip identical, batched, one page", ["-S", "-B"])
+
+
+def main(argv):
+    """Serve the bootloader on a pty, or run the throughput comparison."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument(
+        "--baudrate", type=int, default=115200, help="emulated UART speed"
+    )
+    parser.add_argument(
+        "--latency",
+        type=float,
+        default=0.001,
+        help="seconds the link takes to turn around, e.g. a USB-UART bridge",
+    )
+    parser.add_argument(
+        "--rx-fifo",
+        type=int,
+        default=1,
+        help="bytes the UART holds while the bootloader is busy; 1 is the "
+        "data register alone, as the ROM bootloaders run it",
+    )
+    parser.add_argument(
+        "--bench", metavar="STM32MON", help="run stm32mon against the emulator"
+    )
+    parser.add_argument(
+        "--size", type=int, default=32 * 1024, help="image size for --bench"
+    )
+    args = parser.parse_args(argv)
+
+    master, port, _ = open_pty()
+    bootloader = Bootloader(
+        master, args.baudrate, args.latency, args.rx_fifo
+    )
+
+    if not args.bench:
+        print("STM32 bootloader on %s" % port, flush=True)
+        bootloader.serve()
+        return
+
+    server = threading.Thread(target=bootloader.serve, daemon=True)
+    server.start()
+    bench(bootloader, port, args.bench, args.size)
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -35,6 +35,7 @@
 #include <getopt.h>
 #include <linux/i2c-dev.h>
 #include <linux/spi/spidev.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <termios.h>
@@ -227,7 +228,7 @@ struct stm32_def {
 			.package_data_addr =		0, /* 0x1FFF7BF0 */
 		}
 	},
-	{0x450, "STM32H74x",    0x200000, 131768, {13, 19}, { { 0 } }, { 0 } },
+	{0x450, "STM32H74x",    0x200000, 131072, {13, 19}, { { 0 } }, { 0 } },
 	{0x451, "STM32F76x",    0x200000, 32768, {13, 19}, { { 0 } }, { 0 } },
 	{
 		.id =		0x460,
@@ -330,6 +331,8 @@ enum {
 	FLAG_GO = 0x04,
 	FLAG_READ_UNPROTECT = 0x08,
 	FLAG_CR50_MODE = 0x10,
+	FLAG_SKIP_IDENTICAL = 0x20,
+	FLAG_BATCH = 0x40,
 };
 
 typedef struct {
@@ -345,6 +348,12 @@ command_erase_t command_erase_i2c;
 
 command_erase_t *erase;
 
+/*
+ * Send memory commands in one write, see send_command_batched(). Off by
+ * default: the bootloader may not keep up with back-to-back frames.
+ */
+static int batch_commands;
+
 static void discard_input(int);
 
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
@@ -792,6 +801,140 @@ int send_command_retry(int fd, uint8_t cmd, payload_t *loads, int cnt,
 	return res;
 }
 
+/*
+ * Same as send_command(), but write the command frame and all of its payloads
+ * at once, then collect their ACKs: one round trip over the link instead of
+ * one per payload. Only for the serial protocol.
+ *
+ * The bootloader does not read the UART while it sends an ACK, and most have
+ * no receive FIFO: any byte that comes in meanwhile, beyond the one that the
+ * data register holds, is lost to an overrun. So this only works with a
+ * bootloader that keeps up, which is why it is opt-in (--batch).
+ *
+ * On failures, the input is discarded; resync() the bootloader before sending
+ * the command again with send_command_retry().
+ */
+int send_command_batched(int fd, uint8_t cmd, payload_t *loads, int cnt,
+			 uint8_t *resp, int resp_size)
+{
+	int res, i, c;
+	int size = 2;
+	int readcnt = 0;
+	uint8_t *frame, *ptr;
+
+	for (c = 0; c < cnt; c++)
+		size += loads[c].size + 1;
+
+	frame = (uint8_t *)(malloc(size));
+	if (!frame)
+		return STM32_ENOMEM;
+
+	ptr = frame;
+	*ptr++ = cmd;
+	*ptr++ = 0xff ^ cmd;
+	for (c = 0; c < cnt; c++) {
+		uint8_t crc = 0;
+
+		for (i = 0; i < loads[c].size; i++)
+			crc ^= loads[c].data[i];
+		if (loads[c].size == 1)
+			crc = 0xff ^ crc;
+		memcpy(ptr, loads[c].data, loads[c].size);
+		ptr += loads[c].size;
+		*ptr++ = crc;
+	}
+
+	for (ptr = frame; size; size -= res, ptr += res) {
+		res = write_wrapper(fd, ptr, size);
+		if (res < 0) {
+			perror("Failed to write command");
+			free(frame);
+			return STM32_EIO;
+		}
+	}
+	free(frame);
+
+	/* One ACK for the command, and one per payload */
+	for (c = 0; c <= cnt; c++) {
+		res = wait_for_ack(fd);
+		if (IS_STM32_ERROR(res)) {
+			discard_input(fd);
+			return res;
+		}
+	}
+
+	while ((resp_size > 0) && (res = read_wrapper(fd, resp, resp_size))) {
+		if (res < 0) {
+			perror("Failed to read payload");
+			return STM32_EIO;
+		}
+		readcnt += res;
+		resp += res;
+		resp_size -= res;
+	}
+
+	return readcnt;
+}
+
+/*
+ * After a batched command lost bytes to an overrun, the bootloader may still
+ * wait for the rest of a frame. Feed it filler bytes, one at a time, until it
+ * NACKs: then it waits for a command again. No frame made of 0xfe alone has a
+ * good checksum, so the filler never gets anything written or erased, and it
+ * only completes a command after 0x01 (GET_VERSION).
+ */
+#define RESYNC_FILLER 0xfe
+#define RESYNC_MAX_BYTES 1024
+#define RESYNC_REPLY_MS 20
+
+static int resync(int fd)
+{
+	const uint8_t filler = RESYNC_FILLER;
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	uint8_t resp;
+	int i;
+
+	discard_input(fd);
+	for (i = 0; i < RESYNC_MAX_BYTES; i++) {
+		if (write_wrapper(fd, &filler, 1) != 1)
+			return STM32_EIO;
+		while (poll(&pfd, 1, RESYNC_REPLY_MS) > 0) {
+			if (read_wrapper(fd, &resp, 1) != 1)
+				break;
+			if (resp == RESP_NACK) {
+				discard_input(fd);
+				return STM32_SUCCESS;
+			}
+		}
+	}
+
+	fprintf(stderr, "Bootloader still out of sync after %d bytes\n", i);
+	return STM32_EIO;
+}
+
+/* Send a memory access command, batched when possible */
+static int send_mem_command(int fd, uint8_t cmd, payload_t *loads, int cnt,
+			    uint8_t *resp, int resp_size, int ack_requested)
+{
+	if (batch_commands) {
+		int res = send_command_batched(fd, cmd, loads, cnt, resp,
+					       resp_size);
+
+		if (!IS_STM32_ERROR(res) && res == resp_size)
+			return res;
+		/* The bootloader can't keep up, don't try again */
+		fprintf(stderr,
+			"Batched command 0x%02x failed, retrying unbatched\n",
+			cmd);
+		batch_commands = 0;
+		if (IS_STM32_ERROR(resync(fd)))
+			return STM32_EIO;
+	}
+
+	return send_command_retry(fd, cmd, loads, cnt, resp, resp_size,
+				  ack_requested);
+}
+
 struct stm32_def *command_get_id(int fd)
 {
 	int res;
@@ -949,8 +1092,8 @@ int command_read_mem(int fd, uint32_t address, uint32_t size, uint8_t *buffer)
 
 		draw_spinner(remaining, size);
 
-		res = send_command_retry(fd, CMD_READMEM, loads, 2, buffer,
-					 bytes, 0);
+		res = send_mem_command(fd, CMD_READMEM, loads, 2, buffer,
+				       bytes, 0);
 		if (IS_STM32_ERROR(res))
 			return STM32_EIO;
 
@@ -986,8 +1129,8 @@ int command_write_mem(int fd, uint32_t address, uint32_t size, uint8_t *buffer)
 
 			draw_spinner(remaining, size);
 
-			res = send_command_retry(fd, CMD_WRITEMEM, loads, 2,
-						 NULL, 0, 1);
+			res = send_mem_command(fd, CMD_WRITEMEM, loads, 2,
+					       NULL, 0, 1);
 			if (IS_STM32_ERROR(res))
 				return STM32_EIO;
 		}
@@ -1387,19 +1530,14 @@ int read_flash(int fd, struct stm32_def *chip, const char *filename,
 	return IS_STM32_ERROR(res) ? res : STM32_SUCCESS;
 }
 
-/* Return zero on success, a negative error value on failures. */
-int write_flash(int fd, struct stm32_def *chip, const char *filename,
-		uint32_t offset)
+/*
+ * Read up to size bytes of an image from a file, or from standard input for
+ * "-". Return the number of bytes read, or a negative error value.
+ */
+static int read_image(const char *filename, uint8_t *buffer, int size)
 {
-	int res, written;
+	int res;
 	FILE *hnd;
-	int size = chip->flash_size;
-	uint8_t *buffer = (uint8_t *)(malloc(size));
-
-	if (!buffer) {
-		fprintf(stderr, "Cannot allocate %d bytes\n", size);
-		return STM32_ENOMEM;
-	}
 
 	if (!strncmp(filename, "-", sizeof("-")))
 		hnd = fdopen(STDIN_FILENO, "r");
@@ -1407,17 +1545,37 @@ int write_flash(int fd, struct stm32_def *chip, const char *filename,
 		hnd = fopen(filename, "r");
 	if (!hnd) {
 		fprintf(stderr, "Cannot open file %s for reading\n", filename);
-		free(buffer);
 		return STM32_EIO;
 	}
 	res = fread(buffer, 1, size, hnd);
 	fclose(hnd);
 	if (res <= 0) {
 		fprintf(stderr, "Cannot read %s\n", filename);
-		free(buffer);
 		return STM32_EIO;
 	}
 
+	return res;
+}
+
+/* Return zero on success, a negative error value on failures. */
+int write_flash(int fd, struct stm32_def *chip, const char *filename,
+		uint32_t offset)
+{
+	int res, written;
+	int size = chip->flash_size;
+	uint8_t *buffer = (uint8_t *)(malloc(size));
+
+	if (!buffer) {
+		fprintf(stderr, "Cannot allocate %d bytes\n", size);
+		return STM32_ENOMEM;
+	}
+
+	res = read_image(filename, buffer, size);
+	if (IS_STM32_ERROR(res)) {
+		free(buffer);
+		return res;
+	}
+
 	/* faster write: skip empty trailing space */
 	while (res && buffer[res - 1] == 0xff)
 		res--;
@@ -1437,14 +1595,125 @@ int write_flash(int fd, struct stm32_def *chip, const char *filename,
 	return STM32_SUCCESS;
 }
 
+static double now_seconds(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Only erase and write the pages that differ from the image, after reading
+ * them back. Consecutive pages are erased with one command. Return zero on
+ * success, a negative error value on failures.
+ */
+int write_flash_diff(int fd, struct stm32_def *chip, const char *filename,
+		     uint32_t offset)
+{
+	const uint32_t page_size = chip->page_size;
+	const int size = chip->flash_size;
+	uint32_t first_page, page_count, addr;
+	uint32_t i, n, changed = 0;
+	uint8_t *buffer = NULL, *current = NULL, *dirty = NULL;
+	double start = now_seconds();
+	int res;
+
+	/* Sector numbers don't follow addresses on these */
+	if (!strncmp("STM32F4", chip->name, 7) ||
+	    !strncmp("STM32F7", chip->name, 7)) {
+		fprintf(stderr, "Cannot compare pages of %s\n", chip->name);
+		return STM32_EINVAL;
+	}
+	if (offset < STM32_MAIN_MEMORY_ADDR ||
+	    (offset - STM32_MAIN_MEMORY_ADDR) % page_size ||
+	    offset - STM32_MAIN_MEMORY_ADDR >= (uint32_t)size) {
+		fprintf(stderr, "Offset 0x%08x is not at a page of flash\n",
+			offset);
+		return STM32_EINVAL;
+	}
+	first_page = (offset - STM32_MAIN_MEMORY_ADDR) / page_size;
+
+	buffer = (uint8_t *)(malloc(size));
+	current = (uint8_t *)(malloc(page_size));
+	if (!buffer || !current) {
+		fprintf(stderr, "Cannot allocate %d bytes\n", size);
+		res = STM32_ENOMEM;
+		goto out;
+	}
+
+	/* Pages past the end of the image are compared with erased flash */
+	memset(buffer, 0xff, size);
+	res = read_image(filename, buffer, size - first_page * page_size);
+	if (IS_STM32_ERROR(res))
+		goto out;
+	page_count = (res + page_size - 1) / page_size;
+
+	dirty = (uint8_t *)(calloc(page_count, 1));
+	if (!dirty) {
+		res = STM32_ENOMEM;
+		goto out;
+	}
+
+	printf("Comparing %d pages at 0x%08x\n", page_count, offset);
+	for (i = 0; i < page_count; i++) {
+		addr = offset + i * page_size;
+		res = command_read_mem(fd, addr, page_size, current);
+		if (res != (int)page_size) {
+			fprintf(stderr, "Cannot read page at 0x%08x\n", addr);
+			res = STM32_EIO;
+			goto out;
+		}
+		dirty[i] = !!memcmp(current, buffer + i * page_size, page_size);
+		changed += dirty[i];
+	}
+	printf("\r   %d of %d pages to update.\n", changed, page_count);
+
+	for (i = 0; i < page_count; i += n) {
+		for (n = 0; i + n < page_count && dirty[i + n] && n < 128; n++)
+			;
+		if (!n) {
+			n = 1;
+			continue;
+		}
+		res = erase(fd, n, first_page + i);
+		if (IS_STM32_ERROR(res))
+			goto out;
+	}
+
+	for (i = 0; i < page_count; i++) {
+		if (!dirty[i])
+			continue;
+		addr = offset + i * page_size;
+		res = command_write_mem(fd, addr, page_size,
+					buffer + i * page_size);
+		if (res != (int)page_size) {
+			fprintf(stderr, "Error writing page at 0x%08x\n", addr);
+			res = STM32_EIO;
+			goto out;
+		}
+	}
+	printf("\r   %d pages written in %.1f s.\n", changed,
+	       now_seconds() - start);
+	res = STM32_SUCCESS;
+
+out:
+	free(dirty);
+	free(current);
+	free(buffer);
+	return res;
+}
+
 static const struct option longopts[] = {
-	{ "adapter", 1, 0, 'a' },  { "baudrate", 1, 0, 'b' },
+	{ "adapter", 1, 0, 'a' },  { "batch", 0, 0, 'B' },
+	{ "baudrate", 1, 0, 'b' },
 	{ "cr50", 0, 0, 'c' },	   { "device", 1, 0, 'd' },
 	{ "erase", 0, 0, 'e' },	   { "go", 0, 0, 'g' },
 	{ "help", 0, 0, 'h' },	   { "length", 1, 0, 'n' },
 	{ "location", 1, 0, 'l' }, { "logfile", 1, 0, 'L' },
 	{ "offset", 1, 0, 'o' },   { "progressbar", 0, 0, 'p' },
 	{ "read", 1, 0, 'r' },	   { "retries", 1, 0, 'R' },
+	{ "skip-identical", 0, 0, 'S' },
 	{ "spi", 1, 0, 's' },	   { "unprotect", 0, 0, 'u' },
 	{ "version", 0, 0, 'v' },  { "write", 1, 0, 'w' },
 	{ NULL, 0, 0, 0 }
@@ -1454,8 +1723,9 @@ void display_usage(char *program)
 {
 	fprintf(stderr,
 		"Usage: %s [-a <i2c_adapter> [-l address ]] | [-s]"
-		" [-d <tty>] [-b <baudrate>]] [-u] [-e] [-U]"
-		" [-r <file>] [-w <file>] [-o offset] [-n length] [-g] [-p]"
+		" [-d <tty>] [-b <baudrate>] [-B]] [-u] [-e] [-U]"
+		" [-r <file>] [-w <file> [-S]] [-o offset] [-n length]"
+		" [-g] [-p]"
 		" [-L <log_file>] [-c] [-v]\n",
 		program);
 	fprintf(stderr, "Can access the controller via serial port or i2c\n");
@@ -1463,6 +1733,9 @@ void display_usage(char *program)
 	fprintf(stderr, "--d[evice] <tty> : use <tty> as the serial port\n");
 	fprintf(stderr, "--b[audrate] <baudrate> : set serial port speed "
 			"to <baudrate> bauds\n");
+	fprintf(stderr, "--B[atch] : send each memory command in a single "
+			"write.\n\tFaster, but only for bootloaders that never "
+			"overrun\n\ttheir UART receiver\n");
 	fprintf(stderr, "i2c mode:\n");
 	fprintf(stderr, "--a[dapter] <id> : use i2c adapter <id>.\n");
 	fprintf(stderr, "--l[ocation]  <address> : use address <address>.\n");
@@ -1475,6 +1748,8 @@ void display_usage(char *program)
 	fprintf(stderr, "--s[pi] </dev/spi> : use SPI adapter on </dev>.\n");
 	fprintf(stderr, "--w[rite] <file|-> : read <file> or\n\t"
 			"standard input and write it to flash\n");
+	fprintf(stderr, "--S[kip-identical] : with --write, only erase and "
+			"write the pages\n\tthat differ from <file>\n");
 	fprintf(stderr, "--o[ffset] : offset to read/write/start from/to\n");
 	fprintf(stderr, "--n[length] : amount to read/write\n");
 	fprintf(stderr, "--g[o] : jump to execute flash entrypoint\n");
@@ -1524,8 +1799,9 @@ int parse_parameters(int argc, char **argv)
 	int flags = 0;
 	const char *log_file_name = NULL;
 
-	while ((opt = getopt_long(argc, argv, "a:l:b:cd:eghL:n:o:pr:R:s:w:uUv?",
-				  longopts, &idx)) != -1) {
+	while ((opt = getopt_long(argc, argv,
+				  "a:l:Bb:cd:eghL:n:o:pr:R:s:Sw:uUv?", longopts,
+				  &idx)) != -1) {
 		switch (opt) {
 		case 'a':
 			i2c_adapter = atoi(optarg);
@@ -1534,6 +1810,9 @@ int parse_parameters(int argc, char **argv)
 		case 'l':
 			i2c_peripheral_address = strtol(optarg, NULL, 0);
 			break;
+		case 'B':
+			flags |= FLAG_BATCH;
+			break;
 		case 'b':
 			baudrate = parse_baudrate(optarg);
 			break;
@@ -1576,6 +1855,9 @@ int parse_parameters(int argc, char **argv)
 			spi_adapter = optarg;
 			mode = MODE_SPI;
 			break;
+		case 'S':
+			flags |= FLAG_SKIP_IDENTICAL;
+			break;
 		case 'w':
 			output_filename = optarg;
 			break;
@@ -1625,6 +1907,7 @@ int main(int argc, char **argv)
 	uint16_t flash_size_kbytes = 0;
 	uint8_t unique_device_id[STM32_UNIQUE_ID_SIZE_BYTES] = { 0 };
 	uint16_t package_data_reg = 0;
+	int skip_identical;
 
 	/* Parse command line options */
 	flags = parse_parameters(argc, argv);
@@ -1686,7 +1969,12 @@ int main(int argc, char **argv)
 	if (flags & FLAG_UNPROTECT)
 		command_write_unprotect(ser);
 
-	if (flags & FLAG_ERASE || output_filename) {
+	batch_commands = (flags & FLAG_BATCH) && mode == MODE_SERIAL;
+
+	/* Without a mass erase, the pages of the image are compared first */
+	skip_identical = output_filename && (flags & FLAG_SKIP_IDENTICAL);
+
+	if (flags & FLAG_ERASE || (output_filename && !skip_identical)) {
 		if ((!strncmp("STM32L15", chip->name, 8)) ||
 		    (!strncmp("STM32F411", chip->name, 9))) {
 			/* Mass erase is not supported on these chips*/
@@ -1710,7 +1998,11 @@ int main(int argc, char **argv)
 			goto terminate;
 	}
 
-	if (output_filename) {
+	if (output_filename && skip_identical) {
+		ret = write_flash_diff(ser, chip, output_filename, offset);
+		if (IS_STM32_ERROR(ret))
+			goto terminate;
+	} else if (output_filename) {
 		ret = write_flash(ser, chip, output_filename, offset);
 		if (IS_STM32_ERROR(ret))
 			goto terminate;
@@ -0,0 +1,305 @@
+#!/usr/bin/env python3
+# Copyright 2023 The ChromiumOS Authors
+# Use of this source code is governed by a BSD-style license that can be
+# found in the LICENSE file.
+
+"""Measure serial flash write throughput through a USB SPI bridge.
+
+Erases, programs and reads back a scratch region of the flash behind the
+bridge, once with each write answered after it is done on the SPI bus, and
+once with posted writes if the bridge supports them, and reports MB/s:
+
+    ./util/usb_spi_bench.py --pid 0x520e --offset 0x400000 --size 0x100000
+
+The region is overwritten: pick one the AP firmware does not use, or reflash
+it afterwards.
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+import usb  # pylint:disable=import-error
+
+
+USB_CLASS_VENDOR_SPEC = 0xFF
+USB_SUBCLASS_GOOGLE_SPI = 0x51
+USB_PROTOCOL_GOOGLE_SPI = 0x02
+
+USB_SPI_REQ_ENABLE = 0x0000
+USB_SPI_REQ_DISABLE = 0x0001
+
+PKT_ID_CMD_GET_USB_SPI_CONFIG = 0
+PKT_ID_RSP_USB_SPI_CONFIG = 1
+PKT_ID_CMD_TRANSFER_CONTINUE = 3
+PKT_ID_RSP_TRANSFER_START = 5
+PKT_ID_RSP_TRANSFER_CONTINUE = 6
+PKT_ID_CMD_FLASH_TRANSFER_START = 9
+
+FEATURE_FLASH_EXTENSIONS = 1 << 1
+FEATURE_POSTED_WRITES = 1 << 6
+
+FLASH_FLAG_OPCODE_LEN_POS = 0
+FLASH_FLAG_ADDR_LEN_POS = 2
+FLASH_FLAG_WRITE_ENABLE = 1 << 28
+FLASH_FLAG_POLL = 1 << 29
+FLASH_FLAG_POSTED = 1 << 30
+FLASH_FLAG_WRITE = 1 << 31
+
+# Payload sizes of USB_SPI_PKT_ID_CMD_FLASH_TRANSFER_START and continue
+# packets, see chip/stm32/usb_spi.h.
+FLASH_START_PAYLOAD = 56
+CONTINUE_PAYLOAD = 60
+
+JEDEC_WRITE_ENABLE = 0x06
+JEDEC_PAGE_PROGRAM = 0x02
+JEDEC_SECTOR_ERASE = 0x20
+JEDEC_READ = 0x03
+
+PAGE_SIZE = 256
+SECTOR_SIZE = 4096
+
+TIMEOUT_MS = 5000
+
+
+class UsbSpiError(Exception):
+    """The bridge answered a command with an error."""
+
+
+class UsbSpi:
+    """A flash behind the USB SPI bridge of a servo or a HyperDebug."""
+
+    def __init__(self, vendor, product, serialname, device):
+        self.device = device
+        self.dev = self._find(vendor, product, serialname)
+        self.intf = usb.util.find_descriptor(
+            self.dev.get_active_configuration(),
+            bInterfaceClass=USB_CLASS_VENDOR_SPEC,
+            bInterfaceSubClass=USB_SUBCLASS_GOOGLE_SPI,
+            bInterfaceProtocol=USB_PROTOCOL_GOOGLE_SPI,
+        )
+        if self.intf is None:
+            raise UsbSpiError("no USB SPI interface")
+        if self.dev.is_kernel_driver_active(self.intf.bInterfaceNumber):
+            self.dev.detach_kernel_driver(self.intf.bInterfaceNumber)
+        usb.util.claim_interface(self.dev, self.intf.bInterfaceNumber)
+        self.ep_out = usb.util.find_descriptor(
+            self.intf,
+            custom_match=lambda e: usb.util.endpoint_direction(
+                e.bEndpointAddress
+            )
+            == usb.util.ENDPOINT_OUT,
+        )
+        self.ep_in = usb.util.find_descriptor(
+            self.intf,
+            custom_match=lambda e: usb.util.endpoint_direction(
+                e.bEndpointAddress
+            )
+            == usb.util.ENDPOINT_IN,
+        )
+        self.max_write = 0
+        self.max_read = 0
+        self.features = 0
+
+    @staticmethod
+    def _find(vendor, product, serialname):
+        for dev in usb.core.find(
+            idVendor=vendor, idProduct=product, find_all=True
+        ):
+            if serialname is None or serialname == usb.util.get_string(
+                dev, dev.iSerialNumber
+            ):
+                return dev
+        raise UsbSpiError("USB device not found")
+
+    def _control(self, request):
+        self.dev.ctrl_transfer(
+            usb.util.CTRL_OUT
+            | usb.util.CTRL_TYPE_VENDOR
+            | usb.util.CTRL_RECIPIENT_INTERFACE,
+            request,
+            self.device,
+            self.intf.bInterfaceNumber,
+        )
+
+    def enable(self):
+        """Enable the bridge and read its configuration."""
+        self._control(USB_SPI_REQ_ENABLE)
+        self.ep_out.write(struct.pack("<H", PKT_ID_CMD_GET_USB_SPI_CONFIG))
+        rsp = bytes(self.ep_in.read(64, TIMEOUT_MS))
+        packet_id, self.max_write, self.max_read, self.features = (
+            struct.unpack("<HHHH", rsp[:8])
+        )
+        if packet_id != PKT_ID_RSP_USB_SPI_CONFIG:
+            raise UsbSpiError("bad configuration packet %d" % packet_id)
+        if not self.features & FEATURE_FLASH_EXTENSIONS:
+            raise UsbSpiError("no serial flash extensions")
+
+    def disable(self):
+        """Hand the SPI bus back."""
+        self._control(USB_SPI_REQ_DISABLE)
+
+    def flash_command(self, flags, payload, count):
+        """Send a flash command and return the data read, if any."""
+        self.ep_out.write(
+            struct.pack("<HHI", PKT_ID_CMD_FLASH_TRANSFER_START, count, flags)
+            + payload[:FLASH_START_PAYLOAD]
+        )
+        index = FLASH_START_PAYLOAD
+        while index < len(payload):
+            self.ep_out.write(
+                struct.pack("<HH", PKT_ID_CMD_TRANSFER_CONTINUE, index)
+                + payload[index : index + CONTINUE_PAYLOAD]
+            )
+            index += CONTINUE_PAYLOAD
+
+        rsp = bytes(self.ep_in.read(64, TIMEOUT_MS))
+        packet_id, status = struct.unpack("<HH", rsp[:4])
+        if packet_id != PKT_ID_RSP_TRANSFER_START:
+            raise UsbSpiError("bad response packet %d" % packet_id)
+        if status:
+            raise UsbSpiError("status 0x%04x" % status)
+        data = rsp[4:]
+        if flags & FLASH_FLAG_WRITE:
+            return data
+        while len(data) < count:
+            rsp = bytes(self.ep_in.read(64, TIMEOUT_MS))
+            packet_id, index = struct.unpack("<HH", rsp[:4])
+            if packet_id != PKT_ID_RSP_TRANSFER_CONTINUE or index != len(
+                data
+            ):
+                raise UsbSpiError("lost response packet")
+            data += rsp[4:]
+        return data[:count]
+
+    def erase(self, addr):
+        """Erase the 4 KiB sector at addr, waiting for it."""
+        self.flash_command(
+            FLASH_FLAG_WRITE
+            | FLASH_FLAG_WRITE_ENABLE
+            | FLASH_FLAG_POLL
+            | 1 << FLASH_FLAG_OPCODE_LEN_POS
+            | 3 << FLASH_FLAG_ADDR_LEN_POS,
+            bytes([JEDEC_WRITE_ENABLE, JEDEC_SECTOR_ERASE])
+            + addr.to_bytes(3, "big"),
+            0,
+        )
+
+    def program(self, addr, data, posted):
+        """Program a page, which the bridge may answer before it is done."""
+        flags = (
+            FLASH_FLAG_WRITE
+            | FLASH_FLAG_WRITE_ENABLE
+            | FLASH_FLAG_POLL
+            | 1 << FLASH_FLAG_OPCODE_LEN_POS
+            | 3 << FLASH_FLAG_ADDR_LEN_POS
+        )
+        if posted:
+            flags |= FLASH_FLAG_POSTED
+        self.flash_command(
+            flags,
+            bytes([JEDEC_WRITE_ENABLE, JEDEC_PAGE_PROGRAM])
+            + addr.to_bytes(3, "big")
+            + data,
+            len(data),
+        )
+
+    def read(self, addr, size):
+        """Read from the flash, which also waits for posted writes."""
+        data = b""
+        chunk = min(self.max_read, 4096)
+        while len(data) < size:
+            count = min(chunk, size - len(data))
+            data += self.flash_command(
+                1 << FLASH_FLAG_OPCODE_LEN_POS | 3 << FLASH_FLAG_ADDR_LEN_POS,
+                bytes([JEDEC_READ]) + (addr + len(data)).to_bytes(3, "big"),
+                count,
+            )
+        return data
+
+
+def run(bridge, offset, image, posted):
+    """Erase, program and verify, returning the time each phase took."""
+    start = time.monotonic()
+    for addr in range(offset, offset + len(image), SECTOR_SIZE):
+        bridge.erase(addr)
+    erased = time.monotonic()
+
+    for i in range(0, len(image), PAGE_SIZE):
+        bridge.program(offset + i, image[i : i + PAGE_SIZE], posted)
+    # The first read waits for the last posted writes, count it in
+    bridge.read(offset, 1)
+    programmed = time.monotonic()
+
+    if bridge.read(offset, len(image)) != image:
+        sys.exit("flash does not match what was written")
+    verified = time.monotonic()
+
+    return erased - start, programmed - erased, verified - programmed
+
+
+def main(argv):
+    """Run the throughput comparison."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("--vid", type=lambda x: int(x, 0), default=0x18D1)
+    parser.add_argument("--pid", type=lambda x: int(x, 0), required=True)
+    parser.add_argument("--serial", help="serial number of the bridge")
+    parser.add_argument(
+        "--device", type=int, default=0, help="index of the SPI device"
+    )
+    parser.add_argument(
+        "--offset",
+        type=lambda x: int(x, 0),
+        required=True,
+        help="start of the scratch region, 4 KiB aligned",
+    )
+    parser.add_argument(
+        "--size",
+        type=lambda x: int(x, 0),
+        default=256 * 1024,
+        help="size of the scratch region",
+    )
+    args = parser.parse_args(argv)
+
+    if args.offset % SECTOR_SIZE or args.size % SECTOR_SIZE:
+        sys.exit("offset and size must be multiples of 4 KiB")
+    if args.offset + args.size > 1 << 24:
+        sys.exit("only 3-byte addresses are supported")
+
+    bridge = UsbSpi(args.vid, args.pid, args.serial, args.device)
+    bridge.enable()
+    try:
+        modes = [("serial", False)]
+        if bridge.features & FEATURE_POSTED_WRITES:
+            modes.append(("posted", True))
+        else:
+            print("bridge does not support posted writes")
+
+        for label, posted in modes:
+            # Something different each pass, so that every bit is written
+            image = bytes(
+                (i * 7 + (i >> 8) + len(label)) & 0xFF
+                for i in range(args.size)
+            )
+            erase_s, program_s, verify_s = run(
+                bridge, args.offset, image, posted
+            )
+            print(
+                "%-8s erase %6.2f s, program %6.2f s (%5.3f MB/s), "
+                "read %6.2f s (%5.3f MB/s)"
+                % (
+                    label,
+                    erase_s,
+                    program_s,
+                    args.size / program_s / 1e6,
+                    verify_s,
+                    args.size / verify_s / 1e6,
+                )
+            )
+    finally:
+        bridge.disable()
+
+
+if __name__ == "__main__":
+    main(sys.argv[1:])
@@ -23,8 +23,6 @@ struct sha256_ctx {
 	uint32_t k[64];
 } __aligned(256);
 
-void SHA256_abort(struct sha256_ctx *ctx);
-
 #ifdef CONFIG_ZTEST
 extern uint8_t it8xxx2_sha256_get_sha1hbaddr(void);
 extern uint8_t it8xxx2_sha256_get_sha2hbaddr(void);
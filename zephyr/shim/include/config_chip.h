@@ -350,6 +350,16 @@
 #define CONFIG_CHARGER_RUNTIME_CONFIG
 #endif
 
+#undef CONFIG_CHARGER_SHADOW_REGS
+#ifdef CONFIG_PLATFORM_EC_CHARGER_SHADOW_REGS
+#define CONFIG_CHARGER_SHADOW_REGS
+#endif
+
+#undef CONFIG_CHARGER_STEADY_STATE_POLL
+#ifdef CONFIG_PLATFORM_EC_CHARGER_STEADY_STATE_POLL
+#define CONFIG_CHARGER_STEADY_STATE_POLL
+#endif
+
 /*
  * Note - ISL9241 chargers for all channels are configured with the same
  * switching frequency set with the Kconfig config.
@@ -1174,6 +1184,12 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #define CONFIG_CHARGER_SENSE_RESISTOR_AC 10
 #endif /* CONFIG_PLATFORM_EC_CHARGE_MANAGER */
 
+#undef CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS
+#ifdef CONFIG_PLATFORM_EC_CHARGE_MANAGER_REFRESH_DELAY_MS
+#define CONFIG_CHARGE_MANAGER_REFRESH_DELAY_MS \
+	CONFIG_PLATFORM_EC_CHARGE_MANAGER_REFRESH_DELAY_MS
+#endif
+
 #undef CONFIG_CHARGER
 #ifdef CONFIG_PLATFORM_EC_CHARGER
 #define CONFIG_CHARGER
@@ -1472,6 +1488,16 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 	CONFIG_PLATFORM_EC_USB_PD_PRL_EVENT_LOG_CAPACITY
 #endif
 
+#undef CONFIG_USB_PD_SM_TRACE
+#ifdef CONFIG_PLATFORM_EC_USB_PD_SM_TRACE
+#define CONFIG_USB_PD_SM_TRACE
+#endif
+
+#undef CONFIG_USB_PD_SM_TRACE_SIZE
+#ifdef CONFIG_PLATFORM_EC_USB_PD_SM_TRACE_SIZE
+#define CONFIG_USB_PD_SM_TRACE_SIZE CONFIG_PLATFORM_EC_USB_PD_SM_TRACE_SIZE
+#endif
+
 #undef CONFIG_USBC_OCP
 #ifdef CONFIG_PLATFORM_EC_USBC_OCP
 #define CONFIG_USBC_OCP
@@ -1549,6 +1575,11 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #define CONFIG_USB_DPM_SM
 #endif
 
+#undef CONFIG_USBC_SM_SKIP_IDLE
+#ifdef CONFIG_PLATFORM_EC_USBC_SM_SKIP_IDLE
+#define CONFIG_USBC_SM_SKIP_IDLE
+#endif
+
 #undef CONFIG_USB_PD_DECODE_SOP
 #ifdef CONFIG_PLATFORM_EC_USB_PD_DECODE_SOP
 #define CONFIG_USB_PD_DECODE_SOP
@@ -1705,6 +1736,10 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #if CONFIG_USB_PD_PORT_MAX_COUNT > 0
 #define HAS_TASK_PD_C0 1
 
+#ifdef CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT
+#define HAS_TASK_USB_MUX_C0 1
+#endif /* CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT */
+
 #ifndef CONFIG_PLATFORM_EC_USB_PD_PORT_0_SHARED
 #define HAS_TASK_PD_INT_C0 1
 #endif /* !CONFIG_PLATFORM_EC_USB_PD_PORT_0_SHARED */
@@ -1715,6 +1750,10 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #if CONFIG_USB_PD_PORT_MAX_COUNT > 1
 #define HAS_TASK_PD_C1 1
 
+#ifdef CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT
+#define HAS_TASK_USB_MUX_C1 1
+#endif /* CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT */
+
 #ifndef CONFIG_PLATFORM_EC_USB_PD_PORT_1_SHARED
 #define HAS_TASK_PD_INT_C1 1
 #endif /* !CONFIG_PLATFORM_EC_USB_PD_PORT_1_SHARED */
@@ -1725,6 +1764,10 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #if CONFIG_USB_PD_PORT_MAX_COUNT > 2
 #define HAS_TASK_PD_C2 1
 
+#ifdef CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT
+#define HAS_TASK_USB_MUX_C2 1
+#endif /* CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT */
+
 #ifndef CONFIG_PLATFORM_EC_USB_PD_PORT_2_SHARED
 #define HAS_TASK_PD_INT_C2 1
 #endif /* !CONFIG_PLATFORM_EC_USB_PD_PORT_2_SHARED */
@@ -1735,6 +1778,10 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #if CONFIG_USB_PD_PORT_MAX_COUNT > 3
 #define HAS_TASK_PD_C3 1
 
+#ifdef CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT
+#define HAS_TASK_USB_MUX_C3 1
+#endif /* CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT */
+
 #ifndef CONFIG_PLATFORM_EC_USB_PD_PORT_3_SHARED
 #define HAS_TASK_PD_INT_C3 1
 #endif /* !CONFIG_PLATFORM_EC_USB_PD_PORT_3_SHARED */
@@ -1857,6 +1904,19 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #define CONFIG_USB_PD_DISCOVERY
 #endif
 
+#undef CONFIG_USB_PD_DISCOVERY_CACHE
+#undef CONFIG_USB_PD_DISCOVERY_CACHE_SIZE
+#ifdef CONFIG_PLATFORM_EC_USB_PD_DISCOVERY_CACHE
+#define CONFIG_USB_PD_DISCOVERY_CACHE
+#define CONFIG_USB_PD_DISCOVERY_CACHE_SIZE \
+	CONFIG_PLATFORM_EC_USB_PD_DISCOVERY_CACHE_SIZE
+#endif
+
+#undef CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+#ifdef CONFIG_PLATFORM_EC_USB_PD_DISCOVERY_CACHE_SYSJUMP
+#define CONFIG_USB_PD_DISCOVERY_CACHE_SYSJUMP
+#endif
+
 #undef CONFIG_USB_PD_DPS
 #ifdef CONFIG_PLATFORM_EC_USB_PD_DPS
 #define CONFIG_USB_PD_DPS
@@ -1951,6 +2011,11 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #define CONFIG_USBC_SS_MUX_DFP_ONLY
 #endif
 
+#undef CONFIG_USB_MUX_SHADOW_STATE
+#ifdef CONFIG_PLATFORM_EC_USB_MUX_SHADOW_STATE
+#define CONFIG_USB_MUX_SHADOW_STATE
+#endif
+
 #undef CONFIG_USB_MUX_AP_CONTROL
 #ifdef CONFIG_PLATFORM_EC_USB_MUX_AP_CONTROL
 #define CONFIG_USB_MUX_AP_CONTROL
@@ -2020,6 +2085,11 @@ extern char mock_jump_data[CONFIG_PLATFORM_EC_PRESERVED_END_OF_RAM_SIZE];
 #define CONFIG_MKBP_EVENT
 #endif
 
+#undef CONFIG_MKBP_EVENT_BATCH
+#ifdef CONFIG_PLATFORM_EC_MKBP_EVENT_BATCH
+#define CONFIG_MKBP_EVENT_BATCH
+#endif
+
 #undef CONFIG_MKBP_USE_GPIO
 #ifdef CONFIG_PLATFORM_EC_MKBP_USE_GPIO
 #define CONFIG_MKBP_USE_GPIO
@@ -2440,6 +2510,20 @@ BUILD_ASSERT((DT_NUM_INST_STATUS_OKAY(maxim_max695x)) == 1,
 #define CONFIG_HOSTCMD_GET_UPTIME_INFO
 #endif
 
+#undef CONFIG_HOSTCMD_STATS
+#undef CONFIG_HOSTCMD_STATS_SLOTS
+#ifdef CONFIG_PLATFORM_EC_HOSTCMD_STATS
+#define CONFIG_HOSTCMD_STATS
+#define CONFIG_HOSTCMD_STATS_SLOTS CONFIG_PLATFORM_EC_HOSTCMD_STATS_SLOTS
+#endif
+
+#undef CONFIG_HOOK_INIT_TIMES
+#undef CONFIG_HOOK_INIT_TIMES_SLOTS
+#ifdef CONFIG_PLATFORM_EC_HOOK_INIT_TIMES
+#define CONFIG_HOOK_INIT_TIMES
+#define CONFIG_HOOK_INIT_TIMES_SLOTS CONFIG_PLATFORM_EC_HOOK_INIT_TIMES_SLOTS
+#endif
+
 #undef CONFIG_CMD_AP_RESET_LOG
 #ifdef CONFIG_PLATFORM_EC_AP_RESET_LOG
 #define CONFIG_CMD_AP_RESET_LOG
@@ -3090,6 +3174,11 @@ BUILD_ASSERT((DT_NUM_INST_STATUS_OKAY(mps_mp2964)) == 1,
 #define CONFIG_SYSTEM_SAFE_MODE
 #endif
 
+#undef CONFIG_SYSJUMP_WARM_STATE
+#ifdef CONFIG_PLATFORM_EC_SYSJUMP_WARM_STATE
+#define CONFIG_SYSJUMP_WARM_STATE
+#endif
+
 #undef CONFIG_SYSTEM_SAFE_MODE_TIMEOUT_MSEC
 #ifdef CONFIG_PLATFORM_EC_SYSTEM_SAFE_MODE_TIMEOUT_MSEC
 #define CONFIG_SYSTEM_SAFE_MODE_TIMEOUT_MSEC \
@@ -18,6 +18,4 @@ struct sha256_ctx {
 	struct hash_ctx hash_sha256;
 } __aligned(4);
 
-void SHA256_abort(struct sha256_ctx *ctx);
-
 #endif /* __CROS_EC_SHA256_CHIP_H */
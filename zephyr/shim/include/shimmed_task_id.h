@@ -96,6 +96,22 @@ enum {
 		   (CROS_EC_TASK(USB_MUX, usb_mux_task, 0,                 \
 				 CONFIG_TASK_USB_MUX_STACK_SIZE,           \
 				 EC_TASK_USB_MUX_PRIO)))                   \
+	IF_ENABLED(HAS_TASK_USB_MUX_C0,                                    \
+		   (CROS_EC_TASK(USB_MUX_C0, usb_mux_port_task, 0,         \
+				 CONFIG_TASK_USB_MUX_STACK_SIZE,           \
+				 EC_TASK_USB_MUX_PRIO)))                   \
+	IF_ENABLED(HAS_TASK_USB_MUX_C1,                                    \
+		   (CROS_EC_TASK(USB_MUX_C1, usb_mux_port_task, 1,         \
+				 CONFIG_TASK_USB_MUX_STACK_SIZE,           \
+				 EC_TASK_USB_MUX_PRIO)))                   \
+	IF_ENABLED(HAS_TASK_USB_MUX_C2,                                    \
+		   (CROS_EC_TASK(USB_MUX_C2, usb_mux_port_task, 2,         \
+				 CONFIG_TASK_USB_MUX_STACK_SIZE,           \
+				 EC_TASK_USB_MUX_PRIO)))                   \
+	IF_ENABLED(HAS_TASK_USB_MUX_C3,                                    \
+		   (CROS_EC_TASK(USB_MUX_C3, usb_mux_port_task, 3,         \
+				 CONFIG_TASK_USB_MUX_STACK_SIZE,           \
+				 EC_TASK_USB_MUX_PRIO)))                   \
 	COND_CODE_1(CONFIG_TASK_HOSTCMD_THREAD_DEDICATED,                  \
 		    (CROS_EC_TASK(HOSTCMD, host_command_task, 0,           \
 				  CONFIG_TASK_HOSTCMD_STACK_SIZE,          \
@@ -43,7 +43,9 @@
 #define HAS_TASK_POWERBTN 1
 #endif /* CONFIG_HAS_TASK_POWERBTN */
 
-#ifdef CONFIG_PLATFORM_EC_USB_MUX_TASK
+/* Per-port USB_MUX_C<n> tasks are defined along with the PD tasks */
+#if defined(CONFIG_PLATFORM_EC_USB_MUX_TASK) && \
+	!defined(CONFIG_PLATFORM_EC_USB_MUX_TASK_PER_PORT)
 #define HAS_TASK_USB_MUX 1
 #endif /* CONFIG_PLATFORM_EC_USB_MUX_TASK */
 
@@ -67,8 +67,22 @@ static int eeprom_store(uint8_t *cbi)
 			    ((struct cbi_header *)cbi)->total_size);
 }
 
+static int eeprom_store_range(uint8_t *cbi, int offset, int len)
+{
+	const struct device *dev;
+
+	dev = DEVICE_DT_GET(CBI_EEPROM_NODE);
+
+	if (!device_is_ready(dev)) {
+		return -ENODEV;
+	}
+
+	return eeprom_write(dev, offset, cbi + offset, len);
+}
+
 static const struct cbi_storage_driver eeprom_drv = {
 	.store = eeprom_store,
+	.store_range = eeprom_store_range,
 	.load = eeprom_load,
 	.is_protected = eeprom_is_write_protected,
 };
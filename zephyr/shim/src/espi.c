@@ -639,14 +639,17 @@ static void kbc_ibf_obe_handler(uint32_t data)
 
 	if (is_ibf) {
 		keyboard_host_write(get_8042_data(data), get_8042_type(data));
-	} else if (IS_ENABLED(CONFIG_8042_AUX)) {
+		return;
+	}
+
+	if (IS_ENABLED(CONFIG_8042_AUX)) {
 		rv = espi_write_lpc_request(espi_dev, E8042_CLEAR_FLAG,
 					    &status);
 		if (rv) {
 			LOG_ERR("ESPI write failed: E8042_CLEAR_FLAG = %d", rv);
 		}
 	}
-	task_wake(TASK_ID_KEYPROTO);
+	keyboard_host_read();
 #endif
 }
 
@@ -151,7 +151,12 @@ void hook_notify(enum hook_type type)
 		/* Call each handler with the located priority */
 		for (const struct zephyr_shim_hook_info *p = start; p != end;
 		     p++) {
-			if (p->priority == prio)
+			if (p->priority != prio)
+				continue;
+			if (IS_ENABLED(CONFIG_HOOK_INIT_TIMES) &&
+			    type == HOOK_INIT)
+				hook_call_init_timed(p->routine, prio);
+			else
 				p->routine();
 		}
 	};